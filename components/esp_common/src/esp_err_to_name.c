@@ -231,6 +231,10 @@ static const esp_err_msg_t esp_err_msg_table[] = {
                                                                                 with generic flash encryption. This is
                                                                                 forbidden since the NVS encryption works
                                                                                 differently. */
+#   endif
+#   ifdef      ESP_ERR_NVS_TRANSACTION_TOO_BIG
+    ERR_TBL_IT(ESP_ERR_NVS_TRANSACTION_TOO_BIG),                /*  4378 0x111a Values staged in a write transaction
+                                                                                don't fit into a single page */
 #   endif
     // components/ulp/ulp_fsm/include/ulp_fsm_common.h
 #   ifdef      ESP_ERR_ULP_BASE
@@ -34,6 +34,9 @@
                                         } while(0);
 #endif
 
+// Number of buckets of the dispatch table of a loop when the first event gets dispatched
+#define DISPATCH_TABLE_INITIAL_SIZE   16
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
@@ -123,21 +126,15 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
     start = esp_timer_get_time();
 #endif
     // Execute the handler
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     void* data_ptr = NULL;
 
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
-        } else {
-            data_ptr = &post.data.val;
-        }
+    if (post.data_type == ESP_EVENT_POST_DATA_INLINE) {
+        data_ptr = &post.data.val;
+    } else if (post.data_type != ESP_EVENT_POST_DATA_NONE) {
+        data_ptr = post.data.ptr;
     }
 
     (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
-#else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
-#endif
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
@@ -151,7 +148,364 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
 #endif
 }
 
-static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_event_handler_t event_handler, void* event_handler_arg, esp_event_handler_instance_context_t **handler_ctx, bool legacy)
+// Collect the handlers executed for an event, in the order they are dispatched. Returns the number of handlers,
+// of which at most size are stored to nodes.
+static uint32_t loop_collect_handlers(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id,
+        esp_event_handler_node_t** nodes, uint32_t size)
+{
+    esp_event_handler_node_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+    uint32_t num = 0;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            if (num < size) {
+                nodes[num] = handler;
+            }
+            num++;
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    if (num < size) {
+                        nodes[num] = handler;
+                    }
+                    num++;
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            if (num < size) {
+                                nodes[num] = handler;
+                            }
+                            num++;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return num;
+}
+
+static inline uint32_t dispatch_hash(esp_event_base_t base, int32_t id)
+{
+    uint32_t hash = (uint32_t) (uintptr_t) base ^ ((uint32_t) id * 0x9e3779b1U);
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6dU;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+static esp_event_dispatch_entry_t* dispatch_entry_find(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    if (loop->dispatch_table == NULL) {
+        return NULL;
+    }
+
+    esp_event_dispatch_entry_t* entry;
+    SLIST_FOREACH(entry, &(loop->dispatch_table[dispatch_hash(base, id) & (loop->dispatch_table_size - 1)]), next) {
+        if (entry->base == base && entry->id == id) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void dispatch_table_grow(esp_event_loop_instance_t* loop)
+{
+    uint32_t size = loop->dispatch_table_size * 2;
+    esp_event_dispatch_entries_t* table = malloc(size * sizeof(*table));
+
+    if (table == NULL) {
+        // Keep the current table, lookups just get slower
+        return;
+    }
+
+    for (uint32_t i = 0; i < size; i++) {
+        SLIST_INIT(&(table[i]));
+    }
+
+    for (uint32_t i = 0; i < loop->dispatch_table_size; i++) {
+        while (!SLIST_EMPTY(&(loop->dispatch_table[i]))) {
+            esp_event_dispatch_entry_t* entry = SLIST_FIRST(&(loop->dispatch_table[i]));
+            SLIST_REMOVE_HEAD(&(loop->dispatch_table[i]), next);
+            SLIST_INSERT_HEAD(&(table[dispatch_hash(entry->base, entry->id) & (size - 1)]), entry, next);
+        }
+    }
+
+    free(loop->dispatch_table);
+    loop->dispatch_table = table;
+    loop->dispatch_table_size = size;
+}
+
+// Get the dispatch entry of an event, building it from the registered handlers the first time the event is
+// dispatched. Events with no handlers get no entry, *entry is then NULL: the table only holds events which
+// are handled, it does not grow with the number of distinct events posted.
+static esp_err_t dispatch_entry_get(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_dispatch_entry_t** entry)
+{
+    *entry = dispatch_entry_find(loop, base, id);
+
+    if (*entry != NULL) {
+        return ESP_OK;
+    }
+
+    uint32_t num = loop_collect_handlers(loop, base, id, NULL, 0);
+
+    if (num == 0) {
+        return ESP_OK;
+    }
+
+    if (loop->dispatch_table == NULL) {
+        loop->dispatch_table = malloc(DISPATCH_TABLE_INITIAL_SIZE * sizeof(*(loop->dispatch_table)));
+        if (loop->dispatch_table == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        for (uint32_t i = 0; i < DISPATCH_TABLE_INITIAL_SIZE; i++) {
+            SLIST_INIT(&(loop->dispatch_table[i]));
+        }
+        loop->dispatch_table_size = DISPATCH_TABLE_INITIAL_SIZE;
+    }
+
+    esp_event_dispatch_entry_t* new_entry = calloc(1, sizeof(*new_entry));
+    if (new_entry == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    new_entry->handlers = malloc(num * sizeof(*(new_entry->handlers)));
+    if (new_entry->handlers == NULL) {
+        free(new_entry);
+        return ESP_ERR_NO_MEM;
+    }
+    loop_collect_handlers(loop, base, id, new_entry->handlers, num);
+
+    new_entry->base = base;
+    new_entry->id = id;
+    new_entry->handlers_num = num;
+    new_entry->handlers_size = num;
+
+    SLIST_INSERT_HEAD(&(loop->dispatch_table[dispatch_hash(base, id) & (loop->dispatch_table_size - 1)]), new_entry, next);
+
+    if (++loop->dispatch_entries > loop->dispatch_table_size) {
+        dispatch_table_grow(loop);
+    }
+
+    *entry = new_entry;
+    return ESP_OK;
+}
+
+static esp_err_t dispatch_entry_append(esp_event_dispatch_entry_t* entry, esp_event_handler_node_t* handler)
+{
+    if (entry->handlers_num == entry->handlers_size) {
+        uint32_t size = entry->handlers_size ? entry->handlers_size * 2 : 2;
+        esp_event_handler_node_t** handlers = realloc(entry->handlers, size * sizeof(*handlers));
+
+        if (handlers == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        entry->handlers = handlers;
+        entry->handlers_size = size;
+    }
+
+    entry->handlers[entry->handlers_num++] = handler;
+
+    return ESP_OK;
+}
+
+// Delete an entry whose last handler got unregistered, so that it is built again if the event gets handled again
+static void dispatch_entry_delete(esp_event_loop_instance_t* loop, esp_event_dispatch_entry_t* entry)
+{
+    // Dispatches of the entry in progress have no handler left to execute, do not let them match a new entry
+    for (esp_event_dispatch_t* dispatch = loop->dispatch; dispatch != NULL; dispatch = dispatch->prev) {
+        if (dispatch->entry == entry) {
+            dispatch->entry = NULL;
+        }
+    }
+
+    SLIST_REMOVE(&(loop->dispatch_table[dispatch_hash(entry->base, entry->id) & (loop->dispatch_table_size - 1)]),
+            entry, esp_event_dispatch_entry, next);
+    loop->dispatch_entries--;
+    free(entry->handlers);
+    free(entry);
+}
+
+static void dispatch_entry_remove(esp_event_loop_instance_t* loop, esp_event_dispatch_entry_t* entry, esp_event_handler_node_t* handler)
+{
+    for (int32_t i = 0; i < (int32_t) entry->handlers_num; i++) {
+        if (entry->handlers[i] == handler) {
+            memmove(&(entry->handlers[i]), &(entry->handlers[i + 1]), (entry->handlers_num - i - 1) * sizeof(*(entry->handlers)));
+            entry->handlers_num--;
+
+            // Keep dispatches of this entry in progress on the handlers that follow
+            for (esp_event_dispatch_t* dispatch = loop->dispatch; dispatch != NULL; dispatch = dispatch->prev) {
+                if (dispatch->entry == entry) {
+                    if (i < dispatch->end) {
+                        dispatch->end--;
+                    }
+                    if (i <= dispatch->index) {
+                        dispatch->index--;
+                    }
+                }
+            }
+
+            if (entry->handlers_num == 0) {
+                dispatch_entry_delete(loop, entry);
+            }
+            return;
+        }
+    }
+}
+
+// Add a newly registered handler to the dispatch entries of the events it handles. Since a handler registered
+// later is always dispatched after the ones registered before it, it is appended. Entries of events which have
+// not been dispatched yet are built on their first dispatch.
+static esp_err_t dispatch_table_add(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t* handler)
+{
+    if (id != ESP_EVENT_ANY_ID) {
+        esp_event_dispatch_entry_t* entry = dispatch_entry_find(loop, base, id);
+        return entry != NULL ? dispatch_entry_append(entry, handler) : ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < loop->dispatch_table_size; i++) {
+        esp_event_dispatch_entry_t* entry;
+        SLIST_FOREACH(entry, &(loop->dispatch_table[i]), next) {
+            if (base == esp_event_any_base || entry->base == base) {
+                esp_err_t err = dispatch_entry_append(entry, handler);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+static void dispatch_table_remove(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t* handler)
+{
+    if (id != ESP_EVENT_ANY_ID) {
+        esp_event_dispatch_entry_t* entry = dispatch_entry_find(loop, base, id);
+        if (entry != NULL) {
+            dispatch_entry_remove(loop, entry, handler);
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < loop->dispatch_table_size; i++) {
+        esp_event_dispatch_entry_t *entry, *temp;
+        SLIST_FOREACH_SAFE(entry, &(loop->dispatch_table[i]), next, temp) {
+            if (base == esp_event_any_base || entry->base == base) {
+                dispatch_entry_remove(loop, entry, handler);
+            }
+        }
+    }
+}
+
+static void dispatch_table_delete(esp_event_loop_instance_t* loop)
+{
+    for (uint32_t i = 0; i < loop->dispatch_table_size; i++) {
+        while (!SLIST_EMPTY(&(loop->dispatch_table[i]))) {
+            esp_event_dispatch_entry_t* entry = SLIST_FIRST(&(loop->dispatch_table[i]));
+            SLIST_REMOVE_HEAD(&(loop->dispatch_table[i]), next);
+            free(entry->handlers);
+            free(entry);
+        }
+    }
+
+    free(loop->dispatch_table);
+    loop->dispatch_table = NULL;
+    loop->dispatch_table_size = 0;
+    loop->dispatch_entries = 0;
+}
+
+// Execute the handlers of a post by walking the registered handlers, used when there is not enough memory
+// to build the dispatch entry of the event
+static bool loop_dispatch_unindexed(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    bool exec = false;
+
+    esp_event_handler_node_t *handler, *temp_handler;
+    esp_event_loop_node_t *loop_node, *temp_node;
+    esp_event_base_node_t *base_node, *temp_base;
+    esp_event_id_node_t *id_node, *temp_id_node;
+
+    SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
+        // Execute loop level handlers
+        SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
+            handler_execute(loop, handler, *post);
+            exec |= true;
+        }
+
+        SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
+            if (base_node->base == post->base) {
+                // Execute base level handlers
+                SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
+                    handler_execute(loop, handler, *post);
+                    exec |= true;
+                }
+
+                SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
+                    if (id_node->id == post->id) {
+                        // Execute id level handlers
+                        SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
+                            handler_execute(loop, handler, *post);
+                            exec |= true;
+                        }
+                        // Skip to next base node
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return exec;
+}
+
+// Execute the handlers of a post, returns whether there were any
+static bool loop_dispatch(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    esp_event_dispatch_entry_t* entry;
+
+    if (dispatch_entry_get(loop, post->base, post->id, &entry) != ESP_OK) {
+        return loop_dispatch_unindexed(loop, post);
+    }
+
+    if (entry == NULL) {
+        return false;
+    }
+
+    // Handlers registered while dispatching are executed from the next post of the event on
+    esp_event_dispatch_t dispatch = {
+        .entry = entry,
+        .index = 0,
+        .end = (int32_t) entry->handlers_num,
+        .prev = loop->dispatch
+    };
+    bool exec = dispatch.end > 0;
+
+    loop->dispatch = &dispatch;
+
+    for (; dispatch.index < dispatch.end; dispatch.index++) {
+        handler_execute(loop, entry->handlers[dispatch.index], *post);
+    }
+
+    loop->dispatch = dispatch.prev;
+
+    return exec;
+}
+
+static esp_err_t handler_instances_add(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_base_t base, int32_t id,
+        esp_event_handler_t event_handler, void* event_handler_arg, esp_event_handler_instance_context_t **handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *handler_instance = calloc(1, sizeof(*handler_instance));
 
@@ -168,25 +522,32 @@ static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_
     context->arg = event_handler_arg;
     handler_instance->handler_ctx = context;
 
-    if (SLIST_EMPTY(handlers)) {
-        SLIST_INSERT_HEAD(handlers, handler_instance, next);
-    }
-    else {
-        esp_event_handler_node_t *it = NULL, *last = NULL;
-
-        SLIST_FOREACH(it, handlers, next) {
-            if (legacy) {
-                if(event_handler == it->handler_ctx->handler) {
-                    it->handler_ctx->arg = event_handler_arg;
-                    ESP_LOGW(TAG, "handler already registered, overwriting");
-                    free(handler_instance);
-                    free(context);
-                    return ESP_OK;
-                }
+    esp_event_handler_node_t *it = NULL, *last = NULL;
+
+    SLIST_FOREACH(it, handlers, next) {
+        if (legacy) {
+            if(event_handler == it->handler_ctx->handler) {
+                it->handler_ctx->arg = event_handler_arg;
+                ESP_LOGW(TAG, "handler already registered, overwriting");
+                free(handler_instance);
+                free(context);
+                return ESP_OK;
             }
-            last = it;
         }
+        last = it;
+    }
 
+    if (dispatch_table_add(loop, base, id, handler_instance) != ESP_OK) {
+        dispatch_table_remove(loop, base, id, handler_instance);
+        free(handler_instance);
+        free(context);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!last) {
+        SLIST_INSERT_HEAD(handlers, handler_instance, next);
+    }
+    else {
         SLIST_INSERT_AFTER(last, handler_instance, next);
     }
 
@@ -199,7 +560,8 @@ static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_
     return ESP_OK;
 }
 
-static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
+static esp_err_t base_node_add_handler(esp_event_loop_instance_t* loop,
+        esp_event_base_node_t* base_node,
         int32_t id,
         esp_event_handler_t event_handler,
         void *event_handler_arg,
@@ -207,7 +569,7 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
         bool legacy)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_add(&(base_node->handlers), event_handler, event_handler_arg, handler_ctx, legacy);
+        return handler_instances_add(loop, &(base_node->handlers), base_node->base, id, event_handler, event_handler_arg, handler_ctx, legacy);
     }
     else {
         esp_err_t err = ESP_OK;
@@ -232,7 +594,7 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
 
             SLIST_INIT(&(id_node->handlers));
 
-            err = handler_instances_add(&(id_node->handlers), event_handler, event_handler_arg, handler_ctx, legacy);
+            err = handler_instances_add(loop, &(id_node->handlers), base_node->base, id, event_handler, event_handler_arg, handler_ctx, legacy);
 
             if (err == ESP_OK) {
                 if (!last_id_node) {
@@ -248,12 +610,13 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
             return err;
         }
         else {
-            return handler_instances_add(&(id_node->handlers), event_handler, event_handler_arg, handler_ctx, legacy);
+            return handler_instances_add(loop, &(id_node->handlers), base_node->base, id, event_handler, event_handler_arg, handler_ctx, legacy);
         }
     }
 }
 
-static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
+static esp_err_t loop_node_add_handler(esp_event_loop_instance_t* loop,
+        esp_event_loop_node_t* loop_node,
         esp_event_base_t base,
         int32_t id,
         esp_event_handler_t event_handler,
@@ -262,7 +625,7 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
         bool legacy)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_add(&(loop_node->handlers), event_handler, event_handler_arg, handler_ctx, legacy);
+        return handler_instances_add(loop, &(loop_node->handlers), base, id, event_handler, event_handler_arg, handler_ctx, legacy);
     }
     else {
         esp_err_t err = ESP_OK;
@@ -291,7 +654,7 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
             SLIST_INIT(&(base_node->handlers));
             SLIST_INIT(&(base_node->id_nodes));
 
-            err = base_node_add_handler(base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
+            err = base_node_add_handler(loop, base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
 
             if (err == ESP_OK) {
                 if (!last_base_node) {
@@ -306,12 +669,13 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
 
             return err;
         } else {
-            return base_node_add_handler(base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
+            return base_node_add_handler(loop, base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
         }
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t handler_instances_remove(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_base_t base, int32_t id,
+        esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *it, *temp;
 
@@ -319,6 +683,7 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
         if (legacy) {
             if (it->handler_ctx->handler == handler_ctx->handler) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
+                dispatch_table_remove(loop, base, id, it);
                 free(it->handler_ctx);
                 free(it);
                 return ESP_OK;
@@ -326,6 +691,7 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
         } else {
             if (it->handler_ctx == handler_ctx) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
+                dispatch_table_remove(loop, base, id, it);
                 free(it->handler_ctx);
                 free(it);
                 return ESP_OK;
@@ -337,16 +703,16 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
 }
 
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t base_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(base_node->handlers), base_node->base, id, handler_ctx, legacy);
     }
     else {
         esp_event_id_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
             if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy);
+                esp_err_t res = handler_instances_remove(loop, &(it->handlers), base_node->base, id, handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers))) {
@@ -362,16 +728,16 @@ static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int3
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t loop_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(loop_node->handlers), base, id, handler_ctx, legacy);
     }
     else {
         esp_event_base_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
             if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy);
+                esp_err_t res = base_node_remove_handler(loop, it, id, handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
@@ -421,15 +787,36 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+// Take a free slot of the loop post pool, NULL if there is none
+static void* post_pool_alloc(esp_event_loop_instance_t* loop, size_t size)
 {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    if (post->data_allocated && post->data.ptr) {
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    if (size > ESP_EVENT_POST_POOL_SLOT_SIZE) {
+        return NULL;
+    }
+
+    uint32_t free_slots = atomic_load(&loop->pool_free);
+    while (free_slots != 0) {
+        uint32_t slot = __builtin_ctz(free_slots);
+        if (atomic_compare_exchange_weak(&loop->pool_free, &free_slots, free_slots & ~(1U << slot))) {
+            return loop->pool + slot * ESP_EVENT_POST_POOL_SLOT_SIZE;
+        }
+    }
+
+    atomic_fetch_add(&loop->pool_exhausted, 1);
+#endif
+    return NULL;
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    if (post->data_type == ESP_EVENT_POST_DATA_HEAP) {
         free(post->data.ptr);
     }
-#else
-    if (post->data) {
-        free(post->data);
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    else if (post->data_type == ESP_EVENT_POST_DATA_POOL) {
+        uint32_t slot = ((uint8_t*) post->data.ptr - loop->pool) / ESP_EVENT_POST_POOL_SLOT_SIZE;
+        atomic_fetch_or(&loop->pool_free, 1U << slot);
     }
 #endif
     memset(post, 0, sizeof(*post));
@@ -470,6 +857,15 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         goto on_err;
     }
 
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    loop->pool = malloc(CONFIG_ESP_EVENT_POST_POOL_SIZE * ESP_EVENT_POST_POOL_SLOT_SIZE);
+    if (loop->pool == NULL) {
+        ESP_LOGE(TAG, "alloc for event loop post pool failed");
+        goto on_err;
+    }
+    atomic_init(&loop->pool_free, (uint32_t) (((uint64_t) 1 << CONFIG_ESP_EVENT_POST_POOL_SIZE) - 1));
+#endif
+
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     loop->profiling_mutex = xSemaphoreCreateMutex();
     if (loop->profiling_mutex == NULL) {
@@ -529,17 +925,20 @@ on_err:
     }
 #endif
 
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    free(loop->pool);
+#endif
+
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: The library keeps the registered handlers in linked lists, which would result
+// in O(n) lookup time when dispatching. Instead, the handlers executed for each event are looked up in a
+// hash table keyed by the event base and id, whose entries hold the matching handlers in dispatch order in
+// an array. Entries are built on the first dispatch of an event and updated on handler registration and
+// unregistration.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
@@ -561,47 +960,12 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
 
         loop->running_task = xTaskGetCurrentTaskHandle();
 
-        bool exec = false;
-
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
-
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
-            }
-
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
-
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
-            }
-        }
+        bool exec = loop_dispatch(loop, &post);
 
         esp_event_base_t base = post.base;
         int32_t id = post.id;
 
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
@@ -659,15 +1023,19 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
         SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
         free(it);
     }
+    dispatch_table_delete(loop);
 
     // Drop existing posts on the queue
     esp_event_post_instance_t post;
     while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
     }
 
     // Cleanup loop
     vQueueDelete(loop->queue);
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    free(loop->pool);
+#endif
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -725,7 +1093,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         SLIST_INIT(&(loop_node->handlers));
         SLIST_INIT(&(loop_node->base_nodes));
 
-        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop, loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
 
         if (err == ESP_OK) {
             if (!last_loop_node) {
@@ -739,7 +1107,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         }
     }
     else {
-        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop, last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
     }
 
 on_err:
@@ -782,7 +1150,7 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
     esp_event_loop_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
+        esp_err_t res = loop_node_remove_handler(loop, it, event_base, event_id, handler_ctx, legacy);
 
         if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
             SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
@@ -829,21 +1197,32 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        if (event_data_size <= sizeof(post.data.val)) {
+            // Small data is copied into the post itself.
+            memcpy((void*)(&(post.data.val)), event_data, event_data_size);
+            post.data_type = ESP_EVENT_POST_DATA_INLINE;
+            atomic_fetch_add(&loop->data_inline, 1);
+        } else {
+            // Make persistent copy of event data in the post pool, or on heap if the pool can't hold it.
+            void* event_data_copy = post_pool_alloc(loop, event_data_size);
 
-        if (event_data_copy == NULL) {
-            return ESP_ERR_NO_MEM;
-        }
+            if (event_data_copy != NULL) {
+                post.data_type = ESP_EVENT_POST_DATA_POOL;
+                atomic_fetch_add(&loop->data_pool, 1);
+            } else {
+                event_data_copy = malloc(event_data_size);
 
-        memcpy(event_data_copy, event_data, event_data_size);
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-        post.data.ptr = event_data_copy;
-        post.data_allocated = true;
-        post.data_set = true;
-#else
-        post.data = event_data_copy;
-#endif
+                if (event_data_copy == NULL) {
+                    return ESP_ERR_NO_MEM;
+                }
+
+                post.data_type = ESP_EVENT_POST_DATA_HEAP;
+                atomic_fetch_add(&loop->data_heap, 1);
+            }
+
+            memcpy(event_data_copy, event_data, event_data_size);
+            post.data.ptr = event_data_copy;
+        }
     }
     post.base = event_base;
     post.id = event_id;
@@ -875,7 +1254,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -911,8 +1290,8 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 
     if (event_data != NULL && event_data_size != 0) {
         memcpy((void*)(&(post.data.val)), event_data, event_data_size);
-        post.data_allocated = false;
-        post.data_set = true;
+        post.data_type = ESP_EVENT_POST_DATA_INLINE;
+        atomic_fetch_add(&loop->data_inline, 1);
     }
     post.base = event_base;
     post.id = event_id;
@@ -923,7 +1302,7 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -939,6 +1318,29 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 }
 #endif
 
+esp_err_t esp_event_loop_get_post_stats(esp_event_loop_handle_t event_loop, esp_event_loop_post_stats_t* stats)
+{
+    assert(event_loop);
+
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    stats->data_inline = atomic_load(&loop->data_inline);
+    stats->data_pool = atomic_load(&loop->data_pool);
+    stats->data_heap = atomic_load(&loop->data_heap);
+    stats->pool_exhausted = atomic_load(&loop->pool_exhausted);
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    stats->pool_free = __builtin_popcount(atomic_load(&loop->pool_free));
+#else
+    stats->pool_free = 0;
+#endif
+
+    return ESP_OK;
+}
+
 esp_err_t esp_event_dump(FILE* file)
 {
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -0,0 +1,196 @@
+/* ESP Event Host-Based Dispatch Tests
+
+   This code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "esp_event.h"
+
+#include "catch.hpp"
+
+#include "fixtures.hpp"
+
+extern "C" {
+#include "Mocktask.h"
+#include "Mockqueue.h"
+}
+
+namespace {
+
+ESP_EVENT_DEFINE_BASE(s_dispatch_base1);
+ESP_EVENT_DEFINE_BASE(s_dispatch_base2);
+
+const uint32_t DISPATCH_QUEUE_SIZE = 32;
+
+const int BENCH_BASES = 50;
+const int BENCH_IDS = 20;
+const int BENCH_ROUNDS = 200;
+
+char s_bench_bases[BENCH_BASES][16];
+
+/**
+ * Records the order in which handlers run, every handler argument is the index of the handler.
+ */
+std::vector<int> s_dispatched;
+
+void record_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_dispatched.push_back(*static_cast<int*>(event_handler_arg));
+}
+
+struct DispatchLoop : public StubbedLoop {
+    DispatchLoop() : StubbedLoop(DISPATCH_QUEUE_SIZE)
+    {
+        s_dispatched.clear();
+    }
+
+    std::vector<int> dispatch(esp_event_base_t base, int32_t id)
+    {
+        s_dispatched.clear();
+        CHECK(ESP_OK == esp_event_post_to(loop, base, id, nullptr, 0, 0));
+        CHECK(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+        return s_dispatched;
+    }
+};
+
+struct Unregistering {
+    int index;
+    esp_event_loop_handle_t loop;
+    esp_event_handler_instance_t *instance;
+};
+
+void unregister_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    Unregistering *arg = static_cast<Unregistering*>(event_handler_arg);
+    s_dispatched.push_back(arg->index);
+    CHECK(ESP_OK == esp_event_handler_instance_unregister_with(arg->loop, event_base, event_id, *arg->instance));
+}
+
+struct Registering {
+    int index;
+    esp_event_loop_handle_t loop;
+    int *registered_arg;
+};
+
+void register_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    Registering *arg = static_cast<Registering*>(event_handler_arg);
+    s_dispatched.push_back(arg->index);
+    CHECK(ESP_OK == esp_event_handler_register_with(arg->loop, event_base, event_id, record_handler, arg->registered_arg));
+}
+
+uint32_t s_bench_handled;
+
+void bench_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_bench_handled++;
+}
+
+}
+
+TEST_CASE("handlers are dispatched in the order they are registered")
+{
+    DispatchLoop fix;
+    int args[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    esp_event_handler_instance_t instances[9];
+
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base2, 1, record_handler, &args[0], &instances[0]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, record_handler, &args[1], &instances[1]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, ESP_EVENT_ANY_ID, record_handler, &args[2], &instances[2]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base2, 2, record_handler, &args[3], &instances[3]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, 1, record_handler, &args[4], &instances[4]));
+
+    CHECK(fix.dispatch(s_dispatch_base2, 2) == std::vector<int>({1, 3}));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({1, 2, 4}));
+    CHECK(fix.dispatch(s_dispatch_base2, 1) == std::vector<int>({0, 1}));
+
+    // Handlers registered once the events have been dispatched
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base2, ESP_EVENT_ANY_ID, record_handler, &args[5], &instances[5]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, 2, record_handler, &args[6], &instances[6]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, record_handler, &args[7], &instances[7]));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, 1, record_handler, &args[8], &instances[8]));
+
+    CHECK(fix.dispatch(s_dispatch_base2, 2) == std::vector<int>({1, 3, 5, 7}));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({1, 2, 4, 7, 8}));
+    CHECK(fix.dispatch(s_dispatch_base1, 2) == std::vector<int>({1, 2, 6, 7}));
+    CHECK(fix.dispatch(s_dispatch_base2, 1) == std::vector<int>({0, 1, 5, 7}));
+    CHECK(fix.dispatch(s_dispatch_base2, 3) == std::vector<int>({1, 5, 7}));
+
+    CHECK(ESP_OK == esp_event_handler_instance_unregister_with(fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, instances[1]));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({2, 4, 7, 8}));
+    CHECK(ESP_OK == esp_event_handler_instance_unregister_with(fix.loop, s_dispatch_base2, ESP_EVENT_ANY_ID, instances[5]));
+    CHECK(fix.dispatch(s_dispatch_base2, 1) == std::vector<int>({0, 7}));
+    CHECK(ESP_OK == esp_event_handler_instance_unregister_with(fix.loop, s_dispatch_base1, 1, instances[4]));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({2, 7, 8}));
+    CHECK(fix.dispatch(s_dispatch_base1, 2) == std::vector<int>({2, 6, 7}));
+}
+
+TEST_CASE("handlers can unregister themselves and the handlers following them")
+{
+    DispatchLoop fix;
+    int args[2] = {2, 3};
+    esp_event_handler_instance_t first, second, third, fourth;
+    Unregistering unregister_first = {0, fix.loop, &first};
+    Unregistering unregister_third = {1, fix.loop, &third};
+
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, 1, unregister_handler, &unregister_first, &first));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, ESP_EVENT_ANY_ID, unregister_handler, &unregister_third, &second));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, s_dispatch_base1, 1, record_handler, &args[0], &third));
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, record_handler, &args[1], &fourth));
+
+    // The first handler unregisters itself, the second one unregisters the third, which is not run then
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({0, 1, 3}));
+    CHECK(ESP_OK == esp_event_handler_instance_unregister_with(fix.loop, s_dispatch_base1, ESP_EVENT_ANY_ID, second));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({3}));
+}
+
+TEST_CASE("handlers registered while dispatching run from the next event on")
+{
+    DispatchLoop fix;
+    int arg = 1;
+    Registering registering = {0, fix.loop, &arg};
+
+    CHECK(ESP_OK == esp_event_handler_register_with(fix.loop, s_dispatch_base1, 1, register_handler, &registering));
+
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({0}));
+    CHECK(fix.dispatch(s_dispatch_base1, 1) == std::vector<int>({0, 1}));
+}
+
+TEST_CASE("event dispatch latency", "[.][bench]")
+{
+    DispatchLoop fix;
+    std::vector<std::pair<esp_event_base_t, int32_t> > events;
+
+    for (int base = 0; base < BENCH_BASES; base++) {
+        snprintf(s_bench_bases[base], sizeof(s_bench_bases[base]), "BENCH_BASE%d", base);
+        for (int id = 0; id < BENCH_IDS; id++) {
+            CHECK(ESP_OK == esp_event_handler_register_with(fix.loop, s_bench_bases[base], id, bench_handler, nullptr));
+            events.emplace_back(s_bench_bases[base], id);
+        }
+    }
+    std::shuffle(events.begin(), events.end(), std::mt19937(0));
+
+    s_bench_handled = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < events.size(); i += DISPATCH_QUEUE_SIZE) {
+            for (size_t j = i; j < i + DISPATCH_QUEUE_SIZE && j < events.size(); j++) {
+                esp_event_post_to(fix.loop, events[j].first, events[j].second, nullptr, 0, 0);
+            }
+            esp_event_loop_run(fix.loop, portMAX_DELAY);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%d bases x %d ids: %.0f ns per posted and dispatched event\n", BENCH_BASES, BENCH_IDS,
+           elapsed.count() / (BENCH_ROUNDS * events.size()));
+    CHECK(s_bench_handled == BENCH_ROUNDS * events.size());
+}
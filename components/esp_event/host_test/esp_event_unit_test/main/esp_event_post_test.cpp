@@ -0,0 +1,185 @@
+/* ESP Event Host-Based Post Tests
+
+   This code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "sdkconfig.h"
+#include "esp_event.h"
+
+#include "catch.hpp"
+
+#include "fixtures.hpp"
+
+extern "C" {
+#include "Mocktask.h"
+#include "Mockqueue.h"
+}
+
+namespace {
+
+ESP_EVENT_DEFINE_BASE(s_post_test_base);
+
+const uint32_t POST_QUEUE_SIZE = 64;
+const size_t INLINE_SIZE = CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE;
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+const size_t SLOT_SIZE = CONFIG_ESP_EVENT_POST_POOL_SLOT_SIZE;
+#endif
+const int BENCH_POSTS = 200000;
+const uint32_t BENCH_BATCH = 8;
+
+/**
+ * Data of the events posted by the tests: the event id is the data size and every byte is the id.
+ */
+struct PostResult {
+    uint32_t handled;
+    uint32_t corrupted;
+};
+
+PostResult s_result;
+
+void check_data_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_result.handled++;
+    const uint8_t *data = static_cast<const uint8_t*>(event_data);
+    for (int32_t i = 0; i < event_id; i++) {
+        if (data[i] != (uint8_t) event_id) {
+            s_result.corrupted++;
+            break;
+        }
+    }
+}
+
+esp_err_t post(esp_event_loop_handle_t loop, size_t size)
+{
+    uint8_t data[256];
+    memset(data, (uint8_t) size, size);
+    return esp_event_post_to(loop, s_post_test_base, size, data, size, 0);
+}
+
+/**
+ * Stubbed loop running check_data_handler for all events of s_post_test_base.
+ */
+struct PostLoop : public StubbedLoop {
+    PostLoop() : StubbedLoop(POST_QUEUE_SIZE)
+    {
+        CHECK(ESP_OK == esp_event_handler_register_with(loop, s_post_test_base, ESP_EVENT_ANY_ID, check_data_handler, nullptr));
+        s_result = { };
+    }
+
+    esp_event_loop_post_stats_t stats()
+    {
+        esp_event_loop_post_stats_t stats;
+        CHECK(ESP_OK == esp_event_loop_get_post_stats(loop, &stats));
+        return stats;
+    }
+};
+
+}
+
+TEST_CASE("small event data is stored inline")
+{
+    PostLoop fix;
+
+    CHECK(ESP_OK == esp_event_post_to(fix.loop, s_post_test_base, 0, nullptr, 0, 0));
+    CHECK(ESP_OK == post(fix.loop, 1));
+    CHECK(ESP_OK == post(fix.loop, INLINE_SIZE));
+    CHECK(ESP_OK == esp_event_loop_run(fix.loop, portMAX_DELAY));
+
+    esp_event_loop_post_stats_t stats = fix.stats();
+    CHECK(stats.data_inline == 2);
+    CHECK(stats.data_pool == 0);
+    CHECK(stats.data_heap == 0);
+    CHECK(s_result.handled == 3);
+    CHECK(s_result.corrupted == 0);
+}
+
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+TEST_CASE("larger event data is stored in the post pool")
+{
+    PostLoop fix;
+
+    CHECK(ESP_OK == post(fix.loop, INLINE_SIZE + 1));
+    CHECK(ESP_OK == post(fix.loop, SLOT_SIZE));
+    CHECK(fix.stats().pool_free == CONFIG_ESP_EVENT_POST_POOL_SIZE - 2);
+    CHECK(ESP_OK == esp_event_loop_run(fix.loop, portMAX_DELAY));
+
+    esp_event_loop_post_stats_t stats = fix.stats();
+    CHECK(stats.data_pool == 2);
+    CHECK(stats.data_heap == 0);
+    CHECK(stats.pool_free == CONFIG_ESP_EVENT_POST_POOL_SIZE);
+    CHECK(s_result.handled == 2);
+    CHECK(s_result.corrupted == 0);
+}
+
+TEST_CASE("event data falls back to heap when the post pool can't hold it")
+{
+    PostLoop fix;
+
+    // Larger than a slot
+    CHECK(ESP_OK == post(fix.loop, SLOT_SIZE + 1));
+    CHECK(fix.stats().data_heap == 1);
+    CHECK(fix.stats().pool_exhausted == 0);
+
+    // All slots in use
+    const int overflow = POST_QUEUE_SIZE - 1 - CONFIG_ESP_EVENT_POST_POOL_SIZE;
+    for (int i = 0; i < CONFIG_ESP_EVENT_POST_POOL_SIZE + overflow; i++) {
+        CHECK(ESP_OK == post(fix.loop, SLOT_SIZE));
+    }
+
+    esp_event_loop_post_stats_t stats = fix.stats();
+    CHECK(stats.data_pool == CONFIG_ESP_EVENT_POST_POOL_SIZE);
+    CHECK(stats.data_heap == 1 + overflow);
+    CHECK(stats.pool_exhausted == overflow);
+    CHECK(stats.pool_free == 0);
+
+    CHECK(ESP_OK == esp_event_loop_run(fix.loop, portMAX_DELAY));
+    CHECK(fix.stats().pool_free == CONFIG_ESP_EVENT_POST_POOL_SIZE);
+    CHECK(s_result.handled == POST_QUEUE_SIZE);
+    CHECK(s_result.corrupted == 0);
+
+    // Slot of a post dropped because of a full queue is released
+    for (uint32_t i = 0; i < POST_QUEUE_SIZE; i++) {
+        CHECK(ESP_OK == post(fix.loop, INLINE_SIZE));
+    }
+    CHECK(ESP_ERR_TIMEOUT == post(fix.loop, SLOT_SIZE));
+    CHECK(fix.stats().pool_free == CONFIG_ESP_EVENT_POST_POOL_SIZE);
+}
+#endif
+
+TEST_CASE("event post throughput", "[.][bench]")
+{
+    const size_t sizes[] = {INLINE_SIZE,
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+                            SLOT_SIZE, SLOT_SIZE + 1
+#else
+                            INLINE_SIZE + 1
+#endif
+                           };
+
+    printf("%d posts in batches of %u, pool of %d slots:\n", BENCH_POSTS, (unsigned) BENCH_BATCH, CONFIG_ESP_EVENT_POST_POOL_SIZE);
+    for (size_t size : sizes) {
+        PostLoop fix;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_POSTS; i += BENCH_BATCH) {
+            for (uint32_t j = 0; j < BENCH_BATCH; j++) {
+                post(fix.loop, size);
+            }
+            esp_event_loop_run(fix.loop, portMAX_DELAY);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        esp_event_loop_post_stats_t stats = fix.stats();
+        printf("%3u byte data: %.0f posts/s, %u inline, %u in pool, %u heap allocations\n", (unsigned) size,
+               BENCH_POSTS / elapsed.count(), stats.data_inline, stats.data_pool, stats.data_heap);
+        CHECK(s_result.handled == BENCH_POSTS);
+        CHECK(s_result.corrupted == 0);
+    }
+}
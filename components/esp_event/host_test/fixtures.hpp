@@ -7,6 +7,9 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 
+#include <string.h>
+#include <deque>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -146,3 +149,80 @@ struct MockTask : public CMockFix {
 
     TaskHandle_t task;
 };
+
+/**
+ * FIFO standing in for the FreeRTOS queue of an event loop, so that posted events can be run.
+ */
+struct StubbedQueue {
+    static QueueHandle_t create(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType, int cmock_num_calls)
+    {
+        items.clear();
+        length = uxQueueLength;
+        item_size = uxItemSize;
+        return reinterpret_cast<QueueHandle_t>(&items);
+    }
+
+    static BaseType_t send(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition, int cmock_num_calls)
+    {
+        if (items.size() == length) {
+            return pdFALSE;
+        }
+        const uint8_t *item = static_cast<const uint8_t*>(pvItemToQueue);
+        items.emplace_back(item, item + item_size);
+        return pdTRUE;
+    }
+
+    static BaseType_t receive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait, int cmock_num_calls)
+    {
+        if (items.empty()) {
+            return pdFALSE;
+        }
+        memcpy(pvBuffer, items.front().data(), item_size);
+        items.pop_front();
+        return pdTRUE;
+    }
+
+    static inline std::deque<std::vector<uint8_t> > items;
+    static inline size_t length;
+    static inline size_t item_size;
+};
+
+/**
+ * Event loop without a dedicated task, using StubbedQueue as its queue.
+ * Events posted to it are run by calling esp_event_loop_run().
+ */
+struct StubbedLoop : public CMockFix {
+    StubbedLoop(uint32_t queue_size)
+    {
+        xQueueGenericCreate_Stub(StubbedQueue::create);
+        xQueueGenericSend_Stub(StubbedQueue::send);
+        xQueueReceive_Stub(StubbedQueue::receive);
+        xQueueCreateMutex_IgnoreAndReturn(reinterpret_cast<QueueHandle_t>(0xdeadbeef));
+        vQueueDelete_Ignore();
+        xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xTaskGetTickCount_IgnoreAndReturn(0);
+        xTaskGetCurrentTaskHandle_IgnoreAndReturn(reinterpret_cast<TaskHandle_t>(1));
+
+        esp_event_loop_args_t loop_args = { };
+        loop_args.queue_size = queue_size;
+        loop_args.task_name = nullptr;
+        CHECK(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+    }
+
+    ~StubbedLoop()
+    {
+        CHECK(ESP_OK == esp_event_loop_delete(loop));
+        xQueueGenericCreate_Stub(nullptr);
+        xQueueGenericSend_Stub(nullptr);
+        xQueueReceive_Stub(nullptr);
+        xQueueCreateMutex_StopIgnore();
+        vQueueDelete_StopIgnore();
+        xQueueTakeMutexRecursive_StopIgnore();
+        xQueueGiveMutexRecursive_StopIgnore();
+        xTaskGetTickCount_StopIgnore();
+        xTaskGetCurrentTaskHandle_StopIgnore();
+    }
+
+    esp_event_loop_handle_t loop;
+};
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2022 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -354,6 +354,9 @@ esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base,
  * the copy's lifetime automatically (allocation + deletion); this ensures that the data the
  * handler receives is always valid.
  *
+ * Small event data is copied into the event queue, larger event data into a preallocated slot of the event loop
+ * or, if none is free, into a heap allocation. See esp_event_loop_get_post_stats.
+ *
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
  * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
@@ -409,7 +412,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
  * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data; max is 4 bytes
+ * @param[in] event_data_size the size of the event data; max is CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -422,7 +425,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the default event loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID,
- *                          data size of more than 4 bytes
+ *                          data size of more than CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post(esp_event_base_t event_base,
@@ -451,7 +454,7 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID,
- *                          data size of more than 4 bytes
+ *                          data size of more than CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
@@ -462,6 +465,31 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
                                 BaseType_t *task_unblocked);
 #endif
 
+/// Statistics of the storage used for the data of events posted to an event loop
+typedef struct {
+    uint32_t data_inline;                       /**< number of posts with data stored inline in the event queue */
+    uint32_t data_pool;                         /**< number of posts with data stored in a preallocated slot */
+    uint32_t data_heap;                         /**< number of posts with data allocated from heap */
+    uint32_t pool_exhausted;                    /**< number of posts which fell back to heap because all
+                                                        preallocated slots were in use */
+    uint32_t pool_free;                         /**< number of preallocated slots currently free */
+} esp_event_loop_post_stats_t;
+
+/**
+ * @brief Get statistics of the storage used for the data of events posted to an event loop.
+ *
+ * Counts include events which were dropped afterwards because the event queue was full.
+ * Preallocated slots are configured with CONFIG_ESP_EVENT_POST_POOL_SIZE and CONFIG_ESP_EVENT_POST_POOL_SLOT_SIZE.
+ *
+ * @param[in] event_loop the event loop, must not be NULL
+ * @param[out] stats the statistics of the event loop
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: stats was NULL
+ */
+esp_err_t esp_event_loop_get_post_stats(esp_event_loop_handle_t event_loop, esp_event_loop_post_stats_t *stats);
+
 /**
  * @brief Dumps statistics of all event loops.
  *
@@ -73,6 +73,26 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers executed for an event, in dispatch order
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base of the event */
+    int32_t id;                                                     /**< id of the event */
+    uint32_t handlers_num;                                          /**< number of handlers executed for the event */
+    uint32_t handlers_size;                                         /**< capacity of the handlers array */
+    esp_event_handler_node_t** handlers;                            /**< loop, base and id level handlers matching the event */
+    SLIST_ENTRY(esp_event_dispatch_entry) next;                     /**< next entry in the dispatch table bucket */
+} esp_event_dispatch_entry_t;
+
+typedef SLIST_HEAD(esp_event_dispatch_entries, esp_event_dispatch_entry) esp_event_dispatch_entries_t;
+
+/// Dispatch of an event in progress, adjusted when handlers get unregistered from within a handler
+typedef struct esp_event_dispatch {
+    esp_event_dispatch_entry_t* entry;                              /**< entry whose handlers are executed */
+    int32_t index;                                                  /**< index of the handler being executed */
+    int32_t end;                                                    /**< index past the last handler to execute */
+    struct esp_event_dispatch* prev;                                /**< dispatch which ran the loop this one runs in */
+} esp_event_dispatch_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -83,6 +103,19 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    esp_event_dispatch_entries_t* dispatch_table;                   /**< hash table of the handlers to execute for
+                                                                            each event dispatched by the loop */
+    uint32_t dispatch_table_size;                                   /**< number of buckets of the dispatch table */
+    uint32_t dispatch_entries;                                      /**< number of entries in the dispatch table */
+    esp_event_dispatch_t* dispatch;                                 /**< innermost dispatch in progress */
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+    uint8_t* pool;                                                  /**< storage of the post pool slots */
+    atomic_uint_least32_t pool_free;                                /**< bitmap of free post pool slots */
+#endif
+    atomic_uint_least32_t data_inline;                              /**< number of posts with data stored inline */
+    atomic_uint_least32_t data_pool;                                /**< number of posts with data stored in the post pool */
+    atomic_uint_least32_t data_heap;                                /**< number of posts with data allocated from heap */
+    atomic_uint_least32_t pool_exhausted;                           /**< number of posts which found the post pool empty */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
@@ -91,21 +124,30 @@ typedef struct esp_event_loop_instance {
 #endif
 } esp_event_loop_instance_t;
 
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
+/// Size of event data stored inline in a post
+#define ESP_EVENT_POST_INLINE_DATA_SIZE     ((CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE + 3) & ~3)
+
+#if CONFIG_ESP_EVENT_POST_POOL_SIZE > 0
+/// Size of a post pool slot, keeps the slots aligned like heap allocations
+#define ESP_EVENT_POST_POOL_SLOT_SIZE       ((CONFIG_ESP_EVENT_POST_POOL_SLOT_SIZE + 7) & ~7)
+#endif
+
+/// Storage of the data associated with a post
+typedef enum {
+    ESP_EVENT_POST_DATA_NONE = 0,                                    /**< no data is associated with the event */
+    ESP_EVENT_POST_DATA_INLINE,                                      /**< data is stored in the post itself */
+    ESP_EVENT_POST_DATA_POOL,                                        /**< data is stored in a slot of the loop post pool */
+    ESP_EVENT_POST_DATA_HEAP,                                        /**< data is allocated from heap */
+} esp_event_post_data_type_t;
+
 typedef union esp_event_post_data {
-    uint32_t val;
-    void *ptr;
+    uint32_t val[ESP_EVENT_POST_INLINE_DATA_SIZE / 4];               /**< data stored inline */
+    void *ptr;                                                       /**< data stored in a pool slot or on heap */
 } esp_event_post_data_t;
-#else
-typedef void* esp_event_post_data_t;
-#endif
 
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    bool data_allocated;                                             /**< indicates whether data is allocated from heap */
-    bool data_set;                                                   /**< indicates if data is null */
-#endif
+    uint8_t data_type;                                               /**< storage of the data, esp_event_post_data_type_t */
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
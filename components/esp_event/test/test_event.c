@@ -1946,16 +1946,14 @@ TEST_CASE("can properly prepare event data posted to loop", "[event]")
 
     TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
     TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
-    TEST_ASSERT_EQUAL(false, post.data_set);
-    TEST_ASSERT_EQUAL(false, post.data_allocated);
+    TEST_ASSERT_EQUAL(ESP_EVENT_POST_DATA_NONE, post.data_type);
     TEST_ASSERT_EQUAL(NULL, post.data.ptr);
 
     int sample = 0;
     TEST_ESP_OK(esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &sample, sizeof(sample), NULL));
     TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
-    TEST_ASSERT_EQUAL(true, post.data_set);
-    TEST_ASSERT_EQUAL(false, post.data_allocated);
-    TEST_ASSERT_EQUAL(false, post.data.val);
+    TEST_ASSERT_EQUAL(ESP_EVENT_POST_DATA_INLINE, post.data_type);
+    TEST_ASSERT_EQUAL(0, post.data.val[0]);
 
     TEST_ESP_OK(esp_event_loop_delete(loop));
 
@@ -99,6 +99,31 @@ struct httpd_req_aux {
 #endif
 };
 
+/**
+ * @brief   Ready socket reported by httpd_poll_wait()
+ */
+struct httpd_poll_event {
+    int fd;                                 /*!< The ready socket */
+    struct sock_db *session;                /*!< Session of the socket, NULL for the listening and control sockets */
+};
+
+/**
+ * @brief   State of the backend waiting for the server sockets to be ready,
+ *          kept up to date as sessions are opened and closed
+ */
+struct httpd_poll {
+#if CONFIG_HTTPD_POLL_EPOLL
+    int epoll_fd;                           /*!< epoll instance watching the server sockets */
+    struct epoll_event *ready;              /*!< Events returned by epoll_wait() */
+#else
+    fd_set read_set;                        /*!< Sockets passed to select() */
+    int max_fd;                             /*!< Highest socket in read_set */
+    struct sock_db **sessions;              /*!< Sessions in read_set, indexed by their socket */
+#endif
+    bool listening;                         /*!< Whether the listening socket is watched */
+    struct httpd_poll_event *events;        /*!< Sockets found ready by the last wait */
+};
+
 /**
  * @brief   Server data for each instance. This is exposed publicly as
  *          httpd_handle_t but internal structure/members are kept private.
@@ -114,6 +139,8 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
+    bool hd_sd_pending;                     /*!< Some session may have data buffered which its socket doesn't report */
+    struct httpd_poll hd_poll;              /*!< Readiness of the server sockets */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
@@ -218,17 +245,6 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session);
  */
 void httpd_sess_free_ctx(void **ctx, httpd_free_ctx_fn_t free_fn);
 
-/**
- * @brief   Add descriptors present in the socket database to an fdset and
- *          update the value of maxfd which are needed by the select function
- *          for looking through all available sockets for incoming data.
- *
- * @param[in]  hd    Server instance data
- * @param[out] fdset File descriptor set to be updated.
- * @param[out] maxfd Maximum value among all file descriptors.
- */
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd);
-
 /**
  * @brief   Checks if session can accept another connection from new client.
  *          If sockets database is full then this returns false.
@@ -287,6 +303,84 @@ void httpd_sess_close_all(struct httpd_data *hd);
  * @}
  */
 
+/****************** Group : Socket Readiness ********************/
+/** @name Socket Readiness
+ * Methods for waiting for the server sockets to be ready. The backend,
+ * select() or epoll, is chosen by CONFIG_HTTPD_POLL and only reports
+ * the sockets which are ready, so that the server doesn't go through
+ * all the sessions for every request.
+ * @{
+ */
+
+/**
+ * @brief   Initializes the readiness backend and watches the control socket
+ *
+ * @param[in] hd  Server instance data, with its sockets created
+ *
+ * @return
+ *  - ESP_OK : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if the backend state couldn't be allocated
+ *  - ESP_FAIL : if the backend couldn't be created
+ */
+esp_err_t httpd_poll_init(struct httpd_data *hd);
+
+/**
+ * @brief   Releases the readiness backend
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_poll_deinit(struct httpd_data *hd);
+
+/**
+ * @brief   Watches the socket of a new session
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if the socket can't be watched
+ */
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Stops watching the socket of a session, before it gets closed.
+ *          Does nothing if the session hasn't been added.
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ */
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Starts or stops watching the listening socket
+ *
+ * @param[in] hd     Server instance data
+ * @param[in] enable Whether new connections should be reported
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if the listening socket can't be watched
+ */
+esp_err_t httpd_poll_listen(struct httpd_data *hd, bool enable);
+
+/**
+ * @brief   Waits for some of the watched sockets to be ready for reading,
+ *          and stores them in hd->hd_poll.events
+ *
+ * @param[in] hd    Server instance data
+ * @param[in] block Whether to wait until a socket is ready, or only poll them
+ *
+ * @return
+ *  - Number of ready sockets stored in hd->hd_poll.events
+ *  - -1 : on error, with errno set
+ */
+int httpd_poll_wait(struct httpd_data *hd, bool block);
+
+/** End of Group : Socket Readiness
+ * @}
+ */
+
 /****************** Group : URI Handling ********************/
 /** @name URI Handling
  * Methods for accessing URI handlers
@@ -19,11 +19,6 @@
 #include "freertos/semphr.h"
 #endif
 
-typedef struct {
-    fd_set *fdset;
-    struct httpd_data *hd;
-} process_session_context_t;
-
 static const char *TAG = "httpd";
 
 static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
@@ -181,25 +176,28 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
 #endif
 }
 
-// Called for each session from httpd_server
-static int httpd_process_session(struct sock_db *session, void *context)
+// Called for each ready session from httpd_server
+static void httpd_process_session(struct httpd_data *hd, struct sock_db *session)
 {
-    if ((!session) || (!context)) {
-        return 0;
+    ESP_LOGD(TAG, LOG_FMT("processing socket %d"), session->fd);
+    if (httpd_sess_process(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session); // Delete session
+    } else if (httpd_sess_pending(hd, session)) {
+        // The socket won't report the data which has already been received
+        hd->hd_sd_pending = true;
     }
+}
 
-    if (session->fd < 0) {
-        return 1;
+// Called for each session from httpd_server when some may have pending data
+static int httpd_process_pending_session(struct sock_db *session, void *context)
+{
+    if ((!session) || (!context)) {
+        return 0;
     }
 
-    process_session_context_t *ctx = (process_session_context_t *)context;
-    int fd = session->fd;
-
-    if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
+    struct httpd_data *hd = (struct httpd_data *)context;
+    if ((session->fd >= 0) && httpd_sess_pending(hd, session)) {
+        httpd_process_session(hd, session);
     }
     return 1;
 }
@@ -207,32 +205,33 @@ static int httpd_process_session(struct sock_db *session, void *context)
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
-    fd_set read_set;
-    FD_ZERO(&read_set);
-    if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
-        /* Only listen for new connections if server has capacity to
-         * handle more (or when LRU purge is enabled, in which case
-         * older connections will be closed) */
-        FD_SET(hd->listen_fd, &read_set);
-    }
-    FD_SET(hd->ctrl_fd, &read_set);
-
-    int tmp_max_fd;
-    httpd_sess_set_descriptors(hd, &read_set, &tmp_max_fd);
-    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
-    tmp_max_fd = maxfd;
-    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
-
-    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
+    /* Only listen for new connections if server has capacity to
+     * handle more (or when LRU purge is enabled, in which case
+     * older connections will be closed) */
+    httpd_poll_listen(hd, hd->config.lru_purge_enable ||
+                      (hd->hd_sd_active_count < hd->config.max_open_sockets));
+
+    /* Don't block if data is pending, it has to be processed right away */
+    int active_cnt = httpd_poll_wait(hd, !hd->hd_sd_pending);
     if (active_cnt < 0) {
-        ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
+        ESP_LOGE(TAG, LOG_FMT("error waiting for sockets (%d)"), errno);
         httpd_sess_delete_invalid(hd);
         return ESP_OK;
     }
 
+    struct httpd_poll_event *events = hd->hd_poll.events;
+    bool ctrl_ready = false;
+    bool listen_ready = false;
+    for (int i = 0; i < active_cnt; i++) {
+        if (events[i].fd == hd->ctrl_fd) {
+            ctrl_ready = true;
+        } else if (events[i].fd == hd->listen_fd) {
+            listen_ready = true;
+        }
+    }
+
     /* Case0: Do we have a control message? */
-    if (FD_ISSET(hd->ctrl_fd, &read_set)) {
+    if (ctrl_ready) {
         ESP_LOGD(TAG, LOG_FMT("processing ctrl message"));
         httpd_process_ctrl_msg(hd);
         if (hd->hd_td.status == THREAD_STOPPING) {
@@ -242,16 +241,24 @@ static esp_err_t httpd_server(struct httpd_data *hd)
     }
 
     /* Case1: Do we have any activity on the current data
-     * sessions? */
-    process_session_context_t context = {
-        .fdset = &read_set,
-        .hd = hd
-    };
-    httpd_sess_enum(hd, httpd_process_session, &context);
+     * sessions? Only the ready ones are visited, unless some
+     * data was left pending by the previous requests */
+    bool pending = hd->hd_sd_pending;
+    hd->hd_sd_pending = false;
+    for (int i = 0; i < active_cnt; i++) {
+        struct sock_db *session = events[i].session;
+        /* The session may have been closed by a control message */
+        if (session && (session->fd == events[i].fd)) {
+            httpd_process_session(hd, session);
+        }
+    }
+    if (pending) {
+        httpd_sess_enum(hd, httpd_process_pending_session, hd);
+    }
 
     /* Case2: Do we have any incoming connection requests to
      * process? */
-    if (FD_ISSET(hd->listen_fd, &read_set)) {
+    if (listen_ready) {
         ESP_LOGD(TAG, LOG_FMT("processing listen socket %d"), hd->listen_fd);
         if (httpd_accept_conn(hd, hd->listen_fd) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("error accepting new connection"));
@@ -279,6 +286,7 @@ static void httpd_thread(void *arg)
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_sess_close_all(hd);
+    httpd_poll_deinit(hd);
     close(hd->listen_fd);
     hd->hd_td.status = THREAD_STOPPED;
     httpd_os_thread_delete();
@@ -460,12 +468,21 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    esp_err_t ret = httpd_poll_init(hd);
+    if (ret != ESP_OK) {
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
+        close(hd->listen_fd);
+        httpd_delete(hd);
+        return ret;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd,
                                hd->config.core_id) != ESP_OK) {
         /* Failed to launch task */
+        httpd_poll_deinit(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
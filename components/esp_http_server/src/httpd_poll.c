@@ -0,0 +1,244 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#if CONFIG_HTTPD_POLL_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_poll";
+
+/* The listening and control sockets are watched along with the sessions */
+#define HTTPD_POLL_MAX_EVENTS(hd)   ((hd)->config.max_open_sockets + 2)
+
+#if CONFIG_HTTPD_POLL_EPOLL
+
+/* The data of an epoll event identifies the ready socket: the control socket,
+ * the listening socket or the index of the session in the socket database */
+#define HTTPD_POLL_ID_CTRL      0
+#define HTTPD_POLL_ID_LISTEN    1
+#define HTTPD_POLL_ID_SESSION   2
+
+static esp_err_t poll_ctl(struct httpd_poll *poll, int op, int fd, uint64_t id)
+{
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.u64 = id
+    };
+    if (epoll_ctl(poll->epoll_fd, op, fd, &event) < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_ctl for fd = %d (%d)"), fd, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    poll->listening = false;
+    poll->events = calloc(HTTPD_POLL_MAX_EVENTS(hd), sizeof(struct httpd_poll_event));
+    poll->ready = calloc(HTTPD_POLL_MAX_EVENTS(hd), sizeof(struct epoll_event));
+    if (!poll->events || !poll->ready) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for socket events"));
+        free(poll->events);
+        free(poll->ready);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    poll->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (poll->epoll_fd < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_create1 (%d)"), errno);
+        free(poll->events);
+        free(poll->ready);
+        return ESP_FAIL;
+    }
+    if (poll_ctl(poll, EPOLL_CTL_ADD, hd->ctrl_fd, HTTPD_POLL_ID_CTRL) != ESP_OK) {
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    close(poll->epoll_fd);
+    free(poll->ready);
+    free(poll->events);
+    poll->ready = NULL;
+    poll->events = NULL;
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    return poll_ctl(&hd->hd_poll, EPOLL_CTL_ADD, session->fd,
+                    HTTPD_POLL_ID_SESSION + (session - hd->hd_sd));
+}
+
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session)
+{
+    /* Fails harmlessly for a session which hasn't been added yet */
+    epoll_ctl(hd->hd_poll.epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+}
+
+esp_err_t httpd_poll_listen(struct httpd_data *hd, bool enable)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    if (poll->listening == enable) {
+        return ESP_OK;
+    }
+    if (poll_ctl(poll, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, hd->listen_fd, HTTPD_POLL_ID_LISTEN) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    poll->listening = enable;
+    return ESP_OK;
+}
+
+int httpd_poll_wait(struct httpd_data *hd, bool block)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    ESP_LOGD(TAG, LOG_FMT("doing epoll_wait"));
+    int active_cnt = epoll_wait(poll->epoll_fd, poll->ready, HTTPD_POLL_MAX_EVENTS(hd), block ? -1 : 0);
+    for (int i = 0; i < active_cnt; i++) {
+        uint64_t id = poll->ready[i].data.u64;
+        struct httpd_poll_event *event = &poll->events[i];
+        if (id == HTTPD_POLL_ID_CTRL) {
+            event->fd = hd->ctrl_fd;
+            event->session = NULL;
+        } else if (id == HTTPD_POLL_ID_LISTEN) {
+            event->fd = hd->listen_fd;
+            event->session = NULL;
+        } else {
+            event->session = &hd->hd_sd[id - HTTPD_POLL_ID_SESSION];
+            event->fd = event->session->fd;
+        }
+    }
+    return active_cnt;
+}
+
+#else /* select() */
+
+static esp_err_t poll_watch(struct httpd_poll *poll, int fd)
+{
+    if ((fd < 0) || (fd >= FD_SETSIZE)) {
+        ESP_LOGE(TAG, LOG_FMT("fd = %d can't be used with select"), fd);
+        return ESP_FAIL;
+    }
+    FD_SET(fd, &poll->read_set);
+    if (fd > poll->max_fd) {
+        poll->max_fd = fd;
+    }
+    return ESP_OK;
+}
+
+static void poll_unwatch(struct httpd_poll *poll, int fd)
+{
+    if ((fd < 0) || (fd >= FD_SETSIZE)) {
+        return;
+    }
+    FD_CLR(fd, &poll->read_set);
+    poll->sessions[fd] = NULL;
+    while ((poll->max_fd >= 0) && !FD_ISSET(poll->max_fd, &poll->read_set)) {
+        poll->max_fd--;
+    }
+}
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    FD_ZERO(&poll->read_set);
+    poll->max_fd = -1;
+    poll->listening = false;
+    poll->events = calloc(HTTPD_POLL_MAX_EVENTS(hd), sizeof(struct httpd_poll_event));
+    poll->sessions = calloc(FD_SETSIZE, sizeof(struct sock_db *));
+    if (!poll->events || !poll->sessions) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for socket events"));
+        httpd_poll_deinit(hd);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    if (poll_watch(poll, hd->ctrl_fd) != ESP_OK) {
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    free(poll->sessions);
+    free(poll->events);
+    poll->sessions = NULL;
+    poll->events = NULL;
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    if (poll_watch(poll, session->fd) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    poll->sessions[session->fd] = session;
+    return ESP_OK;
+}
+
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    /* Sessions which haven't been added yet have no entry */
+    if ((session->fd >= 0) && (session->fd < FD_SETSIZE) && (poll->sessions[session->fd] == session)) {
+        poll_unwatch(poll, session->fd);
+    }
+}
+
+esp_err_t httpd_poll_listen(struct httpd_data *hd, bool enable)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    if (poll->listening == enable) {
+        return ESP_OK;
+    }
+    if (enable) {
+        if (poll_watch(poll, hd->listen_fd) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    } else {
+        poll_unwatch(poll, hd->listen_fd);
+    }
+    poll->listening = enable;
+    return ESP_OK;
+}
+
+int httpd_poll_wait(struct httpd_data *hd, bool block)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    fd_set read_set = poll->read_set;
+    struct timeval timeout = { 0 };
+
+    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), poll->max_fd + 1);
+    int active_cnt = select(poll->max_fd + 1, &read_set, NULL, NULL, block ? NULL : &timeout);
+    if (active_cnt < 0) {
+        return active_cnt;
+    }
+
+    /* Only the ready sockets are reported, the scan stops at the last one */
+    int count = 0;
+    for (int fd = 0; (fd <= poll->max_fd) && (count < active_cnt); fd++) {
+        if (FD_ISSET(fd, &read_set)) {
+            poll->events[count].fd = fd;
+            poll->events[count].session = poll->sessions[fd];
+            count++;
+        }
+    }
+    return count;
+}
+
+#endif /* CONFIG_HTTPD_POLL_EPOLL */
@@ -0,0 +1,16 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+/* Only errors are printed, the format may be expanded from LOG_FMT() */
+#define ESP_LOGE(tag, ...)  do { fprintf(stderr, "E %s: ", tag); fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } while (0)
+#define ESP_LOGW(tag, ...)  do { (void) tag; } while (0)
+#define ESP_LOGI(tag, ...)  do { (void) tag; } while (0)
+#define ESP_LOGD(tag, ...)  do { (void) tag; } while (0)
+#define ESP_LOGV(tag, ...)  do { (void) tag; } while (0)
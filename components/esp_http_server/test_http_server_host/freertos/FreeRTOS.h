@@ -0,0 +1,21 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * FreeRTOS types used by the public HTTP server header. The server task is
+ * a thread on the host, see osal.h.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define tskNO_AFFINITY  0x7FFFFFFF
@@ -0,0 +1,314 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "esp_http_server.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define SERVER_PORT             18080
+#define CLIENT_TIMEOUT_MS       2000
+#define NO_RESPONSE_TIMEOUT_MS  200
+#define BENCH_CONNECTIONS       256
+#define BENCH_REQUESTS          20000
+
+static const char HELLO_BODY[] = "Hello World!";
+static const char HELLO_REQUEST[] = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+static esp_err_t hello_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, HELLO_BODY, HTTPD_RESP_USE_STRLEN);
+}
+
+/* Responses are sent in several writes, which Nagle's algorithm holds back until the client's
+ * delayed ACK: disable it, so that latencies measure the server rather than the TCP stack */
+static esp_err_t open_session(httpd_handle_t handle, int sockfd)
+{
+    int enable = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return ESP_OK;
+}
+
+/* Server on SERVER_PORT answering GET /hello */
+struct Server {
+    httpd_handle_t handle;
+    uint16_t max_open_sockets;
+
+    Server(uint16_t max_open_sockets = 7, bool lru_purge_enable = false) : max_open_sockets(max_open_sockets)
+    {
+        httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+        config.server_port = SERVER_PORT;
+        config.max_open_sockets = max_open_sockets;
+        config.lru_purge_enable = lru_purge_enable;
+        config.open_fn = open_session;
+        REQUIRE(httpd_start(&handle, &config) == ESP_OK);
+
+        httpd_uri_t hello = {};
+        hello.uri = "/hello";
+        hello.method = HTTP_GET;
+        hello.handler = hello_handler;
+        REQUIRE(httpd_register_uri_handler(handle, &hello) == ESP_OK);
+    }
+
+    ~Server()
+    {
+        httpd_stop(handle);
+    }
+
+    size_t clients()
+    {
+        std::vector<int> fds(max_open_sockets);
+        size_t count = fds.size();
+        REQUIRE(httpd_get_client_list(handle, &count, fds.data()) == ESP_OK);
+        return count;
+    }
+};
+
+/* Keep-alive connection to the server */
+struct Client {
+    int fd;
+    std::string received;
+    size_t response_size;
+
+    Client() : response_size(0)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(fd >= 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    ~Client()
+    {
+        close(fd);
+    }
+
+    bool send(const std::string &data)
+    {
+        return ::send(fd, data.data(), data.size(), 0) == (ssize_t) data.size();
+    }
+
+    /* Returns false if nothing is received before the timeout, or the connection is closed */
+    bool receive(int timeout_ms)
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeout_ms) != 1) {
+            return false;
+        }
+        char buf[1024];
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            return false;
+        }
+        received.append(buf, len);
+        return true;
+    }
+
+    /* Body of the next response, empty if none is received before the timeout */
+    std::string response(int timeout_ms = CLIENT_TIMEOUT_MS)
+    {
+        while (true) {
+            size_t header_end = received.find("\r\n\r\n");
+            if (header_end != std::string::npos) {
+                size_t length_field = received.find("Content-Length: ");
+                REQUIRE(length_field < header_end);
+                size_t body_len = strtoul(received.c_str() + length_field + strlen("Content-Length: "), NULL, 10);
+                size_t size = header_end + 4 + body_len;
+                if (received.size() >= size) {
+                    std::string body = received.substr(header_end + 4, body_len);
+                    received.erase(0, size);
+                    response_size = size;
+                    return body;
+                }
+            }
+            if (!receive(timeout_ms)) {
+                return "";
+            }
+        }
+    }
+
+    bool closed()
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        char buf[1024];
+        while (poll(&pfd, 1, CLIENT_TIMEOUT_MS) == 1) {
+            if (recv(fd, buf, sizeof(buf), 0) <= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+typedef std::vector<std::unique_ptr<Client> > Clients;
+
+static void connect_clients(Clients &clients, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        clients.emplace_back(new Client());
+        REQUIRE(clients.back()->send(HELLO_REQUEST));
+        REQUIRE(clients.back()->response() == HELLO_BODY);
+    }
+}
+
+TEST_CASE("keep-alive connections are served")
+{
+    Server server;
+    Client a, b;
+
+    for (int i = 0; i < 3; i++) {
+        CHECK(a.send(HELLO_REQUEST));
+        CHECK(b.send(HELLO_REQUEST));
+        CHECK(b.response() == HELLO_BODY);
+        CHECK(a.response() == HELLO_BODY);
+    }
+    CHECK(server.clients() == 2);
+}
+
+TEST_CASE("pipelined requests are answered")
+{
+    Server server;
+    Client client;
+
+    // The server receives all of them at once and has to process those left pending
+    CHECK(client.send(std::string(HELLO_REQUEST) + HELLO_REQUEST + HELLO_REQUEST));
+    for (int i = 0; i < 3; i++) {
+        CHECK(client.response() == HELLO_BODY);
+    }
+}
+
+TEST_CASE("sessions closed by clients are released")
+{
+    Server server(8);
+    Clients clients;
+
+    connect_clients(clients, 8);
+    CHECK(server.clients() == 8);
+    clients.clear();
+    for (int i = 0; i < CLIENT_TIMEOUT_MS / 10 && server.clients(); i++) {
+        usleep(10 * 1000);
+    }
+    CHECK(server.clients() == 0);
+
+    connect_clients(clients, 8);
+    CHECK(server.clients() == 8);
+}
+
+TEST_CASE("connections wait for a free session")
+{
+    Server server(4);
+    Clients clients;
+    connect_clients(clients, 4);
+
+    Client waiting;
+    CHECK(waiting.send(HELLO_REQUEST));
+    CHECK(waiting.response(NO_RESPONSE_TIMEOUT_MS) == "");
+
+    clients.erase(clients.begin());
+    CHECK(waiting.response() == HELLO_BODY);
+    CHECK(server.clients() == 4);
+}
+
+TEST_CASE("LRU purge closes the least recently used session")
+{
+    Server server(4, true);
+    Clients clients;
+    connect_clients(clients, 4);
+
+    CHECK(clients[0]->send(HELLO_REQUEST));
+    CHECK(clients[0]->response() == HELLO_BODY);
+
+    Client client;
+    CHECK(client.send(HELLO_REQUEST));
+    CHECK(client.response() == HELLO_BODY);
+    CHECK(clients[1]->closed());
+}
+
+/* Sends requests on the first active clients, a new one as soon as the previous response is received */
+static void bench(Clients &clients, size_t active, int requests)
+{
+    typedef std::chrono::steady_clock clock;
+    const size_t response_size = clients[0]->response_size;
+    std::vector<clock::time_point> sent(active);
+    std::vector<size_t> received(active);
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+
+    int epoll_fd = epoll_create1(0);
+    REQUIRE(epoll_fd >= 0);
+    int issued = 0;
+    clock::time_point start = clock::now();
+    for (size_t i = 0; i < active; i++) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        REQUIRE(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i]->fd, &event) == 0);
+        REQUIRE(clients[i]->send(HELLO_REQUEST));
+        sent[i] = clock::now();
+        issued++;
+    }
+
+    while (latencies.size() < (size_t) requests) {
+        struct epoll_event events[64];
+        int count = epoll_wait(epoll_fd, events, 64, CLIENT_TIMEOUT_MS);
+        REQUIRE(count > 0);
+        for (int e = 0; e < count; e++) {
+            size_t i = events[e].data.u32;
+            char buf[1024];
+            ssize_t len = recv(clients[i]->fd, buf, sizeof(buf), 0);
+            REQUIRE(len > 0);
+            received[i] += len;
+            REQUIRE(received[i] <= response_size);
+            if (received[i] < response_size) {
+                continue;
+            }
+            std::chrono::duration<double, std::micro> latency = clock::now() - sent[i];
+            latencies.push_back(latency.count());
+            received[i] = 0;
+            if (issued < requests) {
+                REQUIRE(clients[i]->send(HELLO_REQUEST));
+                sent[i] = clock::now();
+                issued++;
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = clock::now() - start;
+    close(epoll_fd);
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("%u open connections, %u active: %.0f req/s, p99 latency %.0f us\n", (unsigned) clients.size(),
+           (unsigned) active, requests / elapsed.count(), latencies[latencies.size() * 99 / 100]);
+}
+
+TEST_CASE("keep-alive request throughput", "[.][bench]")
+{
+    Server server(BENCH_CONNECTIONS);
+    Clients clients;
+    connect_clients(clients, BENCH_CONNECTIONS);
+
+    bench(clients, BENCH_CONNECTIONS, BENCH_REQUESTS);
+    bench(clients, 16, BENCH_REQUESTS);
+    bench(clients, 1, BENCH_REQUESTS / 4);
+    CHECK(server.clients() == BENCH_CONNECTIONS);
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -45,6 +45,20 @@ typedef enum {
      * time.
      */
     RINGBUF_TYPE_BYTEBUF,
+    /**
+     * Single-producer/single-consumer no-split buffers store items like
+     * no-split buffers, but don't use a critical section. Items must only be
+     * sent by one task or ISR, and only be received by one task or ISR.
+     * The semaphores are only used when a task has to block.
+     */
+    RINGBUF_TYPE_NOSPLIT_SPSC,
+    /**
+     * Single-producer/single-consumer byte buffers store data like byte
+     * buffers, but don't use a critical section. Data must only be sent by one
+     * task or ISR, and only be received by one task or ISR. The semaphores are
+     * only used when a task has to block.
+     */
+    RINGBUF_TYPE_BYTEBUF_SPSC,
     RINGBUF_TYPE_MAX,
 } RingbufferType_t;
 
@@ -62,7 +76,7 @@ typedef struct xSTATIC_RINGBUFFER {
     /** @cond */    //Doxygen command to hide this structure from API Reference
     size_t xDummy1[2];
     UBaseType_t uxDummy2;
-    BaseType_t xDummy3;
+    BaseType_t xDummy3[3];
     void *pvDummy4[11];
     StaticSemaphore_t xDummy5[2];
     portMUX_TYPE muxDummy;
@@ -78,6 +92,8 @@ typedef struct xSTATIC_RINGBUFFER {
  * @param[in]   xBufferType Type of ring buffer, see documentation.
  *
  * @note    xBufferSize of no-split/allow-split buffers will be rounded up to the nearest 32-bit aligned size.
+ * @note    Single-producer/single-consumer buffers leave a few bytes unused to tell a full buffer
+ *          from an empty one, see xRingbufferGetMaxItemSize().
  *
  * @return  A handle to the created ring buffer, or NULL in case of error.
  */
@@ -212,6 +228,51 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
  */
 BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
 
+/**
+ * @brief Acquire memory for multiple items from the ring buffer in one call
+ *
+ * Batched version of ``xRingbufferSendAcquire``. The items are acquired in
+ * order, as many of them as currently fit, with a single critical section.
+ * This function will block until at least the first item fits or until it
+ * times out.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to allocate the memory
+ * @param[out]  ppvItems        Array of uxItems pointers, filled with the memory acquired for each item (NULL if not acquired)
+ * @param[in]   pxItemSizes     Array of uxItems sizes of the items to acquire
+ * @param[in]   uxItems         Number of items to acquire
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
+ *
+ * @note Only applicable for no-split ring buffers. The acquired items must be
+ *       sent by ``xRingbufferSendComplete`` or ``xRingbufferSendCompleteMultiple``.
+ *
+ * @return Number of items acquired, from the start of the arrays. 0 on time-out
+ *         or when any item is larger than the maximum permissible size of the buffer
+ */
+UBaseType_t xRingbufferSendAcquireMultiple(RingbufHandle_t xRingbuffer,
+                                           void **ppvItems,
+                                           const size_t *pxItemSizes,
+                                           UBaseType_t uxItems,
+                                           TickType_t xTicksToWait);
+
+/**
+ * @brief   Send multiple items allocated by ``xRingbufferSendAcquire`` or
+ *          ``xRingbufferSendAcquireMultiple`` in one call
+ *
+ * The items are sent with a single critical section, and a blocked receiving
+ * task is woken once for the whole batch.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the items into
+ * @param[in]   ppvItems        Array of pointers to the items to send
+ * @param[in]   uxItems         Number of items to send
+ *
+ * @note Only applicable for no-split ring buffers.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE if fail for some reason.
+ */
+BaseType_t xRingbufferSendCompleteMultiple(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems);
+
 /**
  * @brief   Retrieve an item from the ring buffer
  *
@@ -250,6 +311,29 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
  */
 void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
 
+/**
+ * @brief   Retrieve an item from the ring buffer in the panic handler
+ *
+ * Same as xRingbufferReceiveFromISR(), except that the spinlock of the ring buffer is not taken
+ * and no task is woken up, so that the function can't deadlock if the panic happened while
+ * the spinlock was held. In that case the ring buffer may be in the middle of an update, and
+ * no item is retrieved.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the item from
+ * @param[out]  pxItemSize      Pointer to a variable to which the size of the
+ *                              retrieved item will be written.
+ *
+ * @note    Only for use when nothing else can access the ring buffer anymore, e.g. by the panic
+ *          handler after the other cores have been stalled.
+ * @note    The item doesn't need to be returned.
+ * @note    Byte buffers do not allow multiple retrievals.
+ *
+ * @return
+ *      - Pointer to the retrieved item on success; *pxItemSize filled with the length of the item.
+ *      - NULL when the ring buffer is empty or its spinlock is held, *pxItemSize is untouched in that case.
+ */
+void *xRingbufferReceiveFromPanic(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
+
 /**
  * @brief   Retrieve a split item from an allow-split ring buffer
  *
@@ -356,6 +440,52 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
  */
 void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize, size_t xMaxSize);
 
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer in one call
+ *
+ * Attempt to retrieve all the items available in the ring buffer, up to
+ * uxMaxItems, with a single critical section. This function will block until
+ * at least one item is available or until it times out.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of at least uxMaxItems pointers, filled with the retrieved items in FIFO order
+ * @param[out]  pxItemSizes     Array of at least uxMaxItems sizes, filled with the size of each retrieved item. Can be NULL.
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    The items must be returned by vRingbufferReturnItems() or vRingbufferReturnItem().
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved, 0 on timeout
+ */
+UBaseType_t xRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                       void **ppvItems,
+                                       size_t *pxItemSizes,
+                                       UBaseType_t uxMaxItems,
+                                       TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer in an ISR
+ *
+ * Attempt to retrieve all the items available in the ring buffer, up to
+ * uxMaxItems. This function returns immediately if there are no items
+ * available for retrieval.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of at least uxMaxItems pointers, filled with the retrieved items in FIFO order
+ * @param[out]  pxItemSizes     Array of at least uxMaxItems sizes, filled with the size of each retrieved item. Can be NULL.
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve
+ *
+ * @note    The items must be returned by vRingbufferReturnItemsFromISR() or vRingbufferReturnItemFromISR().
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved, 0 when the ring buffer is empty
+ */
+UBaseType_t xRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                              void **ppvItems,
+                                              size_t *pxItemSizes,
+                                              UBaseType_t uxMaxItems);
+
 /**
  * @brief   Return a previously-retrieved item to the ring buffer
  *
@@ -378,6 +508,29 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return multiple previously-retrieved items to the ring buffer in one call
+ *
+ * The items are returned with a single critical section, and a blocked sending
+ * task is woken once for the whole batch.
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   ppvItems    Array of items that were received earlier
+ * @param[in]   uxItems     Number of items to return
+ */
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems);
+
+/**
+ * @brief   Return multiple previously-retrieved items to the ring buffer from an ISR
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   ppvItems    Array of items that were received earlier
+ * @param[in]   uxItems     Number of items to return
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE
+ *                                          if the function woke up a higher priority task.
+ */
+void vRingbufferReturnItemsFromISR(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems, BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Delete a ring buffer
  *
@@ -402,6 +555,9 @@ void vRingbufferDelete(RingbufHandle_t xRingbuffer);
  *          of max item size can always be sent to an empty no-split buffer
  *          regardless of the internal positions of the buffer's read/write/free
  *          pointers.
+ * @note    For single-producer/single-consumer buffers, the limit is
+ *          ((buffer_size/2 rounded down to 32-bit)-header_size) for no-split
+ *          buffers and (buffer_size-1) for byte buffers.
  *
  * @return  Maximum size, in bytes, of an item that can be placed in a ring buffer.
  */
@@ -438,6 +594,9 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer);
  * @param[in]   xRingbuffer     Ring buffer to add to the queue set
  * @param[in]   xQueueSet       Queue set to add the ring buffer's read semaphore to
  *
+ * @note    Not supported by single-producer/single-consumer buffers, which only
+ *          give the read semaphore when the receiving task is blocked.
+ *
  * @return
  *      - pdTRUE on success, pdFALSE otherwise
  */
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -21,6 +21,7 @@
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 16 )  //The ring buffer has a single producer and a single consumer, and uses no critical section
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -28,6 +29,10 @@
 #define rbITEM_SPLIT_FLAG           ( ( UBaseType_t ) 4 )   //Valid for RINGBUF_TYPE_ALLOWSPLIT, indicating that rest of the data is wrapped around
 #define rbITEM_WRITTEN_FLAG         ( ( UBaseType_t ) 8 )   //Item has been written to by the application, thus can be read
 
+//Lock-free access to the pointers shared by the producer and consumer of SPSC ring buffers
+#define rbLOAD_ACQUIRE( xVar )              __atomic_load_n( &( xVar ), __ATOMIC_ACQUIRE )
+#define rbSTORE_RELEASE( xVar, xValue )     __atomic_store_n( &( xVar ), ( xValue ), __ATOMIC_RELEASE )
+
 //Static allocation related
 #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
 #define rbGET_TX_SEM_HANDLE( pxRingbuffer ) ( (SemaphoreHandle_t) &(pxRingbuffer->xTransSemStatic) )
@@ -37,6 +42,13 @@
 #define rbGET_RX_SEM_HANDLE( pxRingbuffer ) ( pxRingbuffer->xRecvSemHandle )
 #endif
 
+//Whether the ring buffer may be in the middle of an update. Ports whose critical sections don't use a spinlock don't have a panic handler either.
+#ifdef SPINLOCK_FREE
+#define rbIS_LOCKED( pxRingbuffer )         ( ( pxRingbuffer )->mux.owner != SPINLOCK_FREE )
+#else
+#define rbIS_LOCKED( pxRingbuffer )         ( pdFALSE )
+#endif
+
 typedef struct {
     //This size of this structure must be 32-bit aligned
     size_t xItemLen;
@@ -71,6 +83,8 @@ typedef struct RingbufferDefinition {
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
 
     BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
+    BaseType_t xRecvWaiting;                    //SPSC only. Set by the consumer while it may block on RecvSem
+    BaseType_t xSendWaiting;                    //SPSC only. Set by the producer while it may block on TransSem
     /*
      * TransSem: Binary semaphore used to indicate to a blocked transmitting tasks
      *           that more free space has become available or that the block has
@@ -223,6 +237,65 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize);
 
+/*
+Retrieve up to uxMaxItems items from a no-split ring buffer
+Exit:
+    - Items are returned in FIFO order, along with their sizes if pxItemSizes is not NULL
+    - Returns the number of items retrieved, 0 if there were none available
+*/
+static UBaseType_t prvGetItemsNoSplit(Ringbuffer_t *pxRingbuffer,
+                                      void **ppvItems,
+                                      size_t *pxItemSizes,
+                                      UBaseType_t uxMaxItems);
+
+/*
+ * The following functions implement SPSC ring buffers. They are called without
+ * a critical section: the prv...SPSC() functions of the producer only by the
+ * single producer, and the functions of the consumer only by the single consumer.
+ */
+
+//Producer. Acquire space for an item in a no-split SPSC ring buffer. Returns NULL if the item doesn't currently fit
+static uint8_t *prvAcquireItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
+
+//Producer. Mark an acquired item as written, and make all items written in order available to the consumer
+static void prvSendItemDoneSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Producer. Copy an item to a SPSC ring buffer. Returns pdFALSE if the item doesn't currently fit
+static BaseType_t prvCopyItemSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+
+//Consumer. Retrieve an item (or data up to xMaxSize for byte buffers) from a SPSC ring buffer. Returns NULL if none is available
+static void *prvGetItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize);
+
+//Consumer. Return an item to a SPSC ring buffer, and make the space of all items returned in order available to the producer
+static void prvReturnItemSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Get the maximum size an item that can currently have if sent to a SPSC ring buffer
+static size_t prvGetCurMaxSizeSPSC(Ringbuffer_t *pxRingbuffer);
+
+//Count the items/bytes(for byte buffers) of a SPSC ring buffer that have not yet been read
+static UBaseType_t prvGetItemsWaitingSPSC(Ringbuffer_t *pxRingbuffer);
+
+//Get the total free space of a SPSC ring buffer, for debugging
+static size_t prvGetFreeSizeSPSC(Ringbuffer_t *pxRingbuffer);
+
+/*
+Block on a semaphore until the other side of a SPSC ring buffer made progress
+Entry:
+    - The caller has just failed to send or retrieve an item
+Exit:
+    - Returns pdFALSE once xTicksToWait have elapsed since the first call
+    - Otherwise the caller must try again. The first call only sets *pxWaiting,
+      the other side then gives the semaphore each time it makes progress
+    - The caller must call prvStopWaitSPSC() when it is done
+*/
+static BaseType_t prvWaitSPSC(BaseType_t *pxWaiting, SemaphoreHandle_t xSemaphore, TickType_t *pxTicksEnd, TickType_t xTicksToWait);
+
+//Clear the flag set by prvWaitSPSC()
+static void prvStopWaitSPSC(BaseType_t *pxWaiting);
+
+//Give the semaphore if the other side of a SPSC ring buffer waits in prvWaitSPSC()
+static void prvWakeSPSC(BaseType_t *pxWaiting, SemaphoreHandle_t xSemaphore, BaseType_t xInISR, BaseType_t *pxHigherPriorityTaskWoken);
+
 /* --------------------------- Static Definitions --------------------------- */
 
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
@@ -239,10 +312,34 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
     pxNewRingbuffer->pucWrite = pucRingbufferStorage;
     pxNewRingbuffer->pucAcquire = pucRingbufferStorage;
     pxNewRingbuffer->xItemsWaiting = 0;
+    pxNewRingbuffer->xRecvWaiting = pdFALSE;
+    pxNewRingbuffer->xSendWaiting = pdFALSE;
     pxNewRingbuffer->uxRingbufferFlags = 0;
 
     //Initialize type dependent values and function pointers
-    if (xBufferType == RINGBUF_TYPE_NOSPLIT) {
+    if (xBufferType == RINGBUF_TYPE_NOSPLIT_SPSC || xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+        /*
+         * SPSC buffers are accessed through the prv...SPSC() functions. The
+         * function pointers are only used by the type independent functions.
+         */
+        pxNewRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+        pxNewRingbuffer->xCheckItemFits = NULL;
+        pxNewRingbuffer->vCopyItem = NULL;
+        pxNewRingbuffer->pvGetItem = NULL;
+        pxNewRingbuffer->vReturnItem = NULL;
+        pxNewRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeSPSC;
+        if (xBufferType == RINGBUF_TYPE_NOSPLIT_SPSC) {
+            /*
+             * As for no-split buffers, but an item must also leave at least
+             * 4 bytes free, as pucAcquire == pucFree means the buffer is empty
+             */
+            pxNewRingbuffer->xMaxItemSize = ((pxNewRingbuffer->xSize / 2) & ~rbALIGN_MASK) - rbHEADER_SIZE;
+        } else {
+            pxNewRingbuffer->uxRingbufferFlags |= rbBYTE_BUFFER_FLAG;
+            //Byte buffers must leave at least one byte free
+            pxNewRingbuffer->xMaxItemSize = pxNewRingbuffer->xSize - 1;
+        }
+    } else if (xBufferType == RINGBUF_TYPE_NOSPLIT) {
         pxNewRingbuffer->xCheckItemFits = prvCheckItemFitsDefault;
         pxNewRingbuffer->vCopyItem = prvCopyItemNoSplit;
         pxNewRingbuffer->pvGetItem = prvGetItemDefault;
@@ -767,6 +864,18 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
                                     size_t xMaxSize,
                                     TickType_t xTicksToWait)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //SPSC buffers never split items, pvItem2 is unused
+        TickType_t xTicksEnd;
+        while ((*pvItem1 = prvGetItemSPSC(pxRingbuffer, xMaxSize, xItemSize1)) == NULL) {
+            if (prvWaitSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), &xTicksEnd, xTicksToWait) == pdFALSE) {
+                break;
+            }
+        }
+        prvStopWaitSPSC(&pxRingbuffer->xRecvWaiting);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
     TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
@@ -831,6 +940,11 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        *pvItem1 = prvGetItemSPSC(pxRingbuffer, xMaxSize, xItemSize1);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
 
@@ -867,6 +981,372 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+static UBaseType_t prvGetItemsNoSplit(Ringbuffer_t *pxRingbuffer,
+                                      void **ppvItems,
+                                      size_t *pxItemSizes,
+                                      UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxCount = 0;
+    while (uxCount < uxMaxItems) {
+        size_t xItemSize;
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            ppvItems[uxCount] = prvGetItemSPSC(pxRingbuffer, 0, &xItemSize);
+            if (ppvItems[uxCount] == NULL) {
+                break;
+            }
+        } else {
+            BaseType_t xIsSplit;
+            if (prvCheckItemAvail(pxRingbuffer) == pdFALSE) {
+                break;
+            }
+            //Third argument (xMaxSize) is unused for no-split buffers
+            ppvItems[uxCount] = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &xItemSize);
+        }
+        if (pxItemSizes != NULL) {
+            pxItemSizes[uxCount] = xItemSize;
+        }
+        uxCount++;
+    }
+    return uxCount;
+}
+
+/*
+ * In SPSC ring buffers, pucAcquire and pucWrite are only modified by the
+ * producer, pucRead and pucFree only by the consumer. pucWrite and pucFree are
+ * stored with release semantics after the items (and their headers) they cover.
+ * The buffer full flag and xItemsWaiting are not used. Instead, the producer
+ * never lets pucAcquire catch up with pucFree, so that pucAcquire == pucFree
+ * always means that the buffer is empty, and pucRead == pucWrite that there is
+ * nothing to read.
+ */
+
+static uint8_t *prvAcquireItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
+{
+    size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;    //Rounded up aligned item size with header
+    uint8_t *pucFree = rbLOAD_ACQUIRE(pxRingbuffer->pucFree);
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    uint8_t *pucItem;
+    configASSERT(rbCHECK_ALIGNED(pucAcquire));                          //pucAcquire is always aligned in no-split ring buffers
+    configASSERT(pucAcquire >= pxRingbuffer->pucHead && pucAcquire < pxRingbuffer->pucTail);    //Check acquire pointer is within bounds
+
+    if (pucFree > pucAcquire) {
+        //Free space does not wrap around, the item must end before pucFree
+        if (xTotalItemSize >= pucFree - pucAcquire) {
+            return NULL;
+        }
+        pucItem = pucAcquire;
+    } else if (xTotalItemSize <= pxRingbuffer->pucTail - pucAcquire &&
+               (pxRingbuffer->pucTail - pucAcquire - xTotalItemSize >= rbHEADER_SIZE || pucFree != pxRingbuffer->pucHead)) {
+        //Item fits without wrapping around. If pucAcquire wraps around after the item, pucFree must not be at the head
+        pucItem = pucAcquire;
+    } else {
+        //Item must be stored at the head, and end before pucFree
+        if (xTotalItemSize >= pucFree - pxRingbuffer->pucHead) {
+            return NULL;
+        }
+        ItemHeader_t *pxDummy = (ItemHeader_t *)pucAcquire;
+        pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;      //Set remaining length as dummy data
+        pxDummy->xItemLen = 0;                              //Dummy data should have no length
+        pucItem = pxRingbuffer->pucHead;
+    }
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucItem;
+    pxHeader->xItemLen = xItemSize;
+    pxHeader->uxItemFlags = 0;
+    pucAcquire = pucItem + xTotalItemSize;
+    //If current remaining length can't fit a header, wrap around acquire pointer
+    if (pxRingbuffer->pucTail - pucAcquire < rbHEADER_SIZE) {
+        pucAcquire = pxRingbuffer->pucHead;
+    }
+    pxRingbuffer->pucAcquire = pucAcquire;
+    return pucItem + rbHEADER_SIZE;
+}
+
+static void prvSendItemDoneSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check arguments and buffer state
+    configASSERT(rbCHECK_ALIGNED(pucItem));
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT(pxCurHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) == 0); //Dummy items should never have been written
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_WRITTEN_FLAG) == 0);    //Indicates item has already been written before
+    pxCurHeader->uxItemFlags |= rbITEM_WRITTEN_FLAG;                        //Mark as written
+
+    //As in prvSendItemDoneNoSplit(), move the write pointer past written and dummy items
+    uint8_t *pucWrite = pxRingbuffer->pucWrite;
+    while (pucWrite != pxRingbuffer->pucAcquire) {
+        pxCurHeader = (ItemHeader_t *)pucWrite;
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucWrite = pxRingbuffer->pucHead;     //Wrap around due to dummy data
+        } else if (pxCurHeader->uxItemFlags & rbITEM_WRITTEN_FLAG) {
+            pucWrite += rbHEADER_SIZE + rbALIGN_SIZE(pxCurHeader->xItemLen);
+            //Check if pucWrite requires wrap around
+            if (pxRingbuffer->pucTail - pucWrite < rbHEADER_SIZE) {
+                pucWrite = pxRingbuffer->pucHead;
+            }
+        } else {
+            break;
+        }
+    }
+    //Publish the items to the consumer
+    rbSTORE_RELEASE(pxRingbuffer->pucWrite, pucWrite);
+}
+
+static BaseType_t prvCopyItemSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) == 0) {
+        uint8_t *pucDest = prvAcquireItemSPSC(pxRingbuffer, xItemSize);
+        if (pucDest == NULL) {
+            return pdFALSE;
+        }
+        memcpy(pucDest, pucItem, xItemSize);
+        prvSendItemDoneSPSC(pxRingbuffer, pucDest);
+        return pdTRUE;
+    }
+
+    //Byte buffer. One byte is always left free, as pucAcquire == pucFree means the buffer is empty
+    uint8_t *pucFree = rbLOAD_ACQUIRE(pxRingbuffer->pucFree);
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    BaseType_t xFreeSize = pucFree - pucAcquire;
+    if (xFreeSize <= 0) {
+        xFreeSize += pxRingbuffer->xSize;
+    }
+    if (xItemSize >= xFreeSize) {
+        return pdFALSE;
+    }
+    size_t xRemLen = pxRingbuffer->pucTail - pucAcquire;    //Length from pucAcquire until end of buffer
+    if (xRemLen < xItemSize) {
+        //Copy as much as possible into remaining length
+        memcpy(pucAcquire, pucItem, xRemLen);
+        pucItem += xRemLen;
+        xItemSize -= xRemLen;
+        pucAcquire = pxRingbuffer->pucHead;
+    }
+    memcpy(pucAcquire, pucItem, xItemSize);
+    pucAcquire += xItemSize;
+    //Wrap around pucAcquire if it reaches the end
+    if (pucAcquire == pxRingbuffer->pucTail) {
+        pucAcquire = pxRingbuffer->pucHead;
+    }
+    pxRingbuffer->pucAcquire = pucAcquire;
+    //Publish the data to the consumer
+    rbSTORE_RELEASE(pxRingbuffer->pucWrite, pucAcquire);
+    return pdTRUE;
+}
+
+static void *prvGetItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize)
+{
+    uint8_t *pucWrite = rbLOAD_ACQUIRE(pxRingbuffer->pucWrite);
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+    uint8_t *pcReturn;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        if (pucRead == pucWrite || pucRead != pxRingbuffer->pucFree) {
+            return NULL;    //No data, or byte buffers do not allow multiple retrievals before return
+        }
+        //Return contiguous data from the read pointer to the write pointer or the tail, up to xMaxSize
+        size_t xSize = (pucWrite > pucRead) ? pucWrite - pucRead : pxRingbuffer->pucTail - pucRead;
+        if (xMaxSize != 0 && xSize > xMaxSize) {
+            xSize = xMaxSize;
+        }
+        pcReturn = pucRead;
+        *pxItemSize = xSize;
+        pucRead += xSize;
+        if (pucRead == pxRingbuffer->pucTail) {
+            pucRead = pxRingbuffer->pucHead;    //Wrap around read pointer
+        }
+    } else {
+        if (pucRead == pucWrite) {
+            return NULL;
+        }
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+        //Wrap around if dummy data (dummy data indicates wrap around in no-split buffers)
+        if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucRead = pxRingbuffer->pucHead;
+            pxRingbuffer->pucRead = pucRead;
+            if (pucRead == pucWrite) {
+                return NULL;    //Item after the dummy data is not written yet
+            }
+            pxHeader = (ItemHeader_t *)pucRead;
+        }
+        configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+        pcReturn = pucRead + rbHEADER_SIZE;    //Get pointer to part of item containing data (point past the header)
+        *pxItemSize = pxHeader->xItemLen;
+        pucRead += rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+        //Check if pucRead requires wrap around
+        if (pxRingbuffer->pucTail - pucRead < rbHEADER_SIZE) {
+            pucRead = pxRingbuffer->pucHead;
+        }
+    }
+    pxRingbuffer->pucRead = pucRead;
+    return (void *)pcReturn;
+}
+
+static void prvReturnItemSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check pointer points to address inside buffer
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Byte buffers do not allow multiple outstanding reads, free up to the read pointer
+        rbSTORE_RELEASE(pxRingbuffer->pucFree, pxRingbuffer->pucRead);
+        return;
+    }
+
+    configASSERT(rbCHECK_ALIGNED(pucItem));
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT(pxCurHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) == 0); //Dummy items should never have been read
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) == 0);       //Indicates item has already been returned before
+    pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;                           //Mark as free
+
+    //As in prvReturnItemDefault(), move the free pointer past freed and dummy items
+    uint8_t *pucFree = pxRingbuffer->pucFree;
+    while (pucFree != pxRingbuffer->pucRead) {
+        pxCurHeader = (ItemHeader_t *)pucFree;
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucFree = pxRingbuffer->pucHead;      //Wrap around due to dummy data
+        } else if (pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) {
+            pucFree += rbHEADER_SIZE + rbALIGN_SIZE(pxCurHeader->xItemLen);
+            //Check if pucFree requires wrap around
+            if (pxRingbuffer->pucTail - pucFree < rbHEADER_SIZE) {
+                pucFree = pxRingbuffer->pucHead;
+            }
+        } else {
+            break;
+        }
+    }
+    //Publish the free space to the producer
+    rbSTORE_RELEASE(pxRingbuffer->pucFree, pucFree);
+}
+
+static size_t prvGetCurMaxSizeSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucFree = rbLOAD_ACQUIRE(pxRingbuffer->pucFree);
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    BaseType_t xFreeSize;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        xFreeSize = pucFree - pucAcquire;
+        if (xFreeSize <= 0) {
+            xFreeSize += pxRingbuffer->xSize;
+        }
+        return xFreeSize - 1;   //One byte is always left free
+    }
+
+    //An item must end at least 4 bytes before pucFree, see prvAcquireItemSPSC()
+    if (pucAcquire < pucFree) {
+        xFreeSize = (pucFree - pucAcquire) - (rbALIGN_MASK + 1);
+    } else {
+        BaseType_t xSize1 = pxRingbuffer->pucTail - pucAcquire;
+        BaseType_t xSize2 = (pucFree - pxRingbuffer->pucHead) - (rbALIGN_MASK + 1);
+        if (pucFree == pxRingbuffer->pucHead) {
+            //pucAcquire must not wrap around to pucFree after the item
+            xSize1 -= rbHEADER_SIZE;
+        }
+        xFreeSize = (xSize1 > xSize2) ? xSize1 : xSize2;
+    }
+    //No-split ring buffer items need space for a header
+    xFreeSize -= rbHEADER_SIZE;
+    if (xFreeSize < 0) {
+        xFreeSize = 0;
+    } else if (xFreeSize > pxRingbuffer->xMaxItemSize) {
+        //Limit free size to be within bounds
+        xFreeSize = pxRingbuffer->xMaxItemSize;
+    }
+    return xFreeSize;
+}
+
+static UBaseType_t prvGetItemsWaitingSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucWrite = rbLOAD_ACQUIRE(pxRingbuffer->pucWrite);
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        BaseType_t xBytes = pucWrite - pucRead;
+        if (xBytes < 0) {
+            xBytes += pxRingbuffer->xSize;
+        }
+        return xBytes;
+    }
+    //Walk the headers from the read to the write pointer. The bound guards against pointers read while the consumer moves on
+    UBaseType_t uxItems = 0;
+    for (size_t i = 0; pucRead != pucWrite && i < pxRingbuffer->xSize / rbHEADER_SIZE; i++) {
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+        if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucRead = pxRingbuffer->pucHead;
+            continue;
+        }
+        uxItems++;
+        pucRead += rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+        if (pxRingbuffer->pucTail - pucRead < rbHEADER_SIZE) {
+            pucRead = pxRingbuffer->pucHead;
+        }
+    }
+    return uxItems;
+}
+
+static size_t prvGetFreeSizeSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    //The full flag is not used, pucAcquire == pucFree always means that the buffer is empty
+    BaseType_t xFreeSize = rbLOAD_ACQUIRE(pxRingbuffer->pucFree) - pxRingbuffer->pucAcquire;
+    if (xFreeSize <= 0) {
+        xFreeSize += pxRingbuffer->xSize;
+    }
+    return xFreeSize;
+}
+
+static BaseType_t prvWaitSPSC(BaseType_t *pxWaiting, SemaphoreHandle_t xSemaphore, TickType_t *pxTicksEnd, TickType_t xTicksToWait)
+{
+    if (xTicksToWait == 0) {
+        return pdFALSE;
+    }
+    if (*pxWaiting == pdFALSE) {
+        /*
+         * Announce the wait before trying again. The fence pairs with the one
+         * in prvWakeSPSC(): either the other side sees the flag and gives the
+         * semaphore, or the caller sees the other side's progress.
+         */
+        *pxTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        __atomic_store_n(pxWaiting, pdTRUE, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        return pdTRUE;
+    }
+    TickType_t xTicksRemaining = xTicksToWait;
+    if (xTicksToWait != portMAX_DELAY) {
+        xTicksRemaining = *pxTicksEnd - xTaskGetTickCount();
+        if (xTicksRemaining == 0 || xTicksRemaining > xTicksToWait) {   //xTicksRemaining will underflow once xTaskGetTickCount() > ticks_end
+            return pdFALSE;
+        }
+    }
+    //The semaphore may also have been given before, for progress the caller has already seen
+    xSemaphoreTake(xSemaphore, xTicksRemaining);
+    return pdTRUE;
+}
+
+static void prvStopWaitSPSC(BaseType_t *pxWaiting)
+{
+    if (*pxWaiting == pdTRUE) {
+        __atomic_store_n(pxWaiting, pdFALSE, __ATOMIC_RELAXED);
+    }
+}
+
+static void prvWakeSPSC(BaseType_t *pxWaiting, SemaphoreHandle_t xSemaphore, BaseType_t xInISR, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(pxWaiting, __ATOMIC_RELAXED) == pdTRUE) {
+        if (xInISR == pdTRUE) {
+            xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken);
+        } else {
+            xSemaphoreGive(xSemaphore);
+        }
+    }
+}
+
 /* --------------------------- Public Definitions --------------------------- */
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
@@ -875,7 +1355,7 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferTy
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
 
     //Allocate memory
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+    if (xBufferType != RINGBUF_TYPE_BYTEBUF && xBufferType != RINGBUF_TYPE_BYTEBUF_SPSC) {
         xBufferSize = rbALIGN_SIZE(xBufferSize);    //xBufferSize is rounded up for no-split/allow-split buffers
     }
     Ringbuffer_t *pxNewRingbuffer = calloc(1, sizeof(Ringbuffer_t));
@@ -928,7 +1408,7 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
     configASSERT(pucRingbufferStorage != NULL && pxStaticRingbuffer != NULL);
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+    if (xBufferType != RINGBUF_TYPE_BYTEBUF && xBufferType != RINGBUF_TYPE_BYTEBUF_SPSC) {
         //No-split/allow-split buffer sizes must be 32-bit aligned
         configASSERT(rbCHECK_ALIGNED(xBufferSize));
     }
@@ -959,6 +1439,17 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        TickType_t xTicksEnd;
+        while ((*ppvItem = prvAcquireItemSPSC(pxRingbuffer, xItemSize)) == NULL) {
+            if (prvWaitSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), &xTicksEnd, xTicksToWait) == pdFALSE) {
+                break;
+            }
+        }
+        prvStopWaitSPSC(&pxRingbuffer->xSendWaiting);
+        return (*ppvItem != NULL) ? pdTRUE : pdFALSE;
+    }
+
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
@@ -1009,6 +1500,12 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pvItem != NULL);
     configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSendItemDoneSPSC(pxRingbuffer, pvItem);
+        prvWakeSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pdFALSE, NULL);
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     prvSendItemDoneNoSplit(pxRingbuffer, pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1017,6 +1514,118 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     return pdTRUE;
 }
 
+UBaseType_t xRingbufferSendAcquireMultiple(RingbufHandle_t xRingbuffer,
+                                           void **ppvItems,
+                                           const size_t *pxItemSizes,
+                                           UBaseType_t uxItems,
+                                           TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL && pxItemSizes != NULL);
+    //currently only supported in NoSplit buffers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        ppvItems[i] = NULL;
+        if (pxItemSizes[i] > pxRingbuffer->xMaxItemSize) {
+            return 0;       //Data will never ever fit in the queue.
+        }
+    }
+    if (uxItems == 0) {
+        return 0;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        TickType_t xTicksEnd;
+        UBaseType_t uxAcquired = 0;
+        for (;;) {
+            while (uxAcquired < uxItems && (ppvItems[uxAcquired] = prvAcquireItemSPSC(pxRingbuffer, pxItemSizes[uxAcquired])) != NULL) {
+                uxAcquired++;
+            }
+            if (uxAcquired > 0 || prvWaitSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), &xTicksEnd, xTicksToWait) == pdFALSE) {
+                break;
+            }
+        }
+        prvStopWaitSPSC(&pxRingbuffer->xSendWaiting);
+        return uxAcquired;
+    }
+
+    //Attempt to acquire the items
+    UBaseType_t uxAcquired = 0;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more free space becomes available or timeout
+        if (xSemaphoreTake(rbGET_TX_SEM_HANDLE(pxRingbuffer), xTicksRemaining) != pdTRUE) {
+            break;
+        }
+
+        //Semaphore obtained, acquire as many items as will fit in FIFO order
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        while (uxAcquired < uxItems && pxRingbuffer->xCheckItemFits(pxRingbuffer, pxItemSizes[uxAcquired]) == pdTRUE) {
+            ppvItems[uxAcquired] = prvAcquireItemNoSplit(pxRingbuffer, pxItemSizes[uxAcquired]);
+            uxAcquired++;
+        }
+        if (uxAcquired > 0) {
+            //Check if the free semaphore should be returned to allow other tasks to send
+            if (prvGetFreeSize(pxRingbuffer) > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //First item doesn't fit, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));  //Give back semaphore so other tasks can acquire
+    }
+    return uxAcquired;
+}
+
+BaseType_t xRingbufferSendCompleteMultiple(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItems == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+    if (uxItems == 0) {
+        return pdTRUE;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxItems; i++) {
+            configASSERT(ppvItems[i] != NULL);
+            prvSendItemDoneSPSC(pxRingbuffer, ppvItems[i]);
+        }
+        prvWakeSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pdFALSE, NULL);
+        return pdTRUE;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        configASSERT(ppvItems[i] != NULL);
+        prvSendItemDoneNoSplit(pxRingbuffer, ppvItems[i]);
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+
+    //A single give wakes the receiver for the whole batch
+    xSemaphoreGive(rbGET_RX_SEM_HANDLE(pxRingbuffer));
+    return pdTRUE;
+}
+
 BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
                            const void *pvItem,
                            size_t xItemSize,
@@ -1033,6 +1642,21 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        TickType_t xTicksEnd;
+        BaseType_t xReturn;
+        while ((xReturn = prvCopyItemSPSC(pxRingbuffer, pvItem, xItemSize)) == pdFALSE) {
+            if (prvWaitSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), &xTicksEnd, xTicksToWait) == pdFALSE) {
+                break;
+            }
+        }
+        prvStopWaitSPSC(&pxRingbuffer->xSendWaiting);
+        if (xReturn == pdTRUE) {
+            prvWakeSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pdFALSE, NULL);
+        }
+        return xReturn;
+    }
+
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
@@ -1094,6 +1718,14 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        BaseType_t xReturn = prvCopyItemSPSC(pxRingbuffer, pvItem, xItemSize);
+        if (xReturn == pdTRUE) {
+            prvWakeSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pdTRUE, pxHigherPriorityTaskWoken);
+        }
+        return xReturn;
+    }
+
     //Attempt to send an item
     BaseType_t xReturn;
     BaseType_t xReturnSemaphore = pdFALSE;
@@ -1158,6 +1790,35 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
     }
 }
 
+void *xRingbufferReceiveFromPanic(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+
+    void *pvTempItem;
+    size_t xTempSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //No spinlock is used
+        pvTempItem = prvGetItemSPSC(pxRingbuffer, 0, &xTempSize);
+    } else {
+        if (rbIS_LOCKED(pxRingbuffer) || prvCheckItemAvail(pxRingbuffer) == pdFALSE) {
+            return NULL;
+        }
+        //The lock is not taken, nothing else can access the ring buffer. The RX semaphore is not given back.
+        BaseType_t xIsSplit;
+        if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+            pvTempItem = pxRingbuffer->pvGetItem(pxRingbuffer, NULL, 0, &xTempSize);
+        } else {
+            pvTempItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &xTempSize);
+        }
+    }
+    if (pvTempItem != NULL && pxItemSize != NULL) {
+        *pxItemSize = xTempSize;
+    }
+    return pvTempItem;
+}
+
 BaseType_t xRingbufferReceiveSplit(RingbufHandle_t xRingbuffer,
                                    void **ppvHeadItem,
                                    void **ppvTailItem,
@@ -1285,12 +1946,116 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
 }
 
+UBaseType_t xRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                       void **ppvItems,
+                                       size_t *pxItemSizes,
+                                       UBaseType_t uxMaxItems,
+                                       TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL);
+    //currently only supported in NoSplit buffers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        TickType_t xTicksEnd;
+        UBaseType_t uxReceived;
+        while ((uxReceived = prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems)) == 0) {
+            if (prvWaitSPSC(&pxRingbuffer->xRecvWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), &xTicksEnd, xTicksToWait) == pdFALSE) {
+                break;
+            }
+        }
+        prvStopWaitSPSC(&pxRingbuffer->xRecvWaiting);
+        return uxReceived;
+    }
+
+    //Attempt to retrieve up to uxMaxItems items
+    UBaseType_t uxReceived = 0;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more items become available or timeout
+        if (xSemaphoreTake(rbGET_RX_SEM_HANDLE(pxRingbuffer), xTicksRemaining) != pdTRUE) {
+            break;
+        }
+
+        //Semaphore obtained, retrieve all available items up to uxMaxItems
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        uxReceived = prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems);
+        if (uxReceived > 0) {
+            if (pxRingbuffer->xItemsWaiting > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //No item available for retrieval, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(rbGET_RX_SEM_HANDLE(pxRingbuffer));  //Give semaphore back so other tasks can retrieve
+    }
+    return uxReceived;
+}
+
+UBaseType_t xRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                              void **ppvItems,
+                                              size_t *pxItemSizes,
+                                              UBaseType_t uxMaxItems)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL);
+    //currently only supported in NoSplit buffers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems);
+    }
+
+    //Attempt to retrieve up to uxMaxItems items
+    UBaseType_t uxReceived;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    uxReceived = prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems);
+    if (uxReceived > 0 && pxRingbuffer->xItemsWaiting > 0) {
+        xReturnSemaphore = pdTRUE;
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGiveFromISR(rbGET_RX_SEM_HANDLE(pxRingbuffer), NULL);  //Give semaphore back so other tasks can retrieve
+    }
+    return uxReceived;
+}
+
 void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvReturnItemSPSC(pxRingbuffer, (uint8_t *)pvItem);
+        prvWakeSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), pdFALSE, NULL);
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1303,12 +2068,72 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvReturnItemSPSC(pxRingbuffer, (uint8_t *)pvItem);
+        prvWakeSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
     xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
 }
 
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItems == 0);
+    if (uxItems == 0) {
+        return;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxItems; i++) {
+            configASSERT(ppvItems[i] != NULL);
+            prvReturnItemSPSC(pxRingbuffer, (uint8_t *)ppvItems[i]);
+        }
+        prvWakeSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), pdFALSE, NULL);
+        return;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        configASSERT(ppvItems[i] != NULL);
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)ppvItems[i]);
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+    xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));
+}
+
+void vRingbufferReturnItemsFromISR(RingbufHandle_t xRingbuffer, void * const *ppvItems, UBaseType_t uxItems, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItems == 0);
+    if (uxItems == 0) {
+        return;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxItems; i++) {
+            configASSERT(ppvItems[i] != NULL);
+            prvReturnItemSPSC(pxRingbuffer, (uint8_t *)ppvItems[i]);
+        }
+        prvWakeSPSC(&pxRingbuffer->xSendWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        configASSERT(ppvItems[i] != NULL);
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)ppvItems[i]);
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1350,6 +2175,8 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    //SPSC buffers only give the read semaphore to a blocked receiver
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
 
     BaseType_t xReturn;
     portENTER_CRITICAL(&pxRingbuffer->mux);
@@ -1414,7 +2241,11 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
         *uxAcquire = (UBaseType_t)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            *uxItemsWaiting = prvGetItemsWaitingSPSC(pxRingbuffer);
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
@@ -1423,8 +2254,14 @@ void xRingbufferPrintInfo(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    size_t xFreeSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        xFreeSize = prvGetFreeSizeSPSC(pxRingbuffer);
+    } else {
+        xFreeSize = prvGetFreeSize(pxRingbuffer);
+    }
     printf("Rb size:%d\tfree: %d\trptr: %d\tfreeptr: %d\twptr: %d, aptr: %d\n",
-           pxRingbuffer->xSize, prvGetFreeSize(pxRingbuffer),
+           pxRingbuffer->xSize, xFreeSize,
            pxRingbuffer->pucRead - pxRingbuffer->pucHead,
            pxRingbuffer->pucFree - pxRingbuffer->pucHead,
            pxRingbuffer->pucWrite - pxRingbuffer->pucHead,
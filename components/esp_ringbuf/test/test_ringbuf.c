@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -857,7 +858,7 @@ static void read_from_buffer(RingbufHandle_t buffer, RingbufferType_t buf_type,
             char *item_data, *item_data2;
 
             //Select appropriate receive function for type of ring buffer
-            if (buf_type ==  RINGBUF_TYPE_NOSPLIT) {
+            if (buf_type ==  RINGBUF_TYPE_NOSPLIT || buf_type == RINGBUF_TYPE_NOSPLIT_SPSC) {
                 item_data = (char *)xRingbufferReceive(buffer, &item_size, TIMEOUT_TICKS);
             } else if (buf_type == RINGBUF_TYPE_ALLOWSPLIT) {
                 BaseType_t ret = xRingbufferReceiveSplit(buffer, (void **)&item_data, (void **)&item_data2, &item_size, &item_size2, TIMEOUT_TICKS);
@@ -868,7 +869,7 @@ static void read_from_buffer(RingbufHandle_t buffer, RingbufferType_t buf_type,
 
             //Check received item and return it
             TEST_ASSERT_MESSAGE(item_data != NULL, "Failed to receive an item");
-            if (buf_type == RINGBUF_TYPE_BYTEBUF) {
+            if (buf_type == RINGBUF_TYPE_BYTEBUF || buf_type == RINGBUF_TYPE_BYTEBUF_SPSC) {
                 TEST_ASSERT_MESSAGE(item_size <= max_rec_size, "Received data exceeds max size");
             }
             for (int i = 0; i < item_size; i++) {
@@ -942,7 +943,7 @@ static void cleanup(void)
 TEST_CASE("Test ring buffer SMP", "[esp_ringbuf]")
 {
     setup();
-    //Iterate through buffer types (No split, split, then byte buff)
+    //Iterate through buffer types (No split, split, byte buff, then the SPSC types)
     for (RingbufferType_t buf_type = 0; buf_type < RINGBUF_TYPE_MAX; buf_type++) {
         //Create buffer
         task_args_t task_args;
@@ -974,7 +975,7 @@ TEST_CASE("Test ring buffer SMP", "[esp_ringbuf]")
 TEST_CASE("Test static ring buffer SMP", "[esp_ringbuf]")
 {
     setup();
-    //Iterate through buffer types (No split, split, then byte buff)
+    //Iterate through buffer types (No split, split, byte buff, then the SPSC types)
     for (RingbufferType_t buf_type = 0; buf_type < RINGBUF_TYPE_MAX; buf_type++) {
         StaticRingbuffer_t *buffer_struct;
         uint8_t *buffer_storage;
@@ -1019,6 +1020,104 @@ TEST_CASE("Test static ring buffer SMP", "[esp_ringbuf]")
 }
 #endif
 
+TEST_CASE("Test ring buffer receive from panic handler", "[esp_ringbuf]")
+{
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT(xRingbufferSend(buffer_handle, &i, sizeof(i), 0) == pdTRUE);
+    }
+
+    //Items are retrieved in order without returning them
+    size_t item_size;
+    for (int i = 0; i < 3; i++) {
+        int *item = (int *)xRingbufferReceiveFromPanic(buffer_handle, &item_size);
+        TEST_ASSERT_NOT_NULL(item);
+        TEST_ASSERT_EQUAL(sizeof(int), item_size);
+        TEST_ASSERT_EQUAL(i, *item);
+    }
+    TEST_ASSERT_NULL(xRingbufferReceiveFromPanic(buffer_handle, &item_size));
+    vRingbufferDelete(buffer_handle);
+}
+
+/* ------------------------- Test batched item APIs -------------------------- */
+
+/*
+ * The following test sends items to a no-split buffer in batches with
+ * xRingbufferSendAcquireMultiple() and xRingbufferSendCompleteMultiple(), and
+ * receives them in batches with xRingbufferReceiveMultiple() and
+ * vRingbufferReturnItems(). Their throughput is compared to sending and
+ * receiving one item per call by a benchmark of the host test (test_ringbuf_host).
+ */
+
+#define BATCH_TEST_BUFF_LEN             256
+#define BATCH_TEST_MAX_ITEMS            8
+
+TEST_CASE("Test ring buffer batched send and receive", "[esp_ringbuf]")
+{
+    RingbufHandle_t handle = xRingbufferCreate(BATCH_TEST_BUFF_LEN, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(handle != NULL, "Failed to create ring buffer");
+    void *items[BATCH_TEST_MAX_ITEMS];
+    size_t sizes[BATCH_TEST_MAX_ITEMS];
+    uint32_t next_send = 0;
+    uint32_t next_recv = 0;
+
+    srand(SRAND_SEED);
+    for (int iter = 0; iter < 1000; iter++) {
+        //Acquire space for a batch of items of random size, as many as fit
+        size_t req_sizes[BATCH_TEST_MAX_ITEMS];
+        UBaseType_t req_items = 1 + rand() % BATCH_TEST_MAX_ITEMS;
+        for (int i = 0; i < req_items; i++) {
+            req_sizes[i] = sizeof(uint32_t) + rand() % LARGE_ITEM_SIZE;
+        }
+        UBaseType_t acquired = xRingbufferSendAcquireMultiple(handle, items, req_sizes, req_items, 0);
+        for (int i = 0; i < acquired; i++) {
+            memset(items[i], (uint8_t)next_send, req_sizes[i]);
+            memcpy(items[i], &next_send, sizeof(uint32_t));
+            next_send++;
+        }
+        for (int i = acquired; i < req_items; i++) {
+            TEST_ASSERT_NULL(items[i]);
+        }
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultiple(handle, items, acquired));
+
+        //Receive a batch of items, check they are in FIFO order, and return them in reverse order
+        UBaseType_t max_items = 1 + rand() % BATCH_TEST_MAX_ITEMS;
+        UBaseType_t received = xRingbufferReceiveMultiple(handle, items, sizes, max_items, 0);
+        TEST_ASSERT(received <= max_items);
+        for (int i = 0; i < received; i++) {
+            uint32_t seq;
+            memcpy(&seq, items[i], sizeof(uint32_t));
+            TEST_ASSERT_EQUAL_UINT32(next_recv, seq);
+            for (int j = sizeof(uint32_t); j < sizes[i]; j++) {
+                TEST_ASSERT_EQUAL_HEX8((uint8_t)next_recv, ((uint8_t *)items[i])[j]);
+            }
+            next_recv++;
+        }
+        for (int i = 0; i < received / 2; i++) {
+            void *tmp = items[i];
+            items[i] = items[received - 1 - i];
+            items[received - 1 - i] = tmp;
+        }
+        vRingbufferReturnItems(handle, items, received);
+    }
+
+    //Drain the buffer from an ISR context
+    UBaseType_t received;
+    while ((received = xRingbufferReceiveMultipleFromISR(handle, items, NULL, BATCH_TEST_MAX_ITEMS)) > 0) {
+        next_recv += received;
+        vRingbufferReturnItemsFromISR(handle, items, received, NULL);
+    }
+    TEST_ASSERT_EQUAL_UINT32(next_send, next_recv);
+    TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(handle), xRingbufferGetCurFreeSize(handle));
+
+    //Items that can never fit are rejected, and receiving from an empty buffer times out
+    size_t too_large = xRingbufferGetMaxItemSize(handle) + 1;
+    TEST_ASSERT_EQUAL(0, xRingbufferSendAcquireMultiple(handle, items, &too_large, 1, 0));
+    TEST_ASSERT_EQUAL(0, xRingbufferReceiveMultiple(handle, items, sizes, BATCH_TEST_MAX_ITEMS, TIMEOUT_TICKS));
+    vRingbufferDelete(handle);
+}
+
 /* -------------------------- Test ring buffer IRAM ------------------------- */
 
 static IRAM_ATTR __attribute__((noinline)) bool iram_ringbuf_test(void)
@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Minimal FreeRTOS API for building ringbuf.c on the host. Critical sections
+ * are mutexes and binary semaphores are built with a mutex and a condition
+ * variable, ticks are milliseconds.
+ */
+
+#pragma once
+
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define configSUPPORT_STATIC_ALLOCATION 0
+#define configASSERT(x)             assert(x)
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZE(mux)     pthread_mutex_init((mux), NULL)
+#define portENTER_CRITICAL(mux)     pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)      pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux)  pthread_mutex_unlock(mux)
+
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
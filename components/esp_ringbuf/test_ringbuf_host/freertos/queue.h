@@ -0,0 +1,23 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+/* Queue sets are not supported on the host */
+typedef void *QueueSetHandle_t;
+typedef void *QueueSetMemberHandle_t;
+
+static inline BaseType_t xQueueAddToSet(void *xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+    return pdFALSE;
+}
+
+static inline BaseType_t xQueueRemoveFromSet(void *xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+    return pdFALSE;
+}
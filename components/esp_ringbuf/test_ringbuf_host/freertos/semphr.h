@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int given;
+} host_semaphore_t;
+
+typedef host_semaphore_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    host_semaphore_t *sem = (host_semaphore_t *)calloc(1, sizeof(host_semaphore_t));
+    if (sem != NULL) {
+        pthread_mutex_init(&sem->mutex, NULL);
+        pthread_cond_init(&sem->cond, NULL);
+    }
+    return sem;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->mutex);
+    free(sem);
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    BaseType_t ret = sem->given ? pdFALSE : pdTRUE;
+    sem->given = 1;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+    return ret;
+}
+
+static inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    return xSemaphoreGive(sem);
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sem->mutex);
+    while (!sem->given && ticks != 0) {
+        int err = (ticks == portMAX_DELAY) ? pthread_cond_wait(&sem->cond, &sem->mutex)
+                  : pthread_cond_timedwait(&sem->cond, &sem->mutex, &deadline);
+        if (err == ETIMEDOUT) {
+            break;
+        }
+    }
+    BaseType_t ret = sem->given ? pdTRUE : pdFALSE;
+    sem->given = 0;
+    pthread_mutex_unlock(&sem->mutex);
+    return ret;
+}
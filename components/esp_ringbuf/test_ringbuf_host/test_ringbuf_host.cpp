@@ -0,0 +1,398 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define STRESS_BUFF_LEN         1024
+#define STRESS_ITEMS            200000
+#define STRESS_BYTES            (8 * 1024 * 1024)
+#define BENCH_ITEMS             1000000
+#define BENCH_ITEM_SIZE         16
+#define BENCH_BATCH_SIZE        32
+#define TIMEOUT_TICKS           1000
+
+/* Size and contents of the items are derived from their sequence number, so the consumer can check them */
+static size_t item_size(uint32_t seq, size_t max_size)
+{
+    return sizeof(uint32_t) + (seq * 7919) % (max_size - sizeof(uint32_t) + 1);
+}
+
+static void fill_item(uint8_t *item, size_t size, uint32_t seq)
+{
+    memcpy(item, &seq, sizeof(seq));
+    for (size_t i = sizeof(seq); i < size; i++) {
+        item[i] = (uint8_t)(seq * 31 + i);
+    }
+}
+
+static bool check_item(const uint8_t *item, size_t size, uint32_t seq, size_t max_size)
+{
+    uint32_t item_seq;
+    if (size != item_size(seq, max_size)) {
+        return false;
+    }
+    memcpy(&item_seq, item, sizeof(item_seq));
+    if (item_seq != seq) {
+        return false;
+    }
+    for (size_t i = sizeof(seq); i < size; i++) {
+        if (item[i] != (uint8_t)(seq * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t stream_byte(size_t offset)
+{
+    return (uint8_t)(offset * 13 + (offset >> 8));
+}
+
+/*
+ * Producer of no-split buffers. Sends items by copy, by acquire/complete, and
+ * by batches completed in reverse order.
+ */
+static void send_items(RingbufHandle_t buffer, std::atomic<bool> *failed)
+{
+    size_t max_size = xRingbufferGetMaxItemSize(buffer) / 4;
+    uint8_t item[STRESS_BUFF_LEN];
+    uint32_t seq = 0;
+    while (seq < STRESS_ITEMS) {
+        switch (seq % 3) {
+        case 0: {
+            size_t size = item_size(seq, max_size);
+            fill_item(item, size, seq);
+            if (xRingbufferSend(buffer, item, size, TIMEOUT_TICKS) != pdTRUE) {
+                *failed = true;
+                return;
+            }
+            seq++;
+            break;
+        }
+        case 1: {
+            size_t size = item_size(seq, max_size);
+            void *acquired;
+            if (xRingbufferSendAcquire(buffer, &acquired, size, TIMEOUT_TICKS) != pdTRUE) {
+                *failed = true;
+                return;
+            }
+            fill_item((uint8_t *)acquired, size, seq);
+            xRingbufferSendComplete(buffer, acquired);
+            seq++;
+            break;
+        }
+        default: {
+            void *items[4];
+            size_t sizes[4];
+            UBaseType_t count = (STRESS_ITEMS - seq < 4) ? STRESS_ITEMS - seq : 4;
+            for (UBaseType_t i = 0; i < count; i++) {
+                sizes[i] = item_size(seq + i, max_size);
+            }
+            count = xRingbufferSendAcquireMultiple(buffer, items, sizes, count, TIMEOUT_TICKS);
+            if (count == 0) {
+                *failed = true;
+                return;
+            }
+            for (UBaseType_t i = 0; i < count; i++) {
+                fill_item((uint8_t *)items[i], sizes[i], seq + i);
+            }
+            for (UBaseType_t i = 0; i < count / 2; i++) {
+                std::swap(items[i], items[count - 1 - i]);
+            }
+            xRingbufferSendCompleteMultiple(buffer, items, count);
+            seq += count;
+            break;
+        }
+        }
+    }
+}
+
+/* Consumer of no-split buffers. Receives single items and batches, and returns batches in reverse order */
+static bool receive_items(RingbufHandle_t buffer)
+{
+    size_t max_size = xRingbufferGetMaxItemSize(buffer) / 4;
+    uint32_t seq = 0;
+    while (seq < STRESS_ITEMS) {
+        if (seq % 2 == 0) {
+            size_t size;
+            uint8_t *item = (uint8_t *)xRingbufferReceive(buffer, &size, TIMEOUT_TICKS);
+            if (item == NULL || !check_item(item, size, seq, max_size)) {
+                return false;
+            }
+            vRingbufferReturnItem(buffer, item);
+            seq++;
+        } else {
+            void *items[8];
+            size_t sizes[8];
+            UBaseType_t count = xRingbufferReceiveMultiple(buffer, items, sizes, 8, TIMEOUT_TICKS);
+            if (count == 0) {
+                return false;
+            }
+            for (UBaseType_t i = 0; i < count; i++) {
+                if (!check_item((uint8_t *)items[i], sizes[i], seq + i, max_size)) {
+                    return false;
+                }
+            }
+            for (UBaseType_t i = 0; i < count / 2; i++) {
+                std::swap(items[i], items[count - 1 - i]);
+            }
+            vRingbufferReturnItems(buffer, items, count);
+            seq += count;
+        }
+    }
+    return true;
+}
+
+static void send_bytes(RingbufHandle_t buffer, std::atomic<bool> *failed)
+{
+    uint8_t data[STRESS_BUFF_LEN];
+    size_t max_size = xRingbufferGetMaxItemSize(buffer);
+    size_t offset = 0;
+    while (offset < STRESS_BYTES) {
+        size_t size = 1 + (offset * 7919) % max_size;
+        if (size > STRESS_BYTES - offset) {
+            size = STRESS_BYTES - offset;
+        }
+        for (size_t i = 0; i < size; i++) {
+            data[i] = stream_byte(offset + i);
+        }
+        if (xRingbufferSend(buffer, data, size, TIMEOUT_TICKS) != pdTRUE) {
+            *failed = true;
+            return;
+        }
+        offset += size;
+    }
+}
+
+static bool receive_bytes(RingbufHandle_t buffer)
+{
+    size_t offset = 0;
+    while (offset < STRESS_BYTES) {
+        size_t max_size = 1 + offset % 500;
+        size_t size;
+        uint8_t *data = (uint8_t *)xRingbufferReceiveUpTo(buffer, &size, TIMEOUT_TICKS, max_size);
+        if (data == NULL || size == 0 || size > max_size) {
+            return false;
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (data[i] != stream_byte(offset + i)) {
+                return false;
+            }
+        }
+        vRingbufferReturnItem(buffer, data);
+        offset += size;
+    }
+    return true;
+}
+
+static void stress_test(RingbufferType_t type)
+{
+    RingbufHandle_t buffer = xRingbufferCreate(STRESS_BUFF_LEN, type);
+    REQUIRE(buffer != NULL);
+    std::atomic<bool> failed(false);
+    bool bytes = (type == RINGBUF_TYPE_BYTEBUF || type == RINGBUF_TYPE_BYTEBUF_SPSC);
+
+    std::thread producer(bytes ? send_bytes : send_items, buffer, &failed);
+    bool received = bytes ? receive_bytes(buffer) : receive_items(buffer);
+    producer.join();
+    REQUIRE(received);
+    REQUIRE_FALSE(failed);
+
+    //Everything was returned
+    UBaseType_t items_waiting;
+    vRingbufferGetInfo(buffer, NULL, NULL, NULL, NULL, &items_waiting);
+    REQUIRE(items_waiting == 0);
+    REQUIRE(xRingbufferGetCurFreeSize(buffer) == xRingbufferGetMaxItemSize(buffer));
+    vRingbufferDelete(buffer);
+}
+
+TEST_CASE("no-split buffers pass items between two threads in order")
+{
+    stress_test(RINGBUF_TYPE_NOSPLIT);
+    stress_test(RINGBUF_TYPE_NOSPLIT_SPSC);
+}
+
+TEST_CASE("byte buffers pass data between two threads in order")
+{
+    stress_test(RINGBUF_TYPE_BYTEBUF);
+    stress_test(RINGBUF_TYPE_BYTEBUF_SPSC);
+}
+
+TEST_CASE("SPSC buffers fill up and time out")
+{
+    uint8_t item[16] = {0};
+    //Item header is a length and a flags word
+    const size_t header_size = sizeof(size_t) + sizeof(UBaseType_t);
+
+    RingbufHandle_t buffer = xRingbufferCreate(256, RINGBUF_TYPE_NOSPLIT_SPSC);
+    REQUIRE(buffer != NULL);
+    REQUIRE(xRingbufferGetMaxItemSize(buffer) == 128 - header_size);
+    UBaseType_t sent = 0;
+    while (xRingbufferSend(buffer, item, sizeof(item), 0) == pdTRUE) {
+        sent++;
+    }
+    //4 bytes must stay free
+    REQUIRE(sent == (256 - 4) / (header_size + sizeof(item)));
+    REQUIRE(xRingbufferGetCurFreeSize(buffer) < sizeof(item));
+    UBaseType_t items_waiting;
+    vRingbufferGetInfo(buffer, NULL, NULL, NULL, NULL, &items_waiting);
+    REQUIRE(items_waiting == sent);
+
+    //A blocked sender is woken up when an item is returned
+    std::thread producer([buffer, &item]() {
+        REQUIRE(xRingbufferSend(buffer, item, sizeof(item), portMAX_DELAY) == pdTRUE);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    size_t size;
+    void *received = xRingbufferReceive(buffer, &size, 0);
+    REQUIRE(received != NULL);
+    vRingbufferReturnItem(buffer, received);
+    producer.join();
+
+    //Drain, then receiving times out
+    while ((received = xRingbufferReceive(buffer, &size, 0)) != NULL) {
+        vRingbufferReturnItem(buffer, received);
+    }
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(xRingbufferReceive(buffer, &size, 10) == NULL);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(9));
+    //Zero length items are still items
+    REQUIRE(xRingbufferSend(buffer, NULL, 0, 0) == pdTRUE);
+    received = xRingbufferReceive(buffer, &size, 0);
+    REQUIRE(received != NULL);
+    REQUIRE(size == 0);
+    vRingbufferReturnItem(buffer, received);
+    size_t too_large = xRingbufferGetMaxItemSize(buffer) + 1;
+    void *acquired;
+    REQUIRE(xRingbufferSendAcquire(buffer, &acquired, too_large, 0) == pdFALSE);
+    vRingbufferDelete(buffer);
+
+    buffer = xRingbufferCreate(100, RINGBUF_TYPE_BYTEBUF_SPSC);
+    REQUIRE(buffer != NULL);
+    REQUIRE(xRingbufferGetMaxItemSize(buffer) == 99);
+    uint8_t data[99] = {0};
+    REQUIRE(xRingbufferSend(buffer, data, sizeof(data), 0) == pdTRUE);
+    REQUIRE(xRingbufferGetCurFreeSize(buffer) == 0);
+    REQUIRE(xRingbufferSend(buffer, data, 1, 0) == pdFALSE);
+    vRingbufferDelete(buffer);
+}
+
+static double bench(RingbufferType_t type)
+{
+    RingbufHandle_t buffer = xRingbufferCreate(4096, type);
+    REQUIRE(buffer != NULL);
+    bool bytes = (type == RINGBUF_TYPE_BYTEBUF || type == RINGBUF_TYPE_BYTEBUF_SPSC);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([buffer]() {
+        uint8_t item[BENCH_ITEM_SIZE] = {0};
+        for (int i = 0; i < BENCH_ITEMS; i++) {
+            xRingbufferSend(buffer, item, sizeof(item), portMAX_DELAY);
+        }
+    });
+    size_t received = 0;
+    while (received < (size_t)BENCH_ITEMS * (bytes ? BENCH_ITEM_SIZE : 1)) {
+        size_t size;
+        void *item = xRingbufferReceive(buffer, &size, portMAX_DELAY);
+        if (item == NULL) {
+            break;
+        }
+        received += bytes ? size : 1;
+        vRingbufferReturnItem(buffer, item);
+    }
+    producer.join();
+    REQUIRE(received == (size_t)BENCH_ITEMS * (bytes ? BENCH_ITEM_SIZE : 1));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    vRingbufferDelete(buffer);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_ITEMS;
+}
+
+TEST_CASE("SPSC buffer throughput", "[.][bench]")
+{
+    printf("%d items of %d bytes between two threads, ns per item:\n", BENCH_ITEMS, BENCH_ITEM_SIZE);
+    printf("no-split: locked %.1f, SPSC %.1f\n", bench(RINGBUF_TYPE_NOSPLIT), bench(RINGBUF_TYPE_NOSPLIT_SPSC));
+    printf("byte buffer: locked %.1f, SPSC %.1f\n", bench(RINGBUF_TYPE_BYTEBUF), bench(RINGBUF_TYPE_BYTEBUF_SPSC));
+}
+
+/* One item per call against batches of BENCH_BATCH_SIZE items, for a no-split buffer. Returns ns per item. */
+static double batch_bench(bool batched)
+{
+    RingbufHandle_t buffer = xRingbufferCreate(4096, RINGBUF_TYPE_NOSPLIT);
+    REQUIRE(buffer != NULL);
+    std::atomic<bool> failed(false);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([buffer, batched, &failed]() {
+        uint32_t seq = 0;
+        if (batched) {
+            void *items[BENCH_BATCH_SIZE];
+            size_t sizes[BENCH_BATCH_SIZE];
+            for (int i = 0; i < BENCH_BATCH_SIZE; i++) {
+                sizes[i] = BENCH_ITEM_SIZE;
+            }
+            while (seq < BENCH_ITEMS) {
+                UBaseType_t count = (BENCH_ITEMS - seq < BENCH_BATCH_SIZE) ? BENCH_ITEMS - seq : BENCH_BATCH_SIZE;
+                count = xRingbufferSendAcquireMultiple(buffer, items, sizes, count, portMAX_DELAY);
+                for (UBaseType_t i = 0; i < count; i++, seq++) {
+                    memcpy(items[i], &seq, sizeof(seq));
+                }
+                xRingbufferSendCompleteMultiple(buffer, items, count);
+            }
+        } else {
+            uint8_t item[BENCH_ITEM_SIZE] = {0};
+            for (; seq < BENCH_ITEMS; seq++) {
+                memcpy(item, &seq, sizeof(seq));
+                if (xRingbufferSend(buffer, item, sizeof(item), portMAX_DELAY) != pdTRUE) {
+                    failed = true;
+                    return;
+                }
+            }
+        }
+    });
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < BENCH_ITEMS && !failed) {
+        if (batched) {
+            void *items[BENCH_BATCH_SIZE];
+            UBaseType_t count = xRingbufferReceiveMultiple(buffer, items, NULL, BENCH_BATCH_SIZE, TIMEOUT_TICKS);
+            for (UBaseType_t i = 0; i < count; i++, expected++) {
+                in_order = in_order && memcmp(items[i], &expected, sizeof(expected)) == 0;
+            }
+            vRingbufferReturnItems(buffer, items, count);
+        } else {
+            size_t size;
+            void *item = xRingbufferReceive(buffer, &size, TIMEOUT_TICKS);
+            if (item != NULL) {
+                in_order = in_order && memcmp(item, &expected, sizeof(expected)) == 0;
+                expected++;
+                vRingbufferReturnItem(buffer, item);
+            }
+        }
+    }
+    producer.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    REQUIRE_FALSE(failed);
+    REQUIRE(in_order);
+    vRingbufferDelete(buffer);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_ITEMS;
+}
+
+TEST_CASE("batched send and receive throughput", "[.][bench]")
+{
+    double single = batch_bench(false);
+    double batched = batch_bench(true);
+    printf("%d items of %d bytes between two threads, ns per item: one per call %.1f, batches of %d %.1f\n",
+           BENCH_ITEMS, BENCH_ITEM_SIZE, single, BENCH_BATCH_SIZE, batched);
+    CHECK(batched < single);
+}
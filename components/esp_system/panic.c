@@ -46,6 +46,10 @@
 #endif
 #endif // CONFIG_APPTRACE_ENABLE
 
+#if CONFIG_LOG_ASYNC
+#include "esp_private/log_async.h"
+#endif
+
 #if !CONFIG_ESP_SYSTEM_PANIC_SILENT_REBOOT
 #include "hal/uart_hal.h"
 #endif
@@ -309,6 +313,11 @@ void esp_panic_handler(panic_info_t *info)
 
     esp_panic_handler_reconfigure_wdts(); // Restart WDT again
 
+#if CONFIG_LOG_ASYNC && !CONFIG_ESP_SYSTEM_PANIC_SILENT_REBOOT
+    // The last log messages before the panic may still be waiting for the log writer task
+    esp_log_async_panic_drain(panic_print_char);
+#endif
+
     PANIC_INFO_DUMP(info, state);
     panic_print_str("\r\n");
 
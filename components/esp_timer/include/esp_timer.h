@@ -74,6 +74,16 @@ typedef struct {
     bool skip_unhandled_events;     //!< Skip unhandled events for periodic timers
 } esp_timer_create_args_t;
 
+/**
+ * @brief Statistics about the dispatch of timer callbacks, see esp_timer_get_dispatch_stats
+ */
+typedef struct {
+    uint32_t wakeups;               //!< Number of times the timer interrupt occurred
+    uint32_t callbacks;             //!< Number of timer callbacks called
+    uint64_t total_latency_us;      //!< Sum of the time from the alarm of a timer to the call of its callback, over all callbacks
+    uint32_t max_latency_us;        //!< Longest time from the alarm of a timer to the call of its callback
+} esp_timer_dispatch_stats_t;
+
 
 /**
  * @brief Minimal initialization of esp_timer
@@ -177,6 +187,28 @@ esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
  */
 esp_err_t esp_timer_stop(esp_timer_handle_t timer);
 
+/**
+ * @brief Set the slack of a timer
+ *
+ * The callback of a timer with a slack may be called up to slack_us microseconds
+ * after the timer expires. The timer alarm is set for the latest time which falls
+ * within the slack of every timer expiring first, so that timers with close expiry
+ * times are processed together, with less interrupts and CPU wake ups from sleep.
+ * Periodic timers keep expiring every 'period' microseconds from the time they were
+ * started, regardless of the slack.
+ *
+ * Timer should not be running when this function is called. A timer created by
+ * esp_timer_create has no slack.
+ *
+ * @param timer timer handle created using esp_timer_create
+ * @param slack_us timer slack, in microseconds
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the handle is invalid
+ *      - ESP_ERR_INVALID_STATE if the timer is running
+ */
+esp_err_t esp_timer_set_slack(esp_timer_handle_t timer, uint32_t slack_us);
+
 /**
  * @brief Delete an esp_timer instance
  *
@@ -205,6 +237,9 @@ int64_t esp_timer_get_next_alarm(void);
 
 /**
  * @brief Get the timestamp when the next timeout is expected to occur skipping those which have skip_unhandled_events flag
+ *
+ * Timers are allowed to expire as late as the end of their slack, see esp_timer_set_slack.
+ *
  * @return Timestamp of the nearest timer event, in microseconds.
  *         The timebase is the same as for the values returned by esp_timer_get_time.
  */
@@ -273,6 +308,25 @@ esp_err_t esp_timer_get_expiry_time(esp_timer_handle_t timer, uint64_t *expiry);
  */
 esp_err_t esp_timer_dump(FILE* stream);
 
+/**
+ * @brief Get statistics about the dispatch of timer callbacks
+ *
+ * Counters accumulate since esp_timer is initialized. The number of timer
+ * interrupts per second, and the average latency of callbacks, can be obtained
+ * from the difference between the statistics got at two different times.
+ *
+ * The latency includes the slack of the timers, see esp_timer_set_slack.
+ *
+ * @note Statistics are only collected if CONFIG_ESP_TIMER_PROFILING is enabled.
+ *
+ * @param[out] stats  statistics of callbacks dispatched by both dispatch methods
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if stats is NULL
+ *      - ESP_ERR_NOT_SUPPORTED if CONFIG_ESP_TIMER_PROFILING is disabled
+ */
+esp_err_t esp_timer_get_dispatch_stats(esp_timer_dispatch_stats_t *stats);
+
 #if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD || defined __DOXYGEN__
 /**
  * @brief Requests a context switch from a timer callback function.
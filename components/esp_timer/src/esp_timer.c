@@ -5,6 +5,7 @@
  */
 
 #include <sys/param.h>
+#include <stdlib.h>
 #include <string.h>
 #include "soc/soc.h"
 #include "esp_types.h"
@@ -53,6 +54,7 @@
 typedef enum {
     FL_ISR_DISPATCH_METHOD   = (1 << 0),  //!< 0=Callback is called from timer task, 1=Callback is called from timer ISR
     FL_SKIP_UNHANDLED_EVENTS = (1 << 1),  //!< 0=NOT skip unhandled events for periodic timers, 1=Skip unhandled events for periodic timers
+    FL_REARMED               = (1 << 2),  //!< 1=Periodic timer which expired in the alarm being processed, waits in s_rearmed_timers
 } flags_t;
 
 struct esp_timer {
@@ -64,6 +66,7 @@ struct esp_timer {
         uint32_t event_id;
     };
     void* arg;
+    uint32_t slack;
 #if WITH_PROFILING
     const char* name;
     size_t times_triggered;
@@ -71,15 +74,34 @@ struct esp_timer {
     size_t times_skipped;
     uint64_t total_callback_run_time;
 #endif // WITH_PROFILING
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+    union {
+        LIST_ENTRY(esp_timer) list_entry;   // entry in the list of inactive timers, when not armed
+        struct {
+            struct esp_timer* child;        // first child, the one with the earliest alarm is not known
+            struct esp_timer* next;         // next sibling
+            struct esp_timer* prev;         // previous sibling, or parent for the first child
+        } heap;                             // node of the heap of armed timers, when armed
+    };
+#else
     LIST_ENTRY(esp_timer) list_entry;
+#endif
 };
 
 static inline bool is_initialized(void);
-static esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm);
+static esp_err_t timer_insert(esp_timer_handle_t timer);
 static esp_err_t timer_remove(esp_timer_handle_t timer);
 static bool timer_armed(esp_timer_handle_t timer);
 static void timer_list_lock(esp_timer_dispatch_t timer_type);
 static void timer_list_unlock(esp_timer_dispatch_t timer_type);
+static esp_timer_handle_t timer_queue_first(esp_timer_dispatch_t dispatch_method);
+static void timer_queue_remove(esp_timer_handle_t timer);
+static void timer_queue_insert_rearmed(esp_timer_dispatch_t dispatch_method);
+static void timer_update_wakeup(esp_timer_dispatch_t dispatch_method);
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+static esp_timer_handle_t heap_meld(esp_timer_handle_t a, esp_timer_handle_t b);
+static esp_timer_handle_t heap_next(esp_timer_handle_t timer, bool skip_children);
+#endif
 
 #if WITH_PROFILING
 static void timer_insert_inactive(esp_timer_handle_t timer);
@@ -88,10 +110,23 @@ static void timer_remove_inactive(esp_timer_handle_t timer);
 
 __attribute__((unused)) static const char* TAG = "esp_timer";
 
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+// roots of the pairing heaps of currently armed timers for two dispatch methods: ISR and TASK
+static esp_timer_handle_t s_timer_heaps[ESP_TIMER_MAX];
+#else
 // lists of currently armed timers for two dispatch methods: ISR and TASK
 static LIST_HEAD(esp_timer_list, esp_timer) s_timers[ESP_TIMER_MAX] = {
     [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
 };
+#endif
+// periodic timers which expired while processing an alarm, they are inserted back all at once
+static LIST_HEAD(esp_rearmed_timer_list, esp_timer) s_rearmed_timers[ESP_TIMER_MAX] = {
+    [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_rearmed_timers)
+};
+// times the alarms are set to, the earliest alarm + slack among the armed timers
+static uint64_t s_wakeup[ESP_TIMER_MAX] = {
+    [0 ... (ESP_TIMER_MAX - 1)] = UINT64_MAX
+};
 #if WITH_PROFILING
 // lists of unarmed timers for two dispatch methods: ISR and TASK,
 // used only to be able to dump statistics about all the timers
@@ -102,7 +137,7 @@ static LIST_HEAD(esp_inactive_timer_list, esp_timer) s_inactive_timers[ESP_TIMER
 // task used to dispatch timer callbacks
 static TaskHandle_t s_timer_task;
 
-// lock protecting s_timers, s_inactive_timers
+// lock protecting s_timers, s_rearmed_timers, s_wakeup, s_inactive_timers
 static portMUX_TYPE s_timer_lock[ESP_TIMER_MAX] = {
     [0 ... (ESP_TIMER_MAX - 1)] = portMUX_INITIALIZER_UNLOCKED
 };
@@ -112,6 +147,13 @@ static portMUX_TYPE s_timer_lock[ESP_TIMER_MAX] = {
 static volatile BaseType_t s_isr_dispatch_need_yield = pdFALSE;
 #endif // CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
 
+#if WITH_PROFILING
+// number of times the alarm handler was called
+static uint32_t s_wakeups;
+// callbacks dispatched for two dispatch methods: ISR and TASK, protected by s_timer_lock
+static esp_timer_dispatch_stats_t s_dispatch_stats[ESP_TIMER_MAX];
+#endif
+
 esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
                            esp_timer_handle_t* out_handle)
 {
@@ -157,7 +199,7 @@ esp_err_t IRAM_ATTR esp_timer_start_once(esp_timer_handle_t timer, uint64_t time
 #if WITH_PROFILING
     timer->times_armed++;
 #endif
-    esp_err_t err = timer_insert(timer, false);
+    esp_err_t err = timer_insert(timer);
     timer_list_unlock(dispatch_method);
     return err;
 }
@@ -180,7 +222,7 @@ esp_err_t IRAM_ATTR esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t
     timer->times_armed++;
     timer->times_skipped = 0;
 #endif
-    esp_err_t err = timer_insert(timer, false);
+    esp_err_t err = timer_insert(timer);
     timer_list_unlock(dispatch_method);
     return err;
 }
@@ -196,6 +238,18 @@ esp_err_t IRAM_ATTR esp_timer_stop(esp_timer_handle_t timer)
     return timer_remove(timer);
 }
 
+esp_err_t esp_timer_set_slack(esp_timer_handle_t timer, uint32_t slack_us)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer_armed(timer)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->slack = slack_us;
+    return ESP_OK;
+}
+
 esp_err_t esp_timer_delete(esp_timer_handle_t timer)
 {
     if (timer == NULL) {
@@ -214,18 +268,29 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
     timer->event_id = EVENT_ID_DELETE_TIMER;
     timer->alarm = alarm;
     timer->period = 0;
-    timer_insert(timer, false);
+    timer->slack = 0;
+    timer_insert(timer);
     timer_list_unlock(ESP_TIMER_TASK);
     return ESP_OK;
 }
 
-static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm)
+static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer)
 {
 #if WITH_PROFILING
     timer_remove_inactive(timer);
 #endif
-    esp_timer_handle_t it, last = NULL;
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+    timer->heap.child = NULL;
+    timer->heap.next = NULL;
+    timer->heap.prev = NULL;
+    if (s_timer_heaps[dispatch_method] == NULL) {
+        s_timer_heaps[dispatch_method] = timer;
+    } else {
+        s_timer_heaps[dispatch_method] = heap_meld(s_timer_heaps[dispatch_method], timer);
+    }
+#else
+    esp_timer_handle_t it, last = NULL;
     if (LIST_FIRST(&s_timers[dispatch_method]) == NULL) {
         LIST_INSERT_HEAD(&s_timers[dispatch_method], timer, list_entry);
     } else {
@@ -241,8 +306,10 @@ static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_u
             LIST_INSERT_AFTER(last, timer, list_entry);
         }
     }
-    if (without_update_alarm == false && timer == LIST_FIRST(&s_timers[dispatch_method])) {
-        esp_timer_impl_set_alarm_id(timer->alarm, dispatch_method);
+#endif
+    if (timer->alarm + timer->slack < s_wakeup[dispatch_method]) {
+        s_wakeup[dispatch_method] = timer->alarm + timer->slack;
+        esp_timer_impl_set_alarm_id(s_wakeup[dispatch_method], dispatch_method);
     }
     return ESP_OK;
 }
@@ -251,18 +318,18 @@ static IRAM_ATTR esp_err_t timer_remove(esp_timer_handle_t timer)
 {
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
     timer_list_lock(dispatch_method);
-    esp_timer_handle_t first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-    LIST_REMOVE(timer, list_entry);
-    timer->alarm = 0;
-    timer->period = 0;
-    if (timer == first_timer) { // if this timer was the first in the list.
-        uint64_t next_timestamp = UINT64_MAX;
-        first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-        if (first_timer) { // if after removing the timer from the list, this list is not empty.
-            next_timestamp = first_timer->alarm;
+    if (timer->flags & FL_REARMED) {
+        // the timer expired in the alarm being processed, the alarm is set once it is processed
+        LIST_REMOVE(timer, list_entry);
+        timer->flags &= ~FL_REARMED;
+    } else {
+        timer_queue_remove(timer);
+        if (timer->alarm + timer->slack == s_wakeup[dispatch_method]) { // if the alarm was set for this timer
+            timer_update_wakeup(dispatch_method);
         }
-        esp_timer_impl_set_alarm_id(next_timestamp, dispatch_method);
     }
+    timer->alarm = 0;
+    timer->period = 0;
 #if WITH_PROFILING
     timer_insert_inactive(timer);
 #endif
@@ -296,6 +363,257 @@ static IRAM_ATTR void timer_remove_inactive(esp_timer_handle_t timer)
 
 #endif // WITH_PROFILING
 
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+
+/* Armed timers are kept in a pairing heap ordered by alarm time: inserting a timer is O(1),
+ * removing the first timer or any other one is O(log n) amortized.
+ * Every node links to its first child and to its siblings, the first child links back to its parent.
+ */
+
+// Link two heaps, returns the root of the resulting heap. Siblings of the root are left for the caller to set.
+static IRAM_ATTR esp_timer_handle_t heap_meld(esp_timer_handle_t a, esp_timer_handle_t b)
+{
+    if (b->alarm < a->alarm) {
+        esp_timer_handle_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->heap.prev = a;
+    b->heap.next = a->heap.child;
+    if (a->heap.child) {
+        a->heap.child->heap.prev = b;
+    }
+    a->heap.child = b;
+    return a;
+}
+
+// Link a list of sibling heaps into one: link them in pairs from left to right, then link the pairs from right to left.
+static IRAM_ATTR esp_timer_handle_t heap_merge_pairs(esp_timer_handle_t first)
+{
+    if (first == NULL) {
+        return NULL;
+    }
+    esp_timer_handle_t pairs = NULL;
+    while (first) {
+        esp_timer_handle_t a = first;
+        esp_timer_handle_t b = a->heap.next;
+        if (b) {
+            first = b->heap.next;
+            a = heap_meld(a, b);
+        } else {
+            first = NULL;
+        }
+        a->heap.next = pairs;
+        pairs = a;
+    }
+    esp_timer_handle_t root = pairs;
+    pairs = pairs->heap.next;
+    while (pairs) {
+        esp_timer_handle_t next = pairs->heap.next;
+        root = heap_meld(root, pairs);
+        pairs = next;
+    }
+    root->heap.next = NULL;
+    root->heap.prev = NULL;
+    return root;
+}
+
+static IRAM_ATTR esp_timer_handle_t heap_parent(esp_timer_handle_t timer)
+{
+    while (timer->heap.prev && timer->heap.prev->heap.child != timer) {
+        timer = timer->heap.prev;
+    }
+    return timer->heap.prev;
+}
+
+// Next timer of a heap in pre-order, used to visit all armed timers. Children of a timer have later alarms.
+static IRAM_ATTR esp_timer_handle_t heap_next(esp_timer_handle_t timer, bool skip_children)
+{
+    if (!skip_children && timer->heap.child) {
+        return timer->heap.child;
+    }
+    while (timer) {
+        if (timer->heap.next) {
+            return timer->heap.next;
+        }
+        timer = heap_parent(timer);
+    }
+    return NULL;
+}
+
+static IRAM_ATTR esp_timer_handle_t timer_queue_first(esp_timer_dispatch_t dispatch_method)
+{
+    return s_timer_heaps[dispatch_method];
+}
+
+static IRAM_ATTR void timer_queue_remove(esp_timer_handle_t timer)
+{
+    esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
+    if (timer == s_timer_heaps[dispatch_method]) {
+        s_timer_heaps[dispatch_method] = heap_merge_pairs(timer->heap.child);
+    } else {
+        if (timer->heap.prev->heap.child == timer) {
+            timer->heap.prev->heap.child = timer->heap.next;
+        } else {
+            timer->heap.prev->heap.next = timer->heap.next;
+        }
+        if (timer->heap.next) {
+            timer->heap.next->heap.prev = timer->heap.prev;
+        }
+        esp_timer_handle_t children = heap_merge_pairs(timer->heap.child);
+        if (children) {
+            esp_timer_handle_t root = heap_meld(s_timer_heaps[dispatch_method], children);
+            root->heap.next = NULL;
+            root->heap.prev = NULL;
+            s_timer_heaps[dispatch_method] = root;
+        }
+    }
+}
+
+static IRAM_ATTR void timer_queue_insert_rearmed(esp_timer_dispatch_t dispatch_method)
+{
+    // Link the rearmed timers as siblings, pair them into one heap and link it with the heap of armed timers
+    esp_timer_handle_t first = NULL;
+    esp_timer_handle_t it = LIST_FIRST(&s_rearmed_timers[dispatch_method]);
+    LIST_INIT(&s_rearmed_timers[dispatch_method]);
+    while (it) {
+        esp_timer_handle_t next = LIST_NEXT(it, list_entry);
+        it->flags &= ~FL_REARMED;
+        it->heap.child = NULL;
+        it->heap.next = first;
+        it->heap.prev = NULL;
+        first = it;
+        it = next;
+    }
+    esp_timer_handle_t rearmed = heap_merge_pairs(first);
+    if (rearmed) {
+        esp_timer_handle_t root = rearmed;
+        if (s_timer_heaps[dispatch_method]) {
+            root = heap_meld(s_timer_heaps[dispatch_method], rearmed);
+        }
+        root->heap.next = NULL;
+        root->heap.prev = NULL;
+        s_timer_heaps[dispatch_method] = root;
+    }
+}
+
+static IRAM_ATTR uint64_t timer_queue_wakeup(esp_timer_dispatch_t dispatch_method)
+{
+    // Timers below one which expires after the wakeup found so far can't move it earlier
+    uint64_t wakeup = UINT64_MAX;
+    esp_timer_handle_t it = s_timer_heaps[dispatch_method];
+    while (it) {
+        wakeup = MIN(wakeup, it->alarm + it->slack);
+        it = heap_next(it, it->alarm >= wakeup);
+    }
+    return wakeup;
+}
+
+#define TIMER_QUEUE_FOREACH(it, dispatch_method) \
+    for ((it) = s_timer_heaps[dispatch_method]; (it) != NULL; (it) = heap_next((it), false))
+
+#else // CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+
+static IRAM_ATTR esp_timer_handle_t timer_queue_first(esp_timer_dispatch_t dispatch_method)
+{
+    return LIST_FIRST(&s_timers[dispatch_method]);
+}
+
+static IRAM_ATTR void timer_queue_remove(esp_timer_handle_t timer)
+{
+    LIST_REMOVE(timer, list_entry);
+}
+
+// Sort timers linked through list_entry.le_next by alarm, timers with the same alarm keep their order
+static IRAM_ATTR esp_timer_handle_t timer_chain_sort(esp_timer_handle_t first)
+{
+    if (first == NULL || LIST_NEXT(first, list_entry) == NULL) {
+        return first;
+    }
+    esp_timer_handle_t middle = first;
+    esp_timer_handle_t end = LIST_NEXT(first, list_entry);
+    while (end && LIST_NEXT(end, list_entry)) {
+        middle = LIST_NEXT(middle, list_entry);
+        end = LIST_NEXT(LIST_NEXT(end, list_entry), list_entry);
+    }
+    esp_timer_handle_t b = timer_chain_sort(LIST_NEXT(middle, list_entry));
+    middle->list_entry.le_next = NULL;
+    esp_timer_handle_t a = timer_chain_sort(first);
+    esp_timer_handle_t* tail = &first;
+    while (a && b) {
+        if (b->alarm < a->alarm) {
+            *tail = b;
+            b = LIST_NEXT(b, list_entry);
+        } else {
+            *tail = a;
+            a = LIST_NEXT(a, list_entry);
+        }
+        tail = &(*tail)->list_entry.le_next;
+    }
+    *tail = a ? a : b;
+    return first;
+}
+
+static IRAM_ATTR void timer_queue_insert_rearmed(esp_timer_dispatch_t dispatch_method)
+{
+    // Rearmed timers are linked in the reverse order they expired in, put them back in
+    // that order and sort them, then insert them all in a single walk of the list.
+    esp_timer_handle_t chain = NULL;
+    esp_timer_handle_t it = LIST_FIRST(&s_rearmed_timers[dispatch_method]);
+    LIST_INIT(&s_rearmed_timers[dispatch_method]);
+    while (it) {
+        esp_timer_handle_t next = LIST_NEXT(it, list_entry);
+        it->flags &= ~FL_REARMED;
+        it->list_entry.le_next = chain;
+        chain = it;
+        it = next;
+    }
+    chain = timer_chain_sort(chain);
+
+    esp_timer_handle_t last = NULL;
+    it = LIST_FIRST(&s_timers[dispatch_method]);
+    while (chain) {
+        esp_timer_handle_t timer = chain;
+        chain = LIST_NEXT(timer, list_entry);
+        while (it && it->alarm <= timer->alarm) {
+            last = it;
+            it = LIST_NEXT(it, list_entry);
+        }
+        if (last == NULL) {
+            LIST_INSERT_HEAD(&s_timers[dispatch_method], timer, list_entry);
+        } else {
+            LIST_INSERT_AFTER(last, timer, list_entry);
+        }
+        last = timer;
+    }
+}
+
+static IRAM_ATTR uint64_t timer_queue_wakeup(esp_timer_dispatch_t dispatch_method)
+{
+    // Timers after one which expires after the wakeup found so far can't move it earlier
+    uint64_t wakeup = UINT64_MAX;
+    esp_timer_handle_t it;
+    LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        if (it->alarm >= wakeup) {
+            break;
+        }
+        wakeup = MIN(wakeup, it->alarm + it->slack);
+    }
+    return wakeup;
+}
+
+#define TIMER_QUEUE_FOREACH(it, dispatch_method) \
+    LIST_FOREACH(it, &s_timers[dispatch_method], list_entry)
+
+#endif // CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+
+// Set the alarm for the timer which has to expire first, allowing for the slack of the timers
+static IRAM_ATTR void timer_update_wakeup(esp_timer_dispatch_t dispatch_method)
+{
+    s_wakeup[dispatch_method] = timer_queue_wakeup(dispatch_method);
+    esp_timer_impl_set_alarm_id(s_wakeup[dispatch_method], dispatch_method);
+}
+
 static IRAM_ATTR bool timer_armed(esp_timer_handle_t timer)
 {
     return timer->alarm > 0;
@@ -319,22 +637,37 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
 {
     timer_list_lock(dispatch_method);
     bool processed = false;
-    esp_timer_handle_t it;
+    /* Timers which expired by the time the processing starts are processed in a pass, periodic timers
+     * are inserted back once all of them are processed. The time is read again after the pass,
+     * for the timers which expired while the callbacks were running.
+     */
+    int64_t now = esp_timer_impl_get_time();
     while (1) {
-        it = LIST_FIRST(&s_timers[dispatch_method]);
-        int64_t now = esp_timer_impl_get_time();
+        esp_timer_handle_t it = timer_queue_first(dispatch_method);
         if (it == NULL || it->alarm > now) {
-            break;
+            if (!LIST_EMPTY(&s_rearmed_timers[dispatch_method])) {
+                timer_queue_insert_rearmed(dispatch_method);
+                continue;
+            }
+            if (it == NULL) {
+                break;
+            }
+            now = esp_timer_impl_get_time();
+            if (it->alarm > now) {
+                break;
+            }
         }
         processed = true;
-        LIST_REMOVE(it, list_entry);
+        timer_queue_remove(it);
         if (it->event_id == EVENT_ID_DELETE_TIMER) {
             // It is handled only by ESP_TIMER_TASK (see esp_timer_delete()).
             // All the ESP_TIMER_ISR timers which should be deleted are moved by esp_timer_delete() to the ESP_TIMER_TASK list.
             // We want to free memory of the timer in a task context instead of an isr context.
             free(it);
-            it = NULL;
         } else {
+#if WITH_PROFILING
+            uint64_t alarm = it->alarm;
+#endif
             if (it->period > 0) {
                 int skipped = (now - it->alarm) / it->period;
                 if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) && (skipped > 1)) {
@@ -345,7 +678,8 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
                 } else {
                     it->alarm += it->period;
                 }
-                timer_insert(it, true);
+                it->flags |= FL_REARMED;
+                LIST_INSERT_HEAD(&s_rearmed_timers[dispatch_method], it, list_entry);
             } else {
                 it->alarm = 0;
 #if WITH_PROFILING
@@ -353,7 +687,7 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
 #endif
             }
 #if WITH_PROFILING
-            uint64_t callback_start = now;
+            int64_t callback_start = esp_timer_impl_get_time();
 #endif
             esp_timer_cb_t callback = it->callback;
             void* arg = it->arg;
@@ -361,19 +695,19 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
             (*callback)(arg);
             timer_list_lock(dispatch_method);
 #if WITH_PROFILING
+            int64_t callback_end = esp_timer_impl_get_time();
             it->times_triggered++;
-            it->total_callback_run_time += esp_timer_impl_get_time() - callback_start;
+            it->total_callback_run_time += callback_end - callback_start;
+            esp_timer_dispatch_stats_t* stats = &s_dispatch_stats[dispatch_method];
+            uint32_t latency = callback_start - alarm;
+            stats->callbacks++;
+            stats->total_latency_us += latency;
+            stats->max_latency_us = MAX(stats->max_latency_us, latency);
 #endif
         }
     } // while(1)
-    if (it) {
-        if (dispatch_method == ESP_TIMER_TASK || (dispatch_method != ESP_TIMER_TASK && processed == true)) {
-            esp_timer_impl_set_alarm_id(it->alarm, dispatch_method);
-        }
-    } else {
-        if (processed) {
-            esp_timer_impl_set_alarm_id(UINT64_MAX, dispatch_method);
-        }
+    if (dispatch_method == ESP_TIMER_TASK || processed == true) {
+        timer_update_wakeup(dispatch_method);
     }
     timer_list_unlock(dispatch_method);
     return processed;
@@ -400,6 +734,9 @@ static void IRAM_ATTR timer_alarm_handler(void* arg)
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     bool isr_timers_processed = false;
+#if WITH_PROFILING
+    s_wakeups++;
+#endif
 
 #ifdef CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
     // process timers with ISR dispatch method
@@ -473,7 +810,7 @@ esp_err_t esp_timer_deinit(void)
 
     /* Check if there are any active timers */
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
-        if (!LIST_EMPTY(&s_timers[dispatch_method])) {
+        if (timer_queue_first(dispatch_method) != NULL || !LIST_EMPTY(&s_rearmed_timers[dispatch_method])) {
             return ESP_ERR_INVALID_STATE;
         }
     }
@@ -519,6 +856,14 @@ static void print_timer_info(esp_timer_handle_t t, char** dst, size_t* dst_size)
     *dst_size -= cb;
 }
 
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+static int timer_alarm_cmp(const void* a, const void* b)
+{
+    uint64_t alarm_a = (*(const esp_timer_handle_t*) a)->alarm;
+    uint64_t alarm_b = (*(const esp_timer_handle_t*) b)->alarm;
+    return (alarm_a > alarm_b) - (alarm_a < alarm_b);
+}
+#endif
 
 esp_err_t esp_timer_dump(FILE* stream)
 {
@@ -534,7 +879,10 @@ esp_err_t esp_timer_dump(FILE* stream)
     size_t timer_count = 0;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        TIMER_QUEUE_FOREACH(it, dispatch_method) {
+            ++timer_count;
+        }
+        LIST_FOREACH(it, &s_rearmed_timers[dispatch_method], list_entry) {
             ++timer_count;
         }
 #if WITH_PROFILING
@@ -555,14 +903,48 @@ esp_err_t esp_timer_dump(FILE* stream)
     if (print_buf == NULL) {
         return ESP_ERR_NO_MEM;
     }
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+    /* The heap is not sorted, armed timers are collected and sorted to be
+     * printed in the order they expire.
+     */
+    size_t armed_size = timer_count + 3;
+    esp_timer_handle_t* armed = calloc(armed_size, sizeof(*armed));
+    if (armed == NULL) {
+        free(print_buf);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
 
     /* Print to the buffer */
     char* pos = print_buf;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+        size_t armed_count = 0;
+        TIMER_QUEUE_FOREACH(it, dispatch_method) {
+            if (armed_count == armed_size) {
+                break;
+            }
+            armed[armed_count++] = it;
+        }
+        LIST_FOREACH(it, &s_rearmed_timers[dispatch_method], list_entry) {
+            if (armed_count == armed_size) {
+                break;
+            }
+            armed[armed_count++] = it;
+        }
+        qsort(armed, armed_count, sizeof(*armed), timer_alarm_cmp);
+        for (size_t i = 0; i < armed_count; ++i) {
+            print_timer_info(armed[i], &pos, &buf_size);
+        }
+#else
+        TIMER_QUEUE_FOREACH(it, dispatch_method) {
             print_timer_info(it, &pos, &buf_size);
         }
+        LIST_FOREACH(it, &s_rearmed_timers[dispatch_method], list_entry) {
+            print_timer_info(it, &pos, &buf_size);
+        }
+#endif
 #if WITH_PROFILING
         LIST_FOREACH(it, &s_inactive_timers[dispatch_method], list_entry) {
             print_timer_info(it, &pos, &buf_size);
@@ -584,6 +966,9 @@ esp_err_t esp_timer_dump(FILE* stream)
         fputs(print_buf, stream);
     }
 
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+    free(armed);
+#endif
     free(print_buf);
     return ESP_OK;
 }
@@ -593,12 +978,17 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = LIST_FIRST(&s_timers[dispatch_method]);
+        esp_timer_handle_t it = timer_queue_first(dispatch_method);
         if (it) {
             if (next_alarm > it->alarm) {
                 next_alarm = it->alarm;
             }
         }
+        LIST_FOREACH(it, &s_rearmed_timers[dispatch_method], list_entry) {
+            if (next_alarm > it->alarm) {
+                next_alarm = it->alarm;
+            }
+        }
         timer_list_unlock(dispatch_method);
     }
     return next_alarm;
@@ -610,14 +1000,31 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm_for_wake_up(void)
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
         esp_timer_handle_t it = NULL;
+        // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode,
+        // other ones need not wake it up before the end of their slack.
+        // Timers which expire after next_alarm can't move it earlier, nor can the ones which follow them.
+#if CONFIG_ESP_TIMER_QUEUE_PAIRING_HEAP
+        it = timer_queue_first(dispatch_method);
+        while (it) {
+            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0 && next_alarm > it->alarm + it->slack) {
+                next_alarm = it->alarm + it->slack;
+            }
+            it = heap_next(it, it->alarm >= next_alarm);
+        }
+#else
         LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode.
-            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0) {
-                if (next_alarm > it->alarm) {
-                    next_alarm = it->alarm;
-                }
+            if (it->alarm >= next_alarm) {
                 break;
             }
+            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0 && next_alarm > it->alarm + it->slack) {
+                next_alarm = it->alarm + it->slack;
+            }
+        }
+#endif
+        LIST_FOREACH(it, &s_rearmed_timers[dispatch_method], list_entry) {
+            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0 && next_alarm > it->alarm + it->slack) {
+                next_alarm = it->alarm + it->slack;
+            }
         }
         timer_list_unlock(dispatch_method);
     }
@@ -663,3 +1070,24 @@ bool esp_timer_is_active(esp_timer_handle_t timer)
 {
     return timer_armed(timer);
 }
+
+esp_err_t esp_timer_get_dispatch_stats(esp_timer_dispatch_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if WITH_PROFILING
+    memset(stats, 0, sizeof(*stats));
+    stats->wakeups = s_wakeups;
+    for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
+        timer_list_lock(dispatch_method);
+        stats->callbacks += s_dispatch_stats[dispatch_method].callbacks;
+        stats->total_latency_us += s_dispatch_stats[dispatch_method].total_latency_us;
+        stats->max_latency_us = MAX(stats->max_latency_us, s_dispatch_stats[dispatch_method].max_latency_us);
+        timer_list_unlock(dispatch_method);
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,9 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#define ESP_EARLY_LOGE(tag, format, ...)    fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
@@ -0,0 +1,13 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+/* The host test calls esp_timer_init itself, system init functions are not registered */
+#define ESP_SYSTEM_INIT_FN(f, c, priority, ...) \
+    static esp_err_t __attribute__((unused)) f(void)
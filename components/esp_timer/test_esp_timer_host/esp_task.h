@@ -0,0 +1,10 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#define ESP_TASK_TIMER_PRIO     22
+#define ESP_TASK_TIMER_STACK    CONFIG_ESP_TIMER_TASK_STACK_SIZE
@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_timer_impl.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer_sim.h"
+
+/* Limit of alarm handler calls for a single alarm time, reached if an alarm is never handled */
+#define SIM_MAX_INTERRUPTS_PER_ALARM    16
+
+__thread bool host_in_isr;
+TaskHandle_t host_current_task;
+
+/* The esp_timer treats an alarm at time 0 as not armed, start from some time after boot */
+static int64_t s_time = 1000000;
+static uint64_t s_alarm_id[2] = { UINT64_MAX, UINT64_MAX };
+static intr_handler_t s_alarm_handler;
+static uint32_t s_interrupts;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+int64_t esp_timer_impl_get_time(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    int64_t time = s_time;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+    return time;
+}
+
+int64_t esp_timer_get_time(void) __attribute__((alias("esp_timer_impl_get_time")));
+
+void esp_timer_impl_set_alarm_id(uint64_t timestamp, unsigned alarm_id)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_alarm_id[alarm_id] = timestamp;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+uint64_t esp_timer_impl_get_min_period_us(void)
+{
+    return 50;
+}
+
+esp_err_t esp_timer_impl_early_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_impl_init(intr_handler_t alarm_handler)
+{
+    s_alarm_handler = alarm_handler;
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    s_alarm_handler = NULL;
+}
+
+int64_t esp_timer_sim_get_alarm(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    uint64_t alarm = s_alarm_id[0] < s_alarm_id[1] ? s_alarm_id[0] : s_alarm_id[1];
+    portEXIT_CRITICAL_SAFE(&s_lock);
+    return alarm > INT64_MAX ? INT64_MAX : (int64_t)alarm;
+}
+
+uint32_t esp_timer_sim_get_interrupts(void)
+{
+    return s_interrupts;
+}
+
+void esp_timer_sim_advance(int64_t time_us)
+{
+    int64_t target = esp_timer_impl_get_time() + time_us;
+    int64_t last_alarm = -1;
+    int interrupts = 0;
+    while (1) {
+        int64_t alarm = esp_timer_sim_get_alarm();
+        if (alarm > target) {
+            break;
+        }
+        /* Like the timer hardware, an alarm set in the past fires right away */
+        portENTER_CRITICAL_SAFE(&s_lock);
+        if (alarm > s_time) {
+            s_time = alarm;
+        }
+        portEXIT_CRITICAL_SAFE(&s_lock);
+        if (alarm != last_alarm) {
+            last_alarm = alarm;
+            interrupts = 0;
+        } else if (++interrupts == SIM_MAX_INTERRUPTS_PER_ALARM) {
+            fprintf(stderr, "alarm at %lld is never handled\n", (long long)alarm);
+            abort();
+        }
+        assert(s_alarm_handler);
+        s_interrupts++;
+        host_in_isr = true;
+        (*s_alarm_handler)(NULL);
+        host_in_isr = false;
+        host_task_wait_idle(host_current_task);
+    }
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_time = target;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulated esp_timer implementation: time only passes when the test advances
+ * it, and the alarm handler is called at the exact time of every alarm met on
+ * the way, like the timer interrupt would be.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Advance the simulated time, handling the alarms which are due until then
+ *
+ * Callbacks of timers with ISR dispatch method are called from this function,
+ * it returns once the timer task has called the callbacks of the other timers.
+ *
+ * @param time_us time to advance by, in microseconds
+ */
+void esp_timer_sim_advance(int64_t time_us);
+
+/**
+ * @brief Get the time the alarm is set to, INT64_MAX if no alarm is set
+ */
+int64_t esp_timer_sim_get_alarm(void);
+
+/**
+ * @brief Get the number of times the alarm handler has been called
+ */
+uint32_t esp_timer_sim_get_interrupts(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Minimal FreeRTOS API for building esp_timer.c on the host. Critical sections
+ * are mutexes and tasks are threads. The alarm "ISR" is called by the simulated
+ * timer implementation from the test thread, see esp_timer_sim.h.
+ */
+
+#pragma once
+
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include "esp_heap_caps.h"
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define pdPASS                      pdTRUE
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL_SAFE(mux)    pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     pthread_mutex_unlock(mux)
+
+/* Set by the simulated timer implementation while the alarm handler runs */
+extern __thread bool host_in_isr;
+
+#define xPortInIsrContext()         (host_in_isr)
+#define portYIELD_FROM_ISR()
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Tasks are threads, which only take notifications. host_task_wait_idle()
+ * lets the simulated timer implementation wait until a notified task has
+ * handled its notifications and blocks again.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    TaskFunction_t function;
+    void *arg;
+    uint32_t notified;
+    bool waiting;
+} host_task_t;
+
+typedef host_task_t *TaskHandle_t;
+
+/* Only the esp_timer task is created, notifications are taken by the current task */
+extern TaskHandle_t host_current_task;
+
+static inline void *host_task_run(void *arg)
+{
+    host_task_t *task = (host_task_t *)arg;
+    task->function(task->arg);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                                                 void *arg, UBaseType_t priority, TaskHandle_t *out_task, BaseType_t core_id)
+{
+    host_task_t *task = (host_task_t *)calloc(1, sizeof(host_task_t));
+    if (task == NULL) {
+        return pdFALSE;
+    }
+    pthread_mutex_init(&task->mutex, NULL);
+    pthread_cond_init(&task->cond, NULL);
+    task->function = function;
+    task->arg = arg;
+    host_current_task = task;
+    *out_task = task;
+    if (pthread_create(&task->thread, NULL, host_task_run, task) != 0) {
+        free(task);
+        *out_task = NULL;
+        return pdFALSE;
+    }
+    return pdPASS;
+}
+
+static inline void host_task_unlock(void *mutex)
+{
+    pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+static inline void vTaskDelete(TaskHandle_t task)
+{
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    pthread_cond_destroy(&task->cond);
+    pthread_mutex_destroy(&task->mutex);
+    free(task);
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    host_task_t *task = host_current_task;
+    pthread_mutex_lock(&task->mutex);
+    pthread_cleanup_push(host_task_unlock, &task->mutex);
+    task->waiting = true;
+    pthread_cond_broadcast(&task->cond);
+    while (task->notified == 0) {
+        pthread_cond_wait(&task->cond, &task->mutex);
+    }
+    task->waiting = false;
+    pthread_cleanup_pop(0);
+    uint32_t ret = task->notified;
+    task->notified = clear_on_exit ? 0 : task->notified - 1;
+    pthread_mutex_unlock(&task->mutex);
+    return ret;
+}
+
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    pthread_mutex_lock(&task->mutex);
+    task->notified++;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->mutex);
+    *higher_priority_task_woken = pdTRUE;
+}
+
+static inline void host_task_wait_idle(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->mutex);
+    while (!task->waiting || task->notified != 0) {
+        pthread_cond_wait(&task->cond, &task->mutex);
+    }
+    pthread_mutex_unlock(&task->mutex);
+}
@@ -0,0 +1,458 @@
+#include "catch.hpp"
+#include "esp_timer.h"
+#include "esp_timer_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+#define ORDER_TIMERS            200
+#define MODEL_TIMERS            100
+#define MODEL_OPERATIONS        20000
+#define BENCH_RESTARTS          20000
+#define BENCH_SIM_TIME_US       (1000 * 1000)
+#define SLACK_TIMERS            100
+#define SLACK_SIM_TIME_US       (1000 * 1000)
+
+struct Expiry {
+    size_t index;
+    int64_t time;
+};
+
+/* Timers created by a test, their callbacks record when they expire */
+struct Timers {
+    std::vector<esp_timer_handle_t> handles;
+    std::vector<size_t> indexes;
+    std::vector<Expiry> expired;
+
+    static void callback(void *arg)
+    {
+        size_t *index = static_cast<size_t *>(arg);
+        Timers *timers = s_current;
+        timers->expired.push_back({*index, esp_timer_get_time()});
+    }
+
+    Timers(size_t count, bool mixed_dispatch = false, bool skip_unhandled = false, uint32_t slack = 0)
+    {
+        static bool initialized;
+        if (!initialized) {
+            REQUIRE(esp_timer_early_init() == ESP_OK);
+            REQUIRE(esp_timer_init() == ESP_OK);
+            initialized = true;
+        }
+        s_current = this;
+        handles.resize(count);
+        indexes.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            indexes[i] = i;
+            esp_timer_create_args_t args = {};
+            args.callback = &Timers::callback;
+            args.arg = &indexes[i];
+            args.dispatch_method = (mixed_dispatch && i % 2) ? ESP_TIMER_TASK : ESP_TIMER_ISR;
+            args.skip_unhandled_events = skip_unhandled;
+            REQUIRE(esp_timer_create(&args, &handles[i]) == ESP_OK);
+            REQUIRE(esp_timer_set_slack(handles[i], slack) == ESP_OK);
+        }
+    }
+
+    ~Timers()
+    {
+        for (esp_timer_handle_t handle : handles) {
+            if (esp_timer_is_active(handle)) {
+                esp_timer_stop(handle);
+            }
+            esp_timer_delete(handle);
+        }
+        /* Deleted timers are freed by the timer task */
+        esp_timer_sim_advance(0);
+        s_current = nullptr;
+    }
+
+    int64_t expiry(size_t i)
+    {
+        uint64_t expiry;
+        REQUIRE(esp_timer_get_expiry_time(handles[i], &expiry) == ESP_OK);
+        return expiry;
+    }
+
+    static Timers *s_current;
+};
+
+Timers *Timers::s_current;
+
+TEST_CASE("timers expire at their alarm time, in order")
+{
+    Timers timers(ORDER_TIMERS, true);
+    std::mt19937 rng(0);
+    std::map<size_t, int64_t> alarms;
+
+    for (size_t i = 0; i < ORDER_TIMERS; i++) {
+        /* Many timers share the same alarm time */
+        REQUIRE(esp_timer_start_once(timers.handles[i], (rng() % 50) * 100) == ESP_OK);
+        alarms[i] = timers.expiry(i);
+    }
+    CHECK(esp_timer_get_next_alarm() == std::min_element(alarms.begin(), alarms.end(),
+            [](const std::pair<size_t, int64_t> &a, const std::pair<size_t, int64_t> &b) {
+                return a.second < b.second;
+            })->second);
+
+    esp_timer_sim_advance(10000);
+
+    REQUIRE(timers.expired.size() == ORDER_TIMERS);
+    int64_t last_time[ESP_TIMER_MAX] = {};
+    std::vector<bool> seen(ORDER_TIMERS);
+    for (const Expiry &e : timers.expired) {
+        CHECK(e.time == alarms[e.index]);
+        CHECK_FALSE(seen[e.index]);
+        seen[e.index] = true;
+        int dispatch = e.index % 2 ? ESP_TIMER_TASK : ESP_TIMER_ISR;
+        CHECK(e.time >= last_time[dispatch]);
+        last_time[dispatch] = e.time;
+        CHECK_FALSE(esp_timer_is_active(timers.handles[e.index]));
+    }
+    CHECK(esp_timer_get_next_alarm() == INT64_MAX);
+    CHECK(esp_timer_sim_get_alarm() == INT64_MAX);
+}
+
+TEST_CASE("started and stopped timers match a model of the queue")
+{
+    Timers timers(MODEL_TIMERS, true);
+    std::mt19937 rng(1);
+    std::map<size_t, int64_t> armed;
+    size_t expected_expired = 0;
+
+    for (int op = 0; op < MODEL_OPERATIONS; op++) {
+        size_t i = rng() % MODEL_TIMERS;
+        unsigned action = rng() % 8;
+        if (action == 0) {
+            int64_t until = esp_timer_get_time() + rng() % 2000;
+            esp_timer_sim_advance(until - esp_timer_get_time());
+            for (auto it = armed.begin(); it != armed.end();) {
+                if (it->second <= until) {
+                    expected_expired++;
+                    it = armed.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            REQUIRE(timers.expired.size() == expected_expired);
+            int64_t next_alarm = INT64_MAX;
+            for (const auto &a : armed) {
+                next_alarm = std::min(next_alarm, a.second);
+            }
+            REQUIRE(esp_timer_get_next_alarm() == next_alarm);
+            REQUIRE(esp_timer_sim_get_alarm() == next_alarm);
+        } else if (armed.count(i)) {
+            REQUIRE(esp_timer_stop(timers.handles[i]) == ESP_OK);
+            armed.erase(i);
+        } else {
+            REQUIRE(esp_timer_start_once(timers.handles[i], rng() % 3000) == ESP_OK);
+            armed[i] = timers.expiry(i);
+        }
+    }
+
+    /* Every timer expired when it was expected to */
+    esp_timer_sim_advance(3000);
+    REQUIRE(timers.expired.size() == expected_expired + armed.size());
+    for (const Expiry &e : timers.expired) {
+        CHECK_FALSE(esp_timer_is_active(timers.handles[e.index]));
+    }
+}
+
+TEST_CASE("periodic timers are rearmed from their previous alarm")
+{
+    Timers timers(3);
+
+    int64_t start = esp_timer_get_time();
+    REQUIRE(esp_timer_start_periodic(timers.handles[0], 1000) == ESP_OK);
+    REQUIRE(esp_timer_start_periodic(timers.handles[1], 1500) == ESP_OK);
+    REQUIRE(esp_timer_start_once(timers.handles[2], 2500) == ESP_OK);
+    esp_timer_sim_advance(10500);
+
+    std::vector<int64_t> times[3];
+    for (const Expiry &e : timers.expired) {
+        times[e.index].push_back(e.time - start);
+    }
+    CHECK(times[0] == std::vector<int64_t>({1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000}));
+    CHECK(times[1] == std::vector<int64_t>({1500, 3000, 4500, 6000, 7500, 9000, 10500}));
+    CHECK(times[2] == std::vector<int64_t>({2500}));
+    CHECK(esp_timer_is_active(timers.handles[0]));
+    CHECK_FALSE(esp_timer_is_active(timers.handles[2]));
+    CHECK(esp_timer_get_next_alarm() == start + 11000);
+}
+
+TEST_CASE("next alarm for wake up skips timers which skip unhandled events")
+{
+    Timers skipping(3, false, true);
+    Timers waking(2);
+
+    int64_t now = esp_timer_get_time();
+    REQUIRE(esp_timer_start_periodic(skipping.handles[0], 100) == ESP_OK);
+    REQUIRE(esp_timer_start_periodic(skipping.handles[1], 300) == ESP_OK);
+    REQUIRE(esp_timer_start_periodic(skipping.handles[2], 700) == ESP_OK);
+    CHECK(esp_timer_get_next_alarm_for_wake_up() == INT64_MAX);
+
+    REQUIRE(esp_timer_start_once(waking.handles[0], 500) == ESP_OK);
+    REQUIRE(esp_timer_start_once(waking.handles[1], 600) == ESP_OK);
+    CHECK(esp_timer_get_next_alarm() == now + 100);
+    CHECK(esp_timer_get_next_alarm_for_wake_up() == now + 500);
+
+    REQUIRE(esp_timer_stop(waking.handles[0]) == ESP_OK);
+    CHECK(esp_timer_get_next_alarm_for_wake_up() == now + 600);
+}
+
+TEST_CASE("esp_timer_dump lists armed timers in the order they expire")
+{
+    Timers timers(20, true);
+    std::mt19937 rng(2);
+
+    for (size_t i = 0; i < timers.handles.size(); i++) {
+        REQUIRE(esp_timer_start_once(timers.handles[i], 100 + rng() % 10000) == ESP_OK);
+    }
+
+    char *buf = nullptr;
+    size_t size = 0;
+    FILE *stream = open_memstream(&buf, &size);
+    REQUIRE(esp_timer_dump(stream) == ESP_OK);
+    fclose(stream);
+
+    /* Lines of a dispatch method follow each other, the alarm is the third column */
+    std::vector<int64_t> alarms;
+    char *saveptr;
+    for (char *line = strtok_r(buf, "\n", &saveptr); line; line = strtok_r(nullptr, "\n", &saveptr)) {
+        long long period, alarm;
+        if (sscanf(line, "timer@%*s %lld %lld", &period, &alarm) == 2) {
+            alarms.push_back(alarm);
+        }
+    }
+    free(buf);
+
+    REQUIRE(alarms.size() == timers.handles.size());
+    CHECK(std::is_sorted(alarms.begin(), alarms.begin() + alarms.size() / 2));
+    CHECK(std::is_sorted(alarms.begin() + alarms.size() / 2, alarms.end()));
+}
+
+/* Periodic timers with different periods, started at the same time */
+struct PeriodicTimers : public Timers {
+    std::vector<uint64_t> periods;
+    int64_t start;
+
+    PeriodicTimers(size_t count, uint32_t slack) : Timers(count, true, false, slack), periods(count)
+    {
+        start = esp_timer_get_time();
+        for (size_t i = 0; i < count; i++) {
+            periods[i] = 5000 + i * 1234 % 20000;
+            REQUIRE(esp_timer_start_periodic(handles[i], periods[i]) == ESP_OK);
+        }
+    }
+
+    /* Checks that every callback was called within the slack after the timer expired, returns the total latency */
+    int64_t check_expiries(uint32_t slack, int64_t end)
+    {
+        std::vector<int64_t> alarms(handles.size());
+        int64_t total_latency = 0;
+        for (size_t i = 0; i < handles.size(); i++) {
+            alarms[i] = start + periods[i];
+        }
+        for (const Expiry &e : expired) {
+            int64_t latency = e.time - alarms[e.index];
+            CHECK(latency >= 0);
+            CHECK(latency <= slack);
+            total_latency += latency;
+            alarms[e.index] += periods[e.index];
+        }
+        /* No expiry was missed */
+        for (size_t i = 0; i < handles.size(); i++) {
+            CHECK(alarms[i] + slack > end);
+        }
+        return total_latency;
+    }
+};
+
+TEST_CASE("timers expiring within their slack are processed together")
+{
+    const uint32_t slacks[] = {0, 1000, 5000};
+    uint32_t interrupts[3];
+
+    for (int i = 0; i < 3; i++) {
+        PeriodicTimers timers(SLACK_TIMERS, slacks[i]);
+        uint32_t start_interrupts = esp_timer_sim_get_interrupts();
+        esp_timer_sim_advance(SLACK_SIM_TIME_US);
+        interrupts[i] = esp_timer_sim_get_interrupts() - start_interrupts;
+        timers.check_expiries(slacks[i], esp_timer_get_time());
+    }
+    CHECK(interrupts[1] < interrupts[0] / 2);
+    CHECK(interrupts[2] < interrupts[1] / 2);
+}
+
+TEST_CASE("slack can only be set when the timer is not running")
+{
+    Timers timers(1);
+
+    REQUIRE(esp_timer_start_once(timers.handles[0], 1000) == ESP_OK);
+    CHECK(esp_timer_set_slack(timers.handles[0], 100) == ESP_ERR_INVALID_STATE);
+    REQUIRE(esp_timer_stop(timers.handles[0]) == ESP_OK);
+    CHECK(esp_timer_set_slack(timers.handles[0], 100) == ESP_OK);
+    CHECK(esp_timer_set_slack(nullptr, 100) == ESP_ERR_INVALID_ARG);
+}
+
+TEST_CASE("alarm is set for the end of the slack of the timers expiring first")
+{
+    Timers exact(1);
+    Timers timers(3, false, false, 1000);
+
+    int64_t now = esp_timer_get_time();
+    REQUIRE(esp_timer_start_once(timers.handles[0], 100) == ESP_OK);
+    CHECK(esp_timer_sim_get_alarm() == now + 1100);
+    REQUIRE(esp_timer_start_once(timers.handles[1], 500) == ESP_OK);
+    CHECK(esp_timer_sim_get_alarm() == now + 1100);
+    REQUIRE(esp_timer_start_once(exact.handles[0], 900) == ESP_OK);
+    CHECK(esp_timer_sim_get_alarm() == now + 900);
+    CHECK(esp_timer_get_next_alarm() == now + 100);
+    CHECK(esp_timer_get_next_alarm_for_wake_up() == now + 900);
+    REQUIRE(esp_timer_stop(exact.handles[0]) == ESP_OK);
+    CHECK(esp_timer_sim_get_alarm() == now + 1100);
+    REQUIRE(esp_timer_start_once(timers.handles[2], 1200) == ESP_OK);
+
+    uint32_t start_interrupts = esp_timer_sim_get_interrupts();
+    esp_timer_sim_advance(3000);
+    CHECK(esp_timer_sim_get_interrupts() - start_interrupts == 2);
+    REQUIRE(timers.expired.size() == 3);
+    CHECK(timers.expired[0].time == now + 1100);
+    CHECK(timers.expired[1].time == now + 1100);
+    CHECK(timers.expired[2].time == now + 2200);
+}
+
+struct Stopping {
+    esp_timer_handle_t timer;
+    esp_timer_handle_t stop;
+    int calls;
+};
+
+static void stop_callback(void *arg)
+{
+    Stopping *stopping = static_cast<Stopping *>(arg);
+    stopping->calls++;
+    if (stopping->stop && esp_timer_is_active(stopping->stop)) {
+        CHECK(esp_timer_stop(stopping->stop) == ESP_OK);
+    }
+}
+
+TEST_CASE("periodic timers can be stopped by callbacks of timers expiring together")
+{
+    Timers init(0);
+    Stopping stopping[3] = {};
+    esp_timer_create_args_t args = {};
+    args.callback = stop_callback;
+    for (Stopping &s : stopping) {
+        args.arg = &s;
+        REQUIRE(esp_timer_create(&args, &s.timer) == ESP_OK);
+        REQUIRE(esp_timer_set_slack(s.timer, 500) == ESP_OK);
+    }
+    /* The first timer stops itself, the second one stops the third one */
+    stopping[0].stop = stopping[0].timer;
+    stopping[1].stop = stopping[2].timer;
+    REQUIRE(esp_timer_start_periodic(stopping[2].timer, 1000) == ESP_OK);
+    REQUIRE(esp_timer_start_periodic(stopping[0].timer, 1000) == ESP_OK);
+    REQUIRE(esp_timer_start_periodic(stopping[1].timer, 1200) == ESP_OK);
+
+    /* All three expire at 1500 us, the second one then expires at the end of its slack */
+    esp_timer_sim_advance(5000);
+    CHECK(stopping[0].calls == 1);
+    CHECK(stopping[2].calls == 1);
+    CHECK(stopping[1].calls == 3);
+    CHECK_FALSE(esp_timer_is_active(stopping[0].timer));
+    CHECK_FALSE(esp_timer_is_active(stopping[2].timer));
+    CHECK(esp_timer_is_active(stopping[1].timer));
+
+    REQUIRE(esp_timer_stop(stopping[1].timer) == ESP_OK);
+    CHECK(esp_timer_get_next_alarm() == INT64_MAX);
+    for (Stopping &s : stopping) {
+        REQUIRE(esp_timer_delete(s.timer) == ESP_OK);
+    }
+}
+
+TEST_CASE("dispatch statistics count wakeups and callback latency")
+{
+    esp_timer_dispatch_stats_t before, after;
+    Timers timers(2, false, false, 300);
+    if (esp_timer_get_dispatch_stats(&before) == ESP_ERR_NOT_SUPPORTED) {
+        WARN("esp_timer profiling is disabled");
+        return;
+    }
+
+    uint32_t start_interrupts = esp_timer_sim_get_interrupts();
+    REQUIRE(esp_timer_start_once(timers.handles[0], 1000) == ESP_OK);
+    REQUIRE(esp_timer_start_once(timers.handles[1], 1200) == ESP_OK);
+    esp_timer_sim_advance(2000);
+
+    REQUIRE(esp_timer_get_dispatch_stats(&after) == ESP_OK);
+    CHECK(after.wakeups - before.wakeups == esp_timer_sim_get_interrupts() - start_interrupts);
+    CHECK(after.wakeups - before.wakeups == 1);
+    CHECK(after.callbacks - before.callbacks == 2);
+    CHECK(after.total_latency_us - before.total_latency_us == 300 + 100);
+    CHECK(after.max_latency_us >= 300);
+    CHECK(esp_timer_get_dispatch_stats(nullptr) == ESP_ERR_INVALID_ARG);
+}
+
+TEST_CASE("timer queue performance", "[.][bench]")
+{
+    const size_t counts[] = {10, 100, 1000};
+
+    for (size_t count : counts) {
+        Timers timers(count);
+        std::mt19937 rng(3);
+        std::vector<uint64_t> periods(count);
+        for (uint64_t &period : periods) {
+            period = 1000 + rng() % 100000;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            esp_timer_start_periodic(timers.handles[i], periods[i]);
+        }
+        std::chrono::duration<double, std::nano> start_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_RESTARTS; i++) {
+            size_t index = rng() % count;
+            esp_timer_stop(timers.handles[index]);
+            esp_timer_start_periodic(timers.handles[index], periods[index]);
+        }
+        std::chrono::duration<double, std::nano> restart_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        esp_timer_sim_advance(BENCH_SIM_TIME_US);
+        std::chrono::duration<double, std::nano> expiry_time = std::chrono::steady_clock::now() - start;
+
+        printf("%4zu timers: %5.0f ns per start, %5.0f ns per stop and restart, %5.0f ns per expiry\n", count,
+               start_time.count() / count, restart_time.count() / BENCH_RESTARTS,
+               expiry_time.count() / timers.expired.size());
+        CHECK(timers.expired.size() > 0);
+    }
+}
+
+TEST_CASE("timer slack performance", "[.][bench]")
+{
+    const uint32_t slacks[] = {0, 100, 1000, 5000};
+
+    for (uint32_t slack : slacks) {
+        PeriodicTimers timers(SLACK_TIMERS, slack);
+        uint32_t start_interrupts = esp_timer_sim_get_interrupts();
+
+        auto start = std::chrono::steady_clock::now();
+        esp_timer_sim_advance(SLACK_SIM_TIME_US);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        uint32_t interrupts = esp_timer_sim_get_interrupts() - start_interrupts;
+        int64_t latency = timers.check_expiries(slack, esp_timer_get_time());
+        printf("%3d timers, %4u us slack: %5.0f wakeups/s, %4.0f ns per callback, %5.0f us average latency\n",
+               SLACK_TIMERS, (unsigned) slack, interrupts * 1e6 / SLACK_SIM_TIME_US,
+               elapsed.count() / timers.expired.size(), (double) latency / timers.expired.size());
+    }
+}
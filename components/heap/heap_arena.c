@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "heap_arena.h"
+
+#define ALIGN_UP_BY(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
+
+static inline uintptr_t chunk_start(heap_arena_chunk_t *chunk)
+{
+    return (uintptr_t)(chunk + 1);
+}
+
+static heap_arena_chunk_t *new_chunk(heap_arena_t *arena, size_t size)
+{
+    if (arena->max_chunks != 0 && arena->stats.chunks >= arena->max_chunks) {
+        return NULL;
+    }
+    heap_arena_chunk_t *chunk = arena->chunk_alloc(sizeof(heap_arena_chunk_t) + size, arena->ctx);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->size = size;
+    arena->stats.chunks++;
+    arena->stats.capacity_bytes += size;
+    return chunk;
+}
+
+static void use_chunk(heap_arena_t *arena, heap_arena_chunk_t *chunk)
+{
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->pos = chunk_start(chunk);
+    arena->end = chunk_start(chunk) + chunk->size;
+}
+
+bool heap_arena_init(heap_arena_t *arena, size_t chunk_size, size_t max_chunks,
+                     heap_arena_chunk_alloc_t chunk_alloc, heap_arena_chunk_free_t chunk_free, void *ctx)
+{
+    memset(arena, 0, sizeof(heap_arena_t));
+    arena->max_chunks = max_chunks;
+    arena->chunk_alloc = chunk_alloc;
+    arena->chunk_free = chunk_free;
+    arena->ctx = ctx;
+    arena->stats.chunk_size = ALIGN_UP_BY(chunk_size, HEAP_ARENA_ALIGN);
+
+    heap_arena_chunk_t *chunk = new_chunk(arena, arena->stats.chunk_size);
+    if (chunk == NULL) {
+        return false;
+    }
+    use_chunk(arena, chunk);
+    return true;
+}
+
+static void *alloc_from_new_chunk(heap_arena_t *arena, size_t size, size_t alignment)
+{
+    size_t needed = size + alignment - 1;
+
+    if (needed > arena->stats.chunk_size) {
+        /* Large allocation, give it a chunk of its own behind the head */
+        heap_arena_chunk_t *chunk = new_chunk(arena, needed);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        if (arena->chunks != NULL) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            /* No chunk to allocate from, e.g. the first chunk couldn't be allocated again after a reset */
+            chunk->next = NULL;
+            arena->chunks = chunk;
+            arena->pos = chunk_start(chunk) + chunk->size;
+            arena->end = arena->pos;
+        }
+        arena->stats.allocated_bytes += needed;
+        return (void *)ALIGN_UP_BY(chunk_start(chunk), alignment);
+    }
+
+    /* The rest of the head chunk is left unused */
+    heap_arena_chunk_t *chunk = new_chunk(arena, arena->stats.chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    use_chunk(arena, chunk);
+    uintptr_t p = ALIGN_UP_BY(arena->pos, alignment);
+    arena->stats.allocated_bytes += p + size - arena->pos;
+    arena->pos = p + size;
+    return (void *)p;
+}
+
+void *heap_arena_alloc(heap_arena_t *arena, size_t size, size_t alignment)
+{
+    if (size == 0 || size > SIZE_MAX / 2 || alignment > SIZE_MAX / 2) {
+        return NULL;
+    }
+    alignment = (alignment < HEAP_ARENA_ALIGN) ? HEAP_ARENA_ALIGN : alignment;
+
+    void *result;
+    uintptr_t p = ALIGN_UP_BY(arena->pos, alignment);
+    if (p <= arena->end && size <= arena->end - p) {
+        arena->stats.allocated_bytes += p + size - arena->pos;
+        arena->pos = p + size;
+        result = (void *)p;
+    } else {
+        result = alloc_from_new_chunk(arena, size, alignment);
+        if (result == NULL) {
+            arena->stats.failures++;
+            return NULL;
+        }
+    }
+
+    arena->stats.allocations++;
+    if (arena->stats.allocated_bytes > arena->stats.peak_bytes) {
+        arena->stats.peak_bytes = arena->stats.allocated_bytes;
+    }
+    return result;
+}
+
+void heap_arena_reset(heap_arena_t *arena)
+{
+    heap_arena_chunk_t *keep = NULL;
+    heap_arena_chunk_t *chunk = arena->chunks;
+
+    while (chunk != NULL) {
+        heap_arena_chunk_t *next = chunk->next;
+        if (keep == NULL && chunk->size == arena->stats.chunk_size) {
+            keep = chunk;
+        } else {
+            arena->stats.chunks--;
+            arena->stats.capacity_bytes -= chunk->size;
+            arena->chunk_free(chunk, arena->ctx);
+        }
+        chunk = next;
+    }
+
+    arena->chunks = NULL;
+    if (keep != NULL) {
+        use_chunk(arena, keep);
+    }
+    arena->stats.allocated_bytes = 0;
+    arena->stats.allocations = 0;
+    arena->stats.resets++;
+}
+
+void heap_arena_release(heap_arena_t *arena)
+{
+    heap_arena_chunk_t *chunk = arena->chunks;
+
+    while (chunk != NULL) {
+        heap_arena_chunk_t *next = chunk->next;
+        arena->chunk_free(chunk, arena->ctx);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->pos = 0;
+    arena->end = 0;
+    arena->stats.chunks = 0;
+    arena->stats.capacity_bytes = 0;
+    arena->stats.allocated_bytes = 0;
+    arena->stats.allocations = 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_heap_caps_arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bump pointer allocator behind heap_caps_arena_create().
+
+   Chunks are obtained from the chunk_alloc callback, and linked in a list
+   whose head is the chunk being allocated from. Chunks for allocations larger
+   than chunk_size are linked behind the head, so the head keeps serving small
+   allocations.
+
+   Arenas are not locked, see esp_heap_caps_arena.h.
+*/
+
+/* Alignment of the memory returned by heap_arena_alloc() by default, same as the heap */
+#define HEAP_ARENA_ALIGN sizeof(void *)
+
+typedef void *(*heap_arena_chunk_alloc_t)(size_t size, void *ctx);
+typedef void (*heap_arena_chunk_free_t)(void *chunk, void *ctx);
+
+typedef struct heap_arena_chunk {
+    struct heap_arena_chunk *next;
+    size_t size;                            /* Usable bytes following the header */
+} heap_arena_chunk_t;
+
+struct heap_arena {
+    heap_arena_chunk_t *chunks;             /* Head is the chunk being allocated from */
+    uintptr_t pos;                          /* Next free byte of the head chunk */
+    uintptr_t end;                          /* End of the head chunk */
+    size_t max_chunks;                      /* 0 for no limit */
+    heap_arena_chunk_alloc_t chunk_alloc;
+    heap_arena_chunk_free_t chunk_free;
+    void *ctx;
+    heap_caps_arena_stats_t stats;
+};
+
+typedef struct heap_arena heap_arena_t;
+
+/* Initialise an arena and allocate its first chunk. Returns false if the chunk couldn't be allocated. */
+bool heap_arena_init(heap_arena_t *arena, size_t chunk_size, size_t max_chunks,
+                     heap_arena_chunk_alloc_t chunk_alloc, heap_arena_chunk_free_t chunk_free, void *ctx);
+
+/* Allocate size bytes aligned to alignment, a power of two */
+void *heap_arena_alloc(heap_arena_t *arena, size_t size, size_t alignment);
+
+/* Release all allocations, keeping one chunk of chunk_size */
+void heap_arena_reset(heap_arena_t *arena);
+
+/* Release all allocations and free all chunks */
+void heap_arena_release(heap_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
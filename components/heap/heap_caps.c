@@ -116,6 +116,10 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         size = (size + 3) & (~3); // int overflow checked above
     }
 
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    bool caches_flushed = false;
+ retry:
+#endif
     for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
         //Iterate over heaps and check capabilities at this priority
         heap_t *heap;
@@ -139,7 +143,11 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
                         }
                     } else {
                         //Just try to alloc, nothing special.
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+                        ret = multi_heap_cache_malloc(&heap->cache, size);
+#else
                         ret = multi_heap_malloc(heap->heap, size);
+#endif
                         if (ret != NULL) {
                             return ret;
                         }
@@ -149,6 +157,16 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         }
     }
 
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    //The memory may be sitting in the small object caches, give it back to the heaps and try again.
+    if (!caches_flushed) {
+        caches_flushed = true;
+        if (heap_caps_cache_flush() > 0) {
+            goto retry;
+        }
+    }
+#endif
+
     //Nothing usable found.
     return NULL;
 }
@@ -321,7 +339,13 @@ IRAM_ATTR void *heap_caps_calloc_prefer( size_t n, size_t size, size_t num, ...
 IRAM_ATTR static heap_t *find_containing_heap(void *ptr )
 {
     intptr_t p = (intptr_t)ptr;
-    heap_t *heap;
+    heap_t *heap = heap_range_table_find(&registered_heap_ranges, p);
+    /* The table may be updated while we search it, so only trust a result
+       that really contains the pointer. Heaps are never removed and never
+       overlap, so such a heap is the one owning the pointer. */
+    if (heap != NULL && p >= heap->start && p < heap->end) {
+        return heap;
+    }
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap->heap != NULL && p >= heap->start && p < heap->end) {
             return heap;
@@ -346,7 +370,11 @@ IRAM_ATTR void heap_caps_free( void *ptr)
 
     heap_t *heap = find_containing_heap(ptr);
     assert(heap != NULL && "free() target pointer is outside heap areas");
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    multi_heap_cache_free(&heap->cache, ptr);
+#else
     multi_heap_free(heap->heap, ptr);
+#endif
 }
 
 /*
@@ -534,6 +562,58 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     }
 }
 
+void heap_caps_get_frag_info( multi_heap_frag_info_t *info, uint32_t caps )
+{
+    bzero(info, sizeof(multi_heap_frag_info_t));
+
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap_caps_match(heap, caps)) {
+            multi_heap_frag_info_t hinfo;
+            multi_heap_get_frag_info(heap->heap, &hinfo);
+
+            for (int i = 0; i < MULTI_HEAP_FRAG_CLASSES; i++) {
+                info->free_blocks[i] += hinfo.free_blocks[i];
+                info->free_bytes[i] += hinfo.free_bytes[i];
+                info->allocated_blocks[i] += hinfo.allocated_blocks[i];
+            }
+            info->total_free_bytes += hinfo.total_free_bytes;
+            info->largest_free_block = MAX(info->largest_free_block,
+                                           hinfo.largest_free_block);
+        }
+    }
+    if (info->total_free_bytes) {
+        info->fragmentation = 100 - (uint32_t)((uint64_t)info->largest_free_block * 100 / info->total_free_bytes);
+    }
+}
+
+IRAM_ATTR size_t heap_caps_cache_flush(void)
+{
+    size_t flushed = 0;
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap != NULL) {
+            flushed += multi_heap_cache_flush(&heap->cache);
+        }
+    }
+#endif
+    return flushed;
+}
+
+void heap_caps_get_cache_stats(multi_heap_cache_stats_t *stats)
+{
+    bzero(stats, sizeof(multi_heap_cache_stats_t));
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap != NULL) {
+            multi_heap_cache_get_stats(&heap->cache, stats);
+        }
+    }
+#endif
+}
+
 void heap_caps_print_heap_info( uint32_t caps )
 {
     multi_heap_info_t info;
@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_arena.h"
+#include "heap_arena.h"
+
+static void *arena_chunk_alloc(size_t size, void *ctx)
+{
+    return heap_caps_malloc(size, (uint32_t)(uintptr_t)ctx);
+}
+
+static void arena_chunk_free(void *chunk, void *ctx)
+{
+    heap_caps_free(chunk);
+}
+
+heap_caps_arena_handle_t heap_caps_arena_create_with_limit(uint32_t caps, size_t chunk_size, size_t max_chunks)
+{
+    if (chunk_size == 0) {
+        return NULL;
+    }
+
+    heap_arena_t *arena = heap_caps_malloc(sizeof(heap_arena_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (arena == NULL) {
+        return NULL;
+    }
+    if (!heap_arena_init(arena, chunk_size, max_chunks, arena_chunk_alloc, arena_chunk_free, (void *)(uintptr_t)caps)) {
+        heap_caps_free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+heap_caps_arena_handle_t heap_caps_arena_create(uint32_t caps, size_t chunk_size)
+{
+    return heap_caps_arena_create_with_limit(caps, chunk_size, 0);
+}
+
+void *heap_caps_arena_malloc(heap_caps_arena_handle_t arena, size_t size)
+{
+    return heap_arena_alloc(arena, size, HEAP_ARENA_ALIGN);
+}
+
+void *heap_caps_arena_calloc(heap_caps_arena_handle_t arena, size_t n, size_t size)
+{
+    size_t size_bytes;
+    if (__builtin_mul_overflow(n, size, &size_bytes)) {
+        return NULL;
+    }
+
+    void *result = heap_arena_alloc(arena, size_bytes, HEAP_ARENA_ALIGN);
+    if (result != NULL) {
+        memset(result, 0, size_bytes);
+    }
+    return result;
+}
+
+void *heap_caps_arena_aligned_alloc(heap_caps_arena_handle_t arena, size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return NULL;
+    }
+    return heap_arena_alloc(arena, size, alignment);
+}
+
+void heap_caps_arena_reset(heap_caps_arena_handle_t arena)
+{
+    heap_arena_reset(arena);
+}
+
+void heap_caps_arena_destroy(heap_caps_arena_handle_t arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+    heap_arena_release(arena);
+    heap_caps_free(arena);
+}
+
+void heap_caps_arena_get_stats(heap_caps_arena_handle_t arena, heap_caps_arena_stats_t *stats)
+{
+    memcpy(stats, &arena->stats, sizeof(heap_caps_arena_stats_t));
+}
@@ -19,6 +19,27 @@ static const char *TAG = "heap_init";
 /* Linked-list of registered heaps */
 struct registered_heap_ll registered_heaps;
 
+/* Sorted address ranges of the registered heaps */
+heap_range_table_t registered_heap_ranges;
+
+/* Serializes writers of registered_heaps and registered_heap_ranges,
+   readers don't take it. */
+static multi_heap_lock_t registered_heaps_write_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+
+static void init_heap_cache(heap_t *heap)
+{
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    multi_heap_cache_init(&heap->cache, heap->heap);
+#endif
+}
+
+static void add_heap_range(heap_t *heap)
+{
+    if (!heap_range_table_insert(&registered_heap_ranges, heap->start, heap->end, heap)) {
+        ESP_EARLY_LOGD(TAG, "heap at %p not indexed, lookups will walk the heap list", (void *)heap->start);
+    }
+}
+
 static void register_heap(heap_t *region)
 {
     size_t heap_size = region->end - region->start;
@@ -39,6 +60,10 @@ void heap_caps_enable_nonos_stack_heaps(void)
             register_heap(heap);
             if (heap->heap != NULL) {
                 multi_heap_set_lock(heap->heap, &heap->heap_mux);
+                init_heap_cache(heap);
+                MULTI_HEAP_LOCK(&registered_heaps_write_lock);
+                add_heap_range(heap);
+                MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
             }
         }
     }
@@ -139,6 +164,8 @@ void heap_caps_init(void)
     for (size_t i = 0; i < num_heaps; i++) {
         if (heaps_array[i].heap != NULL) {
             multi_heap_set_lock(heaps_array[i].heap, &heaps_array[i].heap_mux);
+            init_heap_cache(&heaps_array[i]);
+            add_heap_range(&heaps_array[i]);
         }
         if (i == 0) {
             SLIST_INSERT_HEAD(&registered_heaps, &heaps_array[0], next);
@@ -234,13 +261,15 @@ esp_err_t heap_caps_add_region_with_caps(const uint32_t caps[], intptr_t start,
         goto done;
     }
     multi_heap_set_lock(p_new->heap, &p_new->heap_mux);
+    init_heap_cache(p_new);
 
     /* (This insertion is atomic to registered_heaps, so
        we don't need to worry about thread safety for readers,
-       only for writers. */
-    static multi_heap_lock_t registered_heaps_write_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+       only for writers. Readers of registered_heap_ranges validate
+       what they find, see find_containing_heap().) */
     MULTI_HEAP_LOCK(&registered_heaps_write_lock);
     SLIST_INSERT_HEAD(&registered_heaps, p_new, next);
+    add_heap_range(p_new);
     MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
 
     err = ESP_OK;
@@ -18,7 +18,12 @@
 #include <soc/soc_memory_layout.h>
 #include "multi_heap.h"
 #include "multi_heap_platform.h"
+#include "heap_range_table.h"
 #include "sys/queue.h"
+#include "sdkconfig.h"
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+#include "multi_heap_cache.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +42,9 @@ typedef struct heap_t_ {
     intptr_t end;
     multi_heap_lock_t heap_mux;
     multi_heap_handle_t heap;
+#ifdef CONFIG_HEAP_SMALL_OBJECT_CACHE
+    multi_heap_cache_t cache;
+#endif
     SLIST_ENTRY(heap_t_) next;
 } heap_t;
 
@@ -48,6 +56,14 @@ typedef struct heap_t_ {
 */
 extern SLIST_HEAD(registered_heap_ll, heap_t_) registered_heaps;
 
+/* Address ranges of the registered heaps which have been initialised,
+   sorted by start address. Used to find the heap owning a pointer.
+
+   Heaps which don't fit in the table are only in registered_heaps, so
+   a failed lookup must fall back to walking the list.
+*/
+extern heap_range_table_t registered_heap_ranges;
+
 bool heap_caps_match(const heap_t *heap, uint32_t caps);
 
 /* return all possible capabilities (across all priorities) for a given heap */
@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "heap_range_table.h"
+
+/* Index of the first range whose start is greater than addr */
+static size_t upper_bound(const heap_range_table_t *table, size_t count, intptr_t addr)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->ranges[mid].start <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool heap_range_table_insert(heap_range_table_t *table, intptr_t start, intptr_t end, void *owner)
+{
+    size_t count = table->count;
+    if (count == HEAP_RANGE_TABLE_SIZE || end <= start) {
+        return false;
+    }
+
+    size_t pos = upper_bound(table, count, start);
+    if (pos > 0 && table->ranges[pos - 1].end > start) {
+        return false;
+    }
+    if (pos < count && table->ranges[pos].start < end) {
+        return false;
+    }
+
+    for (size_t i = count; i > pos; i--) {
+        table->ranges[i] = table->ranges[i - 1];
+    }
+    table->ranges[pos].start = start;
+    table->ranges[pos].end = end;
+    table->ranges[pos].owner = owner;
+    table->count = count + 1;
+    return true;
+}
+
+void *heap_range_table_find(const heap_range_table_t *table, intptr_t addr)
+{
+    size_t count = table->count;
+    if (count > HEAP_RANGE_TABLE_SIZE) {
+        return NULL;
+    }
+
+    size_t pos = upper_bound(table, count, addr);
+    if (pos == 0) {
+        return NULL;
+    }
+
+    const heap_range_t *range = &table->ranges[pos - 1];
+    if (addr >= range->end) {
+        return NULL;
+    }
+    return range->owner;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Table of non-overlapping address ranges kept sorted by start address,
+   used to find the heap owning a pointer with a binary search instead of
+   walking the list of registered heaps.
+*/
+
+#define HEAP_RANGE_TABLE_SIZE 32
+
+typedef struct {
+    intptr_t start;
+    intptr_t end;
+    void *owner;
+} heap_range_t;
+
+typedef struct {
+    heap_range_t ranges[HEAP_RANGE_TABLE_SIZE];
+    size_t count;
+} heap_range_table_t;
+
+/**
+ * @brief Insert the range [start, end) into the table, keeping it sorted
+ *
+ * The caller must serialize calls to this function. Lookups may run
+ * concurrently, they can then miss or return an unrelated owner, so the
+ * caller must validate the result of heap_range_table_find().
+ *
+ * @return false if the table is full or the range overlaps an existing entry
+ */
+bool heap_range_table_insert(heap_range_table_t *table, intptr_t start, intptr_t end, void *owner);
+
+/**
+ * @brief Find the owner of the range containing addr
+ *
+ * @return owner passed to heap_range_table_insert(), or NULL if addr is not
+ *         inside any range of the table
+ */
+void *heap_range_table_find(const heap_range_table_t *table, intptr_t addr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,10 +17,90 @@
 #include <multi_heap.h>
 #include "multi_heap_internal.h"
 #include "heap_private.h"
+#include "multi_heap_task_stats.h"
 #include "esp_heap_task_info.h"
 
 #ifdef CONFIG_HEAP_TASK_TRACKING
 
+/* Find the first set of capabilities of params matching the heap, or return NUM_HEAP_TASK_CAPS */
+static uint32_t get_heap_type(const heap_t *reg, const heap_task_info_params_t *params)
+{
+    uint32_t caps = get_all_caps(reg);
+    uint32_t type;
+    for (type = 0; type < NUM_HEAP_TASK_CAPS; ++type) {
+        if ((caps & params->mask[type]) == params->caps[type]) {
+            break;
+        }
+    }
+    return type;
+}
+
+/* Accumulate an allocation total of a task in params->totals, of which *count are in use */
+static void add_to_totals(heap_task_info_params_t *params, size_t *count, TaskHandle_t task, uint32_t type,
+                          size_t size, size_t blocks)
+{
+    size_t i;
+    for (i = 0; i < *count; ++i) {
+        if (params->totals[i].task == task) {
+            break;
+        }
+    }
+    if (i < *count) {
+        params->totals[i].size[type] += size;
+        params->totals[i].count[type] += blocks;
+    }
+    else {
+        if (*count < params->max_totals) {
+            params->totals[*count].task = task;
+            params->totals[*count].size[type] = size;
+            params->totals[*count].count[type] = blocks;
+            ++*count;
+        }
+    }
+}
+
+static void clear_totals(heap_task_info_params_t *params, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t type = 0; type < NUM_HEAP_TASK_CAPS; ++type) {
+            params->totals[i].size[type] = 0;
+            params->totals[i].count[type] = 0;
+        }
+    }
+}
+
+/* Collect the totals from the running per-task counters, in O(tasks * heaps).
+   Returns false if the counters are incomplete. */
+static bool get_totals_from_counters(heap_task_info_params_t *params, size_t *count)
+{
+    multi_heap_task_stats_t stats[8];
+    size_t pos = 0;
+    size_t n;
+    bool complete = true;
+
+    while ((n = multi_heap_task_stats_get(&pos, stats, sizeof(stats) / sizeof(stats[0]), &complete)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            if (stats[i].heap == NULL || stats[i].count == 0) {
+                continue;
+            }
+            heap_t *reg;
+            SLIST_FOREACH(reg, &registered_heaps, next) {
+                if (reg->heap == stats[i].heap) {
+                    break;
+                }
+            }
+            if (reg == NULL) {
+                continue;
+            }
+            uint32_t type = get_heap_type(reg, params);
+            if (type < NUM_HEAP_TASK_CAPS) {
+                add_to_totals(params, count, (TaskHandle_t)stats[i].task, type, stats[i].size, stats[i].count);
+            }
+        }
+    }
+    return complete;
+}
+
 /*
  * Return per-task heap allocation totals and lists of blocks.
  *
@@ -41,12 +121,18 @@ size_t heap_caps_get_per_task_info(heap_task_info_params_t *params)
 
     // Clear out totals for any prepopulated tasks.
     if (params->totals) {
-        for (size_t i = 0; i < count; ++i) {
-            for (size_t type = 0; type < NUM_HEAP_TASK_CAPS; ++type) {
-                params->totals[i].size[type] = 0;
-                params->totals[i].count[type] = 0;
-            }
+        clear_totals(params, count);
+    }
+
+    // Totals alone are kept up to date at allocation time, no need to walk the heaps.
+    if (blocks == NULL || remaining == 0) {
+        if (params->totals == NULL || get_totals_from_counters(params, &count)) {
+            *params->num_totals = count;
+            return 0;
         }
+        // Some allocations were not counted, start over with a walk
+        count = *params->num_totals;
+        clear_totals(params, count);
     }
 
     SLIST_FOREACH(reg, &registered_heaps, next) {
@@ -57,13 +143,7 @@ size_t heap_caps_get_per_task_info(heap_task_info_params_t *params)
 
         // Find if the capabilities of this heap region match on of the desired
         // sets of capabilities.
-        uint32_t caps = get_all_caps(reg);
-        uint32_t type;
-        for (type = 0; type < NUM_HEAP_TASK_CAPS; ++type) {
-            if ((caps & params->mask[type]) == params->caps[type]) {
-                break;
-            }
-        }
+        uint32_t type = get_heap_type(reg, params);
         if (type == NUM_HEAP_TASK_CAPS) {
             continue;
         }
@@ -80,24 +160,7 @@ size_t heap_caps_get_per_task_info(heap_task_info_params_t *params)
 
             // Accumulate per-task allocation totals.
             if (params->totals) {
-                size_t i;
-                for (i = 0; i < count; ++i) {
-                    if (params->totals[i].task == btask) {
-                        break;
-                    }
-                }
-                if (i < count) {
-                    params->totals[i].size[type] += bsize;
-                    params->totals[i].count[type] += 1;
-                }
-                else {
-                    if (count < params->max_totals) {
-                        params->totals[count].task = btask;
-                        params->totals[count].size[type] = bsize;
-                        params->totals[i].count[type] = 1;
-                        ++count;
-                    }
-                }
+                add_to_totals(params, &count, btask, type, bsize, 1);
             }
 
             // Return details about allocated blocks for selected tasks.
@@ -126,4 +189,34 @@ size_t heap_caps_get_per_task_info(heap_task_info_params_t *params)
     return params->max_blocks - remaining;
 }
 
+/*
+ * Return the running allocation counters of each task, over all heaps.
+ */
+size_t heap_caps_get_all_task_stats(heap_task_stat_t *task_stats, size_t max_stats, bool *complete)
+{
+    multi_heap_task_stats_t stats[8];
+    size_t pos = 0;
+    size_t n;
+    size_t count = 0;
+    bool stats_complete = true;
+
+    // Fetch at least once, so that stats_complete is set even if max_stats is 0
+    while ((n = multi_heap_task_stats_get(&pos, stats, sizeof(stats) / sizeof(stats[0]), &stats_complete)) > 0 && count < max_stats) {
+        for (size_t i = 0; i < n && count < max_stats; ++i) {
+            if (stats[i].heap != NULL) {
+                continue;
+            }
+            task_stats[count].task = (TaskHandle_t)stats[i].task;
+            task_stats[count].size = stats[i].size;
+            task_stats[count].count = stats[i].count;
+            task_stats[count].peak_size = stats[i].peak;
+            ++count;
+        }
+    }
+    if (complete) {
+        *complete = stats_complete;
+    }
+    return count;
+}
+
 #endif // CONFIG_HEAP_TASK_TRACKING
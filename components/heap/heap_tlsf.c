@@ -589,6 +589,34 @@ void tlsf_walk_pool(pool_t pool, tlsf_walker walker, void* user)
 	}
 }
 
+void tlsf_walk_free_lists(tlsf_t tlsf, tlsf_walker walker, void* user)
+{
+	control_t* control = tlsf_cast(control_t*, tlsf);
+	tlsf_walker list_walker = walker ? walker : default_walker;
+	unsigned int fl_map = control->fl_bitmap;
+
+	/* Only visit the lists the bitmaps mark as non-empty. */
+	while (fl_map)
+	{
+		const int fl = tlsf_ffs(fl_map);
+		unsigned int sl_map = control->sl_bitmap[fl];
+		fl_map &= ~(1U << fl);
+
+		while (sl_map)
+		{
+			const int sl = tlsf_ffs(sl_map);
+			block_header_t* block = control->blocks[fl][sl];
+			sl_map &= ~(1U << sl);
+
+			while (block != &control->block_null)
+			{
+				list_walker(block_to_ptr(block), block_size(block), 0, user);
+				block = block->next_free;
+			}
+		}
+	}
+}
+
 size_t tlsf_block_size(void* ptr)
 {
 	size_t size = 0;
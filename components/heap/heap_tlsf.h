@@ -123,6 +123,8 @@ size_t tlsf_alloc_overhead(void);
 /* Debugging. */
 typedef void (*tlsf_walker)(void* ptr, size_t size, int used, void* user);
 void tlsf_walk_pool(pool_t pool, tlsf_walker walker, void* user);
+/* Calls walker for each free block only, found through the free list bitmaps. */
+void tlsf_walk_free_lists(tlsf_t tlsf, tlsf_walker walker, void* user);
 /* Returns nonzero if any internal consistency check fails. */
 int tlsf_check(tlsf_t tlsf);
 int tlsf_check_pool(pool_t pool);
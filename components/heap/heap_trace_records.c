@@ -0,0 +1,231 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "heap_trace_records.h"
+
+#define STACK_DEPTH CONFIG_HEAP_TRACING_STACK_DEPTH
+
+static inline heap_trace_record_list_t *hash_bucket(heap_trace_records_t *records, const void *address)
+{
+    /* Allocations are at least 4 byte aligned, spread the remaining bits with a multiplicative hash.
+       Its top bits are the well mixed ones, scale them down to the number of buckets. */
+    uint32_t h = (uint32_t)((uintptr_t)address >> 2) * 2654435761u;
+    return &records->hash_map[((uint64_t)h * records->hash_map_size) >> 32];
+}
+
+static inline heap_trace_record_t *record_of(heap_trace_records_t *records, heap_trace_record_link_t *link)
+{
+    return &records->buffer[link - records->links];
+}
+
+static inline heap_trace_record_link_t *link_of(heap_trace_records_t *records, heap_trace_record_t *record)
+{
+    return &records->links[record - records->buffer];
+}
+
+/* Number of buckets of the hash map for num_records records */
+static inline size_t heap_trace_records_hash_map_size(size_t num_records)
+{
+    return (num_records + 1) / 2;
+}
+
+/* Offset of the links in the buffer of num_records records */
+static inline size_t links_offset(size_t num_records)
+{
+    size_t offset = num_records * sizeof(heap_trace_record_t);
+    return (offset + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+
+size_t heap_trace_records_buffer_size(size_t num_records)
+{
+    return links_offset(num_records) + num_records * sizeof(heap_trace_record_link_t) +
+           heap_trace_records_hash_map_size(num_records) * sizeof(heap_trace_record_list_t);
+}
+
+size_t heap_trace_records_capacity(size_t size)
+{
+    size_t n = size / (sizeof(heap_trace_record_t) + sizeof(heap_trace_record_link_t) + sizeof(heap_trace_record_list_t) / 2);
+    while (n > 0 && heap_trace_records_buffer_size(n) > size) {
+        n--;
+    }
+    return n;
+}
+
+/* List holding the link through tailq_hash */
+static inline heap_trace_record_list_t *hash_list_of(heap_trace_records_t *records, heap_trace_record_link_t *link)
+{
+    return link->freed ? &records->freed : hash_bucket(records, record_of(records, link)->address);
+}
+
+/* Whether a was added before b, seq may wrap around */
+static inline bool is_older(const heap_trace_record_link_t *a, const heap_trace_record_link_t *b)
+{
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/* Move the record in use from index 'from' to the unused index 'to', keeping its place in the lists */
+static void move_record(heap_trace_records_t *records, size_t from, size_t to)
+{
+    heap_trace_record_link_t *src = &records->links[from];
+    heap_trace_record_link_t *dst = &records->links[to];
+    heap_trace_record_list_t *hash_list = hash_list_of(records, src);
+
+    heap_trace_record_link_t *next = TAILQ_NEXT(src, tailq);
+    TAILQ_REMOVE(&records->used, src, tailq);
+    if (next != NULL) {
+        TAILQ_INSERT_BEFORE(next, dst, tailq);
+    } else {
+        TAILQ_INSERT_TAIL(&records->used, dst, tailq);
+    }
+    next = TAILQ_NEXT(src, tailq_hash);
+    TAILQ_REMOVE(hash_list, src, tailq_hash);
+    if (next != NULL) {
+        TAILQ_INSERT_BEFORE(next, dst, tailq_hash);
+    } else {
+        TAILQ_INSERT_TAIL(hash_list, dst, tailq_hash);
+    }
+
+    dst->seq = src->seq;
+    dst->freed = src->freed;
+    memcpy(&records->buffer[to], &records->buffer[from], sizeof(heap_trace_record_t));
+    if (records->cursor == src) {
+        records->cursor = dst;
+    }
+}
+
+static void unlink_record(heap_trace_records_t *records, heap_trace_record_link_t *link)
+{
+    /* Keep the cursor, so that reading all records while others are removed stays O(n) */
+    if (records->cursor != NULL) {
+        if (records->cursor == link) {
+            records->cursor = TAILQ_PREV(link, heap_trace_record_list_, tailq);
+            if (records->cursor != NULL) {
+                records->cursor_index--;
+            }
+        } else if (is_older(link, records->cursor)) {
+            records->cursor_index--;
+        }
+    }
+    TAILQ_REMOVE(&records->used, link, tailq);
+    TAILQ_REMOVE(hash_list_of(records, link), link, tailq_hash);
+    records->count--;
+
+    size_t index = link - records->links;
+    if (index != records->count) {
+        move_record(records, records->count, index);
+    }
+    memset(&records->buffer[records->count], 0, sizeof(heap_trace_record_t));
+}
+
+void heap_trace_records_init(heap_trace_records_t *records, void *buffer, size_t num_records, bool evict_freed_first)
+{
+    records->buffer = (heap_trace_record_t *)buffer;
+    records->links = (heap_trace_record_link_t *)((uint8_t *)buffer + links_offset(num_records));
+    records->hash_map = (heap_trace_record_list_t *)(records->links + num_records);
+    records->hash_map_size = heap_trace_records_hash_map_size(num_records);
+    records->capacity = num_records;
+    records->evict_freed_first = evict_freed_first;
+    heap_trace_records_clear(records);
+}
+
+void heap_trace_records_clear(heap_trace_records_t *records)
+{
+    TAILQ_INIT(&records->used);
+    TAILQ_INIT(&records->freed);
+    for (size_t i = 0; i < records->hash_map_size; i++) {
+        TAILQ_INIT(&records->hash_map[i]);
+    }
+    records->count = 0;
+    records->next_seq = 0;
+    records->cursor = NULL;
+}
+
+void heap_trace_records_add(heap_trace_records_t *records, const heap_trace_record_t *record, bool *evicted)
+{
+    *evicted = false;
+    if (records->capacity == 0) {
+        return;
+    }
+
+    if (records->count == records->capacity) {
+        heap_trace_record_link_t *victim;
+        if (records->evict_freed_first && !TAILQ_EMPTY(&records->freed)) {
+            victim = TAILQ_FIRST(&records->freed);
+        } else {
+            victim = TAILQ_FIRST(&records->used);
+        }
+        unlink_record(records, victim);
+        *evicted = true;
+    }
+
+    heap_trace_record_link_t *link = &records->links[records->count];
+    heap_trace_record_t *r = &records->buffer[records->count];
+    r->ccount = record->ccount;
+    r->address = record->address;
+    r->size = record->size;
+    memcpy(r->alloced_by, record->alloced_by, sizeof(void *) * STACK_DEPTH);
+    memset(r->freed_by, 0, sizeof(void *) * STACK_DEPTH);
+    link->freed = false;
+    link->seq = records->next_seq++;
+
+    TAILQ_INSERT_TAIL(&records->used, link, tailq);
+    /* Newest first, so a stale record of the same address is never found first */
+    TAILQ_INSERT_HEAD(hash_bucket(records, r->address), link, tailq_hash);
+    records->count++;
+}
+
+heap_trace_record_t *heap_trace_records_find(heap_trace_records_t *records, const void *address)
+{
+    heap_trace_record_link_t *link;
+    TAILQ_FOREACH(link, hash_bucket(records, address), tailq_hash) {
+        heap_trace_record_t *r = record_of(records, link);
+        if (r->address == address) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+void heap_trace_records_set_freed(heap_trace_records_t *records, heap_trace_record_t *record, void **callers)
+{
+    heap_trace_record_link_t *link = link_of(records, record);
+    memcpy(record->freed_by, callers, sizeof(void *) * STACK_DEPTH);
+    TAILQ_REMOVE(hash_bucket(records, record->address), link, tailq_hash);
+    TAILQ_INSERT_TAIL(&records->freed, link, tailq_hash);
+    link->freed = true;
+}
+
+void heap_trace_records_remove(heap_trace_records_t *records, heap_trace_record_t *record)
+{
+    unlink_record(records, link_of(records, record));
+}
+
+heap_trace_record_t *heap_trace_records_get(heap_trace_records_t *records, size_t index)
+{
+    if (index >= records->count) {
+        return NULL;
+    }
+
+    heap_trace_record_link_t *link;
+    size_t i;
+    if (records->cursor != NULL && records->cursor_index <= index) {
+        link = records->cursor;
+        i = records->cursor_index;
+    } else {
+        link = TAILQ_FIRST(&records->used);
+        i = 0;
+    }
+    for (; i < index; i++) {
+        link = TAILQ_NEXT(link, tailq);
+    }
+
+    records->cursor = link;
+    records->cursor_index = index;
+    return record_of(records, link);
+}
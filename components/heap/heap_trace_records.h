@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "sys/queue.h"
+
+#define HEAP_TRACE_SRCFILE /* don't warn on inclusion here */
+#include "esp_heap_trace.h"
+#undef HEAP_TRACE_SRCFILE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Record store of the standalone heap tracing.
+
+   Records live at the start of the buffer given to heap_trace_init_standalone(),
+   the records in use are kept in the first entries, so the unused ones form the
+   free list. Removing a record moves the last record in use into its place.
+   Records are linked in allocation order and found by address through a hash
+   map with one bucket per two records, so adding, finding and removing a record
+   are O(1) whatever the number of records.
+
+   The list links and the hash map are kept in the same buffer, after the
+   records, so that heap_trace_record_t only holds what heap_trace_get()
+   returns and no memory is allocated. Callers provide the locking.
+*/
+
+/* Links of the record at the same index of the buffer */
+typedef struct heap_trace_record_link_ {
+    TAILQ_ENTRY(heap_trace_record_link_) tailq;      /* In 'used' */
+    TAILQ_ENTRY(heap_trace_record_link_) tailq_hash; /* In a hash bucket, or in 'freed' */
+    uint32_t seq;                                    /* Increases in allocation order */
+    bool freed;                                      /* The memory was freed, the record is in 'freed' */
+} heap_trace_record_link_t;
+
+typedef TAILQ_HEAD(heap_trace_record_list_, heap_trace_record_link_) heap_trace_record_list_t;
+
+typedef struct {
+    heap_trace_record_t *buffer;
+    heap_trace_record_link_t *links;    /* Same number of entries as buffer */
+    size_t capacity;
+    size_t count;                       /* Records in use, the first entries of buffer */
+    bool evict_freed_first;             /* When full, drop the oldest freed record before the oldest record */
+    uint32_t next_seq;
+    heap_trace_record_list_t used;      /* Records in use, oldest first */
+    heap_trace_record_list_t freed;     /* Records in use whose memory was freed, oldest free first */
+    heap_trace_record_list_t *hash_map; /* Records in use not yet freed, by address */
+    size_t hash_map_size;
+    heap_trace_record_link_t *cursor;   /* Record last returned by heap_trace_records_get(), kept while records are removed */
+    size_t cursor_index;
+} heap_trace_records_t;
+
+/* Number of bytes of buffer needed for num_records records */
+size_t heap_trace_records_buffer_size(size_t num_records);
+
+/* Number of records which fit into size bytes of buffer */
+size_t heap_trace_records_capacity(size_t size);
+
+/* Use heap_trace_records_buffer_size(num_records) bytes of buffer, which has to be aligned
+   like heap_trace_record_t, for num_records records, all unused */
+void heap_trace_records_init(heap_trace_records_t *records, void *buffer, size_t num_records, bool evict_freed_first);
+
+/* Mark all records unused */
+void heap_trace_records_clear(heap_trace_records_t *records);
+
+/* Add a copy of record as the newest record. If all records are in use, one is
+   evicted first and *evicted is set. */
+void heap_trace_records_add(heap_trace_records_t *records, const heap_trace_record_t *record, bool *evicted);
+
+/* Find the newest record of an allocation at address which was not freed yet */
+heap_trace_record_t *heap_trace_records_find(heap_trace_records_t *records, const void *address);
+
+/* Keep the record, but note that its memory was freed by callers */
+void heap_trace_records_set_freed(heap_trace_records_t *records, heap_trace_record_t *record, void **callers);
+
+/* Mark the record unused. The last record in use is moved into its place. */
+void heap_trace_records_remove(heap_trace_records_t *records, heap_trace_record_t *record);
+
+/* Get the record at index in allocation order. O(1) when called with increasing indexes. */
+heap_trace_record_t *heap_trace_records_get(heap_trace_records_t *records, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,7 @@
 #include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "heap_trace_records.h"
 
 
 #define STACK_DEPTH CONFIG_HEAP_TRACING_STACK_DEPTH
@@ -31,16 +32,8 @@ static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
 static bool tracing;
 static heap_trace_mode_t mode;
 
-/* Buffer used for records, starting at offset 0
-*/
-static heap_trace_record_t *buffer;
-static size_t total_records;
-
-/* Count of entries logged in the buffer.
-
-   Maximum total_records
-*/
-static size_t count;
+/* Records, with their links and hash map, in the buffer given to heap_trace_init_standalone() */
+static heap_trace_records_t records;
 
 /* Actual number of allocations logged */
 static size_t total_allocations;
@@ -56,15 +49,19 @@ esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t
     if (tracing) {
         return ESP_ERR_INVALID_STATE;
     }
-    buffer = record_buffer;
-    total_records = num_records;
-    memset(buffer, 0, num_records * sizeof(heap_trace_record_t));
+    size_t size = num_records * sizeof(heap_trace_record_t);
+    memset(record_buffer, 0, size);
+#ifdef CONFIG_HEAP_TRACE_EVICT_FREED_FIRST
+    heap_trace_records_init(&records, record_buffer, heap_trace_records_capacity(size), true);
+#else
+    heap_trace_records_init(&records, record_buffer, heap_trace_records_capacity(size), false);
+#endif
     return ESP_OK;
 }
 
 esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
 {
-    if (buffer == NULL || total_records == 0) {
+    if (records.buffer == NULL || records.capacity == 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -72,7 +69,7 @@ esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
 
     tracing = false;
     mode = mode_param;
-    count = 0;
+    heap_trace_records_clear(&records);
     total_allocations = 0;
     total_frees = 0;
     has_overflowed = false;
@@ -103,7 +100,7 @@ esp_err_t heap_trace_resume(void)
 
 size_t heap_trace_get_count(void)
 {
-    return count;
+    return records.count;
 }
 
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
@@ -114,10 +111,11 @@ esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
     esp_err_t result = ESP_OK;
 
     portENTER_CRITICAL(&trace_mux);
-    if (index >= count) {
+    heap_trace_record_t *rec = heap_trace_records_get(&records, index);
+    if (rec == NULL) {
         result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
     } else {
-        memcpy(record, &buffer[index], sizeof(heap_trace_record_t));
+        memcpy(record, rec, sizeof(heap_trace_record_t));
     }
     portEXIT_CRITICAL(&trace_mux);
     return result;
@@ -129,27 +127,27 @@ void heap_trace_dump(void)
     size_t delta_size = 0;
     size_t delta_allocs = 0;
     printf("%u allocations trace (%u entry buffer)\n",
-           count, total_records);
-    size_t start_count = count;
-    for (int i = 0; i < count; i++) {
-        heap_trace_record_t *rec = &buffer[i];
-
-        if (rec->address != NULL) {
+           records.count, records.capacity);
+    size_t start_count = records.count;
+    heap_trace_record_t rec;
+    // Copy each record out under the lock, the records may be modified while tracing is running
+    for (size_t i = 0; heap_trace_get(i, &rec) == ESP_OK; i++) {
+        if (rec.address != NULL) {
             printf("%d bytes (@ %p) allocated CPU %d ccount 0x%08x caller ",
-                   rec->size, rec->address, rec->ccount & 1, rec->ccount & ~3);
-            for (int j = 0; j < STACK_DEPTH && rec->alloced_by[j] != 0; j++) {
-                printf("%p%s", rec->alloced_by[j],
+                   rec.size, rec.address, rec.ccount & 1, rec.ccount & ~3);
+            for (int j = 0; j < STACK_DEPTH && rec.alloced_by[j] != 0; j++) {
+                printf("%p%s", rec.alloced_by[j],
                        (j < STACK_DEPTH - 1) ? ":" : "");
             }
 
-            if (mode != HEAP_TRACE_ALL || STACK_DEPTH == 0 || rec->freed_by[0] == NULL) {
-                delta_size += rec->size;
+            if (mode != HEAP_TRACE_ALL || STACK_DEPTH == 0 || rec.freed_by[0] == NULL) {
+                delta_size += rec.size;
                 delta_allocs++;
                 printf("\n");
             } else {
                 printf("\nfreed by ");
                 for (int j = 0; j < STACK_DEPTH; j++) {
-                    printf("%p%s", rec->freed_by[j],
+                    printf("%p%s", rec.freed_by[j],
                            (j < STACK_DEPTH - 1) ? ":" : "\n");
                 }
             }
@@ -162,7 +160,7 @@ void heap_trace_dump(void)
         printf("%u bytes 'leaked' in trace (%u allocations)\n", delta_size, delta_allocs);
     }
     printf("total allocations %u total frees %u\n", total_allocations, total_frees);
-    if (start_count != count) { // only a problem if trace isn't stopped before dumping
+    if (start_count != records.count) { // only a problem if trace isn't stopped before dumping
         printf("(NB: New entries were traced while dumping, so trace dump may have duplicate entries.)\n");
     }
     if (has_overflowed) {
@@ -179,29 +177,16 @@ static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 
     portENTER_CRITICAL(&trace_mux);
     if (tracing) {
-        if (count == total_records) {
+        bool evicted;
+        heap_trace_records_add(&records, record, &evicted);
+        if (evicted) {
             has_overflowed = true;
-            /* Move the whole buffer back one slot.
-
-               This is a bit slow, compared to treating this buffer as a ringbuffer and rotating a head pointer.
-
-               However, ringbuffer code gets tricky when we remove elements in mid-buffer (for leak trace mode) while
-               trying to keep track of an item count that may overflow.
-            */
-            memmove(&buffer[0], &buffer[1], sizeof(heap_trace_record_t) * (total_records -1));
-            count--;
         }
-        // Copy new record into place
-        memcpy(&buffer[count], record, sizeof(heap_trace_record_t));
-        count++;
         total_allocations++;
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-// remove a record, used when freeing
-static void remove_record(int index);
-
 /* record a free event in the heap trace log
 
    For HEAP_TRACE_ALL, this means filling in the freed_by pointer.
@@ -214,42 +199,23 @@ static IRAM_ATTR void record_free(void *p, void **callers)
     }
 
     portENTER_CRITICAL(&trace_mux);
-    if (tracing && count > 0) {
+    if (tracing && records.count > 0) {
         total_frees++;
-        /* search backwards for the allocation record matching this free */
-        int i;
-        for (i = count - 1; i >= 0; i--) {
-            if (buffer[i].address == p) {
-                break;
-            }
-        }
+        /* find the newest allocation record matching this free */
+        heap_trace_record_t *rec = heap_trace_records_find(&records, p);
 
-        if (i >= 0) {
+        if (rec != NULL) {
             if (mode == HEAP_TRACE_ALL) {
-                memcpy(buffer[i].freed_by, callers, sizeof(void *) * STACK_DEPTH);
+                heap_trace_records_set_freed(&records, rec, callers);
             } else { // HEAP_TRACE_LEAKS
                 // Leak trace mode, once an allocation is freed we remove it from the list
-                remove_record(i);
+                heap_trace_records_remove(&records, rec);
             }
         }
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-/* remove the entry at 'index' from the ringbuffer of saved records */
-static IRAM_ATTR void remove_record(int index)
-{
-    if (index < count - 1) {
-        // Remove the buffer entry from the list
-        memmove(&buffer[index], &buffer[index+1],
-                sizeof(heap_trace_record_t) * (total_records - index - 1));
-    } else {
-        // For last element, just zero it out to avoid ambiguity
-        memset(&buffer[index], 0, sizeof(heap_trace_record_t));
-    }
-    count--;
-}
-
 #include "heap_trace.inc"
 
 #endif /*CONFIG_HEAP_TRACING_STANDALONE*/
@@ -231,6 +231,42 @@ size_t heap_caps_get_largest_free_block( uint32_t caps );
  */
 void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps );
 
+/**
+ * @brief Get fragmentation metrics for all regions with the given capabilities.
+ *
+ * Calls multi_heap_get_frag_info() on all heaps which share the given capabilities. The histograms
+ * and free bytes are summed over the matching heaps, the fragmentation is computed from the largest
+ * free block of any of them.
+ *
+ * This is cheaper than heap_caps_get_info(), as only the free blocks are visited.
+ *
+ * @param info        Pointer to a structure which will be filled with the
+ *                    fragmentation metrics.
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
+ *                    of memory
+ */
+void heap_caps_get_frag_info( multi_heap_frag_info_t *info, uint32_t caps );
+
+
+/**
+ * @brief Get statistics of the small object caches of all heaps
+ *
+ * All fields are zero unless CONFIG_HEAP_SMALL_OBJECT_CACHE is enabled.
+ *
+ * @param stats       Pointer to a structure which will be filled with the
+ *                    cache statistics.
+ */
+void heap_caps_get_cache_stats( multi_heap_cache_stats_t *stats );
+
+/**
+ * @brief Return the blocks held in the small object caches to their heaps
+ *
+ * This is done automatically when an allocation fails otherwise. Call it
+ * before measuring the free heap size to include the cached memory.
+ *
+ * @return Number of blocks returned to the heaps.
+ */
+size_t heap_caps_cache_flush( void );
 
 /**
  * @brief Print a summary of all memory with the given capabilities.
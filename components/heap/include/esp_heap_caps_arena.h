@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle of an arena, see heap_caps_arena_create()
+ */
+typedef struct heap_arena *heap_caps_arena_handle_t;
+
+/**
+ * @brief Usage statistics of an arena
+ */
+typedef struct {
+    size_t chunk_size;            ///< Usable size of each chunk, as passed to heap_caps_arena_create()
+    size_t chunks;                ///< Number of chunks currently held, including chunks for large allocations
+    size_t capacity_bytes;        ///< Total usable size of the chunks currently held
+    size_t allocated_bytes;       ///< Bytes handed out since the last reset, including alignment padding
+    size_t peak_bytes;            ///< Highest value of allocated_bytes since the arena was created
+    size_t allocations;           ///< Number of allocations since the last reset
+    size_t resets;                ///< Number of calls to heap_caps_arena_reset()
+    size_t failures;              ///< Number of allocations which failed since the arena was created
+} heap_caps_arena_stats_t;
+
+/**
+ * @brief Create an arena allocating memory with the given capabilities
+ *
+ * An arena hands out memory by bumping a pointer through chunks allocated
+ * with heap_caps_malloc(). Single allocations can't be freed, all of them are
+ * released together by heap_caps_arena_reset() or heap_caps_arena_destroy().
+ * This suits memory with the lifetime of a request: it avoids taking the heap
+ * lock for each allocation, and doesn't fragment the heap with small blocks.
+ *
+ * New chunks are allocated when the current one is full. Allocations larger
+ * than a chunk get a chunk of their own.
+ *
+ * Arenas are not thread safe, an arena should be used by one task at a time.
+ * As the chunks are allocated with heap_caps_malloc(), they are recorded by
+ * heap tracing like any other allocation.
+ *
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
+ *                    of memory of the chunks
+ * @param chunk_size  Usable size of each chunk, in bytes
+ *
+ * @return Handle of the arena, or NULL if the arena or its first chunk couldn't be allocated
+ */
+heap_caps_arena_handle_t heap_caps_arena_create(uint32_t caps, size_t chunk_size);
+
+/**
+ * @brief Create an arena with a limited number of chunks
+ *
+ * Same as heap_caps_arena_create(), but allocations fail once max_chunks
+ * chunks are held. With max_chunks of 1, the arena doesn't grow.
+ *
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
+ *                    of memory of the chunks
+ * @param chunk_size  Usable size of each chunk, in bytes
+ * @param max_chunks  Maximum number of chunks, 0 for no limit
+ *
+ * @return Handle of the arena, or NULL if the arena or its first chunk couldn't be allocated
+ */
+heap_caps_arena_handle_t heap_caps_arena_create_with_limit(uint32_t caps, size_t chunk_size, size_t max_chunks);
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * The memory is aligned like memory returned by heap_caps_malloc().
+ *
+ * @param arena Handle of the arena
+ * @param size  Size in bytes of the memory to allocate
+ *
+ * @return Pointer to the memory, or NULL on failure
+ */
+void *heap_caps_arena_malloc(heap_caps_arena_handle_t arena, size_t size);
+
+/**
+ * @brief Allocate zero-initialized memory from an arena
+ *
+ * @param arena Handle of the arena
+ * @param n     Number of elements
+ * @param size  Size of each element
+ *
+ * @return Pointer to the memory, or NULL on failure
+ */
+void *heap_caps_arena_calloc(heap_caps_arena_handle_t arena, size_t n, size_t size);
+
+/**
+ * @brief Allocate aligned memory from an arena
+ *
+ * @param arena     Handle of the arena
+ * @param alignment Alignment of the memory, must be a power of two
+ * @param size      Size in bytes of the memory to allocate
+ *
+ * @return Pointer to the memory, or NULL on failure
+ */
+void *heap_caps_arena_aligned_alloc(heap_caps_arena_handle_t arena, size_t alignment, size_t size);
+
+/**
+ * @brief Release all allocations of an arena
+ *
+ * One chunk is kept for the next allocations, the others are freed.
+ *
+ * @param arena Handle of the arena
+ */
+void heap_caps_arena_reset(heap_caps_arena_handle_t arena);
+
+/**
+ * @brief Release all allocations and all memory of an arena
+ *
+ * @param arena Handle of the arena, may be NULL
+ */
+void heap_caps_arena_destroy(heap_caps_arena_handle_t arena);
+
+/**
+ * @brief Get the usage statistics of an arena
+ *
+ * @param arena Handle of the arena
+ * @param stats Pointer to a structure to fill with the statistics
+ */
+void heap_caps_arena_get_stats(heap_caps_arena_handle_t arena, heap_caps_arena_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
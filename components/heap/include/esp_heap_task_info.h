@@ -85,6 +85,30 @@ typedef struct {
  */
 extern size_t heap_caps_get_per_task_info(heap_task_info_params_t *params);
 
+/** @brief Structure with the running allocation counters of a task, over all heaps */
+typedef struct {
+    TaskHandle_t task;                ///< Task which made the allocations (NULL before the scheduler started)
+    size_t size;                      ///< Total size of the blocks currently allocated by the task
+    size_t count;                     ///< Number of blocks currently allocated by the task
+    size_t peak_size;                 ///< Highest value of size since the task was first counted
+} heap_task_stat_t;
+
+/**
+ * @brief Return the running allocation counters of each task.
+ *
+ * The counters are updated on every allocation and free, so this doesn't walk
+ * the heaps. Counters of tasks without allocations may be dropped when
+ * CONFIG_HEAP_TASK_TRACKING_STATS_SIZE entries are in use.
+ *
+ * @param task_stats Array of structs to fill in
+ * @param max_stats Capacity of the task_stats array
+ * @param[out] complete Set to false if allocations were made while all entries
+ *                      of the counter table were in use, so the counters are
+ *                      missing some allocations. May be NULL.
+ * @return Number of structs filled in
+ */
+size_t heap_caps_get_all_task_stats(heap_task_stat_t *task_stats, size_t max_stats, bool *complete);
+
 #ifdef __cplusplus
 }
 #endif
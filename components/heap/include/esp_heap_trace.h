@@ -54,6 +54,9 @@ typedef struct {
  *
  * @param record_buffer Provide a buffer to use for heap trace data. Must remain valid any time heap tracing is enabled, meaning
  * it must be allocated from internal memory not in PSRAM.
+ * Part of the buffer is used to link and index the records, so it holds fewer than num_records records
+ * (about half of them with the default stack depth of 2). No other memory is allocated.
+ *
  * @param num_records Size of the heap trace buffer, as number of record structures.
  * @return
  *  - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
@@ -177,6 +177,49 @@ typedef struct {
  */
 void multi_heap_get_info(multi_heap_handle_t heap, multi_heap_info_t *info);
 
+/** Number of block size classes in multi_heap_frag_info_t. Class N holds the
+ *  blocks of 2^N to 2^(N+1)-1 bytes, the last class also holds any larger block.
+ *  Above 128 bytes, these are the TLSF first-level classes. */
+#define MULTI_HEAP_FRAG_CLASSES 24
+
+/** @brief Fragmentation metrics of a heap, see multi_heap_get_frag_info() */
+typedef struct {
+    size_t free_blocks[MULTI_HEAP_FRAG_CLASSES];      ///<  Number of free blocks of each size class.
+    size_t free_bytes[MULTI_HEAP_FRAG_CLASSES];       ///<  Total size of the free blocks of each size class.
+    size_t allocated_blocks[MULTI_HEAP_FRAG_CLASSES]; ///<  Number of allocated blocks of each size class.
+    size_t total_free_bytes;      ///<  Total size of the free blocks.
+    size_t largest_free_block;    ///<  Size of the largest free block. Unlike in multi_heap_info_t, this is not rounded down to the largest malloc-able size.
+    uint32_t fragmentation;       ///<  Percentage of the free bytes which can't be allocated in one block: 100 * (1 - largest_free_block / total_free_bytes).
+} multi_heap_frag_info_t;
+
+/** @brief Return fragmentation metrics of a given heap
+ *
+ * Unlike multi_heap_get_info(), this only visits the free blocks, which are
+ * found through the TLSF free list bitmaps. The allocated blocks histogram is
+ * maintained at allocation time.
+ *
+ * Block sizes are the sizes of the underlying TLSF blocks, including any heap
+ * poisoning overhead.
+ *
+ * @param heap Handle to a registered heap.
+ * @param info Pointer to a structure to fill with the metrics.
+ */
+void multi_heap_get_frag_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info);
+
+/** @brief Statistics of the small object caches in front of the heaps
+ *
+ * Blocks held in a cache are allocated from the point of view of the heap,
+ * so they are not included in the free sizes reported for the heap.
+ */
+typedef struct {
+    size_t hits;                  ///<  Allocations served from a cache.
+    size_t misses;                ///<  Allocations which had to refill a cache from the heap.
+    size_t refills;               ///<  Batches of blocks allocated from the heap into a cache.
+    size_t flushes;               ///<  Batches of blocks returned from a cache to the heap.
+    size_t cached_blocks;         ///<  Number of blocks currently held in the caches.
+    size_t cached_bytes;          ///<  Bytes currently held in the caches, allocated from the heap but unused.
+} multi_heap_cache_stats_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -75,8 +75,43 @@ typedef struct multi_heap_info {
     size_t minimum_free_bytes;
     size_t pool_size;
     tlsf_t heap_data;
+#ifndef CONFIG_HEAP_TLSF_USE_ROM_IMPL
+    size_t allocated_blocks[MULTI_HEAP_FRAG_CLASSES];
+#endif
 } heap_t;
 
+static inline size_t frag_class(size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    size_t cls = 31 - __builtin_clz((unsigned)size);
+    return (cls < MULTI_HEAP_FRAG_CLASSES) ? cls : MULTI_HEAP_FRAG_CLASSES - 1;
+}
+
+static void get_frag_info_tlsf(void* ptr, size_t size, int used, void* user)
+{
+    multi_heap_frag_info_t *info = user;
+
+    if (used) {
+        info->allocated_blocks[frag_class(size)]++;
+    } else {
+        info->free_blocks[frag_class(size)]++;
+        info->free_bytes[frag_class(size)] += size;
+        info->total_free_bytes += size;
+        if (size > info->largest_free_block) {
+            info->largest_free_block = size;
+        }
+    }
+}
+
+static void finish_frag_info(multi_heap_frag_info_t *info)
+{
+    if (info->total_free_bytes) {
+        info->fragmentation = 100 - (uint32_t)((uint64_t)info->largest_free_block * 100 / info->total_free_bytes);
+    }
+}
+
 #ifdef CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
 void _multi_heap_lock(void *lock)
@@ -99,6 +134,21 @@ void multi_heap_in_rom_init(void)
     multi_heap_os_funcs_init(&multi_heap_os_funcs);
 }
 
+void multi_heap_get_frag_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+
+    if (heap == NULL) {
+        return;
+    }
+
+    /* The ROM implementation doesn't keep a histogram of the allocations, walk the whole pool */
+    multi_heap_internal_lock(heap);
+    tlsf_walk_pool(tlsf_get_pool(heap->heap_data), get_frag_info_tlsf, info);
+    multi_heap_internal_unlock(heap);
+    finish_frag_info(info);
+}
+
 #else //#ifndef CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
 /* Return true if this block is free. */
@@ -155,6 +205,7 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     result->free_bytes = size - tlsf_size();
     result->pool_size = size;
     result->minimum_free_bytes = result->free_bytes;
+    memset(result->allocated_blocks, 0, sizeof(result->allocated_blocks));
     return result;
 }
 
@@ -212,6 +263,7 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
     multi_heap_internal_lock(heap);
     void *result = tlsf_malloc(heap->heap_data, size);
     if(result) {
+        heap->allocated_blocks[frag_class(tlsf_block_size(result))]++;
         heap->free_bytes -= tlsf_block_size(result);
         heap->free_bytes -= tlsf_alloc_overhead();
         if (heap->free_bytes < heap->minimum_free_bytes) {
@@ -232,6 +284,7 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
     assert_valid_block(heap, block_from_ptr(p));
 
     multi_heap_internal_lock(heap);
+    heap->allocated_blocks[frag_class(tlsf_block_size(p))]--;
     heap->free_bytes += tlsf_block_size(p);
     heap->free_bytes += tlsf_alloc_overhead();
     tlsf_free(heap->heap_data, p);
@@ -258,6 +311,8 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
     if(result) {
         /* No need to subtract the tlsf_alloc_overhead() as it has already
          * been subtracted when allocating the block at first with malloc */
+        heap->allocated_blocks[frag_class(previous_block_size)]--;
+        heap->allocated_blocks[frag_class(tlsf_block_size(result))]++;
         heap->free_bytes += previous_block_size;
         heap->free_bytes -= tlsf_block_size(result);
         if (heap->free_bytes < heap->minimum_free_bytes) {
@@ -288,6 +343,7 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
     multi_heap_internal_lock(heap);
     void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
     if(result) {
+        heap->allocated_blocks[frag_class(tlsf_block_size(result))]++;
         heap->free_bytes -= tlsf_block_size(result);
         heap->free_bytes -= tlsf_alloc_overhead();
         if(heap->free_bytes < heap->minimum_free_bytes) {
@@ -403,4 +459,19 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     }
     multi_heap_internal_unlock(heap);
 }
+
+void multi_heap_get_frag_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+
+    if (heap == NULL) {
+        return;
+    }
+
+    multi_heap_internal_lock(heap);
+    tlsf_walk_free_lists(heap->heap_data, get_frag_info_tlsf, info);
+    memcpy(info->allocated_blocks, heap->allocated_blocks, sizeof(info->allocated_blocks));
+    multi_heap_internal_unlock(heap);
+    finish_frag_info(info);
+}
 #endif
@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "multi_heap.h"
+#include "multi_heap_internal.h"
+#include "multi_heap_cache.h"
+
+/* Note: Keep platform-specific parts in this header, this source
+   file should depend on libc only */
+#include "multi_heap_platform.h"
+
+#define CACHE_CLASS_STEP 16
+#define CLASS_SIZE(CLS) ((size_t)((CLS) + 1) * CACHE_CLASS_STEP)
+
+/* Smallest class able to hold size bytes, or -1 if size is not cached */
+static inline int class_for_alloc(size_t size)
+{
+    if (size == 0 || size > CLASS_SIZE(MULTI_HEAP_CACHE_CLASSES - 1)) {
+        return -1;
+    }
+    return (size - 1) / CACHE_CLASS_STEP;
+}
+
+/* Largest class a block of size usable bytes can serve, or -1 if it is not cached.
+   Blocks not allocated through the cache are accepted too, wasting less than a class step of them. */
+static inline int class_for_free(size_t size)
+{
+    if (size < CLASS_SIZE(0) || size > CLASS_SIZE(MULTI_HEAP_CACHE_CLASSES - 1)) {
+        return -1;
+    }
+    return size / CACHE_CLASS_STEP - 1;
+}
+
+static inline void push_block(multi_heap_cache_slot_t *slot, int cls, void *p)
+{
+    *(void **)p = slot->lists[cls];
+    slot->lists[cls] = p;
+    slot->counts[cls]++;
+}
+
+static inline void *pop_block(multi_heap_cache_slot_t *slot, int cls)
+{
+    void *p = slot->lists[cls];
+    if (p != NULL) {
+        slot->lists[cls] = *(void **)p;
+        slot->counts[cls]--;
+    }
+    return p;
+}
+
+/* Allocate a batch of blocks for this class, returns one and caches the rest.
+   Called with the slot locked. */
+static void *refill(multi_heap_cache_t *cache, multi_heap_cache_slot_t *slot, int cls)
+{
+    size_t size = CLASS_SIZE(cls);
+
+    multi_heap_internal_lock(cache->heap);
+    void *ret = multi_heap_malloc(cache->heap, size);
+    for (int i = 1; ret != NULL && i < MULTI_HEAP_CACHE_BATCH; i++) {
+        void *p = multi_heap_malloc(cache->heap, size);
+        if (p == NULL) {
+            break;
+        }
+        push_block(slot, cls, p);
+    }
+    multi_heap_internal_unlock(cache->heap);
+
+    slot->refills++;
+    return ret;
+}
+
+/* Return up to count blocks of this class to the heap. Called with the slot locked. */
+static size_t flush(multi_heap_cache_t *cache, multi_heap_cache_slot_t *slot, int cls, size_t count)
+{
+    size_t flushed = 0;
+
+    multi_heap_internal_lock(cache->heap);
+    while (flushed < count) {
+        void *p = pop_block(slot, cls);
+        if (p == NULL) {
+            break;
+        }
+        multi_heap_free(cache->heap, p);
+        flushed++;
+    }
+    multi_heap_internal_unlock(cache->heap);
+
+    slot->flushes++;
+    return flushed;
+}
+
+void multi_heap_cache_init(multi_heap_cache_t *cache, multi_heap_handle_t heap)
+{
+    cache->heap = heap;
+    for (int i = 0; i < MULTI_HEAP_CACHE_SLOTS; i++) {
+        multi_heap_cache_slot_t *slot = &cache->slots[i];
+        MULTI_HEAP_LOCK_INIT(&slot->lock);
+        for (int cls = 0; cls < MULTI_HEAP_CACHE_CLASSES; cls++) {
+            slot->lists[cls] = NULL;
+            slot->counts[cls] = 0;
+        }
+        slot->hits = 0;
+        slot->misses = 0;
+        slot->refills = 0;
+        slot->flushes = 0;
+    }
+}
+
+void *multi_heap_cache_malloc(multi_heap_cache_t *cache, size_t size)
+{
+    int cls = class_for_alloc(size);
+    if (cls < 0) {
+        return multi_heap_malloc(cache->heap, size);
+    }
+
+    multi_heap_cache_slot_t *slot = &cache->slots[MULTI_HEAP_CACHE_SLOT()];
+    MULTI_HEAP_LOCK(&slot->lock);
+    void *p = pop_block(slot, cls);
+    if (p != NULL) {
+        slot->hits++;
+    } else {
+        slot->misses++;
+        p = refill(cache, slot, cls);
+    }
+    MULTI_HEAP_UNLOCK(&slot->lock);
+    return p;
+}
+
+void multi_heap_cache_free(multi_heap_cache_t *cache, void *p)
+{
+    if (p == NULL) {
+        return;
+    }
+
+    int cls = class_for_free(multi_heap_get_allocated_size(cache->heap, p));
+    if (cls < 0) {
+        multi_heap_free(cache->heap, p);
+        return;
+    }
+
+    multi_heap_cache_slot_t *slot = &cache->slots[MULTI_HEAP_CACHE_SLOT()];
+    MULTI_HEAP_LOCK(&slot->lock);
+    push_block(slot, cls, p);
+    if (slot->counts[cls] > MULTI_HEAP_CACHE_LIMIT) {
+        flush(cache, slot, cls, MULTI_HEAP_CACHE_BATCH);
+    }
+    MULTI_HEAP_UNLOCK(&slot->lock);
+}
+
+size_t multi_heap_cache_flush(multi_heap_cache_t *cache)
+{
+    size_t flushed = 0;
+
+    for (int i = 0; i < MULTI_HEAP_CACHE_SLOTS; i++) {
+        multi_heap_cache_slot_t *slot = &cache->slots[i];
+        MULTI_HEAP_LOCK(&slot->lock);
+        for (int cls = 0; cls < MULTI_HEAP_CACHE_CLASSES; cls++) {
+            if (slot->counts[cls] != 0) {
+                flushed += flush(cache, slot, cls, slot->counts[cls]);
+            }
+        }
+        MULTI_HEAP_UNLOCK(&slot->lock);
+    }
+    return flushed;
+}
+
+void multi_heap_cache_get_stats(multi_heap_cache_t *cache, multi_heap_cache_stats_t *stats)
+{
+    for (int i = 0; i < MULTI_HEAP_CACHE_SLOTS; i++) {
+        multi_heap_cache_slot_t *slot = &cache->slots[i];
+        MULTI_HEAP_LOCK(&slot->lock);
+        stats->hits += slot->hits;
+        stats->misses += slot->misses;
+        stats->refills += slot->refills;
+        stats->flushes += slot->flushes;
+        for (int cls = 0; cls < MULTI_HEAP_CACHE_CLASSES; cls++) {
+            stats->cached_blocks += slot->counts[cls];
+            stats->cached_bytes += slot->counts[cls] * CLASS_SIZE(cls);
+        }
+        MULTI_HEAP_UNLOCK(&slot->lock);
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "multi_heap.h"
+#include "multi_heap_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Small object cache in front of a multi_heap.
+
+   Freed blocks of 16 to 256 bytes are kept in size classes 16 bytes apart, so
+   that less than 16 bytes of a block are wasted, in one set of free lists per slot (CPU core on the target), and handed out
+   again without taking the heap lock. Each slot has its own lock, so
+   allocations from different cores don't contend. Empty lists are refilled,
+   and overlong lists are flushed, in batches under a single heap lock.
+*/
+
+#define MULTI_HEAP_CACHE_CLASSES 16     /* 16, 32, 48, ... 256 bytes */
+#define MULTI_HEAP_CACHE_BATCH   8      /* Blocks moved per refill or flush */
+#define MULTI_HEAP_CACHE_LIMIT   32     /* Blocks per list above which a batch is flushed */
+
+typedef struct {
+    multi_heap_lock_t lock;
+    void *lists[MULTI_HEAP_CACHE_CLASSES];     /* Linked through the first word of each block */
+    uint16_t counts[MULTI_HEAP_CACHE_CLASSES];
+    size_t hits;
+    size_t misses;
+    size_t refills;
+    size_t flushes;
+} multi_heap_cache_slot_t;
+
+typedef struct {
+    multi_heap_handle_t heap;
+    multi_heap_cache_slot_t slots[MULTI_HEAP_CACHE_SLOTS];
+} multi_heap_cache_t;
+
+/* Initialise an empty cache in front of heap */
+void multi_heap_cache_init(multi_heap_cache_t *cache, multi_heap_handle_t heap);
+
+/* Allocate size bytes, from the cache if size falls in a size class, otherwise from the heap */
+void *multi_heap_cache_malloc(multi_heap_cache_t *cache, size_t size);
+
+/* Free a block allocated from the cache's heap, keeping it in the cache if it fits a size class */
+void multi_heap_cache_free(multi_heap_cache_t *cache, void *p);
+
+/* Return all cached blocks to the heap. Returns the number of blocks returned. */
+size_t multi_heap_cache_flush(multi_heap_cache_t *cache);
+
+/* Add the statistics of this cache to *stats */
+void multi_heap_cache_get_stats(multi_heap_cache_t *cache, multi_heap_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -36,6 +36,10 @@ typedef portMUX_TYPE multi_heap_lock_t;
 
 #define MULTI_HEAP_LOCK_STATIC_INITIALIZER     portMUX_INITIALIZER_UNLOCKED
 
+/* Small object caches keep one set of free lists per core */
+#define MULTI_HEAP_CACHE_SLOTS portNUM_PROCESSORS
+#define MULTI_HEAP_CACHE_SLOT() xPortGetCoreID()
+
 /* Not safe to use std i/o while in a portmux critical section,
    can deadlock, so we use the ROM equivalent functions. */
 
@@ -78,18 +82,71 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
 #else // MULTI_HEAP_FREERTOS
 
 #include <assert.h>
+#include <pthread.h>
+
+/* Heaps are unlocked unless a lock is set with multi_heap_set_lock(). The
+   lock is taken recursively, as on the target, so it must be initialised
+   with MULTI_HEAP_LOCK_INIT(). Statically initialised locks are not recursive. */
+typedef pthread_mutex_t multi_heap_lock_t;
 
 #define MULTI_HEAP_PRINTF printf
 #define MULTI_HEAP_STDERR_PRINTF(MSG, ...) fprintf(stderr, MSG, __VA_ARGS__)
-#define MULTI_HEAP_LOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_UNLOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_INIT(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  0
+#define MULTI_HEAP_LOCK(PLOCK) do {                         \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_lock((PLOCK));                    \
+        }                                                   \
+    } while(0)
+
+#define MULTI_HEAP_UNLOCK(PLOCK) do {                       \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_unlock((PLOCK));                  \
+        }                                                   \
+    } while(0)
+
+#define MULTI_HEAP_LOCK_INIT(PLOCK) do {                    \
+        pthread_mutexattr_t attr;                           \
+        pthread_mutexattr_init(&attr);                      \
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); \
+        pthread_mutex_init((PLOCK), &attr);                 \
+        pthread_mutexattr_destroy(&attr);                   \
+    } while(0)
+
+#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  PTHREAD_MUTEX_INITIALIZER
+
+/* There are no cores on the host, threads are spread over the small object cache slots instead */
+#define MULTI_HEAP_CACHE_SLOTS 8
+
+static inline int multi_heap_cache_slot(void)
+{
+    static int next_slot;
+    static __thread int slot = -1;
+    if (slot < 0) {
+        slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED) % MULTI_HEAP_CACHE_SLOTS;
+    }
+    return slot;
+}
+
+#define MULTI_HEAP_CACHE_SLOT() multi_heap_cache_slot()
 
 #define MULTI_HEAP_ASSERT(CONDITION, ADDRESS) assert((CONDITION) && "Heap corrupt")
 
+#ifdef CONFIG_HEAP_TASK_TRACKING
+/* Tasks are simulated on the host: allocations are owned by the value of
+   multi_heap_host_task in the allocating thread, which the test defines. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern __thread void *multi_heap_host_task;
+#ifdef __cplusplus
+}
+#endif
+#define MULTI_HEAP_BLOCK_OWNER void *task;
+#define MULTI_HEAP_SET_BLOCK_OWNER(HEAD) (HEAD)->task = multi_heap_host_task
+#define MULTI_HEAP_GET_BLOCK_OWNER(HEAD) ((HEAD)->task)
+#else
 #define MULTI_HEAP_BLOCK_OWNER
 #define MULTI_HEAP_SET_BLOCK_OWNER(HEAD)
 #define MULTI_HEAP_GET_BLOCK_OWNER(HEAD) (NULL)
+#endif
 
 #endif // MULTI_HEAP_FREERTOS
@@ -22,6 +22,7 @@
 #include "multi_heap_config.h"
 
 #include "heap_tlsf.h"
+#include "multi_heap_task_stats.h"
 
 #ifdef MULTI_HEAP_POISONING
 
@@ -54,6 +55,18 @@ typedef struct {
 
 #define POISON_OVERHEAD (sizeof(poison_head_t) + sizeof(poison_tail_t))
 
+#ifdef CONFIG_HEAP_TASK_TRACKING
+/* Keep the running per-task counters up to date. Like heap_caps_get_per_task_info(),
+   they count the size of the whole block. */
+#define TASK_STATS_ALLOC(HEAP, HEAD) multi_heap_task_stats_alloc((HEAP), MULTI_HEAP_GET_BLOCK_OWNER(HEAD), \
+                                                                 multi_heap_get_allocated_size_impl((HEAP), (HEAD)))
+#define TASK_STATS_FREE(HEAP, HEAD) multi_heap_task_stats_free((HEAP), MULTI_HEAP_GET_BLOCK_OWNER(HEAD), \
+                                                               multi_heap_get_allocated_size_impl((HEAP), (HEAD)))
+#else
+#define TASK_STATS_ALLOC(HEAP, HEAD)
+#define TASK_STATS_FREE(HEAP, HEAD)
+#endif
+
 /* Given a "poisoned" region with pre-data header 'head', and actual data size 'alloc_size', fill in the head and tail
    region checks.
 
@@ -195,6 +208,7 @@ void *multi_heap_aligned_alloc(multi_heap_handle_t heap, size_t size, size_t ali
     uint8_t *data = NULL;
     if (head != NULL) {
         data = poison_allocated_region(head, size);
+        TASK_STATS_ALLOC(heap, head);
 #ifdef SLOW
         /* check everything we got back is FREE_FILL_PATTERN & swap for MALLOC_FILL_PATTERN */
         bool ret = verify_fill_pattern(data, size, true, true, true);
@@ -225,6 +239,7 @@ void *multi_heap_malloc(multi_heap_handle_t heap, size_t size)
     uint8_t *data = NULL;
     if (head != NULL) {
         data = poison_allocated_region(head, size);
+        TASK_STATS_ALLOC(heap, head);
 #ifdef SLOW
         /* check everything we got back is FREE_FILL_PATTERN & swap for MALLOC_FILL_PATTERN */
         bool ret = verify_fill_pattern(data, size, true, true, true);
@@ -245,6 +260,7 @@ void multi_heap_free(multi_heap_handle_t heap, void *p)
 
     poison_head_t *head = verify_allocated_region(p, true);
     assert(head != NULL);
+    TASK_STATS_FREE(heap, head);
 
     #ifdef SLOW
     /* replace everything with FREE_FILL_PATTERN, including the poison head/tail */
@@ -285,12 +301,16 @@ void *multi_heap_realloc(multi_heap_handle_t heap, void *p, size_t size)
     multi_heap_internal_lock(heap);
 
 #ifndef SLOW
+    TASK_STATS_FREE(heap, head);
     new_head = multi_heap_realloc_impl(heap, head, size + POISON_OVERHEAD);
     if (new_head != NULL) {
         /* For "fast" poisoning, we only overwrite the head/tail of the new block so it's safe
            to poison, so no problem doing this even if realloc resized in place.
         */
         result = poison_allocated_region(new_head, size);
+        TASK_STATS_ALLOC(heap, new_head);
+    } else {
+        TASK_STATS_ALLOC(heap, head);
     }
 #else // SLOW
     /* When slow poisoning is enabled, it becomes very fiddly to try and correctly fill memory when resizing in place
@@ -306,6 +326,7 @@ void *multi_heap_realloc(multi_heap_handle_t heap, void *p, size_t size)
     new_head = multi_heap_malloc_impl(heap, size + POISON_OVERHEAD);
     if (new_head != NULL) {
         result = poison_allocated_region(new_head, size);
+        TASK_STATS_ALLOC(heap, new_head);
         memcpy(result, p, MIN(size, orig_alloc_size));
         multi_heap_free(heap, p);
     }
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "multi_heap.h"
+#include "multi_heap_task_stats.h"
+
+/* The counters are updated from the allocation functions of every heap, under
+   the lock of that heap only, so they are kept with atomic operations instead
+   of a lock of their own.
+
+   Each slot has a sequence number: 0 while it was never used, odd while its
+   key (task and heap) is being written, and even once the key is valid. A
+   slot is only given a new key when it has no live blocks, and the sequence
+   number is checked again after the counters were changed, so that an update
+   racing with the change of key is undone and retried on the right slot.
+
+   An entry is only ever created by its own task, which can't allocate on two
+   cores at once, so the same key is never added twice. */
+typedef struct {
+    uint32_t seq;
+    const void *task;
+    multi_heap_handle_t heap;
+    size_t size;
+    size_t count;
+    size_t peak;
+} stats_slot_t;
+
+static stats_slot_t stats_table[MULTI_HEAP_TASK_STATS_SIZE];
+static bool stats_incomplete;
+
+#define LOAD(PTR) __atomic_load_n((PTR), __ATOMIC_SEQ_CST)
+#define STORE(PTR, VAL) __atomic_store_n((PTR), (VAL), __ATOMIC_SEQ_CST)
+#define CAS(PTR, PEXPECTED, VAL) __atomic_compare_exchange_n((PTR), (PEXPECTED), (VAL), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+static inline size_t stats_hash(multi_heap_handle_t heap, const void *task)
+{
+    uint32_t h = (uint32_t)((uintptr_t)task >> 2) * 2654435761u;
+    h ^= (uint32_t)((uintptr_t)heap >> 2) * 40503u;
+    return h % MULTI_HEAP_TASK_STATS_SIZE;
+}
+
+/* Wait until the key of the slot isn't being written, and return its sequence number */
+static inline uint32_t stable_seq(stats_slot_t *slot)
+{
+    uint32_t seq;
+    while ((seq = LOAD(&slot->seq)) & 1) {
+    }
+    return seq;
+}
+
+/* Give slot, whose sequence number was seq, the key (heap, task). Fails if the
+   slot was changed meanwhile or has live blocks again. */
+static bool claim_slot(stats_slot_t *slot, uint32_t seq, multi_heap_handle_t heap, const void *task)
+{
+    if (!CAS(&slot->seq, &seq, seq + 1)) {
+        return false;
+    }
+    if (seq != 0 && LOAD(&slot->count) != 0) {
+        STORE(&slot->seq, seq);
+        return false;
+    }
+    STORE(&slot->task, task);
+    STORE(&slot->heap, heap);
+    STORE(&slot->peak, 0);
+    STORE(&slot->seq, seq + 2);
+    return true;
+}
+
+/* Find the slot of (heap, task), or a place for it if create is set. Its sequence
+   number is returned in *seq. */
+static stats_slot_t *find_slot(multi_heap_handle_t heap, const void *task, bool create, uint32_t *seq)
+{
+    size_t start = stats_hash(heap, task);
+    size_t i = start;
+    size_t probes;
+
+    for (probes = 0; probes < MULTI_HEAP_TASK_STATS_SIZE; probes++) {
+        stats_slot_t *slot = &stats_table[i];
+        uint32_t s = stable_seq(slot);
+        if (s == 0) {
+            if (!create) {
+                return NULL;
+            }
+            if (claim_slot(slot, s, heap, task)) {
+                *seq = s + 2;
+                return slot;
+            }
+            /* Taken by another task, look at it again */
+            probes--;
+            continue;
+        }
+        if (LOAD(&slot->task) == task && LOAD(&slot->heap) == heap && LOAD(&slot->seq) == s) {
+            *seq = s;
+            return slot;
+        }
+        i = (i + 1) % MULTI_HEAP_TASK_STATS_SIZE;
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    /* Table is full, replace an entry without live blocks. The whole
+       table was probed, so the new entry can still be found there. */
+    for (probes = 0, i = start; probes < MULTI_HEAP_TASK_STATS_SIZE; probes++, i = (i + 1) % MULTI_HEAP_TASK_STATS_SIZE) {
+        stats_slot_t *slot = &stats_table[i];
+        uint32_t s = stable_seq(slot);
+        if (LOAD(&slot->count) == 0 && claim_slot(slot, s, heap, task)) {
+            *seq = s + 2;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void add_block(multi_heap_handle_t heap, const void *task, size_t size)
+{
+    for (;;) {
+        uint32_t seq;
+        stats_slot_t *slot = find_slot(heap, task, true, &seq);
+        if (slot == NULL) {
+            STORE(&stats_incomplete, true);
+            return;
+        }
+        __atomic_fetch_add(&slot->count, 1, __ATOMIC_SEQ_CST);
+        size_t now = __atomic_add_fetch(&slot->size, size, __ATOMIC_SEQ_CST);
+        if (LOAD(&slot->seq) == seq) {
+            size_t peak = LOAD(&slot->peak);
+            while (now > peak && !CAS(&slot->peak, &peak, now)) {
+            }
+            return;
+        }
+        /* The slot was given to another task meanwhile */
+        __atomic_fetch_sub(&slot->size, size, __ATOMIC_SEQ_CST);
+        __atomic_fetch_sub(&slot->count, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void remove_block(multi_heap_handle_t heap, const void *task, size_t size)
+{
+    uint32_t seq;
+    stats_slot_t *slot = find_slot(heap, task, false, &seq);
+    if (slot == NULL) {
+        /* Allocation was not counted */
+        STORE(&stats_incomplete, true);
+        return;
+    }
+
+    /* The size goes first, the slot can be reused as soon as count is 0 */
+    size_t old_size = LOAD(&slot->size);
+    do {
+        if (old_size < size) {
+            STORE(&stats_incomplete, true);
+            return;
+        }
+    } while (!CAS(&slot->size, &old_size, old_size - size));
+    size_t old_count = LOAD(&slot->count);
+    do {
+        if (old_count == 0) {
+            __atomic_fetch_add(&slot->size, size, __ATOMIC_SEQ_CST);
+            STORE(&stats_incomplete, true);
+            return;
+        }
+    } while (!CAS(&slot->count, &old_count, old_count - 1));
+
+    if (LOAD(&slot->seq) != seq) {
+        /* Only possible for a block which was not counted, and whose slot was given
+           to another task, put back what was taken from that task */
+        __atomic_fetch_add(&slot->size, size, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&slot->count, 1, __ATOMIC_SEQ_CST);
+        STORE(&stats_incomplete, true);
+    }
+}
+
+void multi_heap_task_stats_alloc(multi_heap_handle_t heap, const void *task, size_t size)
+{
+    add_block(heap, task, size);
+    add_block(NULL, task, size);
+}
+
+void multi_heap_task_stats_free(multi_heap_handle_t heap, const void *task, size_t size)
+{
+    remove_block(heap, task, size);
+    remove_block(NULL, task, size);
+}
+
+size_t multi_heap_task_stats_get(size_t *pos, multi_heap_task_stats_t *stats, size_t max_stats, bool *complete)
+{
+    size_t count = 0;
+    size_t i;
+
+    for (i = *pos; i < MULTI_HEAP_TASK_STATS_SIZE && count < max_stats; i++) {
+        stats_slot_t *slot = &stats_table[i];
+        uint32_t seq = stable_seq(slot);
+        if (seq == 0) {
+            continue;
+        }
+        multi_heap_task_stats_t *entry = &stats[count];
+        entry->task = LOAD(&slot->task);
+        entry->heap = LOAD(&slot->heap);
+        entry->size = LOAD(&slot->size);
+        entry->count = LOAD(&slot->count);
+        entry->peak = LOAD(&slot->peak);
+        /* Skip the entry if it was given to another task while it was copied */
+        if (LOAD(&slot->seq) == seq) {
+            count++;
+        }
+    }
+    *complete = !LOAD(&stats_incomplete);
+
+    *pos = i;
+    return count;
+}
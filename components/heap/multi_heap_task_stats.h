@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "multi_heap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Running per-task allocation counters, maintained by the heap poisoning
+   layer when heap task tracking is enabled.
+
+   There is one entry per task and heap the task allocated from, plus one
+   entry per task for its totals over all heaps (heap == NULL). Entries are
+   kept in a fixed size hash table. When it is full, entries without live
+   allocations are reused. If none can be reused, the allocation is not
+   counted and the counters are marked incomplete from then on.
+*/
+
+#ifdef CONFIG_HEAP_TASK_TRACKING_STATS_SIZE
+#define MULTI_HEAP_TASK_STATS_SIZE CONFIG_HEAP_TASK_TRACKING_STATS_SIZE
+#else
+#define MULTI_HEAP_TASK_STATS_SIZE 64
+#endif
+
+typedef struct {
+    const void *task;               /* Owner of the allocations */
+    multi_heap_handle_t heap;       /* Heap of the allocations, NULL for the totals of the task */
+    size_t size;                    /* Bytes of the blocks currently allocated */
+    size_t count;                   /* Number of blocks currently allocated */
+    size_t peak;                    /* Highest value of size */
+} multi_heap_task_stats_t;
+
+/* Count a block of size bytes allocated by task from heap */
+void multi_heap_task_stats_alloc(multi_heap_handle_t heap, const void *task, size_t size);
+
+/* Count a block of size bytes allocated by task being freed from heap */
+void multi_heap_task_stats_free(multi_heap_handle_t heap, const void *task, size_t size);
+
+/* Copy up to max_stats entries in use to stats, starting at position *pos of
+   the table (0 for the first call), and update *pos for the next call.
+   Returns the number of entries copied, 0 when all were returned.
+   *complete is set to false if some allocations could not be counted. */
+size_t multi_heap_task_stats_get(size_t *pos, multi_heap_task_stats_t *stats, size_t max_stats, bool *complete);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/*
+ Tests for arenas on top of the capabilities-based allocator
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_arena.h"
+
+TEST_CASE("arena allocations are released by reset and destroy", "[heap]")
+{
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    heap_caps_arena_handle_t arena = heap_caps_arena_create(MALLOC_CAP_8BIT, 1024);
+    TEST_ASSERT_NOT_NULL(arena);
+
+    for (int i = 0; i < 100; i++) {
+        uint8_t *p = heap_caps_arena_malloc(arena, 50);
+        TEST_ASSERT_NOT_NULL(p);
+        TEST_ASSERT_EQUAL(0, (intptr_t)p % sizeof(void *));
+        memset(p, 0xEE, 50);
+    }
+    uint8_t *large = heap_caps_arena_malloc(arena, 4000);
+    TEST_ASSERT_NOT_NULL(large);
+    memset(large, 0xEE, 4000);
+    uint32_t *aligned = heap_caps_arena_aligned_alloc(arena, 64, 16);
+    TEST_ASSERT_NOT_NULL(aligned);
+    TEST_ASSERT_EQUAL(0, (intptr_t)aligned % 64);
+
+    heap_caps_arena_stats_t stats;
+    heap_caps_arena_get_stats(arena, &stats);
+    TEST_ASSERT_EQUAL(102, stats.allocations);
+    TEST_ASSERT_GREATER_THAN(5, stats.chunks);
+
+    heap_caps_arena_reset(arena);
+    heap_caps_arena_get_stats(arena, &stats);
+    TEST_ASSERT_EQUAL(1, stats.chunks);
+    TEST_ASSERT_EQUAL(0, stats.allocated_bytes);
+    TEST_ASSERT_EQUAL(1, stats.resets);
+
+    heap_caps_arena_destroy(arena);
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
+
+TEST_CASE("arena with a chunk limit doesn't grow", "[heap]")
+{
+    heap_caps_arena_handle_t arena = heap_caps_arena_create_with_limit(MALLOC_CAP_8BIT, 256, 1);
+    TEST_ASSERT_NOT_NULL(arena);
+
+    TEST_ASSERT_NOT_NULL(heap_caps_arena_calloc(arena, 10, 20));
+    TEST_ASSERT_NULL(heap_caps_arena_malloc(arena, 200));
+
+    heap_caps_arena_stats_t stats;
+    heap_caps_arena_get_stats(arena, &stats);
+    TEST_ASSERT_EQUAL(1, stats.chunks);
+    TEST_ASSERT_EQUAL(1, stats.failures);
+
+    heap_caps_arena_reset(arena);
+    TEST_ASSERT_NOT_NULL(heap_caps_arena_malloc(arena, 200));
+    heap_caps_arena_destroy(arena);
+}
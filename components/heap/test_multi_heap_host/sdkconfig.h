@@ -0,0 +1,4 @@
+/* Configuration for the parts of the heap component built by the host test */
+#define CONFIG_HEAP_TRACING 1
+#define CONFIG_HEAP_TRACING_STANDALONE 1
+#define CONFIG_HEAP_TRACING_STACK_DEPTH 2
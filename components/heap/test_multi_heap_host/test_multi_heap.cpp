@@ -2,9 +2,21 @@
 #include "multi_heap.h"
 
 #include "../multi_heap_config.h"
+#include "../heap_range_table.h"
+#include "../multi_heap_cache.h"
+#include "../heap_trace_records.h"
+extern "C" {
+#include "../multi_heap_internal.h"
+}
+#include "../multi_heap_task_stats.h"
+#include "../heap_arena.h"
 
 #include <string.h>
 #include <assert.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <map>
 
 /* Insurance against accidentally using libc heap functions in tests */
 #undef free
@@ -523,3 +535,986 @@ TEST_CASE("multi_heap allocation overhead", "[multi_heap]")
 
     multi_heap_free(heap, x);
 }
+
+TEST_CASE("heap range table lookup", "[multi_heap][heap_range_table]")
+{
+    static heap_range_table_t table;
+    memset(&table, 0, sizeof(table));
+    int owners[4];
+
+    /* Insert out of order, lookups must still find the right owner */
+    REQUIRE( heap_range_table_insert(&table, 0x3000, 0x4000, &owners[2]) );
+    REQUIRE( heap_range_table_insert(&table, 0x1000, 0x2000, &owners[0]) );
+    REQUIRE( heap_range_table_insert(&table, 0x2000, 0x2800, &owners[1]) );
+    REQUIRE( heap_range_table_insert(&table, 0x8000, 0x9000, &owners[3]) );
+
+    /* Overlapping or empty ranges are rejected */
+    REQUIRE_FALSE( heap_range_table_insert(&table, 0x1800, 0x2100, NULL) );
+    REQUIRE_FALSE( heap_range_table_insert(&table, 0x0800, 0x1001, NULL) );
+    REQUIRE_FALSE( heap_range_table_insert(&table, 0x5000, 0x5000, NULL) );
+
+    REQUIRE( heap_range_table_find(&table, 0x0fff) == NULL );
+    REQUIRE( heap_range_table_find(&table, 0x1000) == &owners[0] );
+    REQUIRE( heap_range_table_find(&table, 0x1fff) == &owners[0] );
+    REQUIRE( heap_range_table_find(&table, 0x2000) == &owners[1] );
+    REQUIRE( heap_range_table_find(&table, 0x2800) == NULL );
+    REQUIRE( heap_range_table_find(&table, 0x3abc) == &owners[2] );
+    REQUIRE( heap_range_table_find(&table, 0x4000) == NULL );
+    REQUIRE( heap_range_table_find(&table, 0x8fff) == &owners[3] );
+    REQUIRE( heap_range_table_find(&table, 0x9000) == NULL );
+
+    /* Table is full after HEAP_RANGE_TABLE_SIZE entries */
+    for (intptr_t i = table.count; i < HEAP_RANGE_TABLE_SIZE; i++) {
+        REQUIRE( heap_range_table_insert(&table, 0x10000 + i * 0x100, 0x10000 + i * 0x100 + 0x80, NULL) );
+    }
+    REQUIRE_FALSE( heap_range_table_insert(&table, 0x100000, 0x100100, NULL) );
+    REQUIRE( heap_range_table_find(&table, 0x8000) == &owners[3] );
+}
+
+/* Mirrors heap_t in heap_private.h, which can't be built on the host */
+typedef struct {
+    intptr_t start;
+    intptr_t end;
+    multi_heap_handle_t heap;
+} bench_heap_t;
+
+static bench_heap_t *bench_find_linear(bench_heap_t *heaps, size_t num_heaps, void *ptr)
+{
+    intptr_t p = (intptr_t)ptr;
+    for (size_t i = 0; i < num_heaps; i++) {
+        if (heaps[i].heap != NULL && p >= heaps[i].start && p < heaps[i].end) {
+            return &heaps[i];
+        }
+    }
+    return NULL;
+}
+
+static bench_heap_t *bench_find_table(const heap_range_table_t *table, void *ptr)
+{
+    intptr_t p = (intptr_t)ptr;
+    bench_heap_t *heap = (bench_heap_t *)heap_range_table_find(table, p);
+    if (heap != NULL && p >= heap->start && p < heap->end) {
+        return heap;
+    }
+    return NULL;
+}
+
+TEST_CASE("heap range table malloc/free performance", "[multi_heap][heap_range_table][.][bench]")
+{
+    const size_t num_heaps = HEAP_RANGE_TABLE_SIZE;
+    const size_t heap_size = 16384;
+    const size_t iterations = 200000;
+    static uint8_t heap_mem[HEAP_RANGE_TABLE_SIZE][16384];
+    static bench_heap_t heaps[HEAP_RANGE_TABLE_SIZE];
+    static heap_range_table_t table;
+    memset(&table, 0, sizeof(table));
+
+    for (size_t i = 0; i < num_heaps; i++) {
+        heaps[i].start = (intptr_t)heap_mem[i];
+        heaps[i].end = (intptr_t)heap_mem[i] + heap_size;
+        heaps[i].heap = multi_heap_register(heap_mem[i], heap_size);
+        REQUIRE( heaps[i].heap != NULL );
+        REQUIRE( heap_range_table_insert(&table, heaps[i].start, heaps[i].end, &heaps[i]) );
+    }
+
+    /* Allocate from every heap in turn, free through the lookup like heap_caps_free() does */
+    for (int use_table = 0; use_table < 2; use_table++) {
+        size_t mismatches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            /* Heaps are searched from the start of the list, so favour the last ones */
+            bench_heap_t *owner = &heaps[num_heaps - 1 - (i % 4)];
+            void *p = multi_heap_malloc(owner->heap, 32 + (i % 8) * 4);
+            bench_heap_t *found = use_table ? bench_find_table(&table, p) : bench_find_linear(heaps, num_heaps, p);
+            if (found != owner) {
+                mismatches++;
+                continue;
+            }
+            multi_heap_free(found->heap, p);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE( mismatches == 0 );
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        printf("malloc/free pairs per second with %zu heaps, %s lookup: %.0f\n",
+               num_heaps, use_table ? "binary search" : "linear", iterations / seconds);
+    }
+}
+
+/* The cache reuses blocks for larger sizes than they were allocated for, so it
+   can't be combined with heap poisoning (see CONFIG_HEAP_SMALL_OBJECT_CACHE) */
+#ifndef MULTI_HEAP_POISONING
+TEST_CASE("multi_heap small object cache", "[multi_heap][cache]")
+{
+    static uint8_t heapdata[64 * 1024];
+    static multi_heap_cache_t cache;
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_cache_init(&cache, heap);
+    size_t free_before = multi_heap_free_size(heap);
+
+    /* First allocation of a class refills the cache with a batch */
+    void *a = multi_heap_cache_malloc(&cache, 20);
+    REQUIRE( a != NULL );
+    REQUIRE( multi_heap_get_allocated_size(heap, a) >= 32 );
+    multi_heap_cache_stats_t stats = {};
+    multi_heap_cache_get_stats(&cache, &stats);
+    REQUIRE( stats.misses == 1 );
+    REQUIRE( stats.refills == 1 );
+    REQUIRE( stats.cached_blocks == MULTI_HEAP_CACHE_BATCH - 1 );
+    REQUIRE( stats.cached_bytes == (MULTI_HEAP_CACHE_BATCH - 1) * 32 );
+
+    /* Freed blocks are reused, without going back to the heap */
+    memset(a, 0xAA, 20);
+    multi_heap_cache_free(&cache, a);
+    void *b = multi_heap_cache_malloc(&cache, 32);
+    REQUIRE( b == a );
+    multi_heap_cache_free(&cache, b);
+
+    /* Classes are 16 bytes apart, 40 bytes are served from the 48 byte class */
+    void *c = multi_heap_cache_malloc(&cache, 40);
+    REQUIRE( c != NULL );
+    memset(&stats, 0, sizeof(stats));
+    multi_heap_cache_get_stats(&cache, &stats);
+    REQUIRE( stats.refills == 2 );
+    REQUIRE( stats.cached_bytes == MULTI_HEAP_CACHE_BATCH * 32 + (MULTI_HEAP_CACHE_BATCH - 1) * 48 );
+    multi_heap_cache_free(&cache, c);
+
+    /* Sizes outside the classes go straight to the heap */
+    void *big = multi_heap_cache_malloc(&cache, 1000);
+    REQUIRE( big != NULL );
+    multi_heap_cache_free(&cache, big);
+
+    /* Overlong lists are flushed back to the heap in batches */
+    void *blocks[3 * MULTI_HEAP_CACHE_LIMIT];
+    for (int i = 0; i < 3 * MULTI_HEAP_CACHE_LIMIT; i++) {
+        blocks[i] = multi_heap_cache_malloc(&cache, 100);
+        REQUIRE( blocks[i] != NULL );
+    }
+    for (int i = 0; i < 3 * MULTI_HEAP_CACHE_LIMIT; i++) {
+        multi_heap_cache_free(&cache, blocks[i]);
+    }
+    memset(&stats, 0, sizeof(stats));
+    multi_heap_cache_get_stats(&cache, &stats);
+    REQUIRE( stats.hits > 0 );
+    REQUIRE( stats.flushes > 0 );
+    REQUIRE( stats.cached_blocks <= 2 * MULTI_HEAP_CACHE_LIMIT );
+
+    /* Flushing returns all the cached memory */
+    REQUIRE( multi_heap_cache_flush(&cache) == stats.cached_blocks );
+    REQUIRE( multi_heap_free_size(heap) == free_before );
+    REQUIRE( multi_heap_check(heap, true) );
+}
+
+TEST_CASE("multi_heap small object cache multi-threaded performance", "[multi_heap][cache][.][bench]")
+{
+    const size_t ops_per_thread = 200000;
+    const size_t live_blocks = 16;
+    static uint8_t heapdata[512 * 1024];
+    static multi_heap_cache_t cache;
+    static multi_heap_lock_t lock;
+
+    for (int use_cache = 0; use_cache < 2; use_cache++) {
+        for (size_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+            multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+            REQUIRE( heap != NULL );
+            MULTI_HEAP_LOCK_INIT(&lock);
+            multi_heap_set_lock(heap, &lock);
+            multi_heap_cache_init(&cache, heap);
+            size_t failures[8] = {};
+
+            auto worker = [&](size_t thread) {
+                void *live[live_blocks] = {};
+                uint32_t seed = thread + 1;
+                for (size_t i = 0; i < ops_per_thread; i++) {
+                    void **slot = &live[i % live_blocks];
+                    seed = seed * 1103515245 + 12345;
+                    size_t size = 16 + (seed >> 16) % 241;
+                    if (use_cache) {
+                        multi_heap_cache_free(&cache, *slot);
+                        *slot = multi_heap_cache_malloc(&cache, size);
+                    } else {
+                        multi_heap_free(heap, *slot);
+                        *slot = multi_heap_malloc(heap, size);
+                    }
+                    if (*slot == NULL) {
+                        failures[thread]++;
+                    } else {
+                        memset(*slot, thread, size);
+                    }
+                }
+                for (size_t i = 0; i < live_blocks; i++) {
+                    if (use_cache) {
+                        multi_heap_cache_free(&cache, live[i]);
+                    } else {
+                        multi_heap_free(heap, live[i]);
+                    }
+                }
+            };
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < num_threads; t++) {
+                threads.emplace_back(worker, t);
+            }
+            for (auto &t : threads) {
+                t.join();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (size_t t = 0; t < num_threads; t++) {
+                REQUIRE( failures[t] == 0 );
+            }
+            multi_heap_cache_stats_t stats = {};
+            multi_heap_cache_get_stats(&cache, &stats);
+            multi_heap_cache_flush(&cache);
+            REQUIRE( multi_heap_check(heap, true) );
+
+            printf("%s, %zu threads: %.0f malloc/free pairs per second",
+                   use_cache ? "cache" : "heap", num_threads, num_threads * ops_per_thread / seconds);
+            if (use_cache) {
+                printf(", hit rate %.1f%%, %zu bytes cached", 100.0 * stats.hits / (stats.hits + stats.misses), stats.cached_bytes);
+            }
+            printf("\n");
+            pthread_mutex_destroy(&lock);
+        }
+    }
+}
+#endif
+
+/* Size of the record heap_trace_records_get() would continue from */
+static size_t record_size_at_cursor(heap_trace_records_t *records)
+{
+    REQUIRE( records->cursor != NULL );
+    return records->buffer[records->cursor - records->links].size;
+}
+
+TEST_CASE("heap trace records", "[heap_trace]")
+{
+    const size_t N = 8;
+    static heap_trace_record_t buffer[2 * N];
+    static heap_trace_records_t records;
+    void *callers[CONFIG_HEAP_TRACING_STACK_DEPTH] = { (void *)0x1234, (void *)0x5678 };
+    bool evicted;
+
+    /* The links and the hash map are kept in the buffer too */
+    REQUIRE( heap_trace_records_buffer_size(N) <= sizeof(buffer) );
+    REQUIRE( heap_trace_records_capacity(heap_trace_records_buffer_size(N)) == N );
+    REQUIRE( heap_trace_records_capacity(heap_trace_records_buffer_size(N) - 1) == N - 1 );
+
+    heap_trace_records_init(&records, buffer, N, false);
+    for (size_t i = 0; i < N; i++) {
+        heap_trace_record_t rec = {};
+        rec.address = (void *)(0x1000 + i * 16);
+        rec.size = i;
+        heap_trace_records_add(&records, &rec, &evicted);
+        REQUIRE_FALSE( evicted );
+    }
+    REQUIRE( records.count == N );
+
+    /* Removing a record keeps the others in allocation order, and the records in use at the start of the buffer */
+    heap_trace_record_t *rec = heap_trace_records_find(&records, (void *)0x1030);
+    REQUIRE( rec != NULL );
+    REQUIRE( rec->size == 3 );
+    heap_trace_records_remove(&records, rec);
+    REQUIRE( heap_trace_records_find(&records, (void *)0x1030) == NULL );
+    REQUIRE( records.count == N - 1 );
+    REQUIRE( buffer[3].size == N - 1 );
+    REQUIRE( buffer[N - 1].address == NULL );
+    REQUIRE( heap_trace_records_find(&records, (void *)(0x1000 + (N - 1) * 16)) == &buffer[3] );
+    for (size_t i = 0; i < N - 1; i++) {
+        REQUIRE( heap_trace_records_get(&records, i)->size == (i < 3 ? i : i + 1) );
+    }
+    REQUIRE( heap_trace_records_get(&records, 2)->size == 2 );
+    REQUIRE( heap_trace_records_get(&records, N - 1) == NULL );
+
+    /* Freed records stay in the trace, but are not found any more */
+    rec = heap_trace_records_find(&records, (void *)0x1000);
+    heap_trace_records_set_freed(&records, rec, callers);
+    REQUIRE( rec->freed_by[1] == callers[1] );
+    REQUIRE( heap_trace_records_find(&records, (void *)0x1000) == NULL );
+    REQUIRE( heap_trace_records_get(&records, 0) == rec );
+
+    /* The address is allocated again, the new record is found */
+    heap_trace_record_t again = {};
+    again.address = (void *)0x1000;
+    again.size = 100;
+    heap_trace_records_add(&records, &again, &evicted);
+    REQUIRE_FALSE( evicted );
+    REQUIRE( heap_trace_records_find(&records, (void *)0x1000)->size == 100 );
+
+    /* Full: the oldest record is evicted, freed or not */
+    heap_trace_record_t extra = {};
+    extra.address = (void *)0x2000;
+    heap_trace_records_add(&records, &extra, &evicted);
+    REQUIRE( evicted );
+    REQUIRE( records.count == N );
+    REQUIRE( heap_trace_records_get(&records, 0)->size == 1 );
+    REQUIRE( heap_trace_records_get(&records, N - 1)->address == (void *)0x2000 );
+
+    /* With evict_freed_first, records of freed memory go first */
+    heap_trace_records_init(&records, buffer, N, true);
+    for (size_t i = 0; i < N; i++) {
+        heap_trace_record_t r = {};
+        r.address = (void *)(0x1000 + i * 16);
+        heap_trace_records_add(&records, &r, &evicted);
+    }
+    heap_trace_records_set_freed(&records, heap_trace_records_find(&records, (void *)0x1050), callers);
+    heap_trace_records_add(&records, &extra, &evicted);
+    REQUIRE( evicted );
+    REQUIRE( heap_trace_records_get(&records, 0)->address == (void *)0x1000 );
+    for (size_t i = 0; i < N; i++) {
+        REQUIRE( heap_trace_records_get(&records, i)->address != (void *)0x1050 );
+    }
+    /* No freed record left, the oldest one is evicted */
+    extra.address = (void *)0x3000;
+    heap_trace_records_add(&records, &extra, &evicted);
+    REQUIRE( heap_trace_records_find(&records, (void *)0x1000) == NULL );
+
+    /* Reading the records in order while some are removed, like heap_trace_dump() does
+       while tracing, continues from the last record read instead of the oldest one */
+    heap_trace_records_init(&records, buffer, N, false);
+    for (size_t i = 0; i < N; i++) {
+        heap_trace_record_t r = {};
+        r.address = (void *)(0x1000 + i * 16);
+        r.size = i;
+        heap_trace_records_add(&records, &r, &evicted);
+    }
+    REQUIRE( heap_trace_records_get(&records, 3)->size == 3 );
+    heap_trace_records_remove(&records, heap_trace_records_find(&records, (void *)0x1010));
+    REQUIRE( records.cursor_index == 2 );
+    REQUIRE( record_size_at_cursor(&records) == 3 );
+    REQUIRE( heap_trace_records_get(&records, 3)->size == 4 );
+    heap_trace_records_remove(&records, heap_trace_records_find(&records, (void *)0x1040));
+    REQUIRE( records.cursor_index == 2 );
+    REQUIRE( record_size_at_cursor(&records) == 3 );
+    heap_trace_records_remove(&records, heap_trace_records_find(&records, (void *)0x1060));
+    REQUIRE( records.cursor_index == 2 );
+    REQUIRE( heap_trace_records_get(&records, 3)->size == 5 );
+    REQUIRE( heap_trace_records_get(&records, 4)->size == 7 );
+    REQUIRE( heap_trace_records_get(&records, 5) == NULL );
+}
+
+/* Previous record handling of heap_trace_standalone.c, for comparison:
+   linear search from the newest record, and memmove on removal */
+static heap_trace_record_t old_trace_buffer[10000];
+static size_t old_trace_total;
+static size_t old_trace_count;
+
+static void old_trace_alloc(const heap_trace_record_t *record)
+{
+    memcpy(&old_trace_buffer[old_trace_count++], record, sizeof(heap_trace_record_t));
+}
+
+static void old_trace_free(void *address)
+{
+    int i;
+    for (i = old_trace_count - 1; i >= 0; i--) {
+        if (old_trace_buffer[i].address == address) {
+            break;
+        }
+    }
+    if (i >= 0) {
+        memmove(&old_trace_buffer[i], &old_trace_buffer[i + 1],
+                sizeof(heap_trace_record_t) * (old_trace_total - i - 1));
+        old_trace_count--;
+    }
+}
+
+TEST_CASE("heap trace records performance", "[heap_trace][.][bench]")
+{
+    static heap_trace_record_t buffer[3 * 10000];
+    static heap_trace_records_t records;
+    const size_t ops = 20000;
+
+    for (size_t live = 100; live <= 10000; live *= 10) {
+        /* 'live' allocations are traced, each operation frees a random one and allocates a new one */
+        void *addresses[10000];
+        uint32_t seed = 1;
+        for (size_t i = 0; i < live; i++) {
+            addresses[i] = (void *)(0x3ffb0000 + i * 16);
+        }
+
+        for (int use_old = 1; use_old >= 0; use_old--) {
+            bool evicted;
+            heap_trace_records_init(&records, buffer, live, false);
+            old_trace_total = live;
+            old_trace_count = 0;
+            for (size_t i = 0; i < live; i++) {
+                heap_trace_record_t rec = {};
+                rec.address = addresses[i];
+                if (use_old) {
+                    old_trace_alloc(&rec);
+                } else {
+                    heap_trace_records_add(&records, &rec, &evicted);
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < ops; i++) {
+                seed = seed * 1103515245 + 12345;
+                size_t victim = (seed >> 8) % live;
+                heap_trace_record_t rec = {};
+                rec.address = addresses[victim];
+                if (use_old) {
+                    old_trace_free(rec.address);
+                    old_trace_alloc(&rec);
+                } else {
+                    heap_trace_records_remove(&records, heap_trace_records_find(&records, rec.address));
+                    heap_trace_records_add(&records, &rec, &evicted);
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            REQUIRE( (use_old ? old_trace_count : records.count) == live );
+            printf("heap trace with %zu records, %s: %.0f ns per malloc/free pair\n",
+                   live, use_old ? "linear search and memmove" : "hash map", seconds * 1e9 / ops);
+        }
+    }
+}
+
+#if defined(MULTI_HEAP_POISONING) && defined(CONFIG_HEAP_TASK_TRACKING)
+/* Simulated current task of each thread, which owns its allocations */
+__thread void *multi_heap_host_task;
+
+struct task_usage_t {
+    size_t size;
+    size_t count;
+};
+
+/* Per-task usage of a heap, by walking all its blocks */
+static std::map<void *, task_usage_t> walk_task_usage(multi_heap_handle_t heap)
+{
+    std::map<void *, task_usage_t> usage;
+    for (multi_heap_block_handle_t b = multi_heap_get_first_block(heap); b; b = multi_heap_get_next_block(heap, b)) {
+        if (multi_heap_is_free(b)) {
+            continue;
+        }
+        task_usage_t &u = usage[multi_heap_get_block_owner(b)];
+        u.size += multi_heap_get_allocated_size(heap, multi_heap_get_block_address(b));
+        u.count++;
+    }
+    return usage;
+}
+
+/* Per-task counters of a heap, or the totals over all heaps for heap == NULL */
+static std::map<void *, multi_heap_task_stats_t> counted_task_usage(multi_heap_handle_t heap, bool *complete)
+{
+    std::map<void *, multi_heap_task_stats_t> usage;
+    multi_heap_task_stats_t stats[4];
+    size_t pos = 0;
+    size_t n;
+    while ((n = multi_heap_task_stats_get(&pos, stats, 4, complete)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (stats[i].heap == heap && stats[i].count > 0) {
+                usage[(void *)stats[i].task] = stats[i];
+            }
+        }
+    }
+    return usage;
+}
+
+TEST_CASE("multi_heap per-task counters", "[multi_heap][task_stats]")
+{
+    const size_t NUM_TASKS = 6;
+    const size_t NUM_PTRS = 256;
+    const size_t HEAP_SIZE = 32 * 1024;
+    static uint8_t heap_mem[2][HEAP_SIZE];
+    multi_heap_handle_t heaps[2] = { multi_heap_register(heap_mem[0], HEAP_SIZE),
+                                     multi_heap_register(heap_mem[1], HEAP_SIZE) };
+    REQUIRE( heaps[0] != NULL );
+    REQUIRE( heaps[1] != NULL );
+
+    /* Distinct fake task handles */
+    static int tasks[NUM_TASKS];
+    void *ptrs[NUM_PTRS] = {};
+    size_t ptr_heap[NUM_PTRS] = {};
+    std::map<void *, size_t> expected_peak;
+    uint32_t seed = 7;
+
+    /* Simulated allocation trace: tasks are switched at random, and each
+       mallocs, reallocs or frees a random pointer of any task */
+    for (size_t op = 0; op < 20000; op++) {
+        seed = seed * 1103515245 + 12345;
+        void *task = &tasks[(seed >> 8) % NUM_TASKS];
+        multi_heap_host_task = task;
+        size_t i = (seed >> 12) % NUM_PTRS;
+        size_t size = (seed >> 18) % 100 + 1;
+        multi_heap_handle_t heap = heaps[ptr_heap[i]];
+
+        if (ptrs[i] == NULL) {
+            ptr_heap[i] = (seed >> 28) & 1;
+            ptrs[i] = multi_heap_malloc(heaps[ptr_heap[i]], size);
+        } else if ((seed >> 28) % 3 == 0) {
+            void *p = multi_heap_realloc(heap, ptrs[i], size);
+            if (p != NULL) {
+                ptrs[i] = p;
+            }
+        } else {
+            multi_heap_free(heap, ptrs[i]);
+            ptrs[i] = NULL;
+        }
+
+        /* Track the high-water mark of each task over both heaps */
+        if (op % 16 == 0) {
+            std::map<void *, task_usage_t> totals;
+            for (int h = 0; h < 2; h++) {
+                for (auto &u : walk_task_usage(heaps[h])) {
+                    totals[u.first].size += u.second.size;
+                }
+            }
+            for (auto &u : totals) {
+                expected_peak[u.first] = std::max(expected_peak[u.first], u.second.size);
+            }
+        }
+
+        if (op % 1000 == 0) {
+            bool complete = false;
+            for (int h = 0; h < 2; h++) {
+                std::map<void *, task_usage_t> walked = walk_task_usage(heaps[h]);
+                std::map<void *, multi_heap_task_stats_t> counted = counted_task_usage(heaps[h], &complete);
+                REQUIRE( complete );
+                REQUIRE( walked.size() == counted.size() );
+                for (auto &u : walked) {
+                    REQUIRE( counted.count(u.first) == 1 );
+                    REQUIRE( counted[u.first].size == u.second.size );
+                    REQUIRE( counted[u.first].count == u.second.count );
+                }
+            }
+        }
+    }
+
+    /* Peaks are updated on every allocation, so they are at least the sampled high-water marks */
+    bool complete = false;
+    std::map<void *, multi_heap_task_stats_t> totals = counted_task_usage(NULL, &complete);
+    REQUIRE( complete );
+    for (auto &p : expected_peak) {
+        if (totals.count(p.first)) {
+            REQUIRE( totals[p.first].peak >= p.second );
+        }
+    }
+
+    /* Query cost: walking both heaps against reading the counters */
+    const int queries = 1000;
+    auto start = std::chrono::steady_clock::now();
+    size_t walked_tasks = 0;
+    for (int q = 0; q < queries; q++) {
+        walked_tasks += walk_task_usage(heaps[0]).size() + walk_task_usage(heaps[1]).size();
+    }
+    double walk_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    size_t counted_tasks = 0;
+    for (int q = 0; q < queries; q++) {
+        counted_tasks += counted_task_usage(heaps[0], &complete).size() + counted_task_usage(heaps[1], &complete).size();
+    }
+    double counter_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    REQUIRE( walked_tasks == counted_tasks );
+    printf("per-task usage query: %.0f ns walking the heaps, %.0f ns reading the counters\n",
+           walk_seconds * 1e9 / queries, counter_seconds * 1e9 / queries);
+
+    for (size_t i = 0; i < NUM_PTRS; i++) {
+        if (ptrs[i] != NULL) {
+            multi_heap_free(heaps[ptr_heap[i]], ptrs[i]);
+        }
+    }
+    multi_heap_host_task = NULL;
+    REQUIRE( counted_task_usage(heaps[0], &complete).empty() );
+    REQUIRE( counted_task_usage(heaps[1], &complete).empty() );
+    totals = counted_task_usage(NULL, &complete);
+    for (size_t t = 0; t < NUM_TASKS; t++) {
+        REQUIRE( totals.count(&tasks[t]) == 0 );
+    }
+}
+
+TEST_CASE("multi_heap per-task counters with concurrent heaps", "[multi_heap][task_stats]")
+{
+    const size_t NUM_THREADS = 4;
+    const size_t NUM_PTRS = 64;
+    const size_t HEAP_SIZE = 64 * 1024;
+    static uint8_t heap_mem[2][HEAP_SIZE];
+    static multi_heap_lock_t locks[2];
+    multi_heap_handle_t heaps[2];
+    for (int h = 0; h < 2; h++) {
+        heaps[h] = multi_heap_register(heap_mem[h], HEAP_SIZE);
+        REQUIRE( heaps[h] != NULL );
+        MULTI_HEAP_LOCK_INIT(&locks[h]);
+        multi_heap_set_lock(heaps[h], &locks[h]);
+    }
+
+    /* Each thread is a task of its own, allocating from both heaps. The counters
+       are shared by all heaps, so they are updated concurrently. */
+    static int tasks[NUM_THREADS];
+    static void *ptrs[NUM_THREADS][NUM_PTRS];
+    static size_t ptr_heap[NUM_THREADS][NUM_PTRS];
+    auto worker = [&](size_t thread) {
+        multi_heap_host_task = &tasks[thread];
+        uint32_t seed = thread + 1;
+        for (size_t op = 0; op < 50000; op++) {
+            seed = seed * 1103515245 + 12345;
+            size_t i = (seed >> 12) % NUM_PTRS;
+            if (ptrs[thread][i] == NULL) {
+                ptr_heap[thread][i] = (seed >> 28) & 1;
+                ptrs[thread][i] = multi_heap_malloc(heaps[ptr_heap[thread][i]], (seed >> 18) % 100 + 1);
+            } else {
+                multi_heap_free(heaps[ptr_heap[thread][i]], ptrs[thread][i]);
+                ptrs[thread][i] = NULL;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    bool complete = false;
+    std::map<void *, task_usage_t> expected_totals;
+    for (int h = 0; h < 2; h++) {
+        std::map<void *, task_usage_t> walked = walk_task_usage(heaps[h]);
+        std::map<void *, multi_heap_task_stats_t> counted = counted_task_usage(heaps[h], &complete);
+        REQUIRE( complete );
+        REQUIRE( walked.size() == counted.size() );
+        for (auto &u : walked) {
+            REQUIRE( counted.count(u.first) == 1 );
+            REQUIRE( counted[u.first].size == u.second.size );
+            REQUIRE( counted[u.first].count == u.second.count );
+            expected_totals[u.first].size += u.second.size;
+            expected_totals[u.first].count += u.second.count;
+        }
+    }
+    std::map<void *, multi_heap_task_stats_t> totals = counted_task_usage(NULL, &complete);
+    for (auto &u : expected_totals) {
+        REQUIRE( totals.count(u.first) == 1 );
+        REQUIRE( totals[u.first].size == u.second.size );
+        REQUIRE( totals[u.first].count == u.second.count );
+        REQUIRE( totals[u.first].peak >= u.second.size );
+    }
+
+    for (size_t t = 0; t < NUM_THREADS; t++) {
+        for (size_t i = 0; i < NUM_PTRS; i++) {
+            multi_heap_free(heaps[ptr_heap[t][i]], ptrs[t][i]);
+            ptrs[t][i] = NULL;
+        }
+    }
+    REQUIRE( counted_task_usage(heaps[0], &complete).empty() );
+    REQUIRE( counted_task_usage(heaps[1], &complete).empty() );
+    for (int h = 0; h < 2; h++) {
+        multi_heap_set_lock(heaps[h], NULL);
+    }
+}
+#endif
+
+/* Fragmentation metrics computed by walking every block, to check multi_heap_get_frag_info() */
+static void walk_frag_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+    for (multi_heap_block_handle_t b = multi_heap_get_first_block(heap); b; b = multi_heap_get_next_block(heap, b)) {
+        size_t size = multi_heap_get_allocated_size_impl(heap, multi_heap_get_block_address_impl(b));
+        size_t cls = std::min<size_t>(31 - __builtin_clz((unsigned)size), MULTI_HEAP_FRAG_CLASSES - 1);
+        if (multi_heap_is_free(b)) {
+            info->free_blocks[cls]++;
+            info->free_bytes[cls] += size;
+            info->total_free_bytes += size;
+            info->largest_free_block = std::max(info->largest_free_block, size);
+        } else {
+            info->allocated_blocks[cls]++;
+        }
+    }
+}
+
+TEST_CASE("multi_heap fragmentation metrics", "[multi_heap][frag]")
+{
+    static uint8_t heapdata[64 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    void *ptrs[128] = {};
+    uint32_t seed = 3;
+
+    multi_heap_frag_info_t info;
+    multi_heap_get_frag_info(heap, &info);
+    REQUIRE( info.fragmentation == 0 );
+    REQUIRE( info.free_blocks[MULTI_HEAP_FRAG_CLASSES - 1] + info.free_blocks[15] == 1 );
+
+    for (int op = 0; op < 5000; op++) {
+        seed = seed * 1103515245 + 12345;
+        size_t i = (seed >> 8) % 128;
+        size_t size = (seed >> 16) % 1000 + 1;
+        if (ptrs[i] == NULL) {
+            ptrs[i] = ((seed >> 28) & 1) ? multi_heap_malloc(heap, size) : multi_heap_aligned_alloc(heap, size, 64);
+        } else if ((seed >> 28) % 3 == 0) {
+            void *p = multi_heap_realloc(heap, ptrs[i], size);
+            if (p != NULL) {
+                ptrs[i] = p;
+            }
+        } else {
+            multi_heap_free(heap, ptrs[i]);
+            ptrs[i] = NULL;
+        }
+
+        if (op % 100 == 0) {
+            multi_heap_frag_info_t walked;
+            multi_heap_info_t heap_info;
+            multi_heap_get_frag_info(heap, &info);
+            multi_heap_get_info(heap, &heap_info);
+            walk_frag_info(heap, &walked);
+            REQUIRE( memcmp(info.free_blocks, walked.free_blocks, sizeof(info.free_blocks)) == 0 );
+            REQUIRE( memcmp(info.free_bytes, walked.free_bytes, sizeof(info.free_bytes)) == 0 );
+            REQUIRE( memcmp(info.allocated_blocks, walked.allocated_blocks, sizeof(info.allocated_blocks)) == 0 );
+            REQUIRE( info.total_free_bytes == walked.total_free_bytes );
+            REQUIRE( info.largest_free_block == walked.largest_free_block );
+            REQUIRE( info.largest_free_block >= heap_info.largest_free_block );
+            REQUIRE( info.fragmentation <= 100 );
+        }
+    }
+
+    for (size_t i = 0; i < 128; i++) {
+        multi_heap_free(heap, ptrs[i]);
+    }
+    multi_heap_get_frag_info(heap, &info);
+    REQUIRE( info.fragmentation == 0 );
+    for (size_t i = 0; i < MULTI_HEAP_FRAG_CLASSES; i++) {
+        REQUIRE( info.allocated_blocks[i] == 0 );
+    }
+}
+
+struct trace_event_t {
+    bool alloc;
+    uint16_t id;
+    uint32_t size;
+};
+
+/* Alloc/free trace of a device serving TLS connections: each connection
+   allocates a 16KB record buffer and some session objects, a few of which
+   outlive the connection. Recorded once with a fixed seed, then replayed. */
+static std::vector<trace_event_t> record_tls_trace(void)
+{
+    std::vector<trace_event_t> trace;
+    std::vector<uint16_t> long_lived;
+    uint32_t seed = 11;
+    uint16_t next_id = 0;
+
+    for (int conn = 0; conn < 400; conn++) {
+        std::vector<uint16_t> session;
+        uint16_t buffer_id = next_id++;
+        trace.push_back({ true, buffer_id, 16 * 1024 });
+        for (int i = 0; i < 12; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint16_t id = next_id++;
+            trace.push_back({ true, id, (seed >> 16) % 600 + 16 });
+            if ((seed >> 8) % 16 == 0) {
+                long_lived.push_back(id);
+            } else {
+                session.push_back(id);
+            }
+        }
+        trace.push_back({ false, buffer_id, 0 });
+        for (uint16_t id : session) {
+            trace.push_back({ false, id, 0 });
+        }
+        /* Long-lived objects are released eventually, oldest first */
+        while (long_lived.size() > 48) {
+            trace.push_back({ false, long_lived.front(), 0 });
+            long_lived.erase(long_lived.begin());
+        }
+    }
+    return trace;
+}
+
+TEST_CASE("multi_heap fragmentation replaying an allocation trace", "[multi_heap][frag]")
+{
+    static uint8_t heapdata[96 * 1024];
+    std::vector<trace_event_t> trace = record_tls_trace();
+    std::vector<void *> ptrs(65536, nullptr);
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    size_t failed = 0;
+
+    printf("%8s %10s %10s %8s %8s %12s\n", "event", "free", "largest", "frag %", "free blk", "allocs>=512");
+    for (size_t e = 0; e < trace.size(); e++) {
+        const trace_event_t &ev = trace[e];
+        if (ev.alloc) {
+            ptrs[ev.id] = multi_heap_malloc(heap, ev.size);
+            failed += (ptrs[ev.id] == NULL);
+        } else {
+            multi_heap_free(heap, ptrs[ev.id]);
+            ptrs[ev.id] = NULL;
+        }
+
+        if (e % (trace.size() / 10) == 0) {
+            multi_heap_frag_info_t info;
+            multi_heap_get_frag_info(heap, &info);
+            size_t free_blocks = 0, large_allocs = 0;
+            for (size_t i = 0; i < MULTI_HEAP_FRAG_CLASSES; i++) {
+                free_blocks += info.free_blocks[i];
+                large_allocs += (i >= 9) ? info.allocated_blocks[i] : 0;
+            }
+            printf("%8zu %10zu %10zu %8u %8zu %12zu\n", e, info.total_free_bytes, info.largest_free_block,
+                   (unsigned)info.fragmentation, free_blocks, large_allocs);
+        }
+    }
+    printf("%zu of %zu allocations failed\n", failed, trace.size() / 2);
+
+    /* Query cost with the trace's long-lived objects still allocated */
+    const int queries = 20000;
+    multi_heap_frag_info_t info;
+    multi_heap_info_t heap_info;
+    auto start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        multi_heap_get_info(heap, &heap_info);
+    }
+    double info_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        multi_heap_get_frag_info(heap, &info);
+    }
+    double frag_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    REQUIRE( info.largest_free_block >= heap_info.largest_free_block );
+    printf("%zu blocks: %.0f ns for multi_heap_get_info(), %.0f ns for multi_heap_get_frag_info()\n",
+           heap_info.total_blocks, info_seconds * 1e9 / queries, frag_seconds * 1e9 / queries);
+
+    for (void *p : ptrs) {
+        multi_heap_free(heap, p);
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+}
+
+static void *arena_test_chunk_alloc(size_t size, void *ctx)
+{
+    return multi_heap_malloc((multi_heap_handle_t)ctx, size);
+}
+
+static void arena_test_chunk_free(void *chunk, void *ctx)
+{
+    multi_heap_free((multi_heap_handle_t)ctx, chunk);
+}
+
+TEST_CASE("heap arena", "[arena]")
+{
+    static uint8_t heapdata[64 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    size_t free_before = multi_heap_free_size(heap);
+    heap_arena_t arena;
+
+    REQUIRE( heap_arena_init(&arena, 500, 0, arena_test_chunk_alloc, arena_test_chunk_free, heap) );
+    REQUIRE( arena.stats.chunk_size == 504 );
+    REQUIRE( arena.stats.chunks == 1 );
+    REQUIRE( heap_arena_alloc(&arena, 0, HEAP_ARENA_ALIGN) == NULL );
+
+    /* Allocations are aligned, don't overlap and are bumped through the chunks */
+    std::vector<std::pair<uint8_t *, size_t>> allocs;
+    for (size_t i = 0; i < 200; i++) {
+        size_t size = (i * 37) % 150 + 1;
+        size_t alignment = (i % 10 == 0) ? 32 : HEAP_ARENA_ALIGN;
+        uint8_t *p = (uint8_t *)heap_arena_alloc(&arena, size, alignment);
+        REQUIRE( p != NULL );
+        REQUIRE( (uintptr_t)p % alignment == 0 );
+        memset(p, i & 0xFF, size);
+        allocs.push_back(std::make_pair(p, size));
+    }
+    for (size_t i = 0; i < allocs.size(); i++) {
+        for (size_t j = 0; j < allocs[i].second; j++) {
+            REQUIRE( allocs[i].first[j] == (i & 0xFF) );
+        }
+    }
+    REQUIRE( arena.stats.allocations == 200 );
+    REQUIRE( arena.stats.chunks > 10 );
+
+    /* A large allocation gets its own chunk, the head chunk keeps serving small ones */
+    uint8_t *small = (uint8_t *)heap_arena_alloc(&arena, 8, HEAP_ARENA_ALIGN);
+    uint8_t *large = (uint8_t *)heap_arena_alloc(&arena, 2000, HEAP_ARENA_ALIGN);
+    uint8_t *small2 = (uint8_t *)heap_arena_alloc(&arena, 8, HEAP_ARENA_ALIGN);
+    REQUIRE( large != NULL );
+    REQUIRE( small2 == small + 8 );
+    REQUIRE( multi_heap_get_allocated_size(heap, arena.chunks->next) >= 2000 );
+
+    size_t chunks = arena.stats.chunks;
+    heap_arena_reset(&arena);
+    REQUIRE( arena.stats.chunks == 1 );
+    REQUIRE( arena.stats.capacity_bytes == arena.stats.chunk_size );
+    REQUIRE( arena.stats.allocated_bytes == 0 );
+    REQUIRE( arena.stats.peak_bytes > 200 * 8 );
+    REQUIRE( arena.stats.resets == 1 );
+    REQUIRE( multi_heap_free_size(heap) > free_before - 2 * arena.stats.chunk_size );
+    REQUIRE( chunks > 1 );
+
+    heap_arena_release(&arena);
+    REQUIRE( multi_heap_free_size(heap) == free_before );
+
+    /* Limited to one chunk, the arena doesn't grow */
+    REQUIRE( heap_arena_init(&arena, 256, 1, arena_test_chunk_alloc, arena_test_chunk_free, heap) );
+    REQUIRE( heap_arena_alloc(&arena, 200, HEAP_ARENA_ALIGN) != NULL );
+    REQUIRE( heap_arena_alloc(&arena, 100, HEAP_ARENA_ALIGN) == NULL );
+    REQUIRE( heap_arena_alloc(&arena, 1000, HEAP_ARENA_ALIGN) == NULL );
+    REQUIRE( arena.stats.failures == 2 );
+    heap_arena_reset(&arena);
+    REQUIRE( heap_arena_alloc(&arena, 256, HEAP_ARENA_ALIGN) != NULL );
+    heap_arena_release(&arena);
+    REQUIRE( multi_heap_free_size(heap) == free_before );
+}
+
+TEST_CASE("heap arena performance", "[arena][.][bench]")
+{
+    static uint8_t heapdata[128 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_lock_t lock;
+    MULTI_HEAP_LOCK_INIT(&lock);
+    multi_heap_set_lock(heap, &lock);
+
+    /* Sizes of the allocations of a request: an HTTP handler parsing headers
+       and building a response, or an MQTT handler decoding a message */
+    const int requests = 20000;
+    const struct {
+        const char *name;
+        size_t count;
+        size_t min_size;
+        size_t max_size;
+        size_t buffer_size;
+    } patterns[] = {
+        { "http request", 40, 8, 128, 1536 },
+        { "mqtt message", 12, 16, 256, 512 },
+    };
+
+    for (auto &pattern : patterns) {
+        std::vector<size_t> sizes;
+        uint32_t seed = 5;
+        for (size_t i = 0; i < pattern.count; i++) {
+            seed = seed * 1103515245 + 12345;
+            sizes.push_back(pattern.min_size + (seed >> 16) % (pattern.max_size - pattern.min_size));
+        }
+        sizes.push_back(pattern.buffer_size);
+
+        /* Every allocation from the heap, freed at the end of the request */
+        std::vector<void *> ptrs(sizes.size());
+        size_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < requests; r++) {
+            for (size_t i = 0; i < sizes.size(); i++) {
+                ptrs[i] = multi_heap_malloc(heap, sizes[i]);
+                failed += (ptrs[i] == NULL);
+            }
+            for (size_t i = 0; i < sizes.size(); i++) {
+                multi_heap_free(heap, ptrs[i]);
+            }
+        }
+        double heap_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        /* Every allocation from an arena, reset at the end of the request */
+        heap_arena_t arena;
+        REQUIRE( heap_arena_init(&arena, 2048, 0, arena_test_chunk_alloc, arena_test_chunk_free, heap) );
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < requests; r++) {
+            for (size_t i = 0; i < sizes.size(); i++) {
+                failed += (heap_arena_alloc(&arena, sizes[i], HEAP_ARENA_ALIGN) == NULL);
+            }
+            heap_arena_reset(&arena);
+        }
+        double arena_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        heap_arena_release(&arena);
+
+        REQUIRE( failed == 0 );
+        printf("%s, %zu allocations: %.0f ns per request from the heap, %.0f ns from an arena (%zu bytes peak)\n",
+               pattern.name, sizes.size(), heap_seconds * 1e9 / requests, arena_seconds * 1e9 / requests,
+               arena.stats.peak_bytes);
+    }
+
+    multi_heap_set_lock(heap, NULL);
+    pthread_mutex_destroy(&lock);
+}
@@ -1,6 +1,35 @@
 #pragma once
 #include <stdbool.h>
+#include "sdkconfig.h"
 
 void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+bool esp_log_impl_binary_enabled(void);
+#endif
+
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log_async.h"
+
+typedef struct {
+    uint32_t dropped_oldest;    // Queued lines dropped to make room for the line
+    bool dropped;               // The line itself was dropped
+    bool blocked;               // The caller waited for room
+} esp_log_async_result_t;
+
+/* Queue a formatted line for the writer task, which is started if needed.
+   Returns false if the line should be printed synchronously instead: the
+   writer task is not running, it is the caller, or the scheduler isn't running. */
+bool esp_log_impl_async_send(const char *line, size_t len, esp_log_async_policy_t policy, esp_log_async_result_t *result);
+
+/* Wait until the writer task has written all queued lines. If the scheduler
+   isn't running, the lines are printed by the caller instead. */
+bool esp_log_impl_async_flush(uint32_t timeout_ms);
+
+/* Called by the writer task to print a batch of lines */
+void esp_log_async_write_batch(const char *data, size_t len, uint32_t lines);
+#endif
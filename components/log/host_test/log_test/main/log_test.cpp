@@ -10,7 +10,17 @@
 #include <cstdio>
 #include <regex>
 #include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <link.h>
 #include "esp_log.h"
+#include "esp_log_binary.h"
+#include "esp_log_binary_decoder.h"
+#include "esp_log_async.h"
 
 #include "catch.hpp"
 
@@ -26,6 +36,12 @@ public:
     {
         std::memset(print_buffer, 0, BUFFER_SIZE);
         esp_log_level_set("*", log_level);
+#if CONFIG_LOG_BINARY
+        esp_log_set_binary(false);
+#endif
+#if CONFIG_LOG_ASYNC
+        esp_log_set_async(false);
+#endif
     }
 
     virtual ~BasicLogFixture()
@@ -279,3 +295,548 @@ TEST_CASE("changing early log level")
     ESP_EARLY_LOGI(TEST_TAG, "must indeed be printed");
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
+
+static int null_vprintf(const char *format, va_list args)
+{
+    return 0;
+}
+
+/* Time calls with levels looked up for many tags, from several threads */
+static chrono::nanoseconds time_tag_lookups(const vector<string> &tags, esp_log_level_t level, int threads, int calls)
+{
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&tags, level, calls, t]() {
+            for (int i = 0; i < calls; i++) {
+                const char *tag = tags[(i + t * 7) % tags.size()].c_str();
+                esp_log_write(level, tag, "message %d\n", i);
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    return (chrono::steady_clock::now() - start) / ((long long)threads * calls);
+}
+
+static vector<string> many_tags(int count)
+{
+    vector<string> tags;
+    for (int i = 0; i < count; i++) {
+        tags.push_back("component_" + to_string(i));
+    }
+    return tags;
+}
+
+TEST_CASE("tag levels set for many tags")
+{
+    vector<string> tags = many_tags(120);
+
+    esp_log_level_set("*", ESP_LOG_INFO);
+    // A few tags have their own levels, set through different pointers to equal strings
+    for (size_t i = 0; i < tags.size(); i += 16) {
+        esp_log_level_set(string(tags[i]).c_str(), ESP_LOG_WARN);
+    }
+    for (size_t i = 0; i < tags.size(); i++) {
+        CHECK(esp_log_level_get(tags[i].c_str()) == (i % 16 == 0 ? ESP_LOG_WARN : ESP_LOG_INFO));
+    }
+    esp_log_level_set(tags[16].c_str(), ESP_LOG_DEBUG);
+    CHECK(esp_log_level_get(tags[16].c_str()) == ESP_LOG_DEBUG);
+    esp_log_level_set(tags[16].c_str(), ESP_LOG_WARN);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("tag levels with many tags", "[.][bench]")
+{
+    const int TAGS = 120;
+    const int CALLS = 200000;
+    vector<string> tags = many_tags(TAGS);
+
+    esp_log_level_set("*", ESP_LOG_INFO);
+    for (int i = 0; i < TAGS; i += 16) {
+        esp_log_level_set(tags[i].c_str(), ESP_LOG_WARN);
+    }
+
+    vprintf_like_t old_vprintf = esp_log_set_vprintf(null_vprintf);
+#if CONFIG_LOG_BINARY
+    esp_log_set_binary(false);
+#endif
+#if CONFIG_LOG_ASYNC
+    esp_log_set_async(false);
+#endif
+    printf("log calls with %d tags, ns per call:\n", TAGS);
+    for (int threads : { 1, 4 }) {
+        chrono::nanoseconds filtered = time_tag_lookups(tags, ESP_LOG_DEBUG, threads, CALLS);
+        chrono::nanoseconds printed = time_tag_lookups(tags, ESP_LOG_ERROR, threads, CALLS);
+        printf("  %d thread(s): filtered out %lld, printed %lld\n", threads,
+               (long long)filtered.count(), (long long)printed.count());
+    }
+    esp_log_set_vprintf(old_vprintf);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("tag level changes seen by concurrent lookups")
+{
+    static const char *changing = "changing";
+    static const char *fixed = "fixed";
+    esp_log_level_set("*", ESP_LOG_INFO);
+    esp_log_level_set(fixed, ESP_LOG_ERROR);
+    esp_log_level_set(changing, ESP_LOG_WARN);
+
+    atomic<bool> stop(false);
+    atomic<int> errors(0);
+    thread reader([&]() {
+        while (!stop) {
+            esp_log_level_t level = esp_log_level_get(changing);
+            if (level != ESP_LOG_WARN && level != ESP_LOG_DEBUG) {
+                errors++;
+            }
+            if (esp_log_level_get(fixed) != ESP_LOG_ERROR) {
+                errors++;
+            }
+        }
+    });
+    for (int i = 0; i < 20000; i++) {
+        esp_log_level_set(changing, (i & 1) ? ESP_LOG_WARN : ESP_LOG_DEBUG);
+    }
+    stop = true;
+    reader.join();
+
+    CHECK(errors == 0);
+    CHECK(esp_log_level_get(changing) == ESP_LOG_WARN);
+    esp_log_level_set("*", ESP_LOG_INFO);
+    CHECK(esp_log_level_get(fixed) == ESP_LOG_INFO);
+}
+
+#if CONFIG_LOG_BINARY
+/* Resolves addresses of this executable. It may be position independent,
+   so addresses are translated with its load address first. */
+struct ElfResolver {
+    ElfResolver()
+    {
+        elf = esp_log_binary_elf_open("/proc/self/exe");
+        dl_iterate_phdr(get_load_address, &load_address);
+    }
+
+    ~ElfResolver()
+    {
+        esp_log_binary_elf_close(elf);
+    }
+
+    static const char *resolve(uint64_t address, void *ctx)
+    {
+        ElfResolver *self = static_cast<ElfResolver *>(ctx);
+        return esp_log_binary_elf_resolve(address - self->load_address, self->elf);
+    }
+
+    esp_log_binary_elf_t *elf;
+    uintptr_t load_address = 0;
+
+private:
+    static int get_load_address(struct dl_phdr_info *info, size_t size, void *data)
+    {
+        // The executable comes first
+        *static_cast<uintptr_t *>(data) = info->dlpi_addr;
+        return 1;
+    }
+};
+
+static vector<uint8_t> read_binary_log()
+{
+    vector<uint8_t> records(CONFIG_LOG_BINARY_BUFFER_SIZE);
+    records.resize(esp_log_binary_read(records.data(), records.size()));
+    return records;
+}
+
+template<typename... Args>
+static void check_binary_decode(const char *format, Args... args)
+{
+    string expected;
+    {
+        PrintFixture fix(ESP_LOG_INFO);
+        esp_log_write(ESP_LOG_INFO, TEST_TAG, format, args...);
+        expected = fix.get_print_buffer_string();
+    }
+
+    ElfResolver resolver;
+    REQUIRE(resolver.elf != nullptr);
+    esp_log_set_binary(true);
+    esp_log_write(ESP_LOG_INFO, TEST_TAG, format, args...);
+    esp_log_set_binary(false);
+    vector<uint8_t> records = read_binary_log();
+
+    char text[512];
+    esp_log_binary_entry_t entry;
+    size_t len = esp_log_binary_decode(records.data(), records.size(), ElfResolver::resolve, &resolver, &entry, text, sizeof(text));
+    CHECK(len == records.size());
+    CHECK(entry.level == ESP_LOG_INFO);
+    CHECK(string(entry.tag) == TEST_TAG);
+    CHECK(string(text) == expected);
+}
+
+TEST_CASE("binary log records decode to the text output")
+{
+    esp_log_level_set("*", ESP_LOG_INFO);
+    read_binary_log();
+
+    check_binary_decode("no arguments\n");
+    check_binary_decode("ints %d %i %u %x %X %o %c\n", -1, 42, 3000000000u, 0xbeef, 0xBEEF, 8, 'z');
+    check_binary_decode("longs %ld %lu %lld %llx %zu %jd\n", -5L, 6UL, -7LL, 0x123456789abcdefULL, (size_t)8, (intmax_t)9);
+    check_binary_decode("width %5d|%-5d|%05d|%*d|%-*d|%.*f|%+.3e\n", 1, 2, 3, 4, 5, -6, 7, 2, 3.14159, 1234.5);
+    check_binary_decode("strings %s, %.3s, %10s, tag %s\n", "hello", "truncate", "right", TEST_TAG);
+    check_binary_decode("doubles %f %g %.1f %%\n", 0.5, 1e100, -2.25);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("binary log million entries", "[.][bench]")
+{
+    const int ENTRIES = 1000000;
+    const int BATCH = 500;
+    ElfResolver resolver;
+    REQUIRE(resolver.elf != nullptr);
+    esp_log_level_set("*", ESP_LOG_INFO);
+    read_binary_log();
+    esp_log_binary_stats_t before;
+    esp_log_binary_get_stats(&before);
+
+    chrono::nanoseconds binary_time(0);
+    chrono::nanoseconds decode_time(0);
+    int decoded = 0;
+    int errors = 0;
+    bool matches = true;
+    const std::regex decoded_regex("I \\([0-9]*\\) test: request [0-9]+ took [0-9]+ us on /api/v1/items", std::regex::ECMAScript);
+    vector<uint8_t> records(CONFIG_LOG_BINARY_BUFFER_SIZE);
+    char text[256];
+
+    esp_log_set_binary(true);
+    for (int i = 0; i < ENTRIES; i += BATCH) {
+        auto start = chrono::steady_clock::now();
+        for (int j = i; j < i + BATCH; j++) {
+            ESP_LOGI(TEST_TAG, "request %d took %u us on %s", j, (unsigned)(j % 977), "/api/v1/items");
+        }
+        binary_time += chrono::steady_clock::now() - start;
+
+        start = chrono::steady_clock::now();
+        size_t size = esp_log_binary_read(records.data(), records.size());
+        for (size_t pos = 0; pos < size;) {
+            size_t len = esp_log_binary_decode(&records[pos], size - pos, ElfResolver::resolve, &resolver, nullptr, text, sizeof(text));
+            if (len == 0) {
+                errors++;
+                break;
+            }
+            pos += len;
+            if (decoded++ % 9973 == 0) {
+                matches &= regex_search(text, decoded_regex);
+            }
+        }
+        decode_time += chrono::steady_clock::now() - start;
+    }
+    esp_log_set_binary(false);
+
+    esp_log_binary_stats_t after;
+    esp_log_binary_get_stats(&after);
+    CHECK(after.dropped == before.dropped);
+    CHECK(after.records - before.records == (uint32_t)ENTRIES);
+    CHECK(errors == 0);
+    CHECK(decoded == ENTRIES);
+    CHECK(matches);
+
+    chrono::nanoseconds text_time(0);
+    {
+        PrintFixture fix(ESP_LOG_INFO);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < ENTRIES; i++) {
+            ESP_LOGI(TEST_TAG, "request %d took %u us on %s", i, (unsigned)(i % 977), "/api/v1/items");
+        }
+        text_time = chrono::steady_clock::now() - start;
+        CHECK(regex_search(fix.get_print_buffer_string(), decoded_regex));
+    }
+
+    printf("binary log: %lld ns per call, decoding %lld ns per record; text log: %lld ns per call\n",
+           (long long)binary_time.count() / ENTRIES, (long long)decode_time.count() / ENTRIES,
+           (long long)text_time.count() / ENTRIES);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("binary log concurrent writers")
+{
+    const int THREADS = 4;
+    const int ENTRIES = 50000;
+    ElfResolver resolver;
+    REQUIRE(resolver.elf != nullptr);
+    esp_log_level_set("*", ESP_LOG_INFO);
+    read_binary_log();
+    esp_log_binary_stats_t before;
+    esp_log_binary_get_stats(&before);
+
+    atomic<int> running(THREADS);
+    vector<thread> writers;
+    esp_log_set_binary(true);
+    for (int t = 0; t < THREADS; t++) {
+        writers.emplace_back([t, &running]() {
+            for (int i = 0; i < ENTRIES; i++) {
+                ESP_LOGI(TEST_TAG, "writer %d entry %d", t, i);
+            }
+            running--;
+        });
+    }
+
+    // Entries of each writer must come out complete and in order
+    vector<int> next(THREADS, 0);
+    int decoded = 0;
+    int errors = 0;
+    vector<uint8_t> records(CONFIG_LOG_BINARY_BUFFER_SIZE);
+    char text[256];
+    bool done = false;
+    while (!done) {
+        done = (running == 0);
+        size_t size = esp_log_binary_read(records.data(), records.size());
+        for (size_t pos = 0; pos < size;) {
+            size_t len = esp_log_binary_decode(&records[pos], size - pos, ElfResolver::resolve, &resolver, nullptr, text, sizeof(text));
+            int t, i;
+            if (len == 0 || sscanf(text, "I (%*u) test: writer %d entry %d", &t, &i) != 2 ||
+                    t < 0 || t >= THREADS || i < next[t]) {
+                errors++;
+                break;
+            }
+            next[t] = i + 1;
+            decoded++;
+            pos += len;
+        }
+    }
+    for (auto &w : writers) {
+        w.join();
+    }
+    esp_log_set_binary(false);
+
+    esp_log_binary_stats_t after;
+    esp_log_binary_get_stats(&after);
+    CHECK(errors == 0);
+    CHECK(after.records - before.records == (uint32_t)decoded);
+    CHECK(decoded + (after.dropped - before.dropped) == THREADS * ENTRIES);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+#endif // CONFIG_LOG_BINARY
+
+#if CONFIG_LOG_ASYNC
+/* Output which takes sink_delay for each call, like a UART or network
+   connection, and keeps the lines it was given */
+struct SlowSinkFixture {
+    SlowSinkFixture(chrono::microseconds sink_delay) : delay(sink_delay)
+    {
+        if (instance != nullptr) {
+            throw exception();
+        }
+        instance = this;
+        esp_log_level_set("*", ESP_LOG_INFO);
+        old_vprintf = esp_log_set_vprintf(print_callback);
+    }
+
+    ~SlowSinkFixture()
+    {
+        esp_log_set_async(true);
+        CHECK(esp_log_async_flush(5000));
+        esp_log_set_async(false);
+        esp_log_async_set_policy(ESP_LOG_ASYNC_DROP_NEWEST);
+        esp_log_set_vprintf(old_vprintf);
+        instance = nullptr;
+    }
+
+    vector<int> received_ids()
+    {
+        lock_guard<mutex> guard(lock);
+        vector<int> ids;
+        istringstream lines(output);
+        string line;
+        while (getline(lines, line)) {
+            int id;
+            if (sscanf(line.c_str(), "%*c (%*u) test: message %d", &id) == 1) {
+                ids.push_back(id);
+            }
+        }
+        return ids;
+    }
+
+    chrono::microseconds delay;
+    atomic<int> calls{0};
+
+private:
+    static int print_callback(const char *format, va_list args)
+    {
+        char buf[CONFIG_LOG_ASYNC_BATCH_SIZE + 1];
+        int ret = vsnprintf(buf, sizeof(buf), format, args);
+        {
+            lock_guard<mutex> guard(instance->lock);
+            instance->output += buf;
+        }
+        instance->calls++;
+        this_thread::sleep_for(instance->delay);
+        return ret;
+    }
+
+    static SlowSinkFixture *instance;
+    vprintf_like_t old_vprintf;
+    mutex lock;
+    string output;
+};
+
+SlowSinkFixture *SlowSinkFixture::instance = nullptr;
+
+static esp_log_async_stats_t async_stats_diff(const esp_log_async_stats_t &before)
+{
+    esp_log_async_stats_t after;
+    esp_log_async_get_stats(&after);
+    return {
+        after.queued - before.queued,
+        after.written - before.written,
+        after.batches - before.batches,
+        after.dropped_newest - before.dropped_newest,
+        after.dropped_oldest - before.dropped_oldest,
+        after.blocked - before.blocked,
+        after.truncated - before.truncated,
+    };
+}
+
+static chrono::nanoseconds log_messages(int count)
+{
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        ESP_LOGI(TEST_TAG, "message %d of the async log test", i);
+    }
+    return chrono::steady_clock::now() - start;
+}
+
+TEST_CASE("async log writes all messages in order with the block policy")
+{
+    const int MESSAGES = 2000;
+    SlowSinkFixture sink(chrono::microseconds(50));
+    esp_log_async_stats_t before;
+    esp_log_async_get_stats(&before);
+
+    esp_log_async_set_policy(ESP_LOG_ASYNC_BLOCK);
+    esp_log_set_async(true);
+    log_messages(MESSAGES);
+    REQUIRE(esp_log_async_flush(5000));
+
+    vector<int> expected(MESSAGES);
+    for (int i = 0; i < MESSAGES; i++) {
+        expected[i] = i;
+    }
+    CHECK(sink.received_ids() == expected);
+    esp_log_async_stats_t stats = async_stats_diff(before);
+    CHECK(stats.queued == MESSAGES);
+    CHECK(stats.written == MESSAGES);
+    CHECK(stats.dropped_newest == 0);
+    CHECK(stats.dropped_oldest == 0);
+    CHECK(stats.batches < MESSAGES / 4);
+}
+
+TEST_CASE("async log drops the newest messages when full")
+{
+    const int MESSAGES = 2000;
+    SlowSinkFixture sink(chrono::milliseconds(2));
+    esp_log_async_stats_t before;
+    esp_log_async_get_stats(&before);
+
+    esp_log_async_set_policy(ESP_LOG_ASYNC_DROP_NEWEST);
+    esp_log_set_async(true);
+    log_messages(MESSAGES);
+    REQUIRE(esp_log_async_flush(5000));
+
+    vector<int> ids = sink.received_ids();
+    esp_log_async_stats_t stats = async_stats_diff(before);
+    CHECK(stats.dropped_newest > 0);
+    CHECK(stats.dropped_oldest == 0);
+    CHECK(ids.size() + stats.dropped_newest == MESSAGES);
+    CHECK(ids.front() == 0);
+    CHECK(is_sorted(ids.begin(), ids.end()));
+}
+
+TEST_CASE("async log drops the oldest messages when full")
+{
+    const int MESSAGES = 2000;
+    SlowSinkFixture sink(chrono::milliseconds(2));
+    esp_log_async_stats_t before;
+    esp_log_async_get_stats(&before);
+
+    esp_log_async_set_policy(ESP_LOG_ASYNC_DROP_OLDEST);
+    esp_log_set_async(true);
+    log_messages(MESSAGES);
+    REQUIRE(esp_log_async_flush(5000));
+
+    vector<int> ids = sink.received_ids();
+    esp_log_async_stats_t stats = async_stats_diff(before);
+    CHECK(stats.dropped_oldest > 0);
+    CHECK(stats.dropped_newest == 0);
+    CHECK(ids.size() + stats.dropped_oldest == MESSAGES);
+    CHECK(ids.back() == MESSAGES - 1);
+    CHECK(is_sorted(ids.begin(), ids.end()));
+}
+
+TEST_CASE("async log queues errors in order with the other messages")
+{
+    const int MESSAGES = 200;
+    SlowSinkFixture sink(chrono::microseconds(200));
+    esp_log_async_stats_t before;
+    esp_log_async_get_stats(&before);
+
+    esp_log_async_set_policy(ESP_LOG_ASYNC_BLOCK);
+    esp_log_set_async(true);
+    log_messages(MESSAGES);
+    ESP_LOGE(TEST_TAG, "message %d of the async log test", MESSAGES);
+    REQUIRE(esp_log_async_flush(5000));
+
+    vector<int> expected(MESSAGES + 1);
+    for (int i = 0; i <= MESSAGES; i++) {
+        expected[i] = i;
+    }
+    CHECK(sink.received_ids() == expected);
+    esp_log_async_stats_t stats = async_stats_diff(before);
+    CHECK(stats.queued == MESSAGES + 1);
+    CHECK(stats.written == MESSAGES + 1);
+}
+
+TEST_CASE("async log with a slow output", "[.][bench]")
+{
+    const int MESSAGES = 2000;
+    const chrono::microseconds SINK_DELAY(100);
+    chrono::nanoseconds sync_time, block_time, drop_time;
+    int sync_calls, block_calls;
+    esp_log_async_stats_t drop_stats;
+
+    {
+        SlowSinkFixture sink(SINK_DELAY);
+        sync_time = log_messages(MESSAGES);
+        sync_calls = sink.calls;
+    }
+    {
+        SlowSinkFixture sink(SINK_DELAY);
+        esp_log_async_set_policy(ESP_LOG_ASYNC_BLOCK);
+        esp_log_set_async(true);
+        block_time = log_messages(MESSAGES);
+        REQUIRE(esp_log_async_flush(5000));
+        block_calls = sink.calls;
+        CHECK(sink.received_ids().size() == MESSAGES);
+    }
+    {
+        SlowSinkFixture sink(SINK_DELAY);
+        esp_log_async_stats_t before;
+        esp_log_async_get_stats(&before);
+        esp_log_async_set_policy(ESP_LOG_ASYNC_DROP_NEWEST);
+        esp_log_set_async(true);
+        drop_time = log_messages(MESSAGES);
+        REQUIRE(esp_log_async_flush(5000));
+        drop_stats = async_stats_diff(before);
+    }
+
+    CHECK(block_calls < sync_calls);
+    printf("output taking %lld us per call, %d messages:\n", (long long)SINK_DELAY.count(), MESSAGES);
+    printf("  sync:               %lld ns per message, %d output calls\n",
+           (long long)sync_time.count() / MESSAGES, sync_calls);
+    printf("  async, block:       %lld ns per message, %d output calls\n",
+           (long long)block_time.count() / MESSAGES, block_calls);
+    printf("  async, drop newest: %lld ns per message, %u dropped\n",
+           (long long)drop_time.count() / MESSAGES, drop_stats.dropped_newest);
+}
+#endif // CONFIG_LOG_ASYNC
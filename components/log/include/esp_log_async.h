@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Asynchronous log output
+ *
+ * With CONFIG_LOG_ASYNC, log messages are formatted by the caller and queued
+ * in a buffer. A writer task passes them to the function set with
+ * esp_log_set_vprintf() in batches, so a slow output doesn't hold up the
+ * callers. When the buffer is full, the back-pressure policy decides which
+ * messages are dropped, or if the caller waits.
+ *
+ * The writer task is started by the first message logged after the scheduler
+ * has started. Messages logged before, and messages logged by the writer task
+ * itself, are printed synchronously.
+ *
+ * Messages of all levels are queued, so they are printed in order. Messages
+ * still queued when esp_restart() is called or the panic handler runs are
+ * printed from there.
+ */
+
+/**
+ * @brief What to do with a message when the buffer is full
+ */
+typedef enum {
+    ESP_LOG_ASYNC_DROP_NEWEST,  ///< Drop the message being logged
+    ESP_LOG_ASYNC_DROP_OLDEST,  ///< Drop the oldest queued messages to make room
+    ESP_LOG_ASYNC_BLOCK,        ///< Wait for room, up to CONFIG_LOG_ASYNC_BLOCK_TIMEOUT_MS, then drop the message
+} esp_log_async_policy_t;
+
+/**
+ * @brief Counters of the asynchronous log output
+ */
+typedef struct {
+    uint32_t queued;            ///< Messages queued for the writer task
+    uint32_t written;           ///< Messages passed to the output
+    uint32_t batches;           ///< Calls to the output, each with one or more messages
+    uint32_t dropped_newest;    ///< Messages dropped because the buffer was full
+    uint32_t dropped_oldest;    ///< Queued messages dropped to make room for newer ones
+    uint32_t blocked;           ///< Messages for which the caller had to wait for room
+    uint32_t truncated;         ///< Messages truncated to CONFIG_LOG_ASYNC_LINE_SIZE
+} esp_log_async_stats_t;
+
+/**
+ * @brief Switch between asynchronous and synchronous output
+ *
+ * Asynchronous output is enabled at startup when CONFIG_LOG_ASYNC is set.
+ * Switching to synchronous output doesn't flush queued messages, see
+ * esp_log_async_flush().
+ *
+ * @param enable true to queue messages for the writer task, false to print them directly
+ */
+void esp_log_set_async(bool enable);
+
+/**
+ * @brief Set the back-pressure policy
+ *
+ * The policy at startup is set by CONFIG_LOG_ASYNC_POLICY.
+ *
+ * @param policy What to do with messages logged while the buffer is full
+ */
+void esp_log_async_set_policy(esp_log_async_policy_t policy);
+
+/**
+ * @brief Wait until all queued messages are written
+ *
+ * @param timeout_ms Maximum time to wait in milliseconds
+ *
+ * @return true if all messages were written, false on timeout
+ */
+bool esp_log_async_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Get the counters of the asynchronous log output
+ *
+ * @param stats Pointer to a structure to fill with the counters
+ */
+void esp_log_async_get_stats(esp_log_async_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
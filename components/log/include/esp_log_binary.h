@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Deferred binary logging
+ *
+ * With CONFIG_LOG_BINARY, log calls which pass the tag filter don't format
+ * the message. Instead, a record with the timestamp, the level, the tag and
+ * format string pointers, and the raw arguments is appended to a buffer of
+ * the current core, without taking a lock. The records are read out with
+ * esp_log_binary_read() and decoded on the host, which resolves the string
+ * pointers from the ELF file of the application, see esp_log_binary_decoder.h.
+ *
+ * Strings passed as %s arguments are copied into the record, except the tag.
+ */
+
+/** @cond */
+
+/* Layout of a record, all fields are in the byte order of the device:
+ *
+ *   uint32_t header    ESP_LOG_BINARY_VALID | level << 16 | length in bytes of the whole record
+ *   uint32_t timestamp esp_log_timestamp()
+ *   uintptr_t tag      address of the tag string
+ *   uintptr_t format   address of the format string
+ *   arguments          packed in the order of the format conversions, each aligned to 4 bytes:
+ *                      - int and smaller, and long when it is 32 bits wide: 4 bytes
+ *                      - long long, and long when it is 64 bits wide, double: 8 bytes
+ *                      - pointers: sizeof(uintptr_t), see ESP_LOG_BINARY_PTR64
+ *                      - strings: uint16_t length followed by the characters, without the
+ *                        terminating zero. A length of ESP_LOG_BINARY_TAG_REF stands for the tag.
+ *
+ * Records are padded to 4 bytes. A header with a level of ESP_LOG_BINARY_PADDING marks
+ * unused space at the end of the buffer.
+ */
+#define ESP_LOG_BINARY_VALID        0x80000000
+#define ESP_LOG_BINARY_PTR64        0x40000000  ///< Pointers are 8 bytes wide
+#define ESP_LOG_BINARY_LEVEL_SHIFT  16
+#define ESP_LOG_BINARY_LEVEL_MASK   0xFF
+#define ESP_LOG_BINARY_LENGTH_MASK  0xFFFF
+#define ESP_LOG_BINARY_PADDING      0xFF
+#define ESP_LOG_BINARY_TAG_REF      0xFFFF
+#define ESP_LOG_BINARY_MAX_STRING   128         ///< Longer strings arguments are truncated
+
+/** @endcond */
+
+/**
+ * @brief Statistics of the binary log buffers
+ */
+typedef struct {
+    uint32_t records;       ///< Records written
+    uint32_t dropped;       ///< Records dropped because the buffer of their core was full
+    uint32_t bytes;         ///< Bytes of the records written
+} esp_log_binary_stats_t;
+
+/**
+ * @brief Switch between binary and text logging
+ *
+ * Binary logging is enabled at startup when CONFIG_LOG_BINARY is set.
+ *
+ * @param enable true to record binary records, false to print text as usual
+ */
+void esp_log_set_binary(bool enable);
+
+/**
+ * @brief Append a binary record of a log message
+ *
+ * This is called by esp_log_writev() in binary mode, after the tag filter.
+ * It is safe to call from any task, from any core, concurrently.
+ *
+ * @param level  Level of the message
+ * @param tag    Tag of the message, must stay valid until the record is decoded
+ * @param format Format string, must stay valid until the record is decoded
+ * @param args   Arguments of the format
+ */
+void esp_log_binary_writev(esp_log_level_t level, const char *tag, const char *format, va_list args);
+
+/**
+ * @brief Read out binary records
+ *
+ * Copies whole records, oldest first for each core, and frees their space in
+ * the buffers. Only one task should read out records at a time.
+ *
+ * @param buf  Destination of the records
+ * @param size Size of buf in bytes
+ *
+ * @return Number of bytes copied, 0 if there are no records
+ */
+size_t esp_log_binary_read(void *buf, size_t size);
+
+/**
+ * @brief Get the statistics of the binary log buffers
+ *
+ * @param stats Pointer to a structure to fill with the statistics
+ */
+void esp_log_binary_get_stats(esp_log_binary_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decoder of binary log records, see esp_log_binary.h
+ *
+ * The decoder runs on the host. It is built for the Linux target, and depends
+ * on libc only, so it can be built into other host tools as well. Records must
+ * have the byte order of the host.
+ */
+
+/**
+ * @brief Function returning the string at an address of the device
+ *
+ * @param address Address of the string on the device
+ * @param ctx     Context passed to esp_log_binary_decode()
+ *
+ * @return The string, or NULL if the address is unknown
+ */
+typedef const char *(*esp_log_binary_resolver_t)(uint64_t address, void *ctx);
+
+/**
+ * @brief Decoded record
+ */
+typedef struct {
+    esp_log_level_t level;      ///< Level of the message
+    uint32_t timestamp;         ///< Timestamp of the message
+    const char *tag;            ///< Tag of the message, "?" if it couldn't be resolved
+} esp_log_binary_entry_t;
+
+/**
+ * @brief Decode one record and format its message
+ *
+ * The message is formatted like the text log would have printed it, with the
+ * format string as resolved from the record.
+ *
+ * @param data     Records, as read by esp_log_binary_read()
+ * @param size     Size of data in bytes
+ * @param resolve  Function to resolve the tag, format and string addresses
+ * @param ctx      Context for resolve
+ * @param entry    Filled with the level, timestamp and tag of the record, can be NULL
+ * @param text     Buffer for the formatted message, truncated to fit
+ * @param text_size Size of text in bytes
+ *
+ * @return Length of the record in bytes, to advance data to the next record.
+ *         0 if data doesn't start with a complete record.
+ */
+size_t esp_log_binary_decode(const void *data, size_t size, esp_log_binary_resolver_t resolve, void *ctx,
+                             esp_log_binary_entry_t *entry, char *text, size_t text_size);
+
+/**
+ * @brief Strings of an ELF file
+ */
+typedef struct esp_log_binary_elf esp_log_binary_elf_t;
+
+/**
+ * @brief Load an ELF file to resolve string addresses
+ *
+ * 32-bit and 64-bit little endian files are supported. Only the contents of
+ * the allocated sections of the file are kept.
+ *
+ * @param path Path of the ELF file
+ *
+ * @return Handle to pass to esp_log_binary_elf_resolve(), NULL on error
+ */
+esp_log_binary_elf_t *esp_log_binary_elf_open(const char *path);
+
+/**
+ * @brief Resolver for esp_log_binary_decode() using an ELF file
+ *
+ * @param address Address of the string
+ * @param elf     Handle returned by esp_log_binary_elf_open()
+ *
+ * @return The string, NULL if the address is not in an allocated section
+ *         or the string is not terminated in its section
+ */
+const char *esp_log_binary_elf_resolve(uint64_t address, void *elf);
+
+/**
+ * @brief Free an ELF file loaded by esp_log_binary_elf_open()
+ *
+ * @param elf Handle returned by esp_log_binary_elf_open()
+ */
+void esp_log_binary_elf_close(esp_log_binary_elf_t *elf);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Print the log messages queued for the writer task, from the panic handler
+ *
+ * Only for use by the panic handler. The spinlock of the buffer isn't taken,
+ * so nothing is printed if the panic happened while it was held. Messages
+ * logged afterwards are printed synchronously.
+ *
+ * @param put_char Function printing one character, which works in the panic handler
+ */
+void esp_log_async_panic_drain(void (*put_char)(char c));
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,24 +7,23 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in a hash
+ * table of linked lists, keyed by the tag string. See uncached_tag_entry_t
+ * structure.
  *
  * To avoid looking up log level for given tag each time message is
  * printed, this library caches pointers to tags. Because the suggested
  * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * should be effective. The cache is an open addressing hash table keyed
+ * by the tag pointer, probed over TAG_CACHE_PROBES slots. When all of them
+ * are taken, one of them is replaced.
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * The cache is read without taking the lock, so the check of whether a
+ * message should be printed doesn't contend with other tasks logging.
+ * The cache and the levels are only changed with the lock taken, and
+ * every change is bracketed by increments of s_log_cache_version, which
+ * is odd while a change is in progress. A reader which sees the version
+ * change, or an odd version, falls back to the lookup with the lock.
  *
  */
 
@@ -35,8 +34,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_log_private.h"
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+#include "esp_log_binary.h"
+#endif
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+#include "esp_log_async.h"
+#endif
 
 #ifndef NDEBUG
 // Enable built-in checks in queue.h in debug builds
@@ -47,14 +53,13 @@
 
 #include "sys/queue.h"
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
-
-typedef struct {
-    const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
-} cached_tag_entry_t;
+// Number of tags to be cached, a power of two
+#define TAG_CACHE_BITS 7
+#define TAG_CACHE_SIZE (1 << TAG_CACHE_BITS)
+// Number of cache slots where a tag may be found
+#define TAG_CACHE_PROBES 4
+// Number of buckets of the table of tags with a level set
+#define TAG_HASH_SIZE 32
 
 typedef struct uncached_tag_entry_ {
     SLIST_ENTRY(uncached_tag_entry_) entries;
@@ -62,23 +67,44 @@ typedef struct uncached_tag_entry_ {
     char tag[0];    // beginning of a zero-terminated string
 } uncached_tag_entry_t;
 
+SLIST_HEAD(log_tags_head, uncached_tag_entry_);
+
 esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
-static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
-static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+static struct log_tags_head s_log_tags[TAG_HASH_SIZE];
+// Cache slots, with the tags and their levels in separate arrays to save padding
+static _Atomic(const char *) s_log_cache_tags[TAG_CACHE_SIZE];
+static _Atomic uint8_t s_log_cache_levels[TAG_CACHE_SIZE];
+static _Atomic uint32_t s_log_cache_version = 0;
+static uint32_t s_log_cache_evictions = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 
 #ifdef LOG_BUILTIN_CHECKS
 static uint32_t s_log_cache_misses = 0;
 #endif
 
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+static bool s_log_async = true;
+static esp_log_async_policy_t s_log_async_policy = (esp_log_async_policy_t) CONFIG_LOG_ASYNC_POLICY;
+static struct {
+    _Atomic uint32_t queued;
+    _Atomic uint32_t written;
+    _Atomic uint32_t batches;
+    _Atomic uint32_t dropped_newest;
+    _Atomic uint32_t dropped_oldest;
+    _Atomic uint32_t blocked;
+    _Atomic uint32_t truncated;
+} s_log_async_stats;
+
+static bool log_async_write(const char *format, va_list args);
+#endif
+
 
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
 static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void cache_change_begin(void);
+static inline void cache_change_end(void);
+static inline struct log_tags_head *tag_bucket(const char *tag);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -97,15 +123,18 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
 
     // for wildcard tag, remove all linked list items and clear the cache
     if (strcmp(tag, "*") == 0) {
+        cache_change_begin();
         esp_log_default_level = level;
         clear_log_level_list();
+        cache_change_end();
         esp_log_impl_unlock();
         return;
     }
 
     // search for existing tag
+    struct log_tags_head *bucket = tag_bucket(tag);
     uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, bucket, entries) {
         if (strcmp(it->tag, tag) == 0) {
             // one tag in the linked list matched, update the level
             it->level = level;
@@ -125,31 +154,30 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
         }
         new_entry->level = (uint8_t) level;
         memcpy(new_entry->tag, tag, tag_len); // we know the size and strncpy would trigger a compiler warning here
-        SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
+        SLIST_INSERT_HEAD(bucket, new_entry, entries);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
+    // update the cache entries of the tag, there may be several pointers to equal strings
+    cache_change_begin();
+    for (uint32_t i = 0; i < TAG_CACHE_SIZE; ++i) {
+        const char *cached = atomic_load_explicit(&s_log_cache_tags[i], memory_order_relaxed);
+        if (cached != NULL && strcmp(cached, tag) == 0) {
+            atomic_store_explicit(&s_log_cache_levels[i], level, memory_order_relaxed);
         }
     }
+    cache_change_end();
     esp_log_impl_unlock();
 }
 
 
-/* Common code for getting the log level from cache, esp_log_impl_lock()
-   should be called before calling this function. The function unlocks,
-   as indicated in the name.
+/* Common code for getting the log level when it is not found in the cache,
+   esp_log_impl_lock() should be called before calling this function. The
+   function unlocks, as indicated in the name.
 */
 static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 {
     esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
+    // Look for the tag in cache again, it may have been added meanwhile, then in the table of all tags
     if (!get_cached_log_level(tag, &level_for_tag)) {
         if (!get_uncached_log_level(tag, &level_for_tag)) {
             level_for_tag = esp_log_default_level;
@@ -166,19 +194,27 @@ static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 
 esp_log_level_t esp_log_level_get(const char *tag)
 {
+    esp_log_level_t level_for_tag;
+    if (get_cached_log_level(tag, &level_for_tag)) {
+        return level_for_tag;
+    }
     esp_log_impl_lock();
     return s_log_level_get_and_unlock(tag);
 }
 
+/* Called with the lock taken, between cache_change_begin() and cache_change_end() */
 void clear_log_level_list(void)
 {
-    uncached_tag_entry_t *it;
-    while ((it = SLIST_FIRST(&s_log_tags)) != NULL) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries);
-        free(it);
+    for (int i = 0; i < TAG_HASH_SIZE; ++i) {
+        uncached_tag_entry_t *it;
+        while ((it = SLIST_FIRST(&s_log_tags[i])) != NULL) {
+            SLIST_REMOVE_HEAD(&s_log_tags[i], entries);
+            free(it);
+        }
+    }
+    for (int i = 0; i < TAG_CACHE_SIZE; ++i) {
+        atomic_store_explicit(&s_log_cache_tags[i], NULL, memory_order_relaxed);
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
@@ -189,14 +225,29 @@ void esp_log_writev(esp_log_level_t level,
                    const char *format,
                    va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
-        return;
+    esp_log_level_t level_for_tag;
+    if (!get_cached_log_level(tag, &level_for_tag)) {
+        if (!esp_log_impl_lock_timeout()) {
+            return;
+        }
+        level_for_tag = s_log_level_get_and_unlock(tag);
     }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+    if (esp_log_impl_binary_enabled()) {
+        esp_log_binary_writev(level, tag, format, args);
+        return;
+    }
+#endif
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+    if (s_log_async && log_async_write(format, args)) {
+        return;
+    }
+#endif
+
     (*s_log_print_func)(format, args);
 
 }
@@ -211,70 +262,173 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
-static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+/* Format the message and queue it for the writer task. Returns false if it
+   should be printed synchronously. */
+static bool log_async_write(const char *format, va_list args)
 {
-    // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
-        }
+    char line[CONFIG_LOG_ASYNC_LINE_SIZE];
+    va_list args_copy;
+
+    va_copy(args_copy, args);
+    int len = vsnprintf(line, sizeof(line), format, args_copy);
+    va_end(args_copy);
+    if (len < 0) {
+        return false;
     }
-    if (i == s_log_cache_entry_count) { // Not found in cache
+    if ((size_t) len >= sizeof(line)) {
+        // Keep the line break, so the next message still starts on its own line
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+        atomic_fetch_add(&s_log_async_stats.truncated, 1);
+    }
+
+    esp_log_async_result_t result = { 0 };
+    if (!esp_log_impl_async_send(line, len, s_log_async_policy, &result)) {
         return false;
     }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
+    if (result.dropped) {
+        atomic_fetch_add(&s_log_async_stats.dropped_newest, 1);
+    } else {
+        atomic_fetch_add(&s_log_async_stats.queued, 1);
+    }
+    if (result.dropped_oldest != 0) {
+        atomic_fetch_add(&s_log_async_stats.dropped_oldest, result.dropped_oldest);
+    }
+    if (result.blocked) {
+        atomic_fetch_add(&s_log_async_stats.blocked, 1);
     }
     return true;
 }
 
+static int log_async_print(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+
+void esp_log_async_write_batch(const char *data, size_t len, uint32_t lines)
+{
+    log_async_print("%.*s", (int) len, data);
+    atomic_fetch_add(&s_log_async_stats.written, lines);
+    atomic_fetch_add(&s_log_async_stats.batches, 1);
+}
+
+void esp_log_set_async(bool enable)
+{
+    s_log_async = enable;
+}
+
+void esp_log_async_set_policy(esp_log_async_policy_t policy)
+{
+    s_log_async_policy = policy;
+}
+
+bool esp_log_async_flush(uint32_t timeout_ms)
+{
+    return esp_log_impl_async_flush(timeout_ms);
+}
+
+void esp_log_async_get_stats(esp_log_async_stats_t *stats)
+{
+    stats->queued = atomic_load(&s_log_async_stats.queued);
+    stats->written = atomic_load(&s_log_async_stats.written);
+    stats->batches = atomic_load(&s_log_async_stats.batches);
+    stats->dropped_newest = atomic_load(&s_log_async_stats.dropped_newest);
+    stats->dropped_oldest = atomic_load(&s_log_async_stats.dropped_oldest);
+    stats->blocked = atomic_load(&s_log_async_stats.blocked);
+    stats->truncated = atomic_load(&s_log_async_stats.truncated);
+}
+#endif // CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+
+static inline size_t cache_index(const char *tag)
+{
+    // Fibonacci hashing: the top bits of the product depend on all bits of the address,
+    // the low bits only on its low bits, which are often zero due to alignment
+    return ((uint32_t)(uintptr_t) tag * 2654435761u) >> (32 - TAG_CACHE_BITS);
+}
+
+static inline struct log_tags_head *tag_bucket(const char *tag)
+{
+    // FNV-1a hash of the tag string
+    uint32_t h = 2166136261u;
+    for (const char *p = tag; *p != '\0'; ++p) {
+        h = (h ^ (uint8_t) *p) * 16777619u;
+    }
+    return &s_log_tags[h % TAG_HASH_SIZE];
+}
+
+/* Called with the lock taken, before changing the cache or the levels */
+static inline void cache_change_begin(void)
+{
+    uint32_t version = atomic_load_explicit(&s_log_cache_version, memory_order_relaxed);
+    atomic_store_explicit(&s_log_cache_version, version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void cache_change_end(void)
+{
+    uint32_t version = atomic_load_explicit(&s_log_cache_version, memory_order_relaxed);
+    atomic_store_explicit(&s_log_cache_version, version + 1, memory_order_release);
+}
+
+/* Look up the level of the tag in the cache, without the lock. Returns false
+   if the tag is not in the cache, or the cache was changed meanwhile. */
+static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
+{
+    uint32_t version = atomic_load_explicit(&s_log_cache_version, memory_order_acquire);
+    if (version & 1) {
+        return false;
+    }
+    bool found = false;
+    size_t i = cache_index(tag);
+    for (int probe = 0; probe < TAG_CACHE_PROBES; ++probe) {
+        const char *cached = atomic_load_explicit(&s_log_cache_tags[i], memory_order_relaxed);
+        if (cached == tag) {
+            *level = (esp_log_level_t) atomic_load_explicit(&s_log_cache_levels[i], memory_order_relaxed);
+            found = true;
+            break;
+        }
+        if (cached == NULL) {
+            break;
+        }
+        i = (i + 1) % TAG_CACHE_SIZE;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return found && atomic_load_explicit(&s_log_cache_version, memory_order_relaxed) == version;
+}
+
+/* Called with the lock taken */
 static inline void add_to_cache(const char *tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    size_t i = cache_index(tag);
+    size_t slot = TAG_CACHE_SIZE;
+    for (int probe = 0; probe < TAG_CACHE_PROBES; ++probe) {
+        if (atomic_load_explicit(&s_log_cache_tags[i], memory_order_relaxed) == NULL) {
+            slot = i;
+            break;
+        }
+        i = (i + 1) % TAG_CACHE_SIZE;
+    }
+    if (slot == TAG_CACHE_SIZE) {
+        // All slots of the tag are taken, replace them in turn
+        slot = (cache_index(tag) + s_log_cache_evictions++ % TAG_CACHE_PROBES) % TAG_CACHE_SIZE;
     }
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+    cache_change_begin();
+    atomic_store_explicit(&s_log_cache_tags[slot], tag, memory_order_relaxed);
+    atomic_store_explicit(&s_log_cache_levels[slot], level, memory_order_relaxed);
+    cache_change_end();
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
-    // This is slow because tags are compared as strings.
+    // Walk the bucket of the tag and see if given tag is present in it.
     uncached_tag_entry_t *it;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, tag_bucket(tag), entries) {
         if (strcmp(tag, it->tag) == 0) {
             *level = it->level;
             return true;
@@ -287,21 +441,3 @@ static inline bool should_output(esp_log_level_t level_for_message, esp_log_leve
 {
     return level_for_message <= level_for_tag;
 }
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
-    }
-}
-
-static inline void heap_swap(int i, int j)
-{
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
-}
@@ -0,0 +1,376 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Binary log buffers.
+ *
+ * There is one buffer per core. Writers reserve space for a record by moving
+ * the head of the buffer with a compare-and-swap, fill in the record, and
+ * publish it by storing its header word last. The reader copies published
+ * records from the tail, clears their space and moves the tail. As the space
+ * of a record is cleared before it is released, a header word is only seen
+ * as valid once the record behind it is complete. Records are never split at
+ * the end of the buffer, the remaining space is filled with a padding record.
+ *
+ * Head and tail count bytes since startup, modulo 2^32, so the buffer size
+ * must be a power of two.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_log_binary.h"
+#include "esp_log_private.h"
+#include "log_binary_format.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#define LOG_BINARY_BUFFERS      1
+#define CURRENT_BUFFER()        0
+#else
+#include "soc/soc_caps.h"
+#include "esp_cpu.h"
+#define LOG_BINARY_BUFFERS      SOC_CPU_CORES_NUM
+#define CURRENT_BUFFER()        esp_cpu_get_core_id()
+#endif
+
+#define BUFFER_SIZE             CONFIG_LOG_BINARY_BUFFER_SIZE
+#define BUFFER_MASK             (BUFFER_SIZE - 1)
+
+// Records are assembled on the stack before they are copied to the buffer
+#define MAX_RECORD_SIZE         256
+#define RECORD_HEADER_SIZE      (2 * sizeof(uint32_t) + 2 * sizeof(uintptr_t))
+
+_Static_assert((BUFFER_SIZE & BUFFER_MASK) == 0, "CONFIG_LOG_BINARY_BUFFER_SIZE must be a power of two");
+_Static_assert(BUFFER_SIZE >= 2 * MAX_RECORD_SIZE, "CONFIG_LOG_BINARY_BUFFER_SIZE is too small");
+
+typedef struct {
+    _Atomic uint32_t head;              // Bytes reserved by writers
+    _Atomic uint32_t tail;              // Bytes released by the reader
+    _Atomic uint32_t records;
+    _Atomic uint32_t dropped;
+    _Atomic uint32_t bytes;
+    uint32_t data[BUFFER_SIZE / sizeof(uint32_t)];
+} log_binary_buffer_t;
+
+static log_binary_buffer_t s_buffers[LOG_BINARY_BUFFERS];
+static bool s_binary_enabled = true;
+
+static inline uint32_t make_header(uint32_t level, uint32_t length)
+{
+    return ESP_LOG_BINARY_VALID | (sizeof(uintptr_t) == 8 ? ESP_LOG_BINARY_PTR64 : 0) |
+           (level << ESP_LOG_BINARY_LEVEL_SHIFT) | length;
+}
+
+static inline uint32_t *header_at(log_binary_buffer_t *buf, uint32_t pos)
+{
+    return &buf->data[(pos & BUFFER_MASK) / sizeof(uint32_t)];
+}
+
+static inline size_t align4(size_t len)
+{
+    return (len + 3) & ~3;
+}
+
+/* Argument types of a format string, 4 bits per argument in the order of the
+   arguments, terminated by 0. The int arguments of '*' are included. */
+typedef uint64_t format_sig_t;
+
+#define SIG_BITS                4
+#define SIG_MAX_ARGS            (sizeof(format_sig_t) * 8 / SIG_BITS)
+#define SIG_LONG_DOUBLE         (LOG_BINARY_ARG_STRING + 1)
+
+/* Formats are parsed once and their signatures cached by address. Each entry
+   is guarded by a sequence number, odd while the entry is being written, so
+   it can be read and written from any task and core without a lock. */
+#define FORMAT_CACHE_SIZE       64
+
+typedef struct {
+    _Atomic uint32_t seq;
+    _Atomic uintptr_t format;
+    _Atomic uint32_t sig_lo;
+    _Atomic uint32_t sig_hi;
+} format_cache_entry_t;
+
+static format_cache_entry_t s_format_cache[FORMAT_CACHE_SIZE];
+
+static inline format_cache_entry_t *format_cache_entry(const char *format)
+{
+    uint32_t h = (uint32_t)((uintptr_t)format >> 2) * 2654435761u;
+    return &s_format_cache[h % FORMAT_CACHE_SIZE];
+}
+
+static bool format_cache_get(const char *format, format_sig_t *sig)
+{
+    format_cache_entry_t *entry = format_cache_entry(format);
+    uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+    if ((seq & 1) != 0 || atomic_load_explicit(&entry->format, memory_order_relaxed) != (uintptr_t)format) {
+        return false;
+    }
+    uint32_t lo = atomic_load_explicit(&entry->sig_lo, memory_order_relaxed);
+    uint32_t hi = atomic_load_explicit(&entry->sig_hi, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&entry->seq, memory_order_relaxed) != seq) {
+        return false;
+    }
+    *sig = ((format_sig_t)hi << 32) | lo;
+    return true;
+}
+
+static void format_cache_put(const char *format, format_sig_t sig)
+{
+    format_cache_entry_t *entry = format_cache_entry(format);
+    uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+    /* Leave the entry to another writer rather than waiting */
+    if ((seq & 1) != 0 || !atomic_compare_exchange_strong_explicit(&entry->seq, &seq, seq + 1,
+                                                                    memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&entry->format, (uintptr_t)format, memory_order_relaxed);
+    atomic_store_explicit(&entry->sig_lo, (uint32_t)sig, memory_order_relaxed);
+    atomic_store_explicit(&entry->sig_hi, (uint32_t)(sig >> 32), memory_order_relaxed);
+    atomic_store_explicit(&entry->seq, seq + 2, memory_order_release);
+}
+
+/* Parse the signature of format. Returns false if it has too many arguments. */
+static bool parse_format_sig(const char *format, format_sig_t *sig)
+{
+    log_binary_spec_t spec;
+    unsigned n = 0;
+
+    *sig = 0;
+    while (log_binary_next_spec(format, &spec)) {
+        format = spec.end;
+        if (spec.type == LOG_BINARY_ARG_NONE) {
+            continue;
+        }
+        if (n + spec.stars + 1 > SIG_MAX_ARGS) {
+            return false;
+        }
+        for (int i = 0; i < spec.stars; i++) {
+            *sig |= (format_sig_t)LOG_BINARY_ARG_INT << (SIG_BITS * n++);
+        }
+        unsigned type = spec.long_double ? SIG_LONG_DOUBLE : spec.type;
+        *sig |= (format_sig_t)type << (SIG_BITS * n++);
+    }
+    return true;
+}
+
+/* Append an argument of type to the record at rec, which has room for size
+   bytes. Returns the new length of the record, which is larger than size if
+   the argument didn't fit. */
+static inline size_t encode_arg(unsigned type, uint8_t *rec, size_t len, size_t size, const char *tag, va_list *args)
+{
+    union {
+        int i;
+        long l;
+        long long ll;
+        uintptr_t ptr;
+        double d;
+    } value;
+    size_t value_size;
+
+    switch (type) {
+    case LOG_BINARY_ARG_INT:
+        value.i = va_arg(*args, int);
+        value_size = sizeof(value.i);
+        break;
+    case LOG_BINARY_ARG_LONG:
+        value.l = va_arg(*args, long);
+        value_size = sizeof(value.l);
+        break;
+    case LOG_BINARY_ARG_LONG_LONG:
+        value.ll = va_arg(*args, long long);
+        value_size = sizeof(value.ll);
+        break;
+    case LOG_BINARY_ARG_SIZE:
+        value.ptr = va_arg(*args, size_t);
+        value_size = sizeof(value.ptr);
+        break;
+    case LOG_BINARY_ARG_POINTER:
+        value.ptr = (uintptr_t)va_arg(*args, void *);
+        value_size = sizeof(value.ptr);
+        break;
+    case LOG_BINARY_ARG_DOUBLE:
+        value.d = va_arg(*args, double);
+        value_size = sizeof(value.d);
+        break;
+    case SIG_LONG_DOUBLE:
+        value.d = (double)va_arg(*args, long double);
+        value_size = sizeof(value.d);
+        break;
+    case LOG_BINARY_ARG_STRING: {
+        const char *str = va_arg(*args, const char *);
+        uint16_t str_len = 0;
+        if (len + sizeof(str_len) > size) {
+            return size + 1;
+        }
+        if (str == tag) {
+            str_len = ESP_LOG_BINARY_TAG_REF;
+        } else {
+            if (str == NULL) {
+                str = "(null)";
+            }
+            /* Log strings are short, copy and measure them in one pass. Truncate
+               the string to the space left rather than dropping the record. */
+            size_t max_len = size - len - sizeof(str_len);
+            if (max_len > ESP_LOG_BINARY_MAX_STRING) {
+                max_len = ESP_LOG_BINARY_MAX_STRING;
+            }
+            uint8_t *dest = rec + len + sizeof(str_len);
+            while (str_len < max_len && str[str_len] != '\0') {
+                dest[str_len] = str[str_len];
+                str_len++;
+            }
+        }
+        memcpy(rec + len, &str_len, sizeof(str_len));
+        len += sizeof(str_len) + (str_len != ESP_LOG_BINARY_TAG_REF ? str_len : 0);
+        return align4(len);
+    }
+    default:
+        return len;
+    }
+
+    if (len + value_size > size) {
+        return size + 1;
+    }
+    memcpy(rec + len, &value, value_size);
+    return align4(len + value_size);
+}
+
+/* Append the arguments of format to the record at rec, which has room for
+   size bytes. Returns the length of the record, larger than size if the
+   arguments didn't fit. */
+static size_t encode_args(uint8_t *rec, size_t len, size_t size, const char *tag, const char *format, va_list *args)
+{
+    format_sig_t sig;
+
+    if (!format_cache_get(format, &sig)) {
+        if (!parse_format_sig(format, &sig)) {
+            /* Too many arguments for a signature, encode while parsing */
+            log_binary_spec_t spec;
+            while (log_binary_next_spec(format, &spec) && len <= size) {
+                format = spec.end;
+                for (int i = 0; i < spec.stars && len <= size; i++) {
+                    len = encode_arg(LOG_BINARY_ARG_INT, rec, len, size, tag, args);
+                }
+                if (spec.type != LOG_BINARY_ARG_NONE && len <= size) {
+                    len = encode_arg(spec.long_double ? SIG_LONG_DOUBLE : spec.type, rec, len, size, tag, args);
+                }
+            }
+            return len;
+        }
+        format_cache_put(format, sig);
+    }
+
+    for (; sig != 0 && len <= size; sig >>= SIG_BITS) {
+        len = encode_arg(sig & ((1 << SIG_BITS) - 1), rec, len, size, tag, args);
+    }
+    return len;
+}
+
+void esp_log_set_binary(bool enable)
+{
+    s_binary_enabled = enable;
+}
+
+bool esp_log_impl_binary_enabled(void)
+{
+    return s_binary_enabled;
+}
+
+void esp_log_binary_writev(esp_log_level_t level, const char *tag, const char *format, va_list args)
+{
+    uint8_t rec[MAX_RECORD_SIZE] __attribute__((aligned(4)));
+    uint32_t timestamp = esp_log_timestamp();
+    uintptr_t tag_addr = (uintptr_t)tag;
+    uintptr_t format_addr = (uintptr_t)format;
+
+    memcpy(rec + sizeof(uint32_t), &timestamp, sizeof(timestamp));
+    memcpy(rec + 2 * sizeof(uint32_t), &tag_addr, sizeof(tag_addr));
+    memcpy(rec + 2 * sizeof(uint32_t) + sizeof(uintptr_t), &format_addr, sizeof(format_addr));
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    size_t len = encode_args(rec, RECORD_HEADER_SIZE, sizeof(rec), tag, format, &args_copy);
+    va_end(args_copy);
+
+    log_binary_buffer_t *buf = &s_buffers[CURRENT_BUFFER()];
+    if (len > sizeof(rec)) {
+        /* Too many arguments for one record */
+        atomic_fetch_add_explicit(&buf->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint32_t pad;
+    do {
+        uint32_t pos = head & BUFFER_MASK;
+        pad = (pos + len > BUFFER_SIZE) ? BUFFER_SIZE - pos : 0;
+        uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+        if (head + pad + len - tail > BUFFER_SIZE) {
+            atomic_fetch_add_explicit(&buf->dropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&buf->head, &head, head + pad + len,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    if (pad != 0) {
+        __atomic_store_n(header_at(buf, head), make_header(ESP_LOG_BINARY_PADDING, pad), __ATOMIC_RELEASE);
+        head += pad;
+    }
+    uint32_t *dest = header_at(buf, head);
+    memcpy(dest + 1, rec + sizeof(uint32_t), len - sizeof(uint32_t));
+    __atomic_store_n(dest, make_header(level, len), __ATOMIC_RELEASE);
+
+    atomic_fetch_add_explicit(&buf->records, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&buf->bytes, len, memory_order_relaxed);
+}
+
+size_t esp_log_binary_read(void *buf, size_t size)
+{
+    uint8_t *out = buf;
+    size_t copied = 0;
+
+    for (int i = 0; i < LOG_BINARY_BUFFERS; i++) {
+        log_binary_buffer_t *b = &s_buffers[i];
+        uint32_t tail = atomic_load_explicit(&b->tail, memory_order_relaxed);
+        while (true) {
+            uint32_t *src = header_at(b, tail);
+            uint32_t header = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+            if ((header & ESP_LOG_BINARY_VALID) == 0) {
+                break;
+            }
+            size_t len = header & ESP_LOG_BINARY_LENGTH_MASK;
+            bool padding = ((header >> ESP_LOG_BINARY_LEVEL_SHIFT) & ESP_LOG_BINARY_LEVEL_MASK) == ESP_LOG_BINARY_PADDING;
+            if (!padding) {
+                if (copied + len > size) {
+                    break;
+                }
+                memcpy(out + copied, src, len);
+                copied += len;
+            }
+            memset(src, 0, len);
+            tail += len;
+            atomic_store_explicit(&b->tail, tail, memory_order_release);
+        }
+    }
+    return copied;
+}
+
+void esp_log_binary_get_stats(esp_log_binary_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < LOG_BINARY_BUFFERS; i++) {
+        stats->records += atomic_load_explicit(&s_buffers[i].records, memory_order_relaxed);
+        stats->dropped += atomic_load_explicit(&s_buffers[i].dropped, memory_order_relaxed);
+        stats->bytes += atomic_load_explicit(&s_buffers[i].bytes, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,398 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log_binary.h"
+#include "esp_log_binary_decoder.h"
+#include "log_binary_format.h"
+
+/* Note: this file should depend on libc only, it is used by host tools */
+
+typedef struct {
+    const uint8_t *data;
+    size_t pos;
+    size_t len;
+    size_t ptr_size;
+} record_reader_t;
+
+typedef struct {
+    char *text;
+    size_t pos;
+    size_t size;
+} text_writer_t;
+
+static bool read_bytes(record_reader_t *r, void *dest, size_t n)
+{
+    if (r->pos + n > r->len) {
+        return false;
+    }
+    memcpy(dest, r->data + r->pos, n);
+    r->pos += n;
+    return true;
+}
+
+static bool read_int(record_reader_t *r, int64_t *value, size_t n)
+{
+    if (n == sizeof(int32_t)) {
+        int32_t v;
+        if (!read_bytes(r, &v, sizeof(v))) {
+            return false;
+        }
+        *value = v;
+        return true;
+    }
+    return read_bytes(r, value, sizeof(*value));
+}
+
+static uint64_t read_address(const uint8_t *p, size_t ptr_size)
+{
+    if (ptr_size == sizeof(uint32_t)) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void append(text_writer_t *w, const char *str, size_t n)
+{
+    if (w->pos + 1 >= w->size) {
+        return;
+    }
+    if (n > w->size - 1 - w->pos) {
+        n = w->size - 1 - w->pos;
+    }
+    memcpy(w->text + w->pos, str, n);
+    w->pos += n;
+    w->text[w->pos] = '\0';
+}
+
+/* Copy the conversion to spec_fmt for the host printf, with the '*' replaced
+   by the values from the record and without length modifiers. Returns false if
+   the record is too short. */
+static bool host_spec(const log_binary_spec_t *spec, record_reader_t *r, char *spec_fmt, size_t spec_size)
+{
+    size_t n = 0;
+    for (const char *p = spec->start; p < spec->end - 1 && n + 12 < spec_size; p++) {
+        if (*p == '*') {
+            int32_t star;
+            if (!read_bytes(r, &star, sizeof(star))) {
+                return false;
+            }
+            if (star < 0 && n > 0 && spec_fmt[n - 1] == '.') {
+                n--;    // Negative precision is taken as if it was omitted
+            } else {
+                n += snprintf(spec_fmt + n, spec_size - n, "%d", (int)star);
+            }
+        } else if (strchr("hlLqjzt", *p) == NULL) {
+            spec_fmt[n++] = *p;
+        }
+    }
+    spec_fmt[n] = '\0';
+    return true;
+}
+
+static bool format_spec(const log_binary_spec_t *spec, record_reader_t *r, const char *tag, text_writer_t *w)
+{
+    char spec_fmt[32];
+    char conv[2] = { spec->conversion, '\0' };
+    char buf[160];
+    int64_t value;
+    int len = 0;
+
+    if (spec->type == LOG_BINARY_ARG_NONE) {
+        if (spec->conversion == '%') {
+            append(w, "%", 1);
+        } else {
+            append(w, spec->start, spec->end - spec->start);
+        }
+        return true;
+    }
+    if (!host_spec(spec, r, spec_fmt, sizeof(spec_fmt) - 3)) {
+        return false;
+    }
+
+    switch (spec->type) {
+    case LOG_BINARY_ARG_INT:
+    case LOG_BINARY_ARG_LONG:
+    case LOG_BINARY_ARG_LONG_LONG:
+    case LOG_BINARY_ARG_SIZE: {
+        size_t size = (spec->type == LOG_BINARY_ARG_INT) ? sizeof(int32_t) :
+                      (spec->type == LOG_BINARY_ARG_LONG_LONG) ? sizeof(int64_t) : r->ptr_size;
+        if (!read_int(r, &value, size)) {
+            return false;
+        }
+        if (size == sizeof(int32_t)) {
+            strcat(spec_fmt, conv);
+            len = snprintf(buf, sizeof(buf), spec_fmt, (int)value);
+        } else {
+            strcat(spec_fmt, "ll");
+            strcat(spec_fmt, conv);
+            len = snprintf(buf, sizeof(buf), spec_fmt, (long long)value);
+        }
+        break;
+    }
+    case LOG_BINARY_ARG_POINTER:
+        if (!read_int(r, &value, r->ptr_size)) {
+            return false;
+        }
+        if (spec->conversion != 'n') {
+            uint64_t address = (r->ptr_size == sizeof(int32_t)) ? (uint32_t)value : (uint64_t)value;
+            len = snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)address);
+        }
+        break;
+    case LOG_BINARY_ARG_DOUBLE: {
+        double d;
+        if (!read_bytes(r, &d, sizeof(d))) {
+            return false;
+        }
+        strcat(spec_fmt, conv);
+        len = snprintf(buf, sizeof(buf), spec_fmt, d);
+        break;
+    }
+    case LOG_BINARY_ARG_STRING: {
+        uint16_t str_len;
+        char str[ESP_LOG_BINARY_MAX_STRING + 1];
+        if (!read_bytes(r, &str_len, sizeof(str_len))) {
+            return false;
+        }
+        if (str_len == ESP_LOG_BINARY_TAG_REF) {
+            strcat(spec_fmt, conv);
+            len = snprintf(buf, sizeof(buf), spec_fmt, tag);
+        } else {
+            if (str_len > ESP_LOG_BINARY_MAX_STRING || !read_bytes(r, str, str_len)) {
+                return false;
+            }
+            str[str_len] = '\0';
+            strcat(spec_fmt, conv);
+            len = snprintf(buf, sizeof(buf), spec_fmt, str);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    append(w, buf, len < (int)sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+    r->pos = (r->pos + 3) & ~(size_t)3;
+    return true;
+}
+
+size_t esp_log_binary_decode(const void *data, size_t size, esp_log_binary_resolver_t resolve, void *ctx,
+                             esp_log_binary_entry_t *entry, char *text, size_t text_size)
+{
+    const uint8_t *rec = data;
+    uint32_t header;
+
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, rec, sizeof(header));
+    size_t ptr_size = (header & ESP_LOG_BINARY_PTR64) ? sizeof(uint64_t) : sizeof(uint32_t);
+    size_t len = header & ESP_LOG_BINARY_LENGTH_MASK;
+    uint32_t level = (header >> ESP_LOG_BINARY_LEVEL_SHIFT) & ESP_LOG_BINARY_LEVEL_MASK;
+    if ((header & ESP_LOG_BINARY_VALID) == 0 || len > size || len < sizeof(header)) {
+        return 0;
+    }
+
+    text_writer_t w = { .text = text, .pos = 0, .size = text_size };
+    if (text_size > 0) {
+        text[0] = '\0';
+    }
+    if (level == ESP_LOG_BINARY_PADDING) {
+        if (entry != NULL) {
+            *entry = (esp_log_binary_entry_t) { .level = ESP_LOG_NONE, .timestamp = 0, .tag = "" };
+        }
+        return len;
+    }
+    if (len < 2 * sizeof(uint32_t) + 2 * ptr_size) {
+        return 0;
+    }
+
+    uint32_t timestamp;
+    memcpy(&timestamp, rec + sizeof(uint32_t), sizeof(timestamp));
+    uint64_t tag_addr = read_address(rec + 2 * sizeof(uint32_t), ptr_size);
+    uint64_t format_addr = read_address(rec + 2 * sizeof(uint32_t) + ptr_size, ptr_size);
+    const char *tag = resolve(tag_addr, ctx);
+    const char *format = resolve(format_addr, ctx);
+    if (tag == NULL) {
+        tag = "?";
+    }
+    if (entry != NULL) {
+        *entry = (esp_log_binary_entry_t) { .level = level, .timestamp = timestamp, .tag = tag };
+    }
+    if (format == NULL) {
+        char buf[48];
+        int n = snprintf(buf, sizeof(buf), "<unknown format 0x%llx>", (unsigned long long)format_addr);
+        append(&w, buf, n);
+        return len;
+    }
+
+    record_reader_t r = {
+        .data = rec,
+        .pos = 2 * sizeof(uint32_t) + 2 * ptr_size,
+        .len = len,
+        .ptr_size = ptr_size,
+    };
+    log_binary_spec_t spec;
+    while (log_binary_next_spec(format, &spec)) {
+        append(&w, format, spec.start - format);
+        format = spec.end;
+        if (!format_spec(&spec, &r, tag, &w)) {
+            append(&w, "<truncated>", strlen("<truncated>"));
+            return len;
+        }
+    }
+    append(&w, format, strlen(format));
+    return len;
+}
+
+/* ELF files */
+
+#define ELF_CLASS_32        1
+#define ELF_CLASS_64        2
+#define ELF_DATA_LSB        1
+#define ELF_SHT_NOBITS      8
+#define ELF_SHF_ALLOC       2
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    const char *data;
+} elf_section_t;
+
+struct esp_log_binary_elf {
+    char *image;
+    elf_section_t *sections;
+    size_t num_sections;
+};
+
+static uint64_t get_field(const uint8_t *p, size_t n)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++) {
+        v |= (uint64_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+static char *load_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    char *image = NULL;
+    size_t capacity = 0;
+
+    *size = 0;
+    if (f == NULL) {
+        return NULL;
+    }
+    /* Read in chunks, as the size of files like /proc/self/exe is not known in advance */
+    while (true) {
+        if (*size == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            char *bigger = realloc(image, capacity);
+            if (bigger == NULL) {
+                free(image);
+                fclose(f);
+                return NULL;
+            }
+            image = bigger;
+        }
+        size_t n = fread(image + *size, 1, capacity - *size, f);
+        if (n == 0) {
+            break;
+        }
+        *size += n;
+    }
+    fclose(f);
+    return image;
+}
+
+esp_log_binary_elf_t *esp_log_binary_elf_open(const char *path)
+{
+    size_t file_size;
+    char *image = load_file(path, &file_size);
+    if (image == NULL) {
+        return NULL;
+    }
+    const uint8_t *e = (const uint8_t *)image;
+    if (file_size < 64 || memcmp(e, "\x7f" "ELF", 4) != 0 || e[5] != ELF_DATA_LSB ||
+            (e[4] != ELF_CLASS_32 && e[4] != ELF_CLASS_64)) {
+        free(image);
+        return NULL;
+    }
+
+    bool is64 = (e[4] == ELF_CLASS_64);
+    uint64_t shoff = is64 ? get_field(e + 0x28, 8) : get_field(e + 0x20, 4);
+    size_t shentsize = get_field(e + (is64 ? 0x3A : 0x2E), 2);
+    size_t shnum = get_field(e + (is64 ? 0x3C : 0x30), 2);
+    if (shoff > file_size || shnum > (file_size - shoff) / (shentsize ? shentsize : 1) ||
+            shentsize < (is64 ? 0x40u : 0x28u)) {
+        free(image);
+        return NULL;
+    }
+
+    esp_log_binary_elf_t *elf = calloc(1, sizeof(esp_log_binary_elf_t));
+    elf_section_t *sections = calloc(shnum ? shnum : 1, sizeof(elf_section_t));
+    if (elf == NULL || sections == NULL) {
+        free(elf);
+        free(sections);
+        free(image);
+        return NULL;
+    }
+    elf->image = image;
+    elf->sections = sections;
+
+    for (size_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = e + shoff + i * shentsize;
+        uint32_t type = get_field(sh + 4, 4);
+        uint64_t flags = is64 ? get_field(sh + 8, 8) : get_field(sh + 8, 4);
+        uint64_t addr = is64 ? get_field(sh + 0x10, 8) : get_field(sh + 0x0C, 4);
+        uint64_t offset = is64 ? get_field(sh + 0x18, 8) : get_field(sh + 0x10, 4);
+        uint64_t size = is64 ? get_field(sh + 0x20, 8) : get_field(sh + 0x14, 4);
+        if ((flags & ELF_SHF_ALLOC) == 0 || type == ELF_SHT_NOBITS || size == 0 ||
+                offset > file_size || size > file_size - offset) {
+            continue;
+        }
+        sections[elf->num_sections++] = (elf_section_t) {
+            .addr = addr,
+            .size = size,
+            .data = image + offset,
+        };
+    }
+    return elf;
+}
+
+const char *esp_log_binary_elf_resolve(uint64_t address, void *ctx)
+{
+    esp_log_binary_elf_t *elf = ctx;
+    for (size_t i = 0; i < elf->num_sections; i++) {
+        const elf_section_t *s = &elf->sections[i];
+        if (address >= s->addr && address - s->addr < s->size) {
+            const char *str = s->data + (address - s->addr);
+            if (memchr(str, '\0', s->size - (address - s->addr)) == NULL) {
+                return NULL;
+            }
+            return str;
+        }
+    }
+    return NULL;
+}
+
+void esp_log_binary_elf_close(esp_log_binary_elf_t *elf)
+{
+    if (elf != NULL) {
+        free(elf->image);
+        free(elf->sections);
+        free(elf);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/* Parsing of printf format strings, shared by the binary log encoder on the
+ * device and the decoder on the host, so both agree on the arguments of a
+ * record. Depends on libc only.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    LOG_BINARY_ARG_NONE,            // %%
+    LOG_BINARY_ARG_INT,             // int and smaller, 4 bytes
+    LOG_BINARY_ARG_LONG,            // long, 4 or 8 bytes like pointers
+    LOG_BINARY_ARG_LONG_LONG,       // long long and intmax_t, 8 bytes
+    LOG_BINARY_ARG_SIZE,            // size_t and ptrdiff_t, as wide as pointers
+    LOG_BINARY_ARG_POINTER,         // %p, %n and wide strings
+    LOG_BINARY_ARG_DOUBLE,          // 8 bytes, long double is recorded as double
+    LOG_BINARY_ARG_STRING,          // %s
+} log_binary_arg_t;
+
+typedef struct {
+    const char *start;              // The '%'
+    const char *end;                // Just after the conversion character
+    log_binary_arg_t type;
+    uint8_t stars;                  // Number of int arguments for '*' width and precision, which come first
+    bool long_double;               // 'L' modifier of a floating point conversion
+    char conversion;
+} log_binary_spec_t;
+
+/* Find the next conversion in format. Returns false at the end of the string. */
+static inline bool log_binary_next_spec(const char *format, log_binary_spec_t *spec)
+{
+    const char *p = format;
+    while (*p != '%') {
+        if (*p++ == '\0') {
+            return false;
+        }
+    }
+    spec->start = p++;
+    spec->stars = 0;
+    spec->long_double = false;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+    while ((*p >= '0' && *p <= '9') || *p == '*' || *p == '.') {
+        spec->stars += (*p == '*');
+        p++;
+    }
+
+    int longs = 0;
+    bool size = false;
+    bool intmax = false;
+    for (;; p++) {
+        if (*p == 'l' || *p == 'L') {
+            longs++;
+            spec->long_double |= (*p == 'L');
+        } else if (*p == 'q') {
+            longs += 2;
+        } else if (*p == 'z' || *p == 't') {
+            size = true;
+        } else if (*p == 'j') {
+            intmax = true;
+        } else if (*p != 'h') {
+            break;
+        }
+    }
+
+    spec->conversion = *p;
+    spec->end = (*p != '\0') ? p + 1 : p;
+    switch (*p) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+        if (intmax || longs >= 2) {
+            spec->type = LOG_BINARY_ARG_LONG_LONG;
+        } else if (size) {
+            spec->type = LOG_BINARY_ARG_SIZE;
+        } else if (longs == 1) {
+            spec->type = LOG_BINARY_ARG_LONG;
+        } else {
+            spec->type = LOG_BINARY_ARG_INT;
+        }
+        break;
+    case 'c':
+        spec->type = LOG_BINARY_ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = LOG_BINARY_ARG_DOUBLE;
+        break;
+    case 's':
+        spec->type = longs ? LOG_BINARY_ARG_POINTER : LOG_BINARY_ARG_STRING;
+        break;
+    case 'p': case 'n':
+        spec->type = LOG_BINARY_ARG_POINTER;
+        break;
+    default:
+        /* %% and unknown or truncated conversions take no argument */
+        spec->type = LOG_BINARY_ARG_NONE;
+        spec->stars = 0;
+        break;
+    }
+    return true;
+}
@@ -5,6 +5,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <sys/time.h>
 #include "freertos/FreeRTOS.h"
@@ -14,6 +15,11 @@
 #include "esp_compiler.h"
 #include "esp_log.h"
 #include "esp_log_private.h"
+#if CONFIG_LOG_ASYNC
+#include "freertos/ringbuf.h"
+#include "esp_system.h"
+#include "esp_private/log_async.h"
+#endif
 
 
 // Maximum time to wait for the mutex in a logging statement.
@@ -56,6 +62,200 @@ void esp_log_impl_unlock(void)
     xSemaphoreGive(s_log_mutex);
 }
 
+#if CONFIG_LOG_ASYNC
+/* Lines are queued as items of a no-split ring buffer, so whole lines can be
+   dropped from the front of the queue for ESP_LOG_ASYNC_DROP_OLDEST. The
+   writer task copies as many lines as fit into a batch, returns their items
+   to free the space as early as possible, then prints the batch at once.
+   Lines still queued when the system restarts or panics are printed from
+   there, and everything is printed synchronously from then on. */
+
+typedef enum {
+    ASYNC_STOPPED,
+    ASYNC_STARTING,
+    ASYNC_RUNNING,
+    ASYNC_FAILED,
+    ASYNC_SHUT_DOWN,
+} async_state_t;
+
+static portMUX_TYPE s_async_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static async_state_t s_async_state = ASYNC_STOPPED;
+static RingbufHandle_t s_async_buf;
+static TaskHandle_t s_async_task;
+// Lines queued and not yet written or dropped, to know when the queue is flushed
+static volatile uint32_t s_async_pending;
+
+static void async_pending_add(int32_t count)
+{
+    portENTER_CRITICAL(&s_async_spinlock);
+    s_async_pending += count;
+    portEXIT_CRITICAL(&s_async_spinlock);
+}
+
+static void async_writer_task(void *arg)
+{
+    // Static to keep the stack of the task small, there is only one writer
+    static char batch[CONFIG_LOG_ASYNC_BATCH_SIZE];
+
+    while (true) {
+        size_t len = 0;
+        uint32_t lines = 0;
+        size_t size;
+        char *item = xRingbufferReceive(s_async_buf, &size, portMAX_DELAY);
+        while (item != NULL) {
+            memcpy(batch + len, item, size);
+            len += size;
+            lines++;
+            vRingbufferReturnItem(s_async_buf, item);
+            if (len + CONFIG_LOG_ASYNC_LINE_SIZE > sizeof(batch)) {
+                break;
+            }
+            item = xRingbufferReceive(s_async_buf, &size, 0);
+        }
+        esp_log_async_write_batch(batch, len, lines);
+        async_pending_add(-(int32_t) lines);
+    }
+}
+
+/* Print the queued lines from the calling task, without waiting for the writer task */
+static void async_drain(void)
+{
+    size_t size;
+    char *item;
+    while ((item = xRingbufferReceive(s_async_buf, &size, 0)) != NULL) {
+        esp_log_async_write_batch(item, size, 1);
+        vRingbufferReturnItem(s_async_buf, item);
+        async_pending_add(-1);
+    }
+}
+
+static void async_shutdown(void)
+{
+    // Let the writer task print what it can in order, then print the rest from here
+    esp_log_impl_async_flush(CONFIG_LOG_ASYNC_BLOCK_TIMEOUT_MS);
+    s_async_state = ASYNC_SHUT_DOWN;
+    async_drain();
+}
+
+static bool async_start(void)
+{
+    if (likely(s_async_state == ASYNC_RUNNING)) {
+        return true;
+    }
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&s_async_spinlock);
+    bool start = (s_async_state == ASYNC_STOPPED);
+    if (start) {
+        s_async_state = ASYNC_STARTING;
+    }
+    portEXIT_CRITICAL(&s_async_spinlock);
+    if (!start) {
+        return s_async_state == ASYNC_RUNNING;
+    }
+
+    s_async_buf = xRingbufferCreate(CONFIG_LOG_ASYNC_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (s_async_buf == NULL ||
+            xTaskCreate(async_writer_task, "log_writer", CONFIG_LOG_ASYNC_TASK_STACK_SIZE, NULL,
+                        CONFIG_LOG_ASYNC_TASK_PRIORITY, &s_async_task) != pdPASS) {
+        if (s_async_buf != NULL) {
+            vRingbufferDelete(s_async_buf);
+        }
+        // Print synchronously from now on
+        s_async_state = ASYNC_FAILED;
+        return false;
+    }
+    s_async_state = ASYNC_RUNNING;
+    esp_register_shutdown_handler(async_shutdown);
+    return true;
+}
+
+bool esp_log_impl_async_send(const char *line, size_t len, esp_log_async_policy_t policy, esp_log_async_result_t *result)
+{
+    if (!async_start() || xPortInIsrContext() || xTaskGetCurrentTaskHandle() == s_async_task ||
+            xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false;
+    }
+
+    async_pending_add(1);
+    if (xRingbufferSend(s_async_buf, line, len, 0) == pdTRUE) {
+        return true;
+    }
+
+    switch (policy) {
+    case ESP_LOG_ASYNC_DROP_OLDEST:
+        while (xRingbufferSend(s_async_buf, line, len, 0) != pdTRUE) {
+            size_t size;
+            void *oldest = xRingbufferReceive(s_async_buf, &size, 0);
+            if (oldest == NULL) {
+                // The remaining lines are being written
+                result->dropped = true;
+                break;
+            }
+            vRingbufferReturnItem(s_async_buf, oldest);
+            async_pending_add(-1);
+            result->dropped_oldest++;
+        }
+        break;
+    case ESP_LOG_ASYNC_BLOCK:
+        result->blocked = true;
+        result->dropped = xRingbufferSend(s_async_buf, line, len,
+                                          pdMS_TO_TICKS(CONFIG_LOG_ASYNC_BLOCK_TIMEOUT_MS)) != pdTRUE;
+        break;
+    default:
+        result->dropped = true;
+        break;
+    }
+    if (result->dropped) {
+        async_pending_add(-1);
+    }
+    return true;
+}
+
+bool esp_log_impl_async_flush(uint32_t timeout_ms)
+{
+    if (s_async_pending == 0) {
+        return true;
+    }
+    if (s_async_state != ASYNC_RUNNING || xPortInIsrContext()) {
+        return false;
+    }
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        // The writer task may not run again, print the lines from here
+        async_drain();
+        return s_async_pending == 0;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (s_async_pending != 0) {
+        if (s_async_state != ASYNC_RUNNING || xTaskGetCurrentTaskHandle() == s_async_task ||
+                xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+void esp_log_async_panic_drain(void (*put_char)(char c))
+{
+    if (s_async_state != ASYNC_RUNNING) {
+        return;
+    }
+    s_async_state = ASYNC_SHUT_DOWN;
+    // The spinlock of the buffer isn't taken, nothing is printed if the panic happened while it was held
+    size_t size;
+    char *item;
+    while ((item = xRingbufferReceiveFromPanic(s_async_buf, &size)) != NULL) {
+        for (size_t i = 0; i < size; i++) {
+            put_char(item[i]);
+        }
+    }
+}
+#endif // CONFIG_LOG_ASYNC
+
 char *esp_log_system_timestamp(void)
 {
     static char buffer[18] = {0};
@@ -16,6 +16,7 @@
 #include <time.h>
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 #include "esp_log_private.h"
 
 static pthread_mutex_t mutex1 = PTHREAD_MUTEX_INITIALIZER;
@@ -44,3 +45,158 @@ uint32_t esp_log_timestamp(void)
     uint32_t milliseconds = current_time.tv_sec * 1000 + current_time.tv_nsec / 1000000;
     return milliseconds;
 }
+
+#if CONFIG_LOG_ASYNC
+/* Same mode as on the targets, with a pthread writer. Lines are queued in a
+   byte ring, each preceded by its length, guarded by a mutex. */
+
+#define ASYNC_BUFFER_SIZE CONFIG_LOG_ASYNC_BUFFER_SIZE
+
+static pthread_mutex_t s_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_async_data = PTHREAD_COND_INITIALIZER;     // Lines were queued
+static pthread_cond_t s_async_room = PTHREAD_COND_INITIALIZER;     // Lines were removed or written
+static pthread_once_t s_async_once = PTHREAD_ONCE_INIT;
+static bool s_async_running;
+static pthread_t s_async_thread;
+static uint8_t s_async_buf[ASYNC_BUFFER_SIZE];
+static size_t s_async_head;     // Next byte to read
+static size_t s_async_used;     // Bytes queued
+static uint32_t s_async_pending;
+
+static void ring_copy(size_t pos, void *data, size_t len)
+{
+    size_t first = (len < ASYNC_BUFFER_SIZE - pos) ? len : ASYNC_BUFFER_SIZE - pos;
+    memcpy(data, s_async_buf + pos, first);
+    memcpy((uint8_t *) data + first, s_async_buf, len - first);
+}
+
+static void ring_write(const void *data, size_t len)
+{
+    size_t pos = (s_async_head + s_async_used) % ASYNC_BUFFER_SIZE;
+    size_t first = (len < ASYNC_BUFFER_SIZE - pos) ? len : ASYNC_BUFFER_SIZE - pos;
+    memcpy(s_async_buf + pos, data, first);
+    memcpy(s_async_buf, (const uint8_t *) data + first, len - first);
+    s_async_used += len;
+}
+
+/* Length of the oldest line, with its length field */
+static size_t ring_peek_line(void)
+{
+    uint16_t len;
+    ring_copy(s_async_head, &len, sizeof(len));
+    return sizeof(len) + len;
+}
+
+/* Remove the oldest line and copy it to data if not NULL. Returns its length. */
+static size_t ring_read_line(char *data)
+{
+    size_t len = ring_peek_line() - sizeof(uint16_t);
+    size_t pos = (s_async_head + sizeof(uint16_t)) % ASYNC_BUFFER_SIZE;
+    if (data != NULL) {
+        ring_copy(pos, data, len);
+    }
+    s_async_head = (pos + len) % ASYNC_BUFFER_SIZE;
+    s_async_used -= sizeof(uint16_t) + len;
+    return len;
+}
+
+static void deadline_after_ms(struct timespec *deadline, uint32_t timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *async_writer_thread(void *arg)
+{
+    static char batch[CONFIG_LOG_ASYNC_BATCH_SIZE];
+
+    pthread_mutex_lock(&s_async_mutex);
+    while (true) {
+        while (s_async_used == 0) {
+            pthread_cond_wait(&s_async_data, &s_async_mutex);
+        }
+        size_t len = 0;
+        uint32_t lines = 0;
+        while (s_async_used != 0 && len + ring_peek_line() - sizeof(uint16_t) <= sizeof(batch)) {
+            len += ring_read_line(batch + len);
+            lines++;
+        }
+        pthread_cond_broadcast(&s_async_room);
+        pthread_mutex_unlock(&s_async_mutex);
+
+        esp_log_async_write_batch(batch, len, lines);
+
+        pthread_mutex_lock(&s_async_mutex);
+        s_async_pending -= lines;
+        pthread_cond_broadcast(&s_async_room);
+    }
+    return NULL;
+}
+
+static void async_start(void)
+{
+    s_async_running = (pthread_create(&s_async_thread, NULL, async_writer_thread, NULL) == 0);
+}
+
+bool esp_log_impl_async_send(const char *line, size_t len, esp_log_async_policy_t policy, esp_log_async_result_t *result)
+{
+    uint16_t line_len = len;
+    size_t needed = sizeof(line_len) + len;
+
+    pthread_once(&s_async_once, async_start);
+    if (!s_async_running || pthread_equal(pthread_self(), s_async_thread)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_async_mutex);
+    if (ASYNC_BUFFER_SIZE - s_async_used < needed) {
+        if (policy == ESP_LOG_ASYNC_DROP_OLDEST) {
+            while (s_async_used != 0 && ASYNC_BUFFER_SIZE - s_async_used < needed) {
+                ring_read_line(NULL);
+                s_async_pending--;
+                result->dropped_oldest++;
+            }
+        } else if (policy == ESP_LOG_ASYNC_BLOCK) {
+            struct timespec deadline;
+            deadline_after_ms(&deadline, CONFIG_LOG_ASYNC_BLOCK_TIMEOUT_MS);
+            result->blocked = true;
+            while (ASYNC_BUFFER_SIZE - s_async_used < needed &&
+                    pthread_cond_timedwait(&s_async_room, &s_async_mutex, &deadline) == 0) {
+            }
+        }
+    }
+    if (ASYNC_BUFFER_SIZE - s_async_used < needed) {
+        result->dropped = true;
+    } else {
+        ring_write(&line_len, sizeof(line_len));
+        ring_write(line, len);
+        s_async_pending++;
+        pthread_cond_signal(&s_async_data);
+    }
+    pthread_mutex_unlock(&s_async_mutex);
+    return true;
+}
+
+bool esp_log_impl_async_flush(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    if (s_async_running && pthread_equal(pthread_self(), s_async_thread)) {
+        return false;
+    }
+    deadline_after_ms(&deadline, timeout_ms);
+    pthread_mutex_lock(&s_async_mutex);
+    while (s_async_pending != 0 && ret == 0) {
+        ret = pthread_cond_timedwait(&s_async_room, &s_async_mutex, &deadline);
+    }
+    bool flushed = (s_async_pending == 0);
+    pthread_mutex_unlock(&s_async_mutex);
+    return flushed;
+}
+#endif // CONFIG_LOG_ASYNC
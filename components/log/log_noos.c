@@ -36,3 +36,16 @@ uint32_t esp_log_early_timestamp(void)
 }
 
 uint32_t esp_log_timestamp(void) __attribute__((alias("esp_log_early_timestamp")));
+
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+/* There is no writer task without an OS, messages are printed synchronously */
+bool esp_log_impl_async_send(const char *line, size_t len, esp_log_async_policy_t policy, esp_log_async_result_t *result)
+{
+    return false;
+}
+
+bool esp_log_impl_async_flush(uint32_t timeout_ms)
+{
+    return true;
+}
+#endif
@@ -54,6 +54,7 @@ typedef nvs_handle_t nvs_handle IDF_DEPRECATED("Replace with nvs_handle_t");
 #define ESP_ERR_NVS_WRONG_ENCRYPTION        (ESP_ERR_NVS_BASE + 0x19)  /*!< NVS partition is marked as encrypted with generic flash encryption. This is forbidden since the NVS encryption works differently. */
 
 #define ESP_ERR_NVS_CONTENT_DIFFERS         (ESP_ERR_NVS_BASE + 0x18)  /*!< Internal error; never returned by nvs API functions.  NVS key is different in comparison */
+#define ESP_ERR_NVS_TRANSACTION_TOO_BIG     (ESP_ERR_NVS_BASE + 0x1a)  /*!< Values staged in a write transaction don't fit into a single page */
 
 #define NVS_DEFAULT_PART_NAME               "nvs"   /*!< Default partition name of the NVS partition in the partition table */
 
@@ -515,6 +516,183 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start a write transaction on the given handle
+ *
+ * Until the transaction is committed or aborted, values set through this handle with
+ * the nvs_set_* functions (except for nvs_set_blob) are only staged in RAM. Reading
+ * functions keep returning the values which are currently stored.
+ *
+ * nvs_transaction_commit writes all staged values at once, in contiguous entries of one
+ * page, which takes far fewer flash operations than setting the values one by one.
+ * If power is lost during the commit, either all of the staged values or none of them
+ * are present after NVS is initialized again.
+ *
+ * The staged values must fit into a single page, i.e. 124 entries of 32 bytes.
+ * Each primitive value takes one entry, a string takes one entry plus one entry per
+ * 32 bytes of its length (including null character). Transactions spanning several
+ * pages are not supported: a value which doesn't fit any more is rejected by nvs_set_*
+ * with ESP_ERR_NVS_TRANSACTION_TOO_BIG and is not staged, the values staged before it
+ * can still be committed.
+ *
+ * While a transaction is open, nvs_set_blob and nvs_blob_open_write return
+ * ESP_ERR_NOT_SUPPORTED and nvs_erase_key and nvs_erase_all return ESP_ERR_NVS_INVALID_STATE.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a transaction or a blob write is already open on this handle
+ *             - ESP_ERR_NO_MEM in case memory could not be allocated for the internal structures
+ */
+esp_err_t nvs_transaction_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Write all values staged since nvs_transaction_begin
+ *
+ * The transaction is closed, whether or not writing it succeeded. Values which are
+ * equal to the stored ones are not written again.
+ *
+ * While a transaction is open, nvs_set_* functions additionally return
+ * ESP_ERR_NVS_TRANSACTION_TOO_BIG if the staged values wouldn't fit into a single page.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if all staged values have been written
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if there is no open transaction on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the values. None of them has been written.
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the values were written, but the old values
+ *               couldn't be removed because flash write operation has failed. Removing them
+ *               will be finished after re-initialization of nvs, provided that flash
+ *               operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_transaction_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Discard all values staged since nvs_transaction_begin
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if there is no open transaction on this handle
+ */
+esp_err_t nvs_transaction_abort(nvs_handle_t handle);
+
+/**
+ * @brief      Start writing a blob in parts
+ *
+ * Data passed to nvs_blob_append is collected in a buffer of at most one chunk (4000 bytes)
+ * and written out a page at a time, so blobs can be stored which don't fit into RAM.
+ * The new value becomes visible when nvs_blob_finalize succeeds. Until then, reading
+ * the key returns its previous value. If nvs_blob_abort is called, the handle is closed,
+ * or power is lost before finalizing, the previous value is kept and the data written
+ * so far is erased.
+ *
+ * Only one blob can be written at a time through a handle. While it is written, the same
+ * key must not be set, erased or written in parts through another handle.
+ * nvs_transaction_begin and nvs_erase_all return ESP_ERR_NVS_INVALID_STATE.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ * @param[in]  key     Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ *
+ * @return
+ *             - ESP_OK if the blob write has been started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NVS_INVALID_STATE if a blob write is already open on this handle
+ *             - ESP_ERR_NOT_SUPPORTED if a transaction is open on this handle
+ *             - ESP_ERR_NO_MEM in case memory could not be allocated for the internal structures
+ */
+esp_err_t nvs_blob_open_write(nvs_handle_t handle, const char* key);
+
+/**
+ * @brief      Append data to the blob opened with nvs_blob_open_write
+ *
+ * If an error is returned, the blob write is aborted as if nvs_blob_abort was called.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ * @param[in]  value   Pointer to the data.
+ * @param[in]  length  Length of the data in bytes.
+ *
+ * @return
+ *             - ESP_OK if the data has been appended
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if there is no open blob write on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space to save the data
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob needs more chunks than a blob can have
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_append(nvs_handle_t handle, const void* value, size_t length);
+
+/**
+ * @brief      Write the remaining data and make the blob visible
+ *
+ * The blob write is closed, whether or not finalizing succeeded. On success, the previous
+ * value of the key is erased.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the blob has been stored
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if there is no open blob write on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space to save the data.
+ *               The previous value is kept.
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the blob was written, but the previous value
+ *               couldn't be removed because flash write operation has failed. Removing it
+ *               will be finished after re-initialization of nvs, provided that flash
+ *               operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_finalize(nvs_handle_t handle);
+
+/**
+ * @brief      Discard the blob opened with nvs_blob_open_write
+ *
+ * Data written so far is erased, the previous value of the key is kept.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the blob write has been discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if there is no open blob write on this handle
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_abort(nvs_handle_t handle);
+
+/**
+ * @brief      Read a part of a blob
+ *
+ * Only the chunks of the blob which overlap the requested range are read. Works for all
+ * blobs, whether they were stored with nvs_set_blob or written in parts.
+ *
+ * @param[in]     handle     Storage handle obtained with nvs_open.
+ * @param[in]     key        Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[in]     offset     Offset in the blob of the first byte to read.
+ * @param[out]    out_value  Pointer to the output buffer.
+ * @param[in]     length     Number of bytes to read.
+ *
+ * @return
+ *             - ESP_OK if the data has been read
+ *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_LENGTH if the range extends beyond the end of the blob
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_read_at(nvs_handle_t handle, const char* key, size_t offset, void* out_value, size_t length);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -573,6 +751,81 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @brief      Get the amount of RAM used by the lookup indices of an NVS partition.
+ *
+ * NVS keeps a fixed-size hash table for each page and a partition-wide index of items
+ * in RAM. The size of the index grows with the number of items stored in the partition, this
+ * function can be used to size the heap for large partitions.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  index_bytes  Returns the number of bytes of RAM used by the indices.
+ *
+ * @return
+ *             - ESP_OK if the value has been calculated successfully.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *               Return param index_bytes will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if index_bytes equal to NULL.
+ */
+esp_err_t nvs_get_index_memory_usage(const char *part_name, size_t *index_bytes);
+
+/**
+ * @note Info about the read cache of a NVS partition.
+ */
+typedef struct {
+    size_t hits;              /**< Amount of reads answered from the cache. */
+    size_t misses;            /**< Amount of reads which had to access flash. */
+    size_t used_entries;      /**< Amount of values currently held in the cache. */
+    size_t total_entries;     /**< Amount of values the cache can hold. */
+} nvs_read_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_read_cache_stats_t with the counters of the read cache of a partition.
+ *
+ * NVS keeps the most recently read values of primitive types and of strings up to 32 bytes
+ * (including null character) in RAM, so that reading them again doesn't access flash.
+ * The number of cached values is set by CONFIG_NVS_READ_CACHE_SIZE, a size of 0 disables the cache.
+ * Counters are reset when the partition is initialized.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  stats        Returns filled structure nvs_read_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if the counters have been filled successfully.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - ESP_ERR_INVALID_ARG if stats equal to NULL.
+ */
+esp_err_t nvs_get_read_cache_stats(const char *part_name, nvs_read_cache_stats_t *stats);
+
+/**
+ * @brief      Run one step of incremental garbage collection on a partition.
+ *
+ * When a write needs a new page and only one page is free, NVS moves the items of the page
+ * with the most erased entries to the new page and erases it, before the write returns.
+ * Calling this function regularly from a low priority task does this work ahead of time, in
+ * small steps: while fewer than CONFIG_NVS_GC_FREE_PAGES pages are free, it moves about
+ * budget entries out of such a page, or erases a page which has been emptied.
+ *
+ * Items are moved one by one, in the same way as if they were written again, so a power loss
+ * during a step doesn't lose data.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ * @param[in]   budget       Number of entries (32 bytes each) to move in this step. At least one
+ *                           item is moved, even if it spans more entries.
+ *
+ * @return
+ *             - ESP_OK if enough pages are free, or no more space can be reclaimed.
+ *             - ESP_ERR_NOT_FINISHED if the step was done and more steps are needed.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_gc_step(const char *part_name, size_t budget);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_blob_writer.hpp"
+#include <new>
+
+namespace nvs
+{
+
+BlobWriter::BlobWriter()
+{
+    mKey[0] = 0;
+}
+
+BlobWriter::~BlobWriter()
+{
+    delete[] mBuffer;
+}
+
+esp_err_t BlobWriter::init(uint8_t nsIndex, const char* key)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    if (!mBuffer) {
+        mBuffer = new (std::nothrow) uint8_t[Page::CHUNK_MAX_SIZE];
+        if (!mBuffer) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    mNsIndex = nsIndex;
+    strncpy(mKey, key, sizeof(mKey) - 1);
+    mKey[sizeof(mKey) - 1] = 0;
+    mBufferedSize = 0;
+    mWrittenSize = 0;
+    mChunkCount = 0;
+    mChunkStart = VerOffset::VER_0_OFFSET;
+    mPrevStart = VerOffset::VER_ANY;
+    mFinalized = false;
+    return ESP_OK;
+}
+
+size_t BlobWriter::buffer(const void* data, size_t dataSize)
+{
+    size_t copySize = Page::CHUNK_MAX_SIZE - mBufferedSize;
+    if (copySize > dataSize) {
+        copySize = dataSize;
+    }
+    memcpy(mBuffer + mBufferedSize, data, copySize);
+    mBufferedSize += copySize;
+    return copySize;
+}
+
+void BlobWriter::consume(size_t size)
+{
+    memmove(mBuffer, mBuffer + size, mBufferedSize - size);
+    mBufferedSize -= size;
+    mWrittenSize += size;
+}
+
+} // namespace nvs
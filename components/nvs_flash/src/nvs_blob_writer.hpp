@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_blob_writer_hpp
+#define nvs_blob_writer_hpp
+
+#include "nvs_types.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+/**
+ * State of a blob which is written in parts, between nvs_blob_open_write and nvs_blob_finalize.
+ *
+ * Appended data is collected in a buffer of at most one chunk (Page::CHUNK_MAX_SIZE bytes). Storage writes
+ * the buffered data as a BLOB_DATA item as soon as it fills the rest of the current page, so the memory
+ * needed doesn't depend on the size of the blob.
+ *
+ * Chunks are written with the blob version which isn't used by the stored blob of the same key. The blob
+ * index is only written when the blob is finalized, so readers keep seeing the previous value until then.
+ */
+class BlobWriter
+{
+public:
+    BlobWriter();
+    ~BlobWriter();
+
+    /**
+     * Allocates the chunk buffer.
+     */
+    esp_err_t init(uint8_t nsIndex, const char* key);
+
+    uint8_t getNsIndex() const
+    {
+        return mNsIndex;
+    }
+
+    const char* getKey() const
+    {
+        return mKey;
+    }
+
+    /**
+     * Returns the number of bytes appended so far.
+     */
+    size_t getDataSize() const
+    {
+        return mWrittenSize + mBufferedSize;
+    }
+
+private:
+    BlobWriter(const BlobWriter& other);
+    const BlobWriter& operator= (const BlobWriter& rhs);
+
+    /**
+     * Copies as much of data into the buffer as fits and returns the number of bytes copied.
+     */
+    size_t buffer(const void* data, size_t dataSize);
+
+    /**
+     * Drops the given number of bytes from the beginning of the buffer, after they were written.
+     */
+    void consume(size_t size);
+
+    friend class Storage;
+
+    uint8_t mNsIndex = 0;
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+    uint8_t* mBuffer = nullptr;
+    size_t mBufferedSize = 0;
+    size_t mWrittenSize = 0;
+    uint8_t mChunkCount = 0;
+    VerOffset mChunkStart = VerOffset::VER_0_OFFSET;
+    VerOffset mPrevStart = VerOffset::VER_ANY; // version of the blob replaced by this one, VER_ANY if there is none
+    bool mFinalized = false; // set once the blob index is written, the chunks then belong to the stored blob
+}; // class BlobWriter
+
+} // namespace nvs
+
+#endif /* nvs_blob_writer_hpp */
@@ -5,6 +5,7 @@
  */
 
 #include <cstring>
+#include "sdkconfig.h"
 #include "nvs_encrypted_partition.hpp"
 #include "nvs_types.hpp"
 
@@ -13,6 +14,11 @@ namespace nvs {
 NVSEncryptedPartition::NVSEncryptedPartition(const esp_partition_t *partition)
     : NVSPartition(partition) { }
 
+NVSEncryptedPartition::~NVSEncryptedPartition()
+{
+    delete [] mPageCache;
+}
+
 esp_err_t NVSEncryptedPartition::init(nvs_sec_cfg_t* cfg)
 {
     uint8_t* eky = reinterpret_cast<uint8_t*>(cfg);
@@ -28,37 +34,118 @@ esp_err_t NVSEncryptedPartition::init(nvs_sec_cfg_t* cfg)
         return ESP_ERR_NVS_XTS_CFG_FAILED;
     }
 
+#if CONFIG_NVS_ENCRYPTION_PAGE_CACHE
+    // the partition works without the cache if there is not enough memory for it
+    set_page_cache_enabled(true);
+#endif
+
     return ESP_OK;
 }
 
-esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
+esp_err_t NVSEncryptedPartition::set_page_cache_enabled(bool enabled)
 {
-    /** Currently upper layer of NVS reads entries one by one even for variable size
-    * multi-entry data types. So length should always be equal to size of an entry.*/
-    if (size != sizeof(Item)) return ESP_ERR_INVALID_SIZE;
-
-    // read data
-    esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
-    if (read_result != ESP_OK) {
-        return read_result;
+    mPageCacheAddr = SIZE_MAX;
+    if (!enabled) {
+        delete [] mPageCache;
+        mPageCache = nullptr;
+        return ESP_OK;
     }
 
-    // decrypt data
+    if (!mPageCache) {
+        mPageCache = new (std::nothrow) uint8_t [SPI_FLASH_SEC_SIZE];
+        if (!mPageCache) return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+int NVSEncryptedPartition::crypt_entries(mbedtls_aes_xts_context* ctx, int mode, size_t addr, uint8_t* data, size_t size)
+{
+    const size_t entrySize = sizeof(Item);
+
     //sector num required as an arr by mbedtls. Should have been just uint64/32.
     uint8_t data_unit[16];
 
-    uint32_t relAddr = src_offset;
+    /* Use relative address instead of absolute address (relocatable), so that host-generated
+     * encrypted nvs images can be used*/
+    uint32_t relAddr = addr;
 
     memset(data_unit, 0, sizeof(data_unit));
 
-    memcpy(data_unit, &relAddr, sizeof(relAddr));
+    // every entry is a separate XTS data unit, only the address part of the tweak changes between them
+    for (size_t offset = 0; offset + entrySize <= size; offset += entrySize) {
+        uint32_t entryAddr = relAddr + offset;
+        memcpy(data_unit, &entryAddr, sizeof(entryAddr));
+
+        int ret = mbedtls_aes_crypt_xts(ctx, mode, entrySize, data_unit, data + offset, data + offset);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
+{
+    if (size == 0 || size % sizeof(Item) != 0) return ESP_ERR_INVALID_SIZE;
 
     uint8_t *destination = reinterpret_cast<uint8_t*>(dst);
+    const size_t pageAddr = src_offset - src_offset % SPI_FLASH_SEC_SIZE;
+    const size_t firstEntry = (src_offset - pageAddr) / sizeof(Item);
+    const size_t entryCount = size / sizeof(Item);
+
+    if (!mPageCache || firstEntry + entryCount > PAGE_CACHE_ENTRY_COUNT) {
+        // read data
+        esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
+        if (read_result != ESP_OK) {
+            return read_result;
+        }
+
+        // decrypt data
+        if (crypt_entries(&mDctxt, MBEDTLS_AES_DECRYPT, src_offset, destination, size) != 0) {
+            return ESP_ERR_NVS_XTS_DECR_FAILED;
+        }
+        return ESP_OK;
+    }
 
-    if (mbedtls_aes_crypt_xts(&mDctxt, MBEDTLS_AES_DECRYPT, size, data_unit, destination, destination) != 0)  {
-        return ESP_ERR_NVS_XTS_DECR_FAILED;
+    if (pageAddr != mPageCacheAddr) {
+        // the whole sector is read and decrypted at once, entries of the same page are usually read together
+        mPageCacheAddr = SIZE_MAX;
+        esp_err_t read_result = esp_partition_read(mESPPartition, pageAddr, mPageCache, SPI_FLASH_SEC_SIZE);
+        if (read_result != ESP_OK) {
+            return read_result;
+        }
+        if (crypt_entries(&mDctxt, MBEDTLS_AES_DECRYPT, pageAddr, mPageCache, SPI_FLASH_SEC_SIZE) != 0) {
+            return ESP_ERR_NVS_XTS_DECR_FAILED;
+        }
+        mPageCacheAddr = pageAddr;
+        memset(mPageCacheValid, 0xff, sizeof(mPageCacheValid));
+    }
+
+    bool valid = true;
+    for (size_t i = firstEntry; i < firstEntry + entryCount; ++i) {
+        if (!(mPageCacheValid[i / 32] & (1U << (i % 32)))) {
+            valid = false;
+            break;
+        }
+    }
+
+    if (!valid) {
+        uint8_t* cached = mPageCache + (src_offset - pageAddr);
+        esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, cached, size);
+        if (read_result != ESP_OK) {
+            mPageCacheAddr = SIZE_MAX;
+            return read_result;
+        }
+        if (crypt_entries(&mDctxt, MBEDTLS_AES_DECRYPT, src_offset, cached, size) != 0) {
+            mPageCacheAddr = SIZE_MAX;
+            return ESP_ERR_NVS_XTS_DECR_FAILED;
+        }
+        for (size_t i = firstEntry; i < firstEntry + entryCount; ++i) {
+            mPageCacheValid[i / 32] |= 1U << (i % 32);
+        }
     }
 
+    memcpy(destination, mPageCache + (src_offset - pageAddr), size);
     return ESP_OK;
 }
 
@@ -74,32 +161,9 @@ esp_err_t NVSEncryptedPartition::write(size_t addr, const void* src, size_t size
     memcpy(buf, src, size);
 
     // encrypt data
-    uint8_t entrySize = sizeof(Item);
-
-    //sector num required as an arr by mbedtls. Should have been just uint64/32.
-    uint8_t data_unit[16];
-
-    /* Use relative address instead of absolute address (relocatable), so that host-generated
-     * encrypted nvs images can be used*/
-    uint32_t relAddr = addr;
-
-    memset(data_unit, 0, sizeof(data_unit));
-
-    for(uint8_t entry = 0; entry < (size/entrySize); entry++)
-    {
-        uint32_t offset = entry * entrySize;
-        uint32_t *addr_loc = (uint32_t*) &data_unit[0];
-
-        *addr_loc = relAddr + offset;
-        if (mbedtls_aes_crypt_xts(&mEctxt,
-                                  MBEDTLS_AES_ENCRYPT,
-                                  entrySize,
-                                  data_unit,
-                                  buf + offset,
-                                  buf + offset) != 0)  {
-            delete [] buf;
-            return ESP_ERR_NVS_XTS_ENCR_FAILED;
-        }
+    if (crypt_entries(&mEctxt, MBEDTLS_AES_ENCRYPT, addr, buf, size) != 0) {
+        delete [] buf;
+        return ESP_ERR_NVS_XTS_ENCR_FAILED;
     }
 
     // write data
@@ -107,7 +171,48 @@ esp_err_t NVSEncryptedPartition::write(size_t addr, const void* src, size_t size
 
     delete [] buf;
 
+    update_page_cache(addr, (result == ESP_OK) ? src : nullptr, size);
+
     return result;
 }
 
+esp_err_t NVSEncryptedPartition::write_raw(size_t dst_offset, const void* src, size_t size)
+{
+    esp_err_t result = NVSPartition::write_raw(dst_offset, src, size);
+    update_page_cache(dst_offset, nullptr, size);
+    return result;
+}
+
+esp_err_t NVSEncryptedPartition::erase_range(size_t dst_offset, size_t size)
+{
+    esp_err_t result = NVSPartition::erase_range(dst_offset, size);
+    if (mPageCacheAddr != SIZE_MAX && dst_offset < mPageCacheAddr + SPI_FLASH_SEC_SIZE && mPageCacheAddr < dst_offset + size) {
+        mPageCacheAddr = SIZE_MAX;
+    }
+    return result;
+}
+
+void NVSEncryptedPartition::update_page_cache(size_t addr, const void* plaintext, size_t size)
+{
+    if (mPageCacheAddr == SIZE_MAX || size == 0
+            || addr >= mPageCacheAddr + SPI_FLASH_SEC_SIZE || addr + size <= mPageCacheAddr) {
+        return;
+    }
+
+    if (addr < mPageCacheAddr || addr + size > mPageCacheAddr + SPI_FLASH_SEC_SIZE) {
+        mPageCacheAddr = SIZE_MAX;
+        return;
+    }
+
+    const size_t offset = addr - mPageCacheAddr;
+    if (plaintext && offset % sizeof(Item) == 0 && size % sizeof(Item) == 0) {
+        memcpy(mPageCache + offset, plaintext, size);
+        return;
+    }
+
+    for (size_t i = offset / sizeof(Item); i <= (offset + size - 1) / sizeof(Item); ++i) {
+        mPageCacheValid[i / 32] &= ~(1U << (i % 32));
+    }
+}
+
 } // nvs
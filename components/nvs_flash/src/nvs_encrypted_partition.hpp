@@ -18,6 +18,7 @@
 #include "mbedtls/aes.h"
 #include "nvs_flash.h"
 #include "nvs_partition.hpp"
+#include "nvs_types.hpp"
 
 namespace nvs {
 
@@ -25,17 +26,63 @@ class NVSEncryptedPartition : public NVSPartition {
 public:
     NVSEncryptedPartition(const esp_partition_t *partition);
 
-    virtual ~NVSEncryptedPartition() { }
+    virtual ~NVSEncryptedPartition();
 
     esp_err_t init(nvs_sec_cfg_t* cfg);
 
+    /**
+     * Enables or disables the cache of the decrypted contents of the most recently read flash sector.
+     * With the cache, reading entries of the same page again doesn't access flash and doesn't decrypt
+     * the entries again. The cache takes SPI_FLASH_SEC_SIZE bytes of heap.
+     *
+     * @return
+     *      - ESP_OK on success
+     *      - ESP_ERR_NO_MEM if the cache couldn't be allocated
+     */
+    esp_err_t set_page_cache_enabled(bool enabled);
+
+    /**
+     * Reads and decrypts one or more contiguous entries with a single flash read.
+     *
+     * @return
+     *      - ESP_OK on success
+     *      - ESP_ERR_INVALID_SIZE if size isn't a non-zero multiple of the entry size
+     *      - ESP_ERR_NVS_XTS_DECR_FAILED if decryption failed
+     *      - other error codes from the esp_partition API
+     */
     esp_err_t read(size_t src_offset, void* dst, size_t size) override;
 
     esp_err_t write(size_t dst_offset, const void* src, size_t size) override;
 
+    esp_err_t write_raw(size_t dst_offset, const void* src, size_t size) override;
+
+    esp_err_t erase_range(size_t dst_offset, size_t size) override;
+
+    bool is_encrypted() override
+    {
+        return true;
+    }
+
 protected:
+    /**
+     * Encrypts or decrypts the entries in data in place, each entry with the tweak of its address.
+     */
+    int crypt_entries(mbedtls_aes_xts_context* ctx, int mode, size_t addr, uint8_t* data, size_t size);
+
+    /**
+     * Updates the cached sector after data has been written to flash. If plaintext is nullptr (data was
+     * written raw or the write failed), the entries are marked invalid, as their decrypted contents are unknown.
+     */
+    void update_page_cache(size_t addr, const void* plaintext, size_t size);
+
     mbedtls_aes_xts_context mEctxt;
     mbedtls_aes_xts_context mDctxt;
+
+    static const size_t PAGE_CACHE_ENTRY_COUNT = SPI_FLASH_SEC_SIZE / sizeof(Item);
+
+    uint8_t* mPageCache = nullptr;
+    size_t mPageCacheAddr = SIZE_MAX;
+    uint32_t mPageCacheValid[PAGE_CACHE_ENTRY_COUNT / 32]; // bit set for each entry holding decrypted data
 };
 
 } // nvs
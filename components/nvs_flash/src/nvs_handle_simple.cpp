@@ -18,6 +18,13 @@
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    delete mTransaction;
+    if (mBlobWriter) {
+        if (valid) {
+            mStoragePtr->abortBlobWrite(*mBlobWriter);
+        }
+        delete mBlobWriter;
+    }
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
@@ -26,6 +33,9 @@ esp_err_t NVSHandleSimple::set_typed_item(ItemType datatype, const char *key, co
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
 
+    if (mTransaction) {
+        return mTransaction->add(mNsIndex, datatype, key, data, dataSize);
+    }
     return mStoragePtr->writeItem(mNsIndex, datatype, key, data, dataSize);
 }
 
@@ -41,6 +51,9 @@ esp_err_t NVSHandleSimple::set_string(const char *key, const char* str)
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
 
+    if (mTransaction) {
+        return mTransaction->add(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
+    }
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
 }
 
@@ -48,6 +61,8 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    // blobs may span several pages, they can't be part of a transaction
+    if (mTransaction) return ESP_ERR_NOT_SUPPORTED;
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::BLOB, key, blob, len);
 }
@@ -77,6 +92,7 @@ esp_err_t NVSHandleSimple::erase_item(const char* key)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mTransaction) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseItem(mNsIndex, key);
 }
@@ -85,6 +101,8 @@ esp_err_t NVSHandleSimple::erase_all()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mTransaction) return ESP_ERR_NVS_INVALID_STATE;
+    if (mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseNamespace(mNsIndex);
 }
@@ -96,6 +114,107 @@ esp_err_t NVSHandleSimple::commit()
     return ESP_OK;
 }
 
+esp_err_t NVSHandleSimple::begin_transaction()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mTransaction) return ESP_ERR_NVS_INVALID_STATE;
+    if (mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    mTransaction = new (std::nothrow) Transaction();
+    if (!mTransaction) return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::commit_transaction()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->writeTransaction(*mTransaction);
+    delete mTransaction;
+    mTransaction = nullptr;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::abort_transaction()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    delete mTransaction;
+    mTransaction = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::begin_blob_write(const char *key)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    // blobs may span several pages, they can't be part of a transaction
+    if (mTransaction) return ESP_ERR_NOT_SUPPORTED;
+    if (mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    mBlobWriter = new (std::nothrow) BlobWriter();
+    if (!mBlobWriter) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = mStoragePtr->beginBlobWrite(mNsIndex, key, *mBlobWriter);
+    if (err != ESP_OK) {
+        delete mBlobWriter;
+        mBlobWriter = nullptr;
+    }
+    return err;
+}
+
+esp_err_t NVSHandleSimple::append_blob(const void *data, size_t len)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->appendBlob(*mBlobWriter, data, len);
+    if (err != ESP_OK) {
+        // the chunks written so far are useless once a part is missing
+        mStoragePtr->abortBlobWrite(*mBlobWriter);
+        delete mBlobWriter;
+        mBlobWriter = nullptr;
+    }
+    return err;
+}
+
+esp_err_t NVSHandleSimple::finalize_blob_write()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->finalizeBlobWrite(*mBlobWriter);
+    if (err != ESP_OK) {
+        // nothing is erased if the blob index was already written
+        mStoragePtr->abortBlobWrite(*mBlobWriter);
+    }
+    delete mBlobWriter;
+    mBlobWriter = nullptr;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::abort_blob_write()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->abortBlobWrite(*mBlobWriter);
+    delete mBlobWriter;
+    mBlobWriter = nullptr;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::get_blob_at(const char *key, size_t offset, void *out_blob, size_t len)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->readBlobAt(mNsIndex, key, offset, out_blob, len);
+}
+
 esp_err_t NVSHandleSimple::get_used_entry_count(size_t& used_entries)
 {
     used_entries = 0;
@@ -16,6 +16,7 @@
 
 #include "intrusive_list.h"
 #include "nvs_storage.hpp"
+#include "nvs_transaction.hpp"
 #include "nvs_platform.hpp"
 
 #include "nvs_handle.hpp"
@@ -37,7 +38,9 @@ public:
         mStoragePtr(StoragePtr),
         mNsIndex(nsIndex),
         mReadOnly(readOnly),
-        valid(1)
+        valid(1),
+        mTransaction(nullptr),
+        mBlobWriter(nullptr)
     { }
 
     ~NVSHandleSimple();
@@ -62,6 +65,22 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t begin_transaction();
+
+    esp_err_t commit_transaction();
+
+    esp_err_t abort_transaction();
+
+    esp_err_t begin_blob_write(const char *key);
+
+    esp_err_t append_blob(const void *data, size_t len);
+
+    esp_err_t finalize_blob_write();
+
+    esp_err_t abort_blob_write();
+
+    esp_err_t get_blob_at(const char *key, size_t offset, void *out_blob, size_t len);
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
@@ -100,6 +119,16 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Items staged by the open transaction, nullptr if no transaction is open.
+     */
+    Transaction *mTransaction;
+
+    /**
+     * State of the blob which is being written in parts, nullptr if no blob write is open.
+     */
+    BlobWriter *mBlobWriter;
 };
 
 } // nvs
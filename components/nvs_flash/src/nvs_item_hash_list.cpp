@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include "nvs_item_hash_list.hpp"
 
 namespace nvs
@@ -19,16 +20,29 @@ namespace nvs
 
 HashList::HashList()
 {
+    memset(mSpan, 0, sizeof(mSpan));
+}
+
+void HashList::setItemIndex(ItemIndex* itemIndex, Page* page)
+{
+    mItemIndex = itemIndex;
+    mPage = page;
 }
 
 void HashList::clear()
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        auto tmp = it;
-        ++it;
-        mBlockList.erase(tmp);
-        delete static_cast<HashListBlock*>(tmp);
+    for (size_t slot = 0; slot < CAPACITY; ++slot) {
+        HashListNode& node = mNodes[slot];
+        if (node.mIndex != 0xff) {
+            if (mItemIndex) {
+                mItemIndex->erase(node.mHash, mPage);
+                mItemIndex->removeNamespaceEntries(mNsIndex[node.mIndex], mSpan[node.mIndex]);
+            }
+            mSpan[node.mIndex] = 0;
+            node = HashListNode();
+        }
     }
+    mCount = 0;
 }
 
 HashList::~HashList()
@@ -36,88 +50,100 @@ HashList::~HashList()
     clear();
 }
 
-HashList::HashListBlock::HashListBlock()
+esp_err_t HashList::insert(const Item& item, size_t index)
 {
-    static_assert(sizeof(HashListBlock) == HashListBlock::BYTE_SIZE,
-                  "cache block size calculation incorrect");
+    NVS_ASSERT_OR_RETURN(index < MAX_ENTRY_COUNT, ESP_FAIL);
+
+    // an entry index can only hold one item, so there is always a free slot
+    erase(index);
+
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    size_t slot = slotOf(hash_24);
+    while (mNodes[slot].mIndex != 0xff) {
+        slot = nextSlot(slot);
+    }
+    mNodes[slot] = HashListNode(hash_24, index);
+    mNsIndex[index] = item.nsIndex;
+    mSpan[index] = item.span;
+    ++mCount;
+
+    if (mItemIndex) {
+        mItemIndex->insert(hash_24, mPage);
+        mItemIndex->addNamespaceEntries(item.nsIndex, item.span);
+    }
+    return ESP_OK;
 }
 
-esp_err_t HashList::insert(const Item& item, size_t index)
+void HashList::removeSlot(size_t slot)
 {
-    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    // add entry to the end of last block if possible
-    if (mBlockList.size()) {
-        auto& block = mBlockList.back();
-        if (block.mCount < HashListBlock::ENTRY_COUNT) {
-            block.mNodes[block.mCount++] = HashListNode(hash_24, index);
-            return ESP_OK;
+    // backward shift deletion, so that no tombstones are needed. The loop ends
+    // at the latest when it gets back to the hole, which is free.
+    size_t hole = slot;
+    mNodes[hole] = HashListNode();
+    for (size_t next = nextSlot(hole); mNodes[next].mIndex != 0xff; next = nextSlot(next)) {
+        HashListNode& node = mNodes[next];
+        size_t home = slotOf(node.mHash);
+        // node can't be moved if its home slot is cyclically within (hole, next]
+        bool inRange = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!inRange) {
+            mNodes[hole] = node;
+            node = HashListNode();
+            hole = next;
         }
     }
-    // if the above failed, create a new block and add entry to it
-    HashListBlock* newBlock = new (std::nothrow) HashListBlock;
+}
 
-    if (!newBlock) return ESP_ERR_NO_MEM;
+bool HashList::erase(size_t index)
+{
+    if (index >= MAX_ENTRY_COUNT || mSpan[index] == 0) {
+        // item hasn't been present in cache
+        return false;
+    }
 
-    mBlockList.push_back(newBlock);
-    newBlock->mNodes[0] = HashListNode(hash_24, index);
-    newBlock->mCount++;
+    // the table is small, looking for the slot of the entry takes less than the flash write erasing it
+    size_t slot = 0;
+    while (mNodes[slot].mIndex != index) {
+        ++slot;
+    }
+    if (mItemIndex) {
+        mItemIndex->erase(mNodes[slot].mHash, mPage);
+        mItemIndex->removeNamespaceEntries(mNsIndex[index], mSpan[index]);
+    }
+    mSpan[index] = 0;
+    removeSlot(slot);
+    --mCount;
+    return true;
+}
 
-    return ESP_OK;
+size_t HashList::find(size_t start, const Item& item)
+{
+    return find(start, item.calculateCrc32WithoutValue());
 }
 
-bool HashList::erase(size_t index)
+size_t HashList::find(size_t start, uint32_t hash) const
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        bool haveEntries = false;
-        bool foundIndex = false;
-        for (size_t i = 0; i < it->mCount; ++i) {
-            if (it->mNodes[i].mIndex == index) {
-                it->mNodes[i].mIndex = 0xff;
-                foundIndex = true;
-                /* found the item and removed it */
-            }
-            if (it->mNodes[i].mIndex != 0xff) {
-                haveEntries = true;
-            }
-            if (haveEntries && foundIndex) {
-                /* item was found, and HashListBlock still has some items */
-                return true;
-            }
-        }
-        /* no items left in HashListBlock, can remove */
-        if (!haveEntries) {
-            auto tmp = it;
-            ++it;
-            mBlockList.erase(tmp);
-            delete static_cast<HashListBlock*>(tmp);
-        } else {
-            ++it;
-        }
-        if (foundIndex) {
-            /* item was found and empty HashListBlock was removed */
-            return true;
+    // all nodes with this hash are in the probe sequence starting at its home slot,
+    // return the lowest entry index so that the page can scan forward from there
+    const uint32_t hash_24 = hash & 0xffffff;
+    size_t result = SIZE_MAX;
+    size_t slot = slotOf(hash_24);
+    for (size_t i = 0; i < CAPACITY && mNodes[slot].mIndex != 0xff; ++i, slot = nextSlot(slot)) {
+        const HashListNode& e = mNodes[slot];
+        if (e.mHash == hash_24 && e.mIndex >= start && e.mIndex < result) {
+            result = e.mIndex;
         }
     }
-
-    // item hasn't been present in cache");
-    return false;
+    return result;
 }
 
-size_t HashList::find(size_t start, const Item& item)
+size_t HashList::findNamespace(size_t start, uint8_t nsIndex) const
 {
-    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
-        for (size_t index = 0; index < it->mCount; ++index) {
-            HashListNode& e = it->mNodes[index];
-            if (e.mIndex >= start &&
-                    e.mHash == hash_24 &&
-                    e.mIndex != 0xff) {
-                return e.mIndex;
-            }
+    for (size_t index = start; index < MAX_ENTRY_COUNT; ++index) {
+        if (mSpan[index] != 0 && mNsIndex[index] == nsIndex) {
+            return index;
         }
     }
     return SIZE_MAX;
 }
 
-
 } // namespace nvs
@@ -17,11 +17,20 @@
 
 #include "nvs.h"
 #include "nvs_types.hpp"
-#include "intrusive_list.h"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
 
+/**
+ * Per-page table of item hashes (namespace index, key and chunk index), used to find the entry
+ * of an item without reading the whole page. The namespace and span of each item are kept as well,
+ * so that the items of one namespace can be found without reading the others.
+ *
+ * The table uses open addressing with linear probing. Since a page can't hold more than
+ * MAX_ENTRY_COUNT items, it has one slot per entry and is part of the page object, so that no
+ * memory is allocated when items are added.
+ */
 class HashList
 {
 public:
@@ -31,8 +40,39 @@ public:
     esp_err_t insert(const Item& item, size_t index);
     bool erase(const size_t index);
     size_t find(size_t start, const Item& item);
+
+    /**
+     * Same as above, for a hash already computed with Item::calculateCrc32WithoutValue.
+     */
+    size_t find(size_t start, uint32_t hash) const;
+
+    /**
+     * Returns the lowest entry index at or after start which holds an item of the given namespace,
+     * or SIZE_MAX if there is none. Only RAM is accessed.
+     */
+    size_t findNamespace(size_t start, uint8_t nsIndex) const;
     void clear();
 
+    /**
+     * Mirrors all hashes of this list into a partition-wide index, on behalf of the given page.
+     */
+    void setItemIndex(ItemIndex* itemIndex, Page* page);
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Returns the number of bytes of RAM used by the table, which doesn't depend on the number of items.
+     */
+    size_t getMemoryUsage() const
+    {
+        return sizeof(mNodes) + sizeof(mNsIndex) + sizeof(mSpan);
+    }
+
+    static const size_t MAX_ENTRY_COUNT = 126;
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
@@ -54,18 +94,27 @@ protected:
         uint32_t mHash  : 24;
     };
 
-    struct HashListBlock : public intrusive_list_node<HashList::HashListBlock> {
-        HashListBlock();
+    // the table is full when a page holds MAX_ENTRY_COUNT items of one entry each
+    static const size_t CAPACITY = MAX_ENTRY_COUNT;
 
-        static const size_t BYTE_SIZE = 128;
-        static const size_t ENTRY_COUNT = (BYTE_SIZE - sizeof(intrusive_list_node<HashListBlock>) - sizeof(size_t)) / 4;
+    static size_t slotOf(uint32_t hash)
+    {
+        return hash % CAPACITY;
+    }
 
-        size_t mCount = 0;
-        HashListNode mNodes[ENTRY_COUNT];
-    };
+    static size_t nextSlot(size_t slot)
+    {
+        return (slot + 1 < CAPACITY) ? slot + 1 : 0;
+    }
+
+    void removeSlot(size_t slot);
 
-    typedef intrusive_list<HashListBlock> TBlockList;
-    TBlockList mBlockList;
+    HashListNode mNodes[CAPACITY];
+    uint8_t mNsIndex[MAX_ENTRY_COUNT]; // namespace of the item at each entry index
+    uint8_t mSpan[MAX_ENTRY_COUNT]; // span of the item at each entry index, 0 if there is none
+    size_t mCount = 0;
+    ItemIndex* mItemIndex = nullptr;
+    Page* mPage = nullptr;
 }; // class HashList
 
 } // namespace nvs
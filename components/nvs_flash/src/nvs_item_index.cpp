@@ -0,0 +1,171 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_item_index.hpp"
+#include <new>
+#include <algorithm>
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    delete[] mNodes;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mSize = 0;
+    mValid = true;
+    std::fill_n(mNamespaceEntries, sizeof(mNamespaceEntries) / sizeof(mNamespaceEntries[0]), 0);
+}
+
+void ItemIndex::invalidate()
+{
+    // the namespace counts are kept
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mSize = 0;
+    mValid = false;
+}
+
+bool ItemIndex::grow()
+{
+    size_t newCapacity = (mCapacity == 0) ? INITIAL_CAPACITY : mCapacity * 2;
+    Node* newNodes = new (std::nothrow) Node[newCapacity];
+    if (!newNodes) {
+        return false;
+    }
+    for (size_t i = 0; i < newCapacity; ++i) {
+        newNodes[i].mPage = nullptr;
+    }
+
+    Node* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+    mNodes = newNodes;
+    mCapacity = newCapacity;
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mPage == nullptr) {
+            continue;
+        }
+        size_t pos = bucketOf(oldNodes[i].mHash);
+        while (mNodes[pos].mPage != nullptr) {
+            pos = (pos + 1) & (mCapacity - 1);
+        }
+        mNodes[pos] = oldNodes[i];
+    }
+    delete[] oldNodes;
+    return true;
+}
+
+void ItemIndex::insert(uint32_t hash, Page* page)
+{
+    if (!mValid) {
+        return;
+    }
+    hash &= 0xffffff;
+
+    if (mCapacity != 0) {
+        for (size_t pos = bucketOf(hash); mNodes[pos].mPage != nullptr; pos = (pos + 1) & (mCapacity - 1)) {
+            Node& node = mNodes[pos];
+            if (node.mHash == hash && node.mPage == page) {
+                if (node.mCount == 0xff) {
+                    // can't happen with 126 entries per page, but don't wrap around silently
+                    invalidate();
+                    return;
+                }
+                ++node.mCount;
+                return;
+            }
+        }
+    }
+
+    // keep load factor below 3/4, so probe sequences stay short
+    if ((mSize + 1) * 4 > mCapacity * 3) {
+        if (!grow()) {
+            invalidate();
+            return;
+        }
+    }
+
+    size_t pos = bucketOf(hash);
+    while (mNodes[pos].mPage != nullptr) {
+        pos = (pos + 1) & (mCapacity - 1);
+    }
+    mNodes[pos].mHash = hash;
+    mNodes[pos].mCount = 1;
+    mNodes[pos].mPage = page;
+    ++mSize;
+}
+
+void ItemIndex::removeAt(size_t pos)
+{
+    // backward shift deletion: move following nodes of the same probe sequence into the hole
+    const size_t mask = mCapacity - 1;
+    size_t hole = pos;
+    size_t next = pos;
+    while (true) {
+        next = (next + 1) & mask;
+        if (mNodes[next].mPage == nullptr) {
+            break;
+        }
+        size_t home = bucketOf(mNodes[next].mHash);
+        // node may be moved if its home bucket is not cyclically within (hole, next]
+        bool inRange = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!inRange) {
+            mNodes[hole] = mNodes[next];
+            hole = next;
+        }
+    }
+    mNodes[hole].mPage = nullptr;
+    --mSize;
+}
+
+void ItemIndex::erase(uint32_t hash, Page* page)
+{
+    if (!mValid || mCapacity == 0) {
+        return;
+    }
+    hash &= 0xffffff;
+
+    for (size_t pos = bucketOf(hash); mNodes[pos].mPage != nullptr; pos = (pos + 1) & (mCapacity - 1)) {
+        Node& node = mNodes[pos];
+        if (node.mHash == hash && node.mPage == page) {
+            if (--node.mCount == 0) {
+                removeAt(pos);
+            }
+            return;
+        }
+    }
+}
+
+size_t ItemIndex::find(uint32_t hash, Page** pages, size_t maxCount) const
+{
+    if (mCapacity == 0) {
+        return 0;
+    }
+    hash &= 0xffffff;
+
+    size_t count = 0;
+    for (size_t pos = bucketOf(hash); mNodes[pos].mPage != nullptr; pos = (pos + 1) & (mCapacity - 1)) {
+        if (mNodes[pos].mHash == hash) {
+            if (count < maxCount) {
+                pages[count] = mNodes[pos].mPage;
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // namespace nvs
@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_item_index_h
+#define nvs_item_index_h
+
+#include <cstdint>
+#include <cstddef>
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index which maps the 24-bit item hash used by HashList (namespace index, key and
+ * chunk index) to the pages holding a matching item. It lets Storage go straight to the candidate
+ * pages instead of asking every page of the partition.
+ *
+ * The index may report pages which don't hold the item any more (hash collisions, items which
+ * failed to be written), but it never misses a page which does. Each (hash, page) pair is
+ * reference counted, since a page may contain several items with the same hash.
+ *
+ * If memory can't be allocated while growing, the index invalidates itself and callers fall back
+ * to walking all pages. It becomes valid again after the next clear().
+ *
+ * The index also counts the entries used by the items of each namespace. The counts don't need
+ * any allocation and stay exact when the index is invalid.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    void insert(uint32_t hash, Page* page);
+    void erase(uint32_t hash, Page* page);
+
+    /**
+     * Collects up to maxCount pages which may contain an item with the given hash.
+     * Returns the total number of candidate pages, which may be larger than maxCount.
+     */
+    size_t find(uint32_t hash, Page** pages, size_t maxCount) const;
+
+    void clear();
+
+    void addNamespaceEntries(uint8_t nsIndex, size_t span)
+    {
+        mNamespaceEntries[nsIndex] += span;
+    }
+
+    void removeNamespaceEntries(uint8_t nsIndex, size_t span)
+    {
+        mNamespaceEntries[nsIndex] -= (span < mNamespaceEntries[nsIndex]) ? span : mNamespaceEntries[nsIndex];
+    }
+
+    /**
+     * Returns the number of entries used by the items of the given namespace.
+     */
+    size_t getNamespaceEntryCount(uint8_t nsIndex) const
+    {
+        return mNamespaceEntries[nsIndex];
+    }
+
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    /**
+     * Returns the number of bytes of heap used by the index.
+     */
+    size_t getMemoryUsage() const
+    {
+        return mCapacity * sizeof(Node);
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+    struct Node {
+        uint32_t mHash  : 24;
+        uint32_t mCount : 8;
+        Page* mPage;
+    };
+
+    static const size_t INITIAL_CAPACITY = 64;
+
+    size_t bucketOf(uint32_t hash) const
+    {
+        // hash is a CRC, its low bits are distributed well enough
+        return hash & (mCapacity - 1);
+    }
+
+    bool grow();
+    void invalidate();
+    void removeAt(size_t pos);
+
+    Node* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mSize = 0;
+    bool mValid = true;
+    uint32_t mNamespaceEntries[256] = {};
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_h */
@@ -12,6 +12,8 @@
 namespace nvs
 {
 
+const char Page::TXN_RECORD_KEY[] = "nvs.txn";
+
 Page::Page() : mPartition(nullptr) { }
 
 uint32_t Page::Header::calculateCrc32()
@@ -21,7 +23,7 @@ uint32_t Page::Header::calculateCrc32()
                     offsetof(Header, mCrc32) - offsetof(Header, mSeqNumber));
 }
 
-esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
+esp_err_t Page::load(Partition *partition, uint32_t sectorNumber, uint8_t* pageBuffer, bool deferItemCrcCheck)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -33,12 +35,26 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     mErasedEntryCount = 0;
 
     Header header;
-    auto rc = mPartition->read_raw(mBaseAddress, &header, sizeof(header));
+    esp_err_t rc;
+    if (pageBuffer) {
+        rc = mPartition->read_raw(mBaseAddress, pageBuffer, SEC_SIZE);
+        if (rc == ESP_OK) {
+            memcpy(&header, pageBuffer + HEADER_OFFSET, sizeof(header));
+        }
+    } else {
+        rc = mPartition->read_raw(mBaseAddress, &header, sizeof(header));
+    }
     if (rc != ESP_OK) {
         mState = PageState::INVALID;
         return rc;
     }
-    if (header.mState == PageState::UNINITIALIZED) {
+    if (header.mState == PageState::UNINITIALIZED && pageBuffer) {
+        mState = header.mState;
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(pageBuffer);
+        if (std::any_of(words, words + SEC_SIZE / sizeof(uint32_t), [](uint32_t val) -> bool { return val != 0xffffffff; })) {
+            mState = PageState::CORRUPT;
+        }
+    } else if (header.mState == PageState::UNINITIALIZED) {
         mState = header.mState;
         // check if the whole page is really empty
         // reading the whole page takes ~40 times less than erasing it
@@ -80,7 +96,7 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     case PageState::FULL:
     case PageState::ACTIVE:
     case PageState::FREEING:
-        return mLoadEntryTable();
+        return mLoadEntryTable(pageBuffer, deferItemCrcCheck);
         break;
 
     default:
@@ -272,6 +288,100 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+esp_err_t Page::writeTransaction(const Item* entries, size_t count, size_t& itemIndex)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    NVS_ASSERT_OR_RETURN(count > 0, ESP_FAIL);
+
+    // items and both records must fit into this page
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + count + 2 > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    Item record(TXN_NS_INDEX, ItemType::U32, 1, TXN_RECORD_KEY, TXN_BEGIN_CHUNK);
+    const uint32_t entryCount = count;
+    memcpy(record.data, &entryCount, sizeof(entryCount));
+    record.crc32 = record.calculateCrc32();
+    const size_t beginIndex = mNextFreeEntry;
+    err = mHashList.insert(record, beginIndex);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = writeEntry(record);
+    if (err != ESP_OK) {
+        abortTransaction(beginIndex, count);
+        return err;
+    }
+
+    // one flash write for all items, followed by the entry state table words covering them
+    itemIndex = mNextFreeEntry;
+    err = writeEntryData(reinterpret_cast<const uint8_t*>(entries), count * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        abortTransaction(beginIndex, count);
+        return err;
+    }
+    for (size_t i = 0; i < count; i += entries[i].span) {
+        err = mHashList.insert(entries[i], itemIndex + i);
+        if (err != ESP_OK) {
+            abortTransaction(beginIndex, count);
+            return err;
+        }
+    }
+
+    // the transaction is committed once the state of the commit record is written
+    record.chunkIndex = TXN_COMMIT_CHUNK;
+    record.crc32 = record.calculateCrc32();
+    err = mHashList.insert(record, mNextFreeEntry);
+    if (err != ESP_OK) {
+        abortTransaction(beginIndex, count);
+        return err;
+    }
+    err = writeEntry(record);
+    if (err != ESP_OK) {
+        abortTransaction(beginIndex, count);
+        return err;
+    }
+    return ESP_OK;
+}
+
+void Page::abortTransaction(size_t beginIndex, size_t count)
+{
+    // Entries written after the begin record would be erased with the transaction by rollbackTransaction()
+    // when the page is loaded, so the place of the commit record must not be used by another item either.
+    // The slots from the begin record up to the commit record were empty before the transaction.
+    const size_t end = beginIndex + count + 2;
+    for (size_t i = beginIndex; i < end; ++i) {
+        mHashList.erase(i);
+    }
+    if (alterEntryRangeState(beginIndex, end, EntryState::ERASED) != ESP_OK) {
+        // items of the transaction could be found once the page is loaded again
+        mState = PageState::INVALID;
+        return;
+    }
+    mUsedEntryCount -= mNextFreeEntry - beginIndex;
+    mErasedEntryCount += end - beginIndex;
+    mNextFreeEntry = end;
+    if (beginIndex == mFirstUsedEntry) {
+        updateFirstUsedEntry(beginIndex, end - beginIndex);
+    }
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -301,7 +411,17 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
 
     uint8_t* dst = reinterpret_cast<uint8_t*>(data);
     size_t left = item.varLength.dataSize;
-    for (size_t i = index + 1; i < index + item.span; ++i) {
+    // entries which fit into data completely are read at once, only the last one goes through a copy
+    size_t fullEntries = std::min(left / ENTRY_SIZE, static_cast<size_t>(item.span - 1));
+    if (fullEntries > 0) {
+        rc = readEntries(index + 1, dst, fullEntries);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        left -= fullEntries * ENTRY_SIZE;
+        dst += fullEntries * ENTRY_SIZE;
+    }
+    for (size_t i = index + 1 + fullEntries; i < index + item.span; ++i) {
         Item ditem;
         rc = readEntry(i, ditem);
         if (rc != ESP_OK) {
@@ -323,6 +443,62 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
     return ESP_OK;
 }
 
+esp_err_t Page::readItemPart(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t dataSize, uint8_t chunkIdx)
+{
+    size_t index = 0;
+    Item item;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    NVS_ASSERT_OR_RETURN(isVariableLengthType(datatype), ESP_ERR_NVS_TYPE_MISMATCH);
+
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    if (offset > item.varLength.dataSize || dataSize > item.varLength.dataSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    // entries are read in small batches, the crc is updated as they go
+    const size_t batchEntries = 8;
+    Item entries[batchEntries];
+    uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+    size_t left = item.varLength.dataSize;
+    size_t pos = 0;
+    uint32_t crc32 = 0xffffffff;
+    for (size_t i = index + 1; i < index + item.span; i += batchEntries) {
+        size_t count = std::min(batchEntries, index + item.span - i);
+        rc = readEntries(i, entries, count);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(entries);
+        size_t willCopy = std::min(count * ENTRY_SIZE, left);
+        crc32 = esp_rom_crc32_le(crc32, src, willCopy);
+
+        // copy the part of these entries which overlaps [offset, offset + dataSize)
+        size_t from = std::max(pos, offset);
+        size_t to = std::min(pos + willCopy, offset + dataSize);
+        if (from < to) {
+            memcpy(dst + (from - offset), src + (from - pos), to - from);
+        }
+        left -= willCopy;
+        pos += willCopy;
+    }
+    if (crc32 != item.varLength.dataCrc32) {
+        rc = eraseEntryAndSpan(index);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -386,6 +562,11 @@ esp_err_t Page::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, u
     return eraseEntryAndSpan(index);
 }
 
+esp_err_t Page::eraseItemAt(size_t index)
+{
+    return eraseEntryAndSpan(index);
+}
+
 esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -518,47 +699,209 @@ esp_err_t Page::copyItems(Page& other)
             return err;
         }
 
-        err = other.mHashList.insert(entry, other.mNextFreeEntry);
+        if (entry.crc32 == entry.calculateCrc32() && isTransactionRecord(entry, TXN_BEGIN_CHUNK)) {
+            err = copyTransaction(readEntryIndex, entry, other, readEntryIndex);
+            if (err != ESP_OK) {
+                return err;
+            }
+            continue;
+        }
+
+        err = copyItem(readEntryIndex, entry, other);
         if (err != ESP_OK) {
             return err;
         }
+        readEntryIndex += entry.span;
 
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::copyItem(size_t index, const Item& item, Page& other)
+{
+    NVS_ASSERT_OR_RETURN(index + item.span <= ENTRY_COUNT, ESP_FAIL);
+
+    esp_err_t err = other.mHashList.insert(item, other.mNextFreeEntry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = other.writeEntry(item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t i = index + 1; i < index + item.span; ++i) {
+        Item entry;
+        err = readEntry(i, entry);
+        if (err != ESP_OK) {
+            return err;
+        }
         err = other.writeEntry(entry);
         if (err != ESP_OK) {
             return err;
         }
-        size_t span = entry.span;
-        size_t end = readEntryIndex + span;
+    }
+    return ESP_OK;
+}
 
-        NVS_ASSERT_OR_RETURN(end <= ENTRY_COUNT, ESP_FAIL);
+esp_err_t Page::copyTransaction(size_t index, const Item& record, Page& other, size_t& end)
+{
+    size_t commitIndex;
+    bool committed;
+    esp_err_t err = findTransactionCommit(index, record, commitIndex, committed);
+    if (err != ESP_OK) {
+        return err;
+    }
+    end = std::min(commitIndex + 1, static_cast<size_t>(ENTRY_COUNT));
+    if (!committed) {
+        // load() rolls back a transaction which wasn't committed, none of it is kept
+        return ESP_OK;
+    }
+
+    // Items which were erased since the commit are left out. The records are renumbered, so that they
+    // still enclose exactly the items of the transaction on the other page.
+    uint32_t count = 0;
+    EntryState state;
+    Item item;
+    for (size_t i = index + 1; i < commitIndex; ) {
+        err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (state != EntryState::WRITTEN) {
+            ++i;
+            continue;
+        }
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        const size_t span = (item.crc32 == item.calculateCrc32()) ? item.span : 1;
+        count += span;
+        i += span;
+    }
+    if (other.mNextFreeEntry == INVALID_ENTRY || other.mNextFreeEntry + count + 2 > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    Item copy = record;
+    memcpy(copy.data, &count, sizeof(count));
+    copy.crc32 = copy.calculateCrc32();
+    err = copyItem(index, copy, other);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t i = index + 1; i < commitIndex; ) {
+        err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (state != EntryState::WRITTEN) {
+            ++i;
+            continue;
+        }
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (item.crc32 != item.calculateCrc32()) {
+            // copied as it is, like copyItems does, load() erases it
+            err = other.writeEntry(item);
+            ++i;
+        } else {
+            err = copyItem(i, item, other);
+            i += item.span;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    copy.chunkIndex = TXN_COMMIT_CHUNK;
+    copy.crc32 = copy.calculateCrc32();
+    return copyItem(commitIndex, copy, other);
+}
 
-        for (size_t i = readEntryIndex + 1; i < end; ++i) {
-            readEntry(i, entry);
-            err = other.writeEntry(entry);
+esp_err_t Page::moveItem(size_t index, const Item& item, Page& other, size_t& span)
+{
+    if (other.mState == PageState::UNINITIALIZED) {
+        auto err = other.initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (other.mState != PageState::ACTIVE) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    esp_err_t err;
+    if (isTransactionRecord(item, TXN_BEGIN_CHUNK)) {
+        size_t end;
+        err = copyTransaction(index, item, other, end);
+        if (err != ESP_OK) {
+            return err;
+        }
+        // the begin record is erased first, a commit record without it is erased by Storage::init
+        for (size_t i = index; i < end; ) {
+            EntryState state;
+            err = mEntryTable.get(i, &state);
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (state != EntryState::WRITTEN) {
+                ++i;
+                continue;
+            }
+            Item entry;
+            err = readEntry(i, entry);
+            if (err != ESP_OK) {
+                return err;
+            }
+            err = eraseEntryAndSpan(i);
             if (err != ESP_OK) {
                 return err;
             }
+            i += (entry.crc32 == entry.calculateCrc32()) ? entry.span : 1;
         }
-        readEntryIndex = end;
+        span = end - index;
+        return ESP_OK;
+    }
 
+    if (other.mNextFreeEntry + item.span > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
     }
-    return ESP_OK;
+    err = copyItem(index, item, other);
+    if (err != ESP_OK) {
+        return err;
+    }
+    span = item.span;
+    return eraseEntryAndSpan(index);
 }
 
-esp_err_t Page::mLoadEntryTable()
+esp_err_t Page::mLoadEntryTable(const uint8_t* pageBuffer, bool deferItemCrcCheck)
 {
+    mHasUncheckedItems = false;
+
     // for states where we actually care about data in the page, read entry state table
     if (mState == PageState::ACTIVE ||
             mState == PageState::FULL ||
             mState == PageState::FREEING) {
-        auto rc = mPartition->read_raw(mBaseAddress + ENTRY_TABLE_OFFSET, mEntryTable.data(),
-                                 mEntryTable.byteSize());
-        if (rc != ESP_OK) {
-            mState = PageState::INVALID;
-            return rc;
+        if (pageBuffer) {
+            memcpy(mEntryTable.data(), pageBuffer + ENTRY_TABLE_OFFSET, mEntryTable.byteSize());
+        } else {
+            auto rc = mPartition->read_raw(mBaseAddress + ENTRY_TABLE_OFFSET, mEntryTable.data(),
+                                     mEntryTable.byteSize());
+            if (rc != ESP_OK) {
+                mState = PageState::INVALID;
+                return rc;
+            }
         }
     }
 
+    // raw contents of encrypted entries can't be used, they are read through the partition which decrypts them
+    const uint8_t* loadedEntries = nullptr;
+    if (pageBuffer && !mPartition->is_encrypted()) {
+        loadedEntries = pageBuffer + ENTRY_DATA_OFFSET;
+    }
+
     EntryState state;
     esp_err_t err;
     mErasedEntryCount = 0;
@@ -603,7 +946,12 @@ esp_err_t Page::mLoadEntryTable()
                 return err;
             }
             uint32_t header;
-            auto rc = mPartition->read_raw(entryAddress, &header, sizeof(header));
+            esp_err_t rc = ESP_OK;
+            if (pageBuffer) {
+                memcpy(&header, pageBuffer + (entryAddress - mBaseAddress), sizeof(header));
+            } else {
+                rc = mPartition->read_raw(entryAddress, &header, sizeof(header));
+            }
             if (rc != ESP_OK) {
                 mState = PageState::INVALID;
                 return rc;
@@ -661,7 +1009,7 @@ esp_err_t Page::mLoadEntryTable()
 
             lastItemIndex = i;
 
-            auto err = readEntry(i, item);
+            auto err = readEntry(i, item, loadedEntries);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
@@ -676,6 +1024,21 @@ esp_err_t Page::mLoadEntryTable()
                 continue;
             }
 
+            // items of an interrupted transaction must be gone before they are checked for duplicates,
+            // otherwise the values they were meant to replace would be erased
+            if (isTransactionRecord(item, TXN_BEGIN_CHUNK)) {
+                bool rolledBack;
+                err = rollbackTransaction(i, item, rolledBack);
+                if (err != ESP_OK) {
+                    mState = PageState::INVALID;
+                    return err;
+                }
+                if (rolledBack) {
+                    lastItemIndex = INVALID_ENTRY;
+                    continue;
+                }
+            }
+
             err = mHashList.insert(item, i);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
@@ -741,13 +1104,16 @@ esp_err_t Page::mLoadEntryTable()
                 continue;
             }
 
-            err = readEntry(i, item);
+            err = readEntry(i, item, loadedEntries);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
             }
 
-            if (item.crc32 != item.calculateCrc32()) {
+            // if checking is deferred, findItem verifies the CRC of single entry items on first access,
+            // the CRC of longer items is always checked as their span is needed to find the next item
+            bool checkCrc = !deferItemCrcCheck || item.span != 1 || isVariableLengthType(item.datatype);
+            if (checkCrc && item.crc32 != item.calculateCrc32()) {
                 err = eraseEntryAndSpan(i);
                 if (err != ESP_OK) {
                     mState = PageState::INVALID;
@@ -763,6 +1129,7 @@ esp_err_t Page::mLoadEntryTable()
                 mState = PageState::INVALID;
                 return err;
             }
+            mHasUncheckedItems |= !checkCrc;
 
             size_t span = item.span;
 
@@ -788,6 +1155,154 @@ esp_err_t Page::mLoadEntryTable()
 }
 
 
+esp_err_t Page::checkDeferredItems()
+{
+    if (!mHasUncheckedItems) {
+        return ESP_OK;
+    }
+
+    Item item;
+    EntryState state;
+    for (size_t i = mFirstUsedEntry; i < ENTRY_COUNT; ++i) {
+        auto err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (state != EntryState::WRITTEN) {
+            continue;
+        }
+
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
+
+        // removes the item from the hash list, and so from the item index and namespace counts
+        if (item.crc32 != item.calculateCrc32()) {
+            err = eraseEntryAndSpan(i);
+            if (err != ESP_OK) {
+                mState = PageState::INVALID;
+                return err;
+            }
+            continue;
+        }
+
+        NVS_ASSERT_OR_RETURN(item.span > 0, ESP_FAIL);
+        i += item.span - 1;
+    }
+    mHasUncheckedItems = false;
+    return ESP_OK;
+}
+
+bool Page::isTransactionRecord(const Item& item, uint8_t chunkIdx)
+{
+    return item.nsIndex == TXN_NS_INDEX && item.datatype == ItemType::U32 && item.chunkIndex == chunkIdx
+            && strncmp(item.key, TXN_RECORD_KEY, Item::MAX_KEY_LENGTH) == 0;
+}
+
+esp_err_t Page::isTransactionRecordAt(size_t index, uint8_t chunkIdx, uint32_t count, bool& found) const
+{
+    found = false;
+    EntryState state;
+    esp_err_t err = mEntryTable.get(index, &state);
+    if (err != ESP_OK || state != EntryState::WRITTEN) {
+        return err;
+    }
+    Item item;
+    err = readEntry(index, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t value;
+    memcpy(&value, item.data, sizeof(value));
+    found = item.crc32 == item.calculateCrc32() && isTransactionRecord(item, chunkIdx) && value == count;
+    return ESP_OK;
+}
+
+esp_err_t Page::findTransactionCommit(size_t index, const Item& record, size_t& commitIndex, bool& committed) const
+{
+    uint32_t count;
+    memcpy(&count, record.data, sizeof(count));
+    if (count > ENTRY_COUNT) {
+        count = ENTRY_COUNT;
+    }
+    commitIndex = index + 1 + count;
+    committed = false;
+    if (commitIndex >= ENTRY_COUNT) {
+        return ESP_OK;
+    }
+    return isTransactionRecordAt(commitIndex, TXN_COMMIT_CHUNK, count, committed);
+}
+
+esp_err_t Page::findTransactionBegin(size_t commitIndex, const Item& commit, size_t& beginIndex)
+{
+    uint32_t count;
+    memcpy(&count, commit.data, sizeof(count));
+    if (count >= commitIndex) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    bool found;
+    auto err = isTransactionRecordAt(commitIndex - count - 1, TXN_BEGIN_CHUNK, count, found);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!found) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    beginIndex = commitIndex - count - 1;
+    return ESP_OK;
+}
+
+esp_err_t Page::rollbackTransaction(size_t index, const Item& record, bool& rolledBack)
+{
+    rolledBack = false;
+
+    size_t commitIndex;
+    bool committed;
+    esp_err_t err = findTransactionCommit(index, record, commitIndex, committed);
+    if (err != ESP_OK || committed) {
+        return err;
+    }
+
+    // power went out before the transaction was committed. Nothing but the transaction was written
+    // after the begin record, so erase everything up to and including the place of the commit record.
+    size_t end = commitIndex + 1;
+    if (end > ENTRY_COUNT) {
+        end = ENTRY_COUNT;
+    }
+    EntryState state;
+    for (size_t i = index; i < end; ++i) {
+        err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (state == EntryState::WRITTEN) {
+            --mUsedEntryCount;
+        }
+        if (state != EntryState::ERASED) {
+            ++mErasedEntryCount;
+        }
+    }
+    err = alterEntryRangeState(index, end, EntryState::ERASED);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (end > mNextFreeEntry) {
+        mNextFreeEntry = end;
+    }
+    if (index == mFirstUsedEntry) {
+        err = updateFirstUsedEntry(index, end - index);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    rolledBack = true;
+    return ESP_OK;
+}
+
 esp_err_t Page::initialize()
 {
     NVS_ASSERT_OR_RETURN(mState == PageState::UNINITIALIZED, ESP_FAIL);
@@ -883,7 +1398,41 @@ esp_err_t Page::readEntry(size_t index, Item& dst) const
     return ESP_OK;
 }
 
+esp_err_t Page::readEntries(size_t index, void* dst, size_t count) const
+{
+    NVS_ASSERT_OR_RETURN(count > 0 && index + count <= ENTRY_COUNT, ESP_FAIL);
+    uint32_t phyAddr;
+    esp_err_t rc = getEntryAddress(index, &phyAddr);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+    return mPartition->read(phyAddr, dst, count * ENTRY_SIZE);
+}
+
+esp_err_t Page::readEntry(size_t index, Item& dst, const uint8_t* loadedEntries) const
+{
+    if (!loadedEntries) {
+        return readEntry(index, dst);
+    }
+    NVS_ASSERT_OR_RETURN(index < ENTRY_COUNT, ESP_FAIL);
+    memcpy(&dst, loadedEntries + index * ENTRY_SIZE, sizeof(dst));
+    return ESP_OK;
+}
+
 esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    uint32_t hash = 0;
+    if (nsIndex != NS_ANY && datatype != ItemType::ANY && key != NULL) {
+        // pages without items don't need the hash
+        if (mHashList.size() == 0) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        hash = Item(nsIndex, datatype, 0, key, chunkIdx).calculateCrc32WithoutValue();
+    }
+    return findItem(nsIndex, datatype, key, hash, itemIndex, item, chunkIdx, chunkStart);
+}
+
+esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint32_t hash, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
     if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED) {
         return ESP_ERR_NVS_NOT_FOUND;
@@ -905,7 +1454,7 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
     }
 
     if (nsIndex != NS_ANY && datatype != ItemType::ANY && key != NULL) {
-        size_t cachedIndex = mHashList.find(start, Item(nsIndex, datatype, 0, key, chunkIdx));
+        size_t cachedIndex = mHashList.find(start, hash);
         if (cachedIndex < ENTRY_COUNT) {
             start = cachedIndex;
         } else {
@@ -913,10 +1462,19 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
         }
     }
 
+    // when all items of a namespace are searched, only their entries are visited
+    const bool byNamespace = (nsIndex != NS_ANY && key == nullptr);
+
     size_t next;
     EntryState state;
     esp_err_t rc;
     for (size_t i = start; i < end; i = next) {
+        if (byNamespace) {
+            i = mHashList.findNamespace(i, nsIndex);
+            if (i >= end) {
+                break;
+            }
+        }
         next = i + 1;
         rc = mEntryTable.get(i, &state);
         if (rc != ESP_OK) {
@@ -1030,6 +1588,7 @@ esp_err_t Page::erase()
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
     mHashList.clear();
+    mHasUncheckedItems = false;
     return ESP_OK;
 }
 
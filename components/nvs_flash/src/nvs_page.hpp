@@ -48,6 +48,20 @@ public:
 
     static const uint8_t NVS_VERSION = 0xfe; // Decrement to upgrade
 
+    /**
+     * Records written before and after the items of a transaction (see writeTransaction). They are
+     * stored in namespace TXN_NS_INDEX, which isn't NS_INDEX, so that firmware which doesn't know
+     * about transactions doesn't take them for namespace entries. They are told apart from items of
+     * a namespace with that index by their chunk index, which only blob data uses otherwise.
+     * Their value is the number of entries between them, so the records and the items are found by
+     * position. copyItems and moveItem keep them together and renumber them when items in between
+     * were erased.
+     */
+    static const uint8_t TXN_NS_INDEX = 254;
+    static const uint8_t TXN_BEGIN_CHUNK = 0;
+    static const uint8_t TXN_COMMIT_CHUNK = 1;
+    static const char TXN_RECORD_KEY[];
+
     enum class PageState : uint32_t {
         // All bits set, default state after flash erase. Page has not been initialized yet.
         UNINITIALIZED = 0xffffffff,
@@ -77,7 +91,25 @@ public:
         return mState;
     }
 
-    esp_err_t load(Partition *partition, uint32_t sectorNumber);
+    /**
+     * Loads the page state from flash. If pageBuffer, a buffer of SEC_SIZE bytes, is given, the whole
+     * page is read with a single flash operation and parsed from RAM instead of being read entry by entry.
+     *
+     * If deferItemCrcCheck is true, CRCs of single entry items of full pages aren't verified here,
+     * but when the items are accessed for the first time, or by checkDeferredItems.
+     */
+    esp_err_t load(Partition *partition, uint32_t sectorNumber, uint8_t* pageBuffer = nullptr, bool deferItemCrcCheck = false);
+
+    /**
+     * Verifies the CRCs of all items whose check was deferred by load, and erases items with invalid CRC.
+     * Until then, such items are part of the hash list and of the item index and namespace counts.
+     */
+    esp_err_t checkDeferredItems();
+
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mHashList.setItemIndex(itemIndex, this);
+    }
 
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
@@ -87,8 +119,24 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
 
+    /**
+     * Writes items which were already serialized into entries (see Transaction) with a single flash
+     * write. The items are preceded by a begin record and followed by a commit record. If power is lost
+     * before the commit record is written, load() erases the begin record and the items. If writing
+     * fails, they are erased right away, together with the place of the commit record.
+     *
+     * On success, itemIndex is set to the index of the first entry of the items.
+     */
+    esp_err_t writeTransaction(const Item* entries, size_t count, size_t& itemIndex);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Reads dataSize bytes starting at offset from the value of a variable length item. The whole value is
+     * still read from flash to check its CRC, but only the requested part is copied to data.
+     */
+    esp_err_t readItemPart(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
+
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -97,6 +145,25 @@ public:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Same as above for a fully specified item, whose hash was already computed by the caller
+     * with Item::calculateCrc32WithoutValue.
+     */
+    esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint32_t hash, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
+
+    /**
+     * Erases the item starting at index, e.g. a transaction record found with findItem.
+     */
+    esp_err_t eraseItemAt(size_t index);
+
+    /**
+     * Finds the begin record which belongs to the commit record at commitIndex. Returns
+     * ESP_ERR_NVS_NOT_FOUND if it was already erased.
+     */
+    esp_err_t findTransactionBegin(size_t commitIndex, const Item& commit, size_t& beginIndex);
+
+    static bool isTransactionRecord(const Item& item, uint8_t chunkIdx);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -132,12 +199,26 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getHashListMemoryUsage() const
+    {
+        return mHashList.getMemoryUsage();
+    }
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
 
     esp_err_t copyItems(Page& other);
 
+    /**
+     * Writes the item starting at index to the end of other, then erases it on this page. Other must be
+     * the last page: if power is lost in between, the copy is kept and the original is erased on load.
+     * The begin record of a transaction is moved together with its items and its commit record. If power
+     * is lost in between, Storage::init erases the originals. span is set to the number of entries of
+     * this page which were moved. Returns ESP_ERR_NVS_PAGE_FULL if the item doesn't fit into other.
+     */
+    esp_err_t moveItem(size_t index, const Item& item, Page& other, size_t& span);
+
     esp_err_t erase();
 
     void debugDump() const;
@@ -171,7 +252,23 @@ protected:
         INVALID = 0x4 // entry is in inconsistent state (write started but ESB_WRITTEN has not been set yet)
     };
 
-    esp_err_t mLoadEntryTable();
+    esp_err_t mLoadEntryTable(const uint8_t* pageBuffer, bool deferItemCrcCheck);
+
+    esp_err_t rollbackTransaction(size_t index, const Item& record, bool& rolledBack);
+
+    void abortTransaction(size_t beginIndex, size_t count);
+
+    esp_err_t isTransactionRecordAt(size_t index, uint8_t chunkIdx, uint32_t count, bool& found) const;
+
+    esp_err_t findTransactionCommit(size_t index, const Item& record, size_t& commitIndex, bool& committed) const;
+
+    /**
+     * Writes the transaction whose begin record is at index to the end of other, leaving out erased items,
+     * and sets end to the index following its commit record. Nothing is written if it wasn't committed.
+     */
+    esp_err_t copyTransaction(size_t index, const Item& record, Page& other, size_t& end);
+
+    esp_err_t copyItem(size_t index, const Item& item, Page& other);
 
     esp_err_t initialize();
 
@@ -183,6 +280,16 @@ protected:
 
     esp_err_t readEntry(size_t index, Item& dst) const;
 
+    /**
+     * Reads count contiguous entries starting at index with a single partition read.
+     */
+    esp_err_t readEntries(size_t index, void* dst, size_t count) const;
+
+    /**
+     * Like readEntry, but takes the entry from loadedEntries if it isn't nullptr.
+     */
+    esp_err_t readEntry(size_t index, Item& dst, const uint8_t* loadedEntries) const;
+
     esp_err_t writeEntry(const Item& item);
 
     esp_err_t writeEntryData(const uint8_t* data, size_t size);
@@ -217,6 +324,7 @@ protected:
     size_t mFirstUsedEntry = INVALID_ENTRY;
     uint16_t mUsedEntryCount = 0;
     uint16_t mErasedEntryCount = 0;
+    bool mHasUncheckedItems = false;
 
     /**
      * This hash list stores hashes of namespace index, key, and ChunkIndex for quick lookup when searching items.
@@ -230,6 +338,7 @@ protected:
     static const uint32_t ENTRY_DATA_OFFSET = ENTRY_TABLE_OFFSET + 32;
 
     static_assert(sizeof(Header) == 32, "header size must be 32 bytes");
+    static_assert(ENTRY_COUNT <= HashList::MAX_ENTRY_COUNT, "hash list must be able to index every entry");
     static_assert(ENTRY_TABLE_OFFSET % 32 == 0, "entry table offset should be aligned");
     static_assert(ENTRY_DATA_OFFSET % 32 == 0, "entry data offset should be aligned");
 
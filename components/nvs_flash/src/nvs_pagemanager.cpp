@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "sdkconfig.h"
 #include "nvs_pagemanager.hpp"
 
 namespace nvs
@@ -17,12 +18,27 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
+    resetGc();
     mPages.reset(new (nothrow) Page[sectorCount]);
+    mItemIndex.clear();
 
     if (!mPages) return ESP_ERR_NO_MEM;
 
+#if CONFIG_NVS_BULK_PAGE_LOAD
+    // pages are read entry by entry if there is not enough memory for the buffer
+    std::unique_ptr<uint8_t[]> pageBuffer(new (nothrow) uint8_t[Page::SEC_SIZE]);
+#else
+    std::unique_ptr<uint8_t[]> pageBuffer;
+#endif
+#if CONFIG_NVS_DEFER_ITEM_CRC_CHECK
+    const bool deferItemCrcCheck = true;
+#else
+    const bool deferItemCrcCheck = false;
+#endif
+
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(partition, baseSector + i);
+        mPages[i].setItemIndex(&mItemIndex);
+        auto err = mPages[i].load(partition, baseSector + i, pageBuffer.get(), deferItemCrcCheck);
         if (err != ESP_OK) {
             return err;
         }
@@ -62,7 +78,8 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         lastItemIndex = itemIndex;
     }
 
-    if (lastItemIndex != SIZE_MAX) {
+    // a transaction record left by a page move which was interrupted is taken care of by Storage::init
+    if (lastItemIndex != SIZE_MAX && !Page::isTransactionRecord(item, Page::TXN_COMMIT_CHUNK)) {
         auto last = PageManager::TPageListIterator(&lastPage);
         TPageListIterator it;
 
@@ -186,12 +203,119 @@ esp_err_t PageManager::requestNewPage()
     NVS_ASSERT_OR_RETURN(usedEntries == newPage->getUsedEntryCount(), ESP_FAIL);
 #endif
 
+    if (erasedPage == mGcPage) {
+        resetGc();
+    }
     mPageList.erase(maxUnusedItemsPageIt);
     mFreePageList.push_back(erasedPage);
 
     return ESP_OK;
 }
 
+Page* PageManager::pickGcPage()
+{
+    // same choice as in requestNewPage, but the current page is never picked
+    Page* gcPage = nullptr;
+    size_t maxUnusedItems = 0;
+    for (auto it = begin(); it != end(); ++it) {
+        if (&*it == &back() || it->state() != Page::PageState::FULL) {
+            continue;
+        }
+        auto unused = Page::ENTRY_COUNT - it->getUsedEntryCount();
+        if (unused > maxUnusedItems) {
+            gcPage = &*it;
+            maxUnusedItems = unused;
+        }
+    }
+    return gcPage;
+}
+
+esp_err_t PageManager::checkDeferredItems()
+{
+    for (auto it = begin(); it != end(); ++it) {
+        auto err = it->checkDeferredItems();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t PageManager::gcStep(size_t budget, size_t reservePages)
+{
+    if (mGcPage == nullptr) {
+        if (mFreePageList.size() >= reservePages) {
+            return ESP_OK;
+        }
+        mGcPage = pickGcPage();
+        if (mGcPage == nullptr) {
+            return ESP_OK;
+        }
+        mGcIndex = 0;
+    }
+
+    if (mGcPage->getUsedEntryCount() == 0) {
+        esp_err_t err = mGcPage->erase();
+        if (err != ESP_OK) {
+            resetGc();
+            return err;
+        }
+        mPageList.erase(mGcPage);
+        mFreePageList.push_back(mGcPage);
+        resetGc();
+        return (mFreePageList.size() >= reservePages) ? ESP_OK : ESP_ERR_NOT_FINISHED;
+    }
+
+    size_t moved = 0;
+    do {
+        Item item;
+        esp_err_t err = mGcPage->findItem(Page::NS_ANY, ItemType::ANY, nullptr, mGcIndex, item);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            if (mGcPage->getUsedEntryCount() != 0) {
+                // written entries which don't belong to a valid item, leave them to requestNewPage
+                resetGc();
+                return ESP_OK;
+            }
+            break;
+        }
+        if (err != ESP_OK) {
+            resetGc();
+            return err;
+        }
+
+        size_t span;
+        err = mGcPage->moveItem(mGcIndex, item, back(), span);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            // the last free page is left for requestNewPage
+            if (mFreePageList.size() < 2) {
+                resetGc();
+                return ESP_OK;
+            }
+            if (back().state() != Page::PageState::FULL) {
+                err = back().markFull();
+                if (err != ESP_OK) {
+                    resetGc();
+                    return err;
+                }
+            }
+            err = activatePage();
+            if (err != ESP_OK) {
+                resetGc();
+                return err;
+            }
+            err = mGcPage->moveItem(mGcIndex, item, back(), span);
+        }
+        if (err != ESP_OK) {
+            resetGc();
+            return err;
+        }
+        mGcIndex += span;
+        moved += span;
+    } while (moved < budget);
+
+    return ESP_ERR_NOT_FINISHED;
+}
+
 esp_err_t PageManager::activatePage()
 {
     if (mFreePageList.empty()) {
@@ -233,4 +357,15 @@ esp_err_t PageManager::fillStats(nvs_stats_t& nvsStats)
     return err;
 }
 
+size_t PageManager::getIndexMemoryUsage() const
+{
+    size_t usage = mItemIndex.getMemoryUsage();
+    if (mPages) {
+        for (uint32_t i = 0; i < mPageCount; ++i) {
+            usage += mPages[i].getHashListMemoryUsage();
+        }
+    }
+    return usage;
+}
+
 } // namespace nvs
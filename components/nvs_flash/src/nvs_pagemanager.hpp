@@ -18,6 +18,7 @@
 #include <list>
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
+#include "nvs_item_index.hpp"
 #include "partition.hpp"
 #include "intrusive_list.h"
 
@@ -54,8 +55,37 @@ public:
 
     esp_err_t requestNewPage();
 
+    /**
+     * Reclaims erased entries incrementally, so that requestNewPage finds free pages without having to
+     * copy and erase a page itself. While fewer than reservePages pages are free, a full page is picked
+     * and its items are moved to the current page one by one, until about budget entries have been moved.
+     * Erasing the emptied page takes a step of its own.
+     *
+     * Returns ESP_ERR_NOT_FINISHED if more steps are needed, ESP_OK if the reserve is reached or
+     * no more entries can be reclaimed.
+     */
+    esp_err_t gcStep(size_t budget, size_t reservePages);
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    const ItemIndex& getItemIndex() const
+    {
+        return mItemIndex;
+    }
+
+    /**
+     * Checks the items whose CRC check was deferred during load, on all pages, so that the namespace
+     * counts of the item index are exact. Only the first call reads from flash.
+     */
+    esp_err_t checkDeferredItems();
+
+    size_t getIndexMemoryUsage() const;
+
+    size_t getFreePageCount() const
+    {
+        return mFreePageList.size();
+    }
+
     uint32_t getBaseSector()
     {
         return mBaseSector;
@@ -66,12 +96,23 @@ protected:
 
     esp_err_t activatePage();
 
+    Page* pickGcPage();
+
+    void resetGc()
+    {
+        mGcPage = nullptr;
+        mGcIndex = 0;
+    }
+
     TPageList mPageList;
     TPageList mFreePageList;
+    ItemIndex mItemIndex; // must outlive mPages, which unregister their items on destruction
     std::unique_ptr<Page[]> mPages;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
+    Page* mGcPage = nullptr; // page being emptied by gcStep, nullptr if none
+    size_t mGcIndex = 0; // entries of mGcPage before this index were moved already
 }; // class PageManager
 
 
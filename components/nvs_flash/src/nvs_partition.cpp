@@ -64,6 +64,11 @@ esp_err_t NVSPartition::erase_range(size_t dst_offset, size_t size)
     return esp_partition_erase_range(mESPPartition, dst_offset, size);
 }
 
+bool NVSPartition::is_encrypted()
+{
+    return mESPPartition->encrypted;
+}
+
 uint32_t NVSPartition::get_address()
 {
     return mESPPartition->address;
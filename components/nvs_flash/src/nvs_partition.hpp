@@ -96,6 +96,11 @@ public:
      */
     esp_err_t erase_range(size_t dst_offset, size_t size) override;
 
+    /**
+     * @return true if the partition is encrypted by flash encryption.
+     */
+    bool is_encrypted() override;
+
     /**
      * @return the base address of the partition.
      */
@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_read_cache.hpp"
+#include <new>
+
+namespace nvs
+{
+
+ReadCache::ReadCache()
+{
+}
+
+ReadCache::~ReadCache()
+{
+    mUsedList.clear();
+    mFreeList.clear();
+    delete[] mEntries;
+    delete[] mBuckets;
+}
+
+uint32_t ReadCache::hashOf(uint8_t nsIndex, const char* key)
+{
+    // the item hash without data type and chunk index, same as used by HashList
+    return Item(nsIndex, ItemType::ANY, 0, key).calculateCrc32WithoutValue();
+}
+
+esp_err_t ReadCache::setCapacity(size_t capacity)
+{
+    mUsedList.clear();
+    mFreeList.clear();
+    delete[] mEntries;
+    mEntries = nullptr;
+    delete[] mBuckets;
+    mBuckets = nullptr;
+    mBucketCount = 0;
+    mCapacity = 0;
+    mHits = 0;
+    mMisses = 0;
+
+    if (capacity == 0) {
+        return ESP_OK;
+    }
+
+    size_t bucketCount = 1;
+    while (bucketCount < capacity) {
+        bucketCount *= 2;
+    }
+    mEntries = new (std::nothrow) Entry[capacity];
+    mBuckets = new (std::nothrow) Entry*[bucketCount]();
+    if (!mEntries || !mBuckets) {
+        delete[] mEntries;
+        mEntries = nullptr;
+        delete[] mBuckets;
+        mBuckets = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    mCapacity = capacity;
+    mBucketCount = bucketCount;
+    for (size_t i = 0; i < capacity; ++i) {
+        mFreeList.push_back(&mEntries[i]);
+    }
+    return ESP_OK;
+}
+
+ReadCache::Entry* ReadCache::lookup(uint32_t hash, uint8_t nsIndex, ItemType datatype, const char* key) const
+{
+    for (Entry* entry = *bucketOf(hash); entry != nullptr; entry = entry->nextInBucket) {
+        if (entry->hash == hash && entry->nsIndex == nsIndex && entry->datatype == datatype
+                && strncmp(key, entry->key, Item::MAX_KEY_LENGTH) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void ReadCache::unlink(Entry* entry)
+{
+    Entry** link = bucketOf(entry->hash);
+    while (*link != entry) {
+        link = &(*link)->nextInBucket;
+    }
+    *link = entry->nextInBucket;
+    mUsedList.erase(entry);
+    mFreeList.push_back(entry);
+}
+
+const ReadCache::Entry* ReadCache::find(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    if (mCapacity == 0) {
+        return nullptr;
+    }
+
+    Entry* entry = lookup(hashOf(nsIndex, key), nsIndex, datatype, key);
+    if (!entry) {
+        ++mMisses;
+        return nullptr;
+    }
+    mUsedList.erase(entry);
+    mUsedList.push_front(entry);
+    ++mHits;
+    return entry;
+}
+
+const ReadCache::Entry* ReadCache::peek(uint8_t nsIndex, ItemType datatype, const char* key) const
+{
+    if (mCapacity == 0) {
+        return nullptr;
+    }
+    return lookup(hashOf(nsIndex, key), nsIndex, datatype, key);
+}
+
+void ReadCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (mCapacity == 0 || dataSize > MAX_VALUE_SIZE || !isCacheable(datatype)) {
+        return;
+    }
+
+    const uint32_t hash = hashOf(nsIndex, key);
+    Entry* entry = lookup(hash, nsIndex, datatype, key);
+    if (entry) {
+        unlink(entry);
+    }
+    if (mFreeList.empty()) {
+        // evict the least recently used value
+        unlink(&mUsedList.back());
+    }
+    entry = &mFreeList.front();
+    mFreeList.pop_front();
+
+    entry->nsIndex = nsIndex;
+    entry->datatype = datatype;
+    entry->dataSize = dataSize;
+    strncpy(entry->key, key, sizeof(entry->key) - 1);
+    entry->key[sizeof(entry->key) - 1] = 0;
+    memcpy(entry->data, data, dataSize);
+    entry->hash = hash;
+    entry->nextInBucket = *bucketOf(hash);
+    *bucketOf(hash) = entry;
+    mUsedList.push_front(entry);
+}
+
+void ReadCache::erase(uint8_t nsIndex, const char* key)
+{
+    if (mCapacity == 0) {
+        return;
+    }
+
+    const uint32_t hash = hashOf(nsIndex, key);
+    for (Entry* entry = *bucketOf(hash); entry != nullptr;) {
+        Entry* next = entry->nextInBucket;
+        if (entry->hash == hash && entry->nsIndex == nsIndex && strncmp(key, entry->key, Item::MAX_KEY_LENGTH) == 0) {
+            unlink(entry);
+        }
+        entry = next;
+    }
+}
+
+void ReadCache::eraseNamespace(uint8_t nsIndex)
+{
+    for (auto it = mUsedList.begin(); it != mUsedList.end();) {
+        Entry* entry = it++;
+        if (entry->nsIndex == nsIndex) {
+            unlink(entry);
+        }
+    }
+}
+
+void ReadCache::clear()
+{
+    while (!mUsedList.empty()) {
+        Entry* entry = &mUsedList.front();
+        mUsedList.pop_front();
+        mFreeList.push_back(entry);
+    }
+    for (size_t i = 0; i < mBucketCount; ++i) {
+        mBuckets[i] = nullptr;
+    }
+}
+
+} // namespace nvs
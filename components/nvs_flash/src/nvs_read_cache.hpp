@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_read_cache_hpp
+#define nvs_read_cache_hpp
+
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * Bounded LRU cache of decoded values of primitive items and short strings, used by Storage
+ * to answer repeated reads without accessing flash.
+ *
+ * Entries are keyed by namespace index, data type and key. Storage removes the entries of a key
+ * whenever the key is written or erased, so the cache never holds a value which differs from flash.
+ *
+ * Entries are found through a table of buckets, using the same hash of namespace index and key as
+ * HashList. The hash doesn't cover the data type, so all values of a key are in the same bucket.
+ */
+class ReadCache
+{
+public:
+    /**
+     * Longest value which is cached, in bytes (for strings including the null character).
+     */
+    static const size_t MAX_VALUE_SIZE = 32;
+
+    struct Entry : public intrusive_list_node<Entry> {
+    public:
+        uint8_t nsIndex;
+        ItemType datatype;
+        uint8_t dataSize;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t data[MAX_VALUE_SIZE];
+    private:
+        friend class ReadCache;
+        uint32_t hash;
+        Entry* nextInBucket;
+    };
+
+    ReadCache();
+    ~ReadCache();
+
+    /**
+     * Drops all entries and allocates room for the given number of values. A capacity of zero
+     * disables the cache. Hit and miss counters are reset.
+     */
+    esp_err_t setCapacity(size_t capacity);
+
+    /**
+     * Returns the entry for the given value and marks it as most recently used,
+     * or nullptr if the value isn't cached.
+     */
+    const Entry* find(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    /**
+     * Same as find, but neither counts a hit or miss nor changes the order of the entries.
+     */
+    const Entry* peek(uint8_t nsIndex, ItemType datatype, const char* key) const;
+
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Removes the values of the given key, of all data types.
+     */
+    void erase(uint8_t nsIndex, const char* key);
+
+    void eraseNamespace(uint8_t nsIndex);
+
+    void clear();
+
+    size_t getCapacity() const
+    {
+        return mCapacity;
+    }
+
+    size_t size() const
+    {
+        return mUsedList.size();
+    }
+
+    size_t getHits() const
+    {
+        return mHits;
+    }
+
+    size_t getMisses() const
+    {
+        return mMisses;
+    }
+
+    static bool isCacheable(ItemType datatype)
+    {
+        return datatype != ItemType::BLOB && datatype != ItemType::BLOB_DATA &&
+               datatype != ItemType::BLOB_IDX && datatype != ItemType::ANY;
+    }
+
+private:
+    ReadCache(const ReadCache& other);
+    const ReadCache& operator= (const ReadCache& rhs);
+
+    typedef intrusive_list<Entry> TEntryList;
+
+    static uint32_t hashOf(uint8_t nsIndex, const char* key);
+
+    Entry* lookup(uint32_t hash, uint8_t nsIndex, ItemType datatype, const char* key) const;
+    Entry** bucketOf(uint32_t hash) const
+    {
+        return &mBuckets[hash & (mBucketCount - 1)];
+    }
+    void unlink(Entry* entry);
+
+    Entry* mEntries = nullptr;
+    size_t mCapacity = 0;
+    Entry** mBuckets = nullptr;
+    size_t mBucketCount = 0; // power of two, at least mCapacity
+    TEntryList mUsedList; // most recently used entry first
+    TEntryList mFreeList;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+}; // class ReadCache
+
+} // namespace nvs
+
+#endif /* nvs_read_cache_hpp */
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "sdkconfig.h"
 #include "nvs_storage.hpp"
 
 #ifndef ESP_PLATFORM
@@ -86,6 +87,37 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
     }
 }
 
+esp_err_t Storage::finishTransaction()
+{
+    // A transaction which wasn't committed was already rolled back when its page was loaded.
+    // If it was committed, power may have gone out before the old values were erased. There may
+    // be several commit records, e.g. if erasing them failed before or a page move was interrupted.
+    for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+        Item item;
+        size_t commitIndex = 0;
+        while (it->findItem(Page::TXN_NS_INDEX, ItemType::U32, Page::TXN_RECORD_KEY, commitIndex, item, Page::TXN_COMMIT_CHUNK) == ESP_OK) {
+            if (!Page::isTransactionRecord(item, Page::TXN_COMMIT_CHUNK)) {
+                // an item of a namespace which was given the same index
+                commitIndex += item.span;
+                continue;
+            }
+            size_t beginIndex;
+            auto err = it->findTransactionBegin(commitIndex, item, beginIndex);
+            if (err == ESP_OK) {
+                err = eraseTransactionLeftovers(*it, beginIndex, commitIndex);
+            } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+                // the begin record is only erased once the old values are gone
+                err = it->eraseItemAt(commitIndex);
+            }
+            if (err != ESP_OK) {
+                return err;
+            }
+            ++commitIndex;
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
     auto err = mPageManager.load(mPartition, baseSector, sectorCount);
@@ -94,6 +126,16 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
         return err;
     }
 
+    // values replaced by a committed transaction have to be erased before anything is read
+    err = finishTransaction();
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+        return err;
+    }
+
+    // the cache is optional, reads go to flash if there is not enough memory for it
+    mReadCache.setCapacity(CONFIG_NVS_READ_CACHE_SIZE);
+
     // load namespaces list
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
@@ -156,6 +198,21 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    // Pages only use their hash lists for fully specified lookups, the partition-wide index follows the same rule
+    const ItemIndex& index = mPageManager.getItemIndex();
+    if (nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr && index.isValid()) {
+        Page* candidates[MAX_INDEX_CANDIDATES];
+        const uint32_t hash = Item(nsIndex, datatype, 0, key, chunkIdx).calculateCrc32WithoutValue();
+        size_t count = index.find(hash, candidates, MAX_INDEX_CANDIDATES);
+        if (count == 0) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (count <= MAX_INDEX_CANDIDATES) {
+            return findItemInPages(candidates, count, nsIndex, datatype, key, hash, page, item, chunkIdx, chunkStart);
+        }
+        // too many candidates (e.g. many hash collisions), fall back to checking all pages
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -167,6 +224,33 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+esp_err_t Storage::findItemInPages(Page** pages, size_t count, uint8_t nsIndex, ItemType datatype, const char* key, uint32_t hash, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    // Keep the result identical to the page list walk: pages are ordered by sequence number there,
+    // so the oldest page holding the item wins if there are duplicates.
+    uint32_t seqNumbers[MAX_INDEX_CANDIDATES];
+    for (size_t i = 0; i < count; ++i) {
+        if (pages[i]->getSeqNumber(seqNumbers[i]) != ESP_OK) {
+            seqNumbers[i] = UINT32_MAX;
+        }
+        for (size_t j = i; j > 0 && seqNumbers[j - 1] > seqNumbers[j]; --j) {
+            std::swap(seqNumbers[j - 1], seqNumbers[j]);
+            std::swap(pages[j - 1], pages[j]);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t itemIndex = 0;
+        // the hash is the same on every page, don't compute it again
+        auto err = pages[i]->findItem(nsIndex, datatype, key, hash, itemIndex, item, chunkIdx, chunkStart);
+        if (err == ESP_OK) {
+            page = pages[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
 esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
 {
     uint8_t chunkCount = 0;
@@ -278,6 +362,8 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mReadCache.erase(nsIndex, key);
+
     Page* findPage = nullptr;
     Item item;
 
@@ -399,6 +485,132 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+esp_err_t Storage::writeTransaction(Transaction& txn)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    // Same as in writeItem, don't write out items which wouldn't change
+    for (size_t i = 0; i < txn.size();) {
+        const Item& staged = txn.entries()[i];
+        Page* findPage = nullptr;
+        Item item;
+        size_t dataSize;
+        const void* data = txn.getData(i, dataSize);
+        if (findItem(staged.nsIndex, staged.datatype, staged.key, findPage, item) == ESP_OK &&
+                findPage->cmpItem(staged.nsIndex, staged.datatype, staged.key, data, dataSize) == ESP_OK) {
+            txn.remove(i);
+        } else {
+            i += staged.span;
+        }
+    }
+
+    if (txn.size() == 0) {
+        return ESP_OK;
+    }
+
+    // the items and both records must fit into one page
+    if (txn.size() + 2 > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_TRANSACTION_TOO_BIG;
+    }
+
+    for (size_t i = 0; i < txn.size(); i += txn.entries()[i].span) {
+        mReadCache.erase(txn.entries()[i].nsIndex, txn.entries()[i].key);
+    }
+
+    Page* page = &getCurrentPage();
+    size_t itemIndex;
+    auto err = page->writeTransaction(txn.entries(), txn.size(), itemIndex);
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        // don't give up the rest of the current page if there is no page to continue with
+        if (mPageManager.getFreePageCount() == 0) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        if (page->state() != Page::PageState::FULL) {
+            err = page->markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        page = &getCurrentPage();
+        err = page->writeTransaction(txn.entries(), txn.size(), itemIndex);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // The transaction is committed. If erasing the old values fails, init() does it again.
+    err = eraseTransactionLeftovers(*page, itemIndex - 1, itemIndex + txn.size());
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::eraseTransactionLeftovers(Page& page, size_t beginIndex, size_t commitIndex)
+{
+    esp_err_t err;
+    Item item;
+    size_t itemIndex = beginIndex + 1;
+    while (itemIndex < commitIndex && page.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+        if (itemIndex >= commitIndex) {
+            break;
+        }
+        err = eraseOldVersion(page, itemIndex, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        itemIndex += item.span;
+    }
+
+    // The records are erased by position, records of another transaction may be on the same page.
+    // The begin record goes first, a commit record alone is erased by init().
+    err = page.eraseItemAt(beginIndex);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return page.eraseItemAt(commitIndex);
+}
+
+esp_err_t Storage::eraseOldVersion(Page& page, size_t index, const Item& item)
+{
+    Page* findPage = nullptr;
+    Item oldItem;
+    // Pages are searched in order of sequence numbers, so old values on other pages are found first.
+    // There can be two of them if the transaction was moved to another page before it was finished.
+    auto err = findItem(item.nsIndex, item.datatype, item.key, findPage, oldItem);
+    while (err == ESP_OK && findPage != &page) {
+        err = findPage->eraseItem(item.nsIndex, item.datatype, item.key);
+        if (err == ESP_OK) {
+            err = findItem(item.nsIndex, item.datatype, item.key, findPage, oldItem);
+        }
+    }
+    if (err != ESP_OK) {
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_OK : err;
+    }
+
+    size_t oldIndex = 0;
+    if (page.findItem(item.nsIndex, item.datatype, item.key, oldIndex, oldItem) == ESP_OK && oldIndex < index) {
+        return page.eraseItem(item.nsIndex, item.datatype, item.key);
+    }
+    return ESP_OK;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -551,11 +763,32 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         } // else check if the blob is stored with earlier version format without index
     }
 
+    const bool cacheable = ReadCache::isCacheable(datatype);
+    if (cacheable) {
+        const ReadCache::Entry* entry = mReadCache.find(nsIndex, datatype, key);
+        if (entry) {
+            // same checks as in Page::readItem
+            if (!isVariableLengthType(datatype)) {
+                if (dataSize != entry->dataSize) {
+                    return ESP_ERR_NVS_TYPE_MISMATCH;
+                }
+            } else if (dataSize < entry->dataSize) {
+                return ESP_ERR_NVS_INVALID_LENGTH;
+            }
+            memcpy(data, entry->data, entry->dataSize);
+            return ESP_OK;
+        }
+    }
+
     auto err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_OK && cacheable) {
+        mReadCache.insert(nsIndex, datatype, key, data, isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize);
+    }
+    return err;
 
 }
 
@@ -604,12 +837,286 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
     return ESP_OK;
 }
 
+esp_err_t Storage::beginBlobWrite(uint8_t nsIndex, const char* key, BlobWriter& writer)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    auto err = writer.init(nsIndex, key);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    /* Chunks are written with the version which isn't used by the stored blob */
+    writer.mPrevStart = item.blobIndex.chunkStart;
+    NVS_ASSERT_OR_RETURN(writer.mPrevStart == VerOffset::VER_0_OFFSET || writer.mPrevStart == VerOffset::VER_1_OFFSET, ESP_FAIL);
+    writer.mChunkStart
+        = (writer.mPrevStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBlobChunk(BlobWriter& writer, bool flush)
+{
+    esp_err_t err;
+    size_t tailroom = getCurrentPage().getVarDataTailroom();
+    while ((tailroom < writer.mBufferedSize || tailroom == 0) && tailroom < Page::CHUNK_MAX_SIZE/10) {
+        /* The rest of the page is too small for a chunk, continue on a new page */
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (getCurrentPage().getVarDataTailroom() == tailroom) {
+            /* We got the same page or we are not improving.*/
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        tailroom = getCurrentPage().getVarDataTailroom();
+    }
+
+    if (!flush && writer.mBufferedSize < tailroom && writer.mBufferedSize < Page::CHUNK_MAX_SIZE) {
+        /* Wait for more data, so that the chunk fills the page */
+        return ESP_OK;
+    }
+
+    if (writer.mChunkCount >= (Page::CHUNK_ANY-1)/2) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    Page& page = getCurrentPage();
+    size_t chunkSize = (writer.mBufferedSize > tailroom) ? tailroom : writer.mBufferedSize;
+    err = page.writeItem(writer.mNsIndex, ItemType::BLOB_DATA, writer.mKey, writer.mBuffer, chunkSize,
+            static_cast<uint8_t> (writer.mChunkStart) + writer.mChunkCount);
+    writer.mChunkCount++;
+    if (err != ESP_OK) {
+        NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
+        return err;
+    }
+    writer.consume(chunkSize);
+
+    if (writer.mBufferedSize > 0 || (tailroom - chunkSize) < Page::ENTRY_SIZE) {
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::appendBlob(BlobWriter& writer, const void* data, size_t dataSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    NVS_ASSERT_OR_RETURN(!writer.mFinalized, ESP_ERR_NVS_INVALID_STATE);
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    while (dataSize > 0) {
+        size_t copied = writer.buffer(src, dataSize);
+        src += copied;
+        dataSize -= copied;
+
+        /* Write out the buffer as soon as it fills the rest of the current page */
+        while (writer.mBufferedSize > 0 && (writer.mBufferedSize == Page::CHUNK_MAX_SIZE
+                || writer.mBufferedSize >= getCurrentPage().getVarDataTailroom())) {
+            auto err = writeBlobChunk(writer, false);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::finalizeBlobWrite(BlobWriter& writer)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    NVS_ASSERT_OR_RETURN(!writer.mFinalized, ESP_ERR_NVS_INVALID_STATE);
+
+    esp_err_t err;
+    /* An empty blob still gets one chunk, same as in writeMultiPageBlob */
+    while (writer.mBufferedSize > 0 || writer.mChunkCount == 0) {
+        err = writeBlobChunk(writer, true);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    Item item;
+    std::fill_n(item.data, sizeof(item.data), 0xff);
+    item.blobIndex.dataSize = writer.mWrittenSize;
+    item.blobIndex.chunkCount = writer.mChunkCount;
+    item.blobIndex.chunkStart = writer.mChunkStart;
+
+    err = getCurrentPage().writeItem(writer.mNsIndex, ItemType::BLOB_IDX, writer.mKey, item.data, sizeof(item.data));
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        /* Other items may have filled the page since the last chunk was written */
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = getCurrentPage().writeItem(writer.mNsIndex, ItemType::BLOB_IDX, writer.mKey, item.data, sizeof(item.data));
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    writer.mFinalized = true;
+
+    mReadCache.erase(writer.mNsIndex, writer.mKey);
+
+    if (writer.mPrevStart != VerOffset::VER_ANY) {
+        /* Erase the blob with earlier version*/
+        err = eraseMultiPageBlob(writer.mNsIndex, writer.mKey, writer.mPrevStart);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    } else {
+        /* Support for earlier versions where BLOBS were stored without index */
+        Page* findPage = nullptr;
+        err = findItem(writer.mNsIndex, ItemType::BLOB, writer.mKey, findPage, item);
+        if (err == ESP_OK) {
+            err = findPage->eraseItem(writer.mNsIndex, ItemType::BLOB, writer.mKey);
+            if (err == ESP_ERR_FLASH_OP_FAIL) {
+                return ESP_ERR_NVS_REMOVE_FAILED;
+            }
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::abortBlobWrite(BlobWriter& writer)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (writer.mFinalized) {
+        return ESP_OK;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    for (uint8_t chunkNum = 0; chunkNum < writer.mChunkCount; chunkNum++) {
+        uint8_t chunkIdx = static_cast<uint8_t> (writer.mChunkStart) + chunkNum;
+        auto err = findItem(writer.mNsIndex, ItemType::BLOB_DATA, writer.mKey, findPage, item, chunkIdx);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            continue;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = findPage->eraseItem(writer.mNsIndex, ItemType::BLOB_DATA, writer.mKey, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    writer.mChunkCount = 0;
+    writer.mBufferedSize = 0;
+    writer.mWrittenSize = 0;
+    return ESP_OK;
+}
+
+esp_err_t Storage::readBlobAt(uint8_t nsIndex, const char* key, size_t offset, void* data, size_t dataSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+
+    /* First read the blob index */
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t chunkCount = item.blobIndex.chunkCount;
+    VerOffset chunkStart = item.blobIndex.chunkStart;
+    size_t blobSize = item.blobIndex.dataSize;
+    if (offset > blobSize || dataSize > blobSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    /* Chunk sizes are taken from the chunk headers, only the chunks overlapping the range are read */
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    size_t chunkOffset = 0;
+    for (uint8_t chunkNum = 0; chunkNum < chunkCount && dataSize > 0; chunkNum++) {
+        uint8_t chunkIdx = static_cast<uint8_t> (chunkStart) + chunkNum;
+        err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, item, chunkIdx);
+        if (err == ESP_OK) {
+            size_t chunkSize = item.varLength.dataSize;
+            if (offset < chunkOffset + chunkSize) {
+                size_t partOffset = offset - chunkOffset;
+                size_t partSize = std::min(chunkSize - partOffset, dataSize);
+                err = findPage->readItemPart(nsIndex, ItemType::BLOB_DATA, key, partOffset, dst, partSize, chunkIdx);
+                dst += partSize;
+                offset += partSize;
+                dataSize -= partSize;
+            }
+            chunkOffset += chunkSize;
+        }
+        if (err != ESP_OK) {
+            if (err == ESP_ERR_NVS_NOT_FOUND) {
+                eraseMultiPageBlob(nsIndex, key); // cleanup if a chunk is not found
+            }
+            return err;
+        }
+    }
+    NVS_ASSERT_OR_RETURN(dataSize == 0, ESP_FAIL);
+    return ESP_OK;
+}
+
 esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mReadCache.erase(nsIndex, key);
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -634,9 +1141,19 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mReadCache.eraseNamespace(nsIndex);
+
+    auto err = mPageManager.checkDeferredItems();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (mPageManager.getItemIndex().getNamespaceEntryCount(nsIndex) == 0) {
+        return ESP_OK;
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
-            auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
+            err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
             if (err == ESP_ERR_NVS_NOT_FOUND) {
                 break;
             }
@@ -655,6 +1172,15 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (isVariableLengthType(datatype) && ReadCache::isCacheable(datatype)) {
+        // usually followed by a read of the value, which is the one to count
+        const ReadCache::Entry* entry = mReadCache.peek(nsIndex, datatype, key);
+        if (entry) {
+            dataSize = entry->dataSize;
+            return ESP_OK;
+        }
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -687,6 +1213,10 @@ void Storage::debugCheck()
     std::map<std::string, Page*> keys;
 
     for (auto p = mPageManager.begin(); p != mPageManager.end(); ++p) {
+        // items of a page on which a flash operation failed can't be read any more
+        if (p->state() == Page::PageState::INVALID) {
+            continue;
+        }
         size_t itemIndex = 0;
         size_t usedCount = 0;
         Item item;
@@ -714,6 +1244,22 @@ esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
     return mPageManager.fillStats(nvsStats);
 }
 
+void Storage::fillReadCacheStats(nvs_read_cache_stats_t& stats) const
+{
+    stats.hits = mReadCache.getHits();
+    stats.misses = mReadCache.getMisses();
+    stats.used_entries = mReadCache.size();
+    stats.total_entries = mReadCache.getCapacity();
+}
+
+esp_err_t Storage::gcStep(size_t budget)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    return mPageManager.gcStep(budget, CONFIG_NVS_GC_FREE_PAGES);
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
@@ -722,22 +1268,11 @@ esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
-    for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
-        size_t itemIndex = 0;
-        Item item;
-        while (true) {
-            auto err = it->findItem(nsIndex, ItemType::ANY, nullptr, itemIndex, item);
-            if (err == ESP_ERR_NVS_NOT_FOUND) {
-                break;
-            }
-            else if (err != ESP_OK) {
-                return err;
-            }
-            usedEntries += item.span;
-            itemIndex   += item.span;
-            if (itemIndex >= it->ENTRY_COUNT) break;
-        }
+    auto err = mPageManager.checkDeferredItems();
+    if (err != ESP_OK) {
+        return err;
     }
+    usedEntries = mPageManager.getItemIndex().getNamespaceEntryCount(nsIndex);
     return ESP_OK;
 }
 
@@ -778,7 +1313,9 @@ inline bool isIterableItem(Item& item)
 {
     return (item.nsIndex != 0 &&
             item.datatype != ItemType::BLOB &&
-            item.datatype != ItemType::BLOB_IDX);
+            item.datatype != ItemType::BLOB_IDX &&
+            !Page::isTransactionRecord(item, Page::TXN_BEGIN_CHUNK) &&
+            !Page::isTransactionRecord(item, Page::TXN_COMMIT_CHUNK));
 }
 
 inline bool isMultipageBlob(Item& item)
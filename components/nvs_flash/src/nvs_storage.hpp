@@ -20,6 +20,9 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_transaction.hpp"
+#include "nvs_read_cache.hpp"
+#include "nvs_blob_writer.hpp"
 #include "partition.hpp"
 
 //extern void dumpBytes(const uint8_t* data, size_t count);
@@ -100,6 +103,40 @@ public:
 
     esp_err_t eraseNamespace(uint8_t nsIndex);
 
+    /**
+     * Writes all items staged in the transaction with a single commit point: after a power loss,
+     * either all of them or none of them are stored. Staged items which are equal to the stored
+     * ones are removed from the transaction.
+     */
+    esp_err_t writeTransaction(Transaction& txn);
+
+    /**
+     * Prepares writer for writing a new value of the given blob in parts. The stored value, if any, stays
+     * visible until finalizeBlobWrite is called.
+     */
+    esp_err_t beginBlobWrite(uint8_t nsIndex, const char* key, BlobWriter& writer);
+
+    /**
+     * Appends data to the blob. Whenever the buffered data fills the rest of the current page,
+     * it is written out as a chunk.
+     */
+    esp_err_t appendBlob(BlobWriter& writer, const void* data, size_t dataSize);
+
+    /**
+     * Writes the remaining data and the blob index, then erases the previous value of the blob.
+     */
+    esp_err_t finalizeBlobWrite(BlobWriter& writer);
+
+    /**
+     * Erases the chunks written so far. The previous value of the blob is kept.
+     */
+    esp_err_t abortBlobWrite(BlobWriter& writer);
+
+    /**
+     * Reads dataSize bytes of a blob starting at offset. Only the chunks overlapping the range are read.
+     */
+    esp_err_t readBlobAt(uint8_t nsIndex, const char* key, size_t offset, void* data, size_t dataSize);
+
     const Partition *getPart() const
     {
         return mPartition;
@@ -131,6 +168,28 @@ public:
 
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
+    /**
+     * Runs one step of incremental garbage collection, which keeps CONFIG_NVS_GC_FREE_PAGES pages free.
+     * See PageManager::gcStep.
+     */
+    esp_err_t gcStep(size_t budget);
+
+    size_t getIndexMemoryUsage() const
+    {
+        return mPageManager.getIndexMemoryUsage();
+    }
+
+    /**
+     * Sets the number of values kept in the read cache, 0 disables it.
+     * By default, CONFIG_NVS_READ_CACHE_SIZE values are cached.
+     */
+    esp_err_t setReadCacheCapacity(size_t capacity)
+    {
+        return mReadCache.setCapacity(capacity);
+    }
+
+    void fillReadCacheStats(nvs_read_cache_stats_t& stats) const;
+
     bool findEntry(nvs_opaque_iterator_t*, const char* name);
 
     bool nextEntry(nvs_opaque_iterator_t* it);
@@ -150,14 +209,35 @@ protected:
 
     void fillEntryInfo(Item &item, nvs_entry_info_t &info);
 
+    esp_err_t finishTransaction();
+
+    esp_err_t eraseTransactionLeftovers(Page& page, size_t beginIndex, size_t commitIndex);
+
+    esp_err_t eraseOldVersion(Page& page, size_t index, const Item& item);
+
+    /**
+     * Writes buffered data of writer as a chunk on the current page. Unless flush is set, nothing is written
+     * while the buffered data fits into the rest of the page.
+     */
+    esp_err_t writeBlobChunk(BlobWriter& writer, bool flush);
+
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t findItemInPages(Page** pages, size_t count, uint8_t nsIndex, ItemType datatype, const char* key, uint32_t hash, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart);
+
+    /**
+     * Number of candidate pages returned by the item index which are checked directly. Beyond that,
+     * lookups fall back to walking all pages.
+     */
+    static const size_t MAX_INDEX_CANDIDATES = 8;
+
 protected:
     Partition *mPartition;
     size_t mPageCount;
     PageManager mPageManager;
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
+    ReadCache mReadCache;
     StorageState mState = StorageState::INVALID;
 };
 
@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_transaction.hpp"
+#include <new>
+
+namespace nvs
+{
+
+Transaction::Transaction()
+{
+}
+
+Transaction::~Transaction()
+{
+    delete[] mEntries;
+}
+
+void Transaction::clear()
+{
+    delete[] mEntries;
+    mEntries = nullptr;
+    mCount = 0;
+    mCapacity = 0;
+}
+
+bool Transaction::reserve(size_t count)
+{
+    if (count <= mCapacity) {
+        return true;
+    }
+
+    size_t newCapacity = (mCapacity == 0) ? INITIAL_CAPACITY : mCapacity * 2;
+    if (newCapacity < count) {
+        newCapacity = count;
+    }
+    if (newCapacity > MAX_ENTRY_COUNT) {
+        newCapacity = MAX_ENTRY_COUNT;
+    }
+
+    Item* newEntries = new (std::nothrow) Item[newCapacity];
+    if (!newEntries) {
+        return false;
+    }
+    if (mCount > 0) {
+        memcpy(newEntries, mEntries, mCount * sizeof(Item));
+    }
+    delete[] mEntries;
+    mEntries = newEntries;
+    mCapacity = newCapacity;
+    return true;
+}
+
+size_t Transaction::find(uint8_t nsIndex, ItemType datatype, const char* key) const
+{
+    for (size_t i = 0; i < mCount; i += mEntries[i].span) {
+        const Item& item = mEntries[i];
+        if (item.nsIndex == nsIndex && item.datatype == datatype
+                && strncmp(key, item.key, Item::MAX_KEY_LENGTH) == 0) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+void Transaction::remove(size_t index)
+{
+    size_t span = mEntries[index].span;
+    memmove(mEntries + index, mEntries + index + span, (mCount - index - span) * sizeof(Item));
+    mCount -= span;
+}
+
+esp_err_t Transaction::add(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (datatype == ItemType::BLOB || datatype == ItemType::BLOB_DATA ||
+            datatype == ItemType::BLOB_IDX || datatype == ItemType::ANY) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    if ((!isVariableLengthType(datatype)) && dataSize > 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (isVariableLengthType(datatype) && dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    size_t span = 1;
+    if (isVariableLengthType(datatype)) {
+        span += (dataSize + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE;
+    }
+    if (span > MAX_ENTRY_COUNT) {
+        return ESP_ERR_NVS_TRANSACTION_TOO_BIG;
+    }
+
+    // the new value replaces a value staged earlier for the same key
+    size_t previous = find(nsIndex, datatype, key);
+    size_t count = mCount + span;
+    if (previous != SIZE_MAX) {
+        count -= mEntries[previous].span;
+    }
+    if (count > MAX_ENTRY_COUNT) {
+        return ESP_ERR_NVS_TRANSACTION_TOO_BIG;
+    }
+    if (!reserve(count)) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (previous != SIZE_MAX) {
+        remove(previous);
+    }
+
+    Item* item = mEntries + mCount;
+    *item = Item(nsIndex, datatype, span, key);
+    if (!isVariableLengthType(datatype)) {
+        memcpy(item->data, data, dataSize);
+    } else {
+        item->varLength.dataCrc32 = Item::calculateCrc32(static_cast<const uint8_t*>(data), dataSize);
+        item->varLength.dataSize = dataSize;
+        item->varLength.reserved = 0xffff;
+
+        uint8_t* dst = reinterpret_cast<uint8_t*>(item + 1);
+        memset(dst, 0xff, (span - 1) * Page::ENTRY_SIZE);
+        memcpy(dst, data, dataSize);
+    }
+    item->crc32 = item->calculateCrc32();
+    mCount += span;
+    return ESP_OK;
+}
+
+const void* Transaction::getData(size_t index, size_t& dataSize) const
+{
+    const Item& item = mEntries[index];
+    if (isVariableLengthType(item.datatype)) {
+        dataSize = item.varLength.dataSize;
+        return &mEntries[index + 1];
+    }
+    dataSize = static_cast<uint8_t>(item.datatype) & 0x0f;
+    return item.data;
+}
+
+} // namespace nvs
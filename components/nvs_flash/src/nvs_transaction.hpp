@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_transaction_hpp
+#define nvs_transaction_hpp
+
+#include "nvs_types.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+/**
+ * Items staged in RAM between nvs_transaction_begin and nvs_transaction_commit.
+ *
+ * Items are kept in the same layout they have on flash: a header entry, followed by the data entries
+ * of variable length items. Entries of all items are packed back to back, so that a page can write
+ * the whole transaction with a single flash write (see Storage::writeTransaction).
+ *
+ * Staging the same key twice replaces the previously staged value. Blobs can't be staged, since they
+ * may need to be split across several pages.
+ */
+class Transaction
+{
+public:
+    /**
+     * A transaction must fit into a single page. Two entries of that page are taken by the records
+     * which mark the begin and the commit of the transaction.
+     */
+    static const size_t MAX_ENTRY_COUNT = Page::ENTRY_COUNT - 2;
+
+    Transaction();
+    ~Transaction();
+
+    esp_err_t add(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Removes the staged item whose header entry is at the given position.
+     */
+    void remove(size_t index);
+
+    void clear();
+
+    const Item* entries() const
+    {
+        return mEntries;
+    }
+
+    /**
+     * Returns the number of entries (not items) staged in the transaction.
+     */
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Returns the value of the staged item whose header entry is at the given position,
+     * in the form expected by Page::cmpItem.
+     */
+    const void* getData(size_t index, size_t& dataSize) const;
+
+private:
+    Transaction(const Transaction& other);
+    const Transaction& operator= (const Transaction& rhs);
+
+    size_t find(uint8_t nsIndex, ItemType datatype, const char* key) const;
+    bool reserve(size_t count);
+
+    Item* mEntries = nullptr;
+    size_t mCount = 0;
+    size_t mCapacity = 0;
+
+    static const size_t INITIAL_CAPACITY = 16;
+}; // class Transaction
+
+} // namespace nvs
+
+#endif /* nvs_transaction_hpp */
@@ -43,6 +43,14 @@ public:
 
     virtual esp_err_t erase_range(size_t dst_offset, size_t size) = 0;
 
+    /**
+     * Return true if the data returned by read() differs from the raw flash contents returned by read_raw().
+     */
+    virtual bool is_encrypted()
+    {
+        return false;
+    }
+
     /**
      * Return the address of the beginning of the partition.
      */
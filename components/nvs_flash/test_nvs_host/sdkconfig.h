@@ -1,5 +1,9 @@
 #define CONFIG_NVS_ENCRYPTION 1
+#define CONFIG_NVS_ENCRYPTION_PAGE_CACHE 1
 #define CONFIG_LOG_MAXIMUM_LEVEL 3
 #define CONFIG_LOG_TIMESTAMP_SOURCE_RTOS 1
 #define CONFIG_IDF_TARGET_LINUX 1
 #define CONFIG_NVS_ASSERT_ERROR_CHECK 1
+#define CONFIG_NVS_READ_CACHE_SIZE 16
+#define CONFIG_NVS_BULK_PAGE_LOAD 1
+#define CONFIG_NVS_GC_FREE_PAGES 3
@@ -19,6 +19,8 @@
 #include <sys/wait.h>
 #include <string.h>
 #include <string>
+#include <chrono>
+#include <algorithm>
 
 #include "test_fixtures.hpp"
 
@@ -282,33 +284,24 @@ TEST_CASE("Page handles invalid CRC of variable length items", "[nvs][cur]")
     }
 }
 
-class HashListTestHelper : public HashList
-{
-    public:
-        size_t getBlockCount()
-        {
-            return mBlockList.size();
-        }
-};
-
 TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
 {
-    HashListTestHelper hashlist;
+    HashList hashlist;
     // Add items
-    const size_t count = 128;
+    const size_t count = Page::ENTRY_COUNT;
     for (size_t i = 0; i < count; ++i) {
         char key[16];
         snprintf(key, sizeof(key), "i%ld", (long int)i);
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items");
     // Remove them in reverse order
     for (size_t i = count; i > 0; --i) {
         // Make sure that the element existed before it's erased
         CHECK(hashlist.erase(i - 1) == true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.size() == 0);
     // Add again
     for (size_t i = 0; i < count; ++i) {
         char key[16];
@@ -316,12 +309,102 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
-    // Remove them in the same order
+    INFO("Added " << count << " items");
+    // Remove them in the same order, the remaining items have to be found after each removal
     for (size_t i = 0; i < count; ++i) {
         CHECK(hashlist.erase(i) == true);
+        if (i + 1 < count) {
+            char key[16];
+            snprintf(key, sizeof(key), "i%ld", (long int)(count - 1));
+            CHECK(hashlist.find(0, Item(1, ItemType::U32, 1, key)) == count - 1);
+        }
+    }
+    CHECK(hashlist.size() == 0);
+}
+
+TEST_CASE("HashList finds the lowest matching entry index starting from a given index", "[nvs]")
+{
+    HashList hashlist;
+    Item foo(1, ItemType::U32, 1, "foo");
+    Item bar(1, ItemType::U32, 1, "bar");
+    CHECK(hashlist.find(0, foo) == SIZE_MAX);
+    // the table is part of the list, it doesn't grow with the items
+    const size_t emptyUsage = hashlist.getMemoryUsage();
+    CHECK(emptyUsage < 1024);
+
+    // duplicates of an item exist on a page for a short time, e.g. after power loss
+    TEST_ESP_OK(hashlist.insert(foo, 70));
+    TEST_ESP_OK(hashlist.insert(bar, 3));
+    TEST_ESP_OK(hashlist.insert(foo, 10));
+    TEST_ESP_OK(hashlist.insert(foo, 40));
+    CHECK(hashlist.size() == 4);
+    CHECK(hashlist.getMemoryUsage() == emptyUsage);
+    CHECK(hashlist.find(0, foo) == 10);
+    CHECK(hashlist.find(11, foo) == 40);
+    CHECK(hashlist.find(41, foo) == 70);
+    CHECK(hashlist.find(71, foo) == SIZE_MAX);
+    CHECK(hashlist.find(0, bar) == 3);
+
+    CHECK(hashlist.erase(40) == true);
+    CHECK(hashlist.erase(40) == false);
+    CHECK(hashlist.find(11, foo) == 70);
+    CHECK(hashlist.find(0, bar) == 3);
+
+    // fill the whole page, lookups still have to work with a full table
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)i);
+        TEST_ESP_OK(hashlist.insert(Item(1, ItemType::U32, 1, key), i));
+    }
+    CHECK(hashlist.size() == static_cast<size_t>(Page::ENTRY_COUNT));
+    CHECK(hashlist.getMemoryUsage() == emptyUsage);
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)i);
+        CHECK(hashlist.find(0, Item(1, ItemType::U32, 1, key)) == i);
+    }
+    hashlist.clear();
+    CHECK(hashlist.size() == 0);
+    CHECK(hashlist.find(0, foo) == SIZE_MAX);
+}
+
+TEST_CASE("ItemIndex keeps reference counted pages per hash", "[nvs]")
+{
+    ItemIndex index;
+    Page pages[3];
+    Page* found[4];
+
+    CHECK(index.find(0x123456, found, 4) == 0);
+    index.insert(0x123456, &pages[0]);
+    index.insert(0x123456, &pages[0]);
+    index.insert(0x123456, &pages[1]);
+    index.insert(0x654321, &pages[2]);
+    CHECK(index.size() == 3);
+    CHECK(index.find(0x123456, found, 4) == 2);
+    CHECK(index.find(0x654321, found, 4) == 1);
+    CHECK(found[0] == &pages[2]);
+
+    // the first page still holds one item with this hash
+    index.erase(0x123456, &pages[0]);
+    CHECK(index.find(0x123456, found, 4) == 2);
+    index.erase(0x123456, &pages[0]);
+    CHECK(index.find(0x123456, found, 4) == 1);
+    CHECK(found[0] == &pages[1]);
+
+    // grow the table and remove everything again, in a different order
+    const size_t count = 1000;
+    for (size_t i = 0; i < count; ++i) {
+        index.insert(static_cast<uint32_t>(i * 7919), &pages[i % 3]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        CAPTURE(i);
+        REQUIRE(index.find(static_cast<uint32_t>(i * 7919), found, 4) >= 1);
+    }
+    for (size_t i = count; i > 0; --i) {
+        index.erase(static_cast<uint32_t>((i - 1) * 7919), &pages[(i - 1) % 3]);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(index.size() == 2);
+    CHECK(index.isValid());
 }
 
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
@@ -464,6 +547,535 @@ TEST_CASE("can write and read variable length data lots of times", "[nvs]")
 }
 
 
+class StorageLookupHelper : public Storage
+{
+public:
+    StorageLookupHelper(Partition *partition) : Storage(partition) { }
+
+    esp_err_t findIndexed(uint8_t nsIndex, const char* key)
+    {
+        Page* page;
+        Item item;
+        return findItem(nsIndex, ItemType::U32, key, page, item);
+    }
+
+    // lookup as done before the partition-wide item index was introduced
+    esp_err_t findLinear(uint8_t nsIndex, const char* key)
+    {
+        Item item;
+        for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+            size_t itemIndex = 0;
+            if (it->findItem(nsIndex, ItemType::U32, key, itemIndex, item) == ESP_OK) {
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    size_t getIndexSize() const
+    {
+        return mPageManager.getItemIndex().size();
+    }
+};
+
+TEST_CASE("storage finds items through the item index after writes, erases and init", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 8);
+    const size_t keyCount = Page::ENTRY_COUNT * 3;
+    char key[16];
+    {
+        StorageLookupHelper storage(&f.part);
+        REQUIRE(storage.init(0, 8) == ESP_OK);
+        // overwrite keys a few times, so that pages get freed and items are moved around
+        for (uint32_t round = 0; round < 4; ++round) {
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key_%d", (int) i);
+                REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i + round)) == ESP_OK);
+            }
+        }
+        for (size_t i = 0; i < keyCount; i += 2) {
+            snprintf(key, sizeof(key), "key_%d", (int) i);
+            REQUIRE(storage.eraseItem(1, key) == ESP_OK);
+        }
+        for (size_t i = 0; i < keyCount; ++i) {
+            CAPTURE(i);
+            snprintf(key, sizeof(key), "key_%d", (int) i);
+            CHECK(storage.findIndexed(1, key) == storage.findLinear(1, key));
+        }
+        CHECK(storage.getIndexSize() == keyCount / 2);
+    }
+    StorageLookupHelper storage(&f.part);
+    REQUIRE(storage.init(0, 8) == ESP_OK);
+    CHECK(storage.getIndexSize() == keyCount / 2);
+    for (size_t i = 0; i < keyCount; ++i) {
+        CAPTURE(i);
+        snprintf(key, sizeof(key), "key_%d", (int) i);
+        uint32_t value;
+        CHECK(storage.readItem(1, key, value) == ((i % 2) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND));
+        CHECK(storage.findIndexed(1, key) == storage.findLinear(1, key));
+    }
+}
+
+TEST_CASE("nvs_get_index_memory_usage reports memory of NVS indices", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 10);
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+
+    size_t indexBytes;
+    CHECK(nvs_get_index_memory_usage(NULL, &indexBytes) == ESP_ERR_NVS_NOT_INITIALIZED);
+    CHECK(nvs_get_index_memory_usage(NULL, NULL) == ESP_ERR_INVALID_ARG);
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part,
+            NVS_FLASH_SECTOR,
+            NVS_FLASH_SECTOR_COUNT_MIN));
+    TEST_ESP_OK(nvs_get_index_memory_usage(NULL, &indexBytes));
+    size_t emptyBytes = indexBytes;
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    for (int i = 0; i < 100; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        TEST_ESP_OK(nvs_set_i32(handle, key, i));
+    }
+    TEST_ESP_OK(nvs_get_index_memory_usage(NULL, &indexBytes));
+    CHECK(indexBytes > emptyBytes);
+    s_perf << "Index memory for 100 keys: " << indexBytes << " bytes" << std::endl;
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("benchmark item lookup with and without item index", "[nvs][item_index][long]")
+{
+    const size_t pageCounts[] = {8, 32, 64};
+    const size_t keyCounts[] = {100, 500, 2000};
+    const size_t rounds = 20;
+    // both lookups are timed a few times in turns, the fastest run of each is reported
+    const size_t repeats = 5;
+
+    for (size_t pageCount : pageCounts) {
+        for (size_t keyCount : keyCounts) {
+            if (keyCount > (pageCount - 2) * Page::ENTRY_COUNT) {
+                continue;
+            }
+            PartitionEmulationFixture f(0, pageCount);
+            StorageLookupHelper storage(&f.part);
+            REQUIRE(storage.init(0, pageCount) == ESP_OK);
+            std::vector<std::string> keys;
+            for (size_t i = 0; i < keyCount; ++i) {
+                keys.push_back("key_" + std::to_string(i));
+                REQUIRE(storage.writeItem(1, keys.back().c_str(), static_cast<uint32_t>(i)) == ESP_OK);
+            }
+
+            auto linearTime = std::chrono::steady_clock::duration::max();
+            auto indexedTime = std::chrono::steady_clock::duration::max();
+            for (size_t repeat = 0; repeat < repeats; ++repeat) {
+                auto start = std::chrono::steady_clock::now();
+                for (size_t r = 0; r < rounds; ++r) {
+                    for (const auto& key : keys) {
+                        REQUIRE(storage.findLinear(1, key.c_str()) == ESP_OK);
+                    }
+                }
+                linearTime = std::min(linearTime, std::chrono::steady_clock::now() - start);
+
+                start = std::chrono::steady_clock::now();
+                for (size_t r = 0; r < rounds; ++r) {
+                    for (const auto& key : keys) {
+                        REQUIRE(storage.findIndexed(1, key.c_str()) == ESP_OK);
+                    }
+                }
+                indexedTime = std::min(indexedTime, std::chrono::steady_clock::now() - start);
+            }
+
+            const size_t lookups = rounds * keyCount;
+            s_perf << "Item lookup (" << pageCount << " pages, " << keyCount << " keys): "
+                   << std::chrono::duration_cast<std::chrono::nanoseconds>(linearTime).count() / lookups << " ns per page walk, "
+                   << std::chrono::duration_cast<std::chrono::nanoseconds>(indexedTime).count() / lookups << " ns with item index" << std::endl;
+        }
+    }
+}
+
+TEST_CASE("storage read cache returns current values after writes and erases", "[nvs][read_cache]")
+{
+    PartitionEmulationFixture f(0, 8);
+    Storage storage(&f.part);
+    REQUIRE(storage.init(0, 8) == ESP_OK);
+    REQUIRE(storage.setReadCacheCapacity(4) == ESP_OK);
+    nvs_read_cache_stats_t stats;
+    uint32_t value;
+
+    REQUIRE(storage.writeItem(1, "key", static_cast<uint32_t>(1)) == ESP_OK);
+    CHECK(storage.readItem(1, "key", value) == ESP_OK);
+    CHECK(value == 1);
+    CHECK(storage.readItem(1, "key", value) == ESP_OK);
+    CHECK(value == 1);
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 1);
+    CHECK(stats.used_entries == 1);
+    CHECK(stats.total_entries == 4);
+
+    // a cached value has the same size checks as a value read from flash
+    uint16_t shortValue;
+    CHECK(storage.readItem(1, ItemType::U32, "key", &shortValue, sizeof(shortValue)) == ESP_ERR_NVS_TYPE_MISMATCH);
+
+    REQUIRE(storage.writeItem(1, "key", static_cast<uint32_t>(2)) == ESP_OK);
+    CHECK(storage.readItem(1, "key", value) == ESP_OK);
+    CHECK(value == 2);
+    REQUIRE(storage.eraseItem(1, ItemType::U32, "key") == ESP_OK);
+    CHECK(storage.readItem(1, "key", value) == ESP_ERR_NVS_NOT_FOUND);
+
+    const char shortString[] = "short string";
+    char buf[64];
+    size_t size;
+    REQUIRE(storage.writeItem(1, ItemType::SZ, "str", shortString, sizeof(shortString)) == ESP_OK);
+    CHECK(storage.readItem(1, ItemType::SZ, "str", buf, sizeof(buf)) == ESP_OK);
+    CHECK(strcmp(buf, shortString) == 0);
+    storage.fillReadCacheStats(stats);
+    size_t hits = stats.hits;
+    // the size is taken from the cache without counting a hit, only the reads are counted
+    CHECK(storage.getItemDataSize(1, ItemType::SZ, "str", size) == ESP_OK);
+    CHECK(size == sizeof(shortString));
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == hits);
+    CHECK(storage.readItem(1, ItemType::SZ, "str", buf, sizeof(shortString) - 1) == ESP_ERR_NVS_INVALID_LENGTH);
+    CHECK(storage.readItem(1, ItemType::SZ, "str", buf, sizeof(shortString)) == ESP_OK);
+    CHECK(strcmp(buf, shortString) == 0);
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == hits + 2);
+
+    // strings longer than ReadCache::MAX_VALUE_SIZE are always read from flash
+    const char longString[] = "this string is too long to be kept in the read cache";
+    REQUIRE(storage.writeItem(1, ItemType::SZ, "long", longString, sizeof(longString)) == ESP_OK);
+    storage.fillReadCacheStats(stats);
+    size_t misses = stats.misses;
+    for (int i = 0; i < 2; ++i) {
+        CHECK(storage.readItem(1, ItemType::SZ, "long", buf, sizeof(buf)) == ESP_OK);
+        CHECK(strcmp(buf, longString) == 0);
+    }
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.misses == misses + 2);
+
+    REQUIRE(storage.writeItem(2, "key", static_cast<uint32_t>(3)) == ESP_OK);
+    CHECK(storage.readItem(2, "key", value) == ESP_OK);
+    REQUIRE(storage.eraseNamespace(2) == ESP_OK);
+    CHECK(storage.readItem(2, "key", value) == ESP_ERR_NVS_NOT_FOUND);
+}
+
+TEST_CASE("storage read cache evicts least recently used values", "[nvs][read_cache]")
+{
+    PartitionEmulationFixture f(0, 8);
+    Storage storage(&f.part);
+    REQUIRE(storage.init(0, 8) == ESP_OK);
+    REQUIRE(storage.setReadCacheCapacity(4) == ESP_OK);
+    nvs_read_cache_stats_t stats;
+    char key[16];
+    uint32_t value;
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        REQUIRE(storage.writeItem(1, key, i) == ESP_OK);
+    }
+    // reading key0 again keeps it in the cache, key1 gets evicted by key4
+    for (int i : {0, 1, 2, 3, 0, 4}) {
+        snprintf(key, sizeof(key), "key%d", i);
+        CHECK(storage.readItem(1, key, value) == ESP_OK);
+        CHECK(value == static_cast<uint32_t>(i));
+    }
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 5);
+    CHECK(stats.used_entries == 4);
+
+    for (int i : {0, 2, 3, 4}) {
+        snprintf(key, sizeof(key), "key%d", i);
+        CHECK(storage.readItem(1, key, value) == ESP_OK);
+    }
+    CHECK(storage.readItem(1, "key1", value) == ESP_OK);
+    CHECK(value == 1);
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == 5);
+    CHECK(stats.misses == 6);
+
+    REQUIRE(storage.setReadCacheCapacity(0) == ESP_OK);
+    CHECK(storage.readItem(1, "key1", value) == ESP_OK);
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == 0);
+    CHECK(stats.total_entries == 0);
+}
+
+TEST_CASE("nvs_get_read_cache_stats reports read cache counters", "[nvs][read_cache]")
+{
+    PartitionEmulationFixture f(0, 10);
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+
+    nvs_read_cache_stats_t stats;
+    CHECK(nvs_get_read_cache_stats(NULL, &stats) == ESP_ERR_NVS_NOT_INITIALIZED);
+    CHECK(nvs_get_read_cache_stats(NULL, NULL) == ESP_ERR_INVALID_ARG);
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part,
+            NVS_FLASH_SECTOR,
+            NVS_FLASH_SECTOR_COUNT_MIN));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "key", 42));
+    TEST_ESP_OK(nvs_get_read_cache_stats(NULL, &stats));
+    size_t hits = stats.hits;
+    size_t misses = stats.misses;
+
+    int32_t value;
+    for (int i = 0; i < 3; ++i) {
+        TEST_ESP_OK(nvs_get_i32(handle, "key", &value));
+        CHECK(value == 42);
+    }
+    TEST_ESP_OK(nvs_get_read_cache_stats(NULL, &stats));
+    CHECK(stats.hits == hits + 2);
+    CHECK(stats.misses == misses + 1);
+    CHECK(stats.used_entries > 0);
+    CHECK(stats.total_entries == CONFIG_NVS_READ_CACHE_SIZE);
+
+    TEST_ESP_OK(nvs_set_i32(handle, "key", 43));
+    TEST_ESP_OK(nvs_get_i32(handle, "key", &value));
+    CHECK(value == 43);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("benchmark reads with and without read cache", "[nvs][read_cache][long]")
+{
+    const size_t keyCount = 16;
+    const size_t rounds = 1000;
+    char key[16];
+    const char str[] = "a short string";
+    char buf[sizeof(str)];
+    int64_t readTime[2];
+    size_t flashTime[2];
+    size_t readOps[2];
+
+    for (int useCache = 0; useCache < 2; ++useCache) {
+        PartitionEmulationFixture f(0, 8);
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, 8) == ESP_OK);
+        REQUIRE(storage.setReadCacheCapacity(useCache ? keyCount * 2 : 0) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "int%d", (int) i);
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+            snprintf(key, sizeof(key), "str%d", (int) i);
+            REQUIRE(storage.writeItem(1, ItemType::SZ, key, str, sizeof(str)) == ESP_OK);
+        }
+
+        f.emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < keyCount; ++i) {
+                uint32_t value;
+                snprintf(key, sizeof(key), "int%d", (int) i);
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+                snprintf(key, sizeof(key), "str%d", (int) i);
+                REQUIRE(storage.readItem(1, ItemType::SZ, key, buf, sizeof(buf)) == ESP_OK);
+            }
+        }
+        readTime[useCache] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        flashTime[useCache] = f.emu.getTotalTime();
+        readOps[useCache] = f.emu.getReadOps();
+    }
+
+    CHECK(readOps[1] < readOps[0]);
+    const size_t reads = rounds * keyCount * 2;
+    s_perf << "Read of cached values (" << keyCount * 2 << " keys): "
+           << readTime[0] / reads << " ns and " << readOps[0] << " flash reads (" << flashTime[0] << " us) without cache, "
+           << readTime[1] / reads << " ns and " << readOps[1] << " flash reads (" << flashTime[1] << " us) with cache" << std::endl;
+}
+
+TEST_CASE("page loaded with a single read has the same contents as a page loaded entry by entry", "[nvs][bulk_load]")
+{
+    const size_t pageCount = 6;
+    PartitionEmulationFixture f(0, pageCount);
+    const size_t keyCount = 300;
+    char key[16];
+    {
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, pageCount) == ESP_OK);
+        const char str[] = "a string which takes two entries";
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key_%d", (int) i);
+            if (i % 3 == 0) {
+                REQUIRE(storage.writeItem(1, ItemType::SZ, key, str, sizeof(str)) == ESP_OK);
+            } else {
+                REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+            }
+        }
+        for (size_t i = 0; i < keyCount; i += 5) {
+            snprintf(key, sizeof(key), "key_%d", (int) i);
+            REQUIRE(storage.eraseItem(1, key) == ESP_OK);
+        }
+    }
+
+    uint8_t pageBuffer[Page::SEC_SIZE];
+    for (size_t sector = 0; sector < pageCount; ++sector) {
+        CAPTURE(sector);
+        Page page;
+        Page bulkPage;
+        f.emu.clearStats();
+        REQUIRE(page.load(&f.part, sector) == ESP_OK);
+        size_t readOps = f.emu.getReadOps();
+        f.emu.clearStats();
+        REQUIRE(bulkPage.load(&f.part, sector, pageBuffer) == ESP_OK);
+        // the active page additionally looks up its last item to check it for duplicates
+        CHECK(f.emu.getReadOps() <= ((page.state() == Page::PageState::ACTIVE) ? 2 : 1));
+        CHECK(f.emu.getReadOps() < readOps);
+
+        CHECK(bulkPage.state() == page.state());
+        CHECK(bulkPage.getUsedEntryCount() == page.getUsedEntryCount());
+        CHECK(bulkPage.getErasedEntryCount() == page.getErasedEntryCount());
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key_%d", (int) i);
+            CHECK(bulkPage.findItem(1, ItemType::ANY, key) == page.findItem(1, ItemType::ANY, key));
+        }
+    }
+}
+
+TEST_CASE("deferred crc check erases corrupted items of full pages on first access", "[nvs][bulk_load]")
+{
+    PartitionEmulationFixture f(0, 3);
+    Storage storage(&f.part);
+    TEST_ESP_OK(storage.init(0, 3));
+    TEST_ESP_OK(storage.writeItem(0, "ns1", static_cast<uint8_t>(1)));
+    TEST_ESP_OK(storage.writeItem(1, "value1", static_cast<uint32_t>(1)));
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        char item_name[Item::MAX_KEY_LENGTH + 1];
+        snprintf(item_name, sizeof(item_name), "item_%ld", (long int)i);
+        TEST_ESP_OK(storage.writeItem(1, item_name, static_cast<uint32_t>(i)));
+    }
+
+    // corrupt the value of "value1", which is stored on the first page, now full
+    uint32_t val = 0;
+    f.emu.write(32 * 3 + 24, &val, 4);
+
+    uint8_t pageBuffer[Page::SEC_SIZE];
+    Page page;
+    TEST_ESP_OK(page.load(&f.part, 0, pageBuffer, true));
+    CHECK(page.state() == Page::PageState::FULL);
+    size_t usedEntries = page.getUsedEntryCount();
+    TEST_ESP_ERR(page.findItem(1, ItemType::U32, "value1"), ESP_ERR_NVS_NOT_FOUND);
+    CHECK(page.getUsedEntryCount() == usedEntries - 1);
+    TEST_ESP_OK(page.findItem(1, ItemType::U32, "item_0"));
+
+    Page checkedPage;
+    TEST_ESP_OK(checkedPage.load(&f.part, 0, pageBuffer));
+    CHECK(checkedPage.getUsedEntryCount() == usedEntries - 1);
+}
+
+TEST_CASE("deferred crc check removes corrupted items from the item index and namespace counts", "[nvs][bulk_load]")
+{
+    // the corrupted item is dropped either on first access, or when all deferred items are checked,
+    // which Storage does before namespace counts are used
+    for (bool checkAll : {false, true}) {
+        CAPTURE(checkAll);
+        PartitionEmulationFixture f(0, 3);
+        {
+            Storage storage(&f.part);
+            TEST_ESP_OK(storage.init(0, 3));
+            TEST_ESP_OK(storage.writeItem(0, "ns1", static_cast<uint8_t>(1)));
+            TEST_ESP_OK(storage.writeItem(1, "value1", static_cast<uint32_t>(1)));
+            for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+                char item_name[Item::MAX_KEY_LENGTH + 1];
+                snprintf(item_name, sizeof(item_name), "item_%ld", (long int)i);
+                TEST_ESP_OK(storage.writeItem(1, item_name, static_cast<uint32_t>(i)));
+            }
+        }
+
+        // corrupt the value of "value1", which is stored on the first page, now full
+        uint32_t val = 0;
+        f.emu.write(32 * 3 + 24, &val, 4);
+        const uint32_t hash = Item(1, ItemType::U32, 0, "value1").calculateCrc32WithoutValue();
+        Page* candidates[1];
+        uint8_t pageBuffer[Page::SEC_SIZE];
+
+        ItemIndex index;
+        Page page;
+        page.setItemIndex(&index);
+        TEST_ESP_OK(page.load(&f.part, 0, pageBuffer, true));
+        CHECK(index.find(hash, candidates, 1) == 1);
+        const size_t indexSize = index.size();
+        const size_t nsEntries = index.getNamespaceEntryCount(1);
+
+        if (checkAll) {
+            TEST_ESP_OK(page.checkDeferredItems());
+        } else {
+            TEST_ESP_ERR(page.findItem(1, ItemType::U32, "value1"), ESP_ERR_NVS_NOT_FOUND);
+        }
+        CHECK(index.find(hash, candidates, 1) == 0);
+        CHECK(index.size() == indexSize - 1);
+        CHECK(index.getNamespaceEntryCount(1) == nsEntries - 1);
+        TEST_ESP_OK(page.findItem(1, ItemType::U32, "item_0"));
+
+        // same as if all CRCs had been checked during load
+        ItemIndex checkedIndex;
+        Page checkedPage;
+        checkedPage.setItemIndex(&checkedIndex);
+        TEST_ESP_OK(checkedPage.load(&f.part, 0, pageBuffer));
+        CHECK(checkedIndex.size() == index.size());
+        CHECK(checkedIndex.getNamespaceEntryCount(1) == index.getNamespaceEntryCount(1));
+        CHECK(checkedPage.getUsedEntryCount() == page.getUsedEntryCount());
+    }
+}
+
+TEST_CASE("benchmark page load with and without a single read per page", "[nvs][bulk_load][long]")
+{
+    const size_t pageCounts[] = {8, 32, 64};
+    char key[16];
+    const char str[] = "a short string";
+    uint8_t pageBuffer[Page::SEC_SIZE];
+
+    for (size_t pageCount : pageCounts) {
+        PartitionEmulationFixture f(0, pageCount);
+        {
+            Storage storage(&f.part);
+            REQUIRE(storage.init(0, pageCount) == ESP_OK);
+            // fill all but the last two pages, with a mix of primitive values and strings
+            const size_t keyCount = (pageCount - 2) * Page::ENTRY_COUNT / 2;
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key_%d", (int) i);
+                if (i % 2) {
+                    REQUIRE(storage.writeItem(1, ItemType::SZ, key, str, sizeof(str)) == ESP_OK);
+                } else {
+                    REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+                }
+            }
+        }
+
+        size_t readOps[3];
+        size_t flashTime[3];
+        int64_t loadTime[3];
+        for (int mode = 0; mode < 3; ++mode) {
+            std::unique_ptr<Page[]> pages(new Page[pageCount]);
+            f.emu.clearStats();
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < pageCount; ++i) {
+                REQUIRE(pages[i].load(&f.part, i, (mode > 0) ? pageBuffer : nullptr, mode == 2) == ESP_OK);
+            }
+            loadTime[mode] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            readOps[mode] = f.emu.getReadOps();
+            flashTime[mode] = f.emu.getTotalTime();
+        }
+
+        CHECK(readOps[1] <= pageCount + 1);
+        CHECK(readOps[1] < readOps[0]);
+        s_perf << "Page load (" << pageCount << " pages): "
+               << readOps[0] << " reads, " << flashTime[0] << " us flash, " << loadTime[0] << " us host entry by entry; "
+               << readOps[1] << " reads, " << flashTime[1] << " us flash, " << loadTime[1] << " us host with single read; "
+               << loadTime[2] << " us host with deferred crc check" << std::endl;
+    }
+}
+
 TEST_CASE("can get length of variable length data", "[nvs]")
 {
     PartitionEmulationFixture f(0, 8);
@@ -990,6 +1602,162 @@ TEST_CASE("nvs iterators tests", "[nvs]")
     TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 }
 
+static size_t countNamespaceKeys(const char* ns)
+{
+    size_t count = 0;
+    nvs_iterator_t it = nullptr;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, ns, NVS_TYPE_ANY, &it);
+    while (res == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        if (ns) {
+            CHECK(strcmp(info.namespace_name, ns) == 0);
+        }
+        ++count;
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    return count;
+}
+
+TEST_CASE("per-namespace index keeps entry counts and iteration of one namespace exact", "[nvs][ns_index]")
+{
+    PartitionEmulationFixture f(0, 10);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10));
+
+    const char* names[] = {"ns0", "ns1", "ns2"};
+    nvs_handle_t handles[3];
+    for (int n = 0; n < 3; ++n) {
+        TEST_ESP_OK(nvs_open(names[n], NVS_READWRITE, &handles[n]));
+    }
+
+    // the entries of all namespaces plus one entry per namespace name add up to the used entries
+    auto checkCounts = [&]() {
+        size_t sum = 0;
+        for (int n = 0; n < 3; ++n) {
+            size_t used;
+            TEST_ESP_OK(nvs_get_used_entry_count(handles[n], &used));
+            sum += used;
+        }
+        nvs_stats_t stats;
+        TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+        CHECK(sum + 3 == stats.used_entries);
+    };
+
+    char key[16];
+    char str[100];
+    uint8_t blob[5000];
+    memset(blob, 0x5a, sizeof(blob));
+    for (int round = 0; round < 3; ++round) {
+        for (int n = 0; n < 3; ++n) {
+            for (int i = 0; i < 10 * (n + 1); ++i) {
+                snprintf(key, sizeof(key), "u%d", i);
+                TEST_ESP_OK(nvs_set_u32(handles[n], key, round * 100 + i));
+                snprintf(key, sizeof(key), "s%d", i);
+                snprintf(str, sizeof(str), "%*d", 10 + round * 30, i);
+                TEST_ESP_OK(nvs_set_str(handles[n], key, str));
+            }
+        }
+        TEST_ESP_OK(nvs_set_blob(handles[1], "blob", blob, 1000 + round * 2000));
+        checkCounts();
+    }
+    CHECK(countNamespaceKeys("ns0") == 20);
+    CHECK(countNamespaceKeys("ns1") == 41);
+    CHECK(countNamespaceKeys("ns2") == 60);
+    CHECK(countNamespaceKeys(NULL) == 121);
+
+    TEST_ESP_OK(nvs_erase_key(handles[2], "u3"));
+    TEST_ESP_OK(nvs_erase_key(handles[1], "blob"));
+    checkCounts();
+    CHECK(countNamespaceKeys("ns1") == 40);
+    CHECK(countNamespaceKeys("ns2") == 59);
+
+    TEST_ESP_OK(nvs_erase_all(handles[0]));
+    size_t used;
+    TEST_ESP_OK(nvs_get_used_entry_count(handles[0], &used));
+    CHECK(used == 0);
+    CHECK(countNamespaceKeys("ns0") == 0);
+    checkCounts();
+
+    // moving items to other pages keeps the counts
+    while (nvs_gc_step(NULL, 16) == ESP_ERR_NOT_FINISHED) {
+    }
+    checkCounts();
+
+    // the counts are rebuilt when the partition is loaded
+    size_t before[3];
+    for (int n = 0; n < 3; ++n) {
+        TEST_ESP_OK(nvs_get_used_entry_count(handles[n], &before[n]));
+        nvs_close(handles[n]);
+    }
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10));
+    for (int n = 0; n < 3; ++n) {
+        TEST_ESP_OK(nvs_open(names[n], NVS_READWRITE, &handles[n]));
+        TEST_ESP_OK(nvs_get_used_entry_count(handles[n], &used));
+        CHECK(used == before[n]);
+    }
+    checkCounts();
+    CHECK(countNamespaceKeys("ns2") == 59);
+    for (int n = 0; n < 3; ++n) {
+        nvs_close(handles[n]);
+    }
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("benchmark namespace enumeration with the per-namespace index", "[nvs][ns_index][long]")
+{
+    const int nsCount = 20;
+    const int keyCount = 50;
+    PartitionEmulationFixture f(0, 20);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 20));
+
+    char name[16];
+    char key[16];
+    for (int n = 0; n < nsCount; ++n) {
+        snprintf(name, sizeof(name), "ns%d", n);
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open(name, NVS_READWRITE, &handle));
+        for (int i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", i);
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+        nvs_close(handle);
+    }
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("ns7", NVS_READWRITE, &handle));
+
+    f.emu.clearStats();
+    size_t used;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used));
+    CHECK(used == keyCount);
+    size_t countReads = f.emu.getReadOps();
+
+    f.emu.clearStats();
+    CHECK(countNamespaceKeys("ns7") == keyCount);
+    size_t listReads = f.emu.getReadOps();
+
+    f.emu.clearStats();
+    CHECK(countNamespaceKeys(NULL) == nsCount * keyCount);
+    size_t listAllReads = f.emu.getReadOps();
+
+    f.emu.clearStats();
+    TEST_ESP_OK(nvs_erase_all(handle));
+    size_t eraseReads = f.emu.getReadOps();
+    CHECK(countNamespaceKeys("ns7") == 0);
+
+    CHECK(countReads == 0);
+    CHECK(listReads * 10 < listAllReads);
+    CHECK(eraseReads * 5 < listAllReads);
+    s_perf << "Flash reads for one of " << nsCount << " namespaces with " << keyCount << " keys each: "
+           << countReads << " to count entries, " << listReads << " to list keys, " << eraseReads
+           << " to erase it (" << listAllReads << " to list all keys)" << std::endl;
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
 TEST_CASE("Iterator with not matching type iterates correctly", "[nvs]")
 {
     PartitionEmulationFixture f(0, 5);
@@ -1476,194 +2244,992 @@ public:
                     char buf[strBufLen];
                     size_t len = strBufLen;
 
-                    size_t strLen = gen() % (strBufLen - 1);
-                    std::generate_n(buf, strLen, [&]() -> char {
-                        const char c = static_cast<char>(gen() % 127);
-                        return (c < 32) ? 32 : c;
-                    });
-                    buf[strLen] = 0;
+                    size_t strLen = gen() % (strBufLen - 1);
+                    std::generate_n(buf, strLen, [&]() -> char {
+                        const char c = static_cast<char>(gen() % 127);
+                        return (c < 32) ? 32 : c;
+                    });
+                    buf[strLen] = 0;
+
+                    auto err = nvs_set_str(handle, keys[index], buf);
+                    if (err == ESP_ERR_FLASH_OP_FAIL) {
+                        return err;
+                    }
+                    if (err == ESP_ERR_NVS_REMOVE_FAILED) {
+                        written[index] = true;
+                        strncpy(reinterpret_cast<char*>(values[index]), buf, strBufLen);
+                        return ESP_ERR_FLASH_OP_FAIL;
+                    }
+                    REQUIRE(err == ESP_OK);
+                    written[index] = true;
+                    strncpy(reinterpret_cast<char*>(values[index]), buf, strBufLen);
+                    break;
+                }
+
+                case ItemType::BLOB:
+                {
+                    uint32_t blobBufLen = 0;
+                    if(strncmp(keys[index],"singlepage", sizeof("singlepage")) == 0) {
+                       blobBufLen = smallBlobLen ;
+                    } else {
+                       blobBufLen = largeBlobLen ;
+                    }
+                    uint8_t buf[blobBufLen];
+                    memset(buf, 0, blobBufLen);
+                    size_t blobLen = gen() % blobBufLen;
+                    std::generate_n(buf, blobLen, [&]() -> uint8_t {
+                        return static_cast<uint8_t>(gen() % 256);
+                    });
+
+                    auto err = nvs_set_blob(handle, keys[index], buf, blobLen);
+                    if (err == ESP_ERR_FLASH_OP_FAIL) {
+                        return err;
+                    }
+                    if (err == ESP_ERR_NVS_REMOVE_FAILED) {
+                        written[index] = true;
+                        memcpy(reinterpret_cast<uint8_t*>(values[index]), buf, blobBufLen);
+                        return ESP_ERR_FLASH_OP_FAIL;
+                    }
+                    REQUIRE(err == ESP_OK);
+                    written[index] = true;
+                    memcpy(reinterpret_cast<char*>(values[index]), buf, blobBufLen);
+                    break;
+                }
+
+                default:
+                    assert(0);
+            }
+            return ESP_OK;
+        };
+
+
+        for (; count != 0; --count) {
+            size_t index = gen() % (nKeys);
+            switch (gen() % 3) {
+                case 0:  // read, 1/3
+                    if (randomRead(index) == ESP_ERR_FLASH_OP_FAIL) {
+                        return ESP_ERR_FLASH_OP_FAIL;
+                    }
+                    break;
+
+                default: // write, 2/3
+                    if (randomWrite(index) == ESP_ERR_FLASH_OP_FAIL) {
+                        return ESP_ERR_FLASH_OP_FAIL;
+                    }
+                    break;
+            }
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t handleExternalWriteAtIndex(uint8_t index, const void* value, const size_t len ) {
+        if(index == 9) {  /* This is only done for small-page blobs for now*/
+            if(len > smallBlobLen) {
+                return ESP_FAIL;
+            }
+            memcpy(v10, value, len);
+            written[index] = true;
+            return ESP_OK;
+        } else {
+            return ESP_FAIL;
+        }
+    }
+};
+
+TEST_CASE("monkey test", "[nvs][monkey]")
+{
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    uint32_t seed = 3;
+    gen.seed(seed);
+
+    PartitionEmulationFixture f(0, 10);
+    f.emu.randomize(seed);
+    f.emu.clearStats();
+
+    const uint32_t NVS_FLASH_SECTOR = 2;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 8;
+    f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part,
+            NVS_FLASH_SECTOR,
+            NVS_FLASH_SECTOR_COUNT_MIN));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    RandomTest test;
+    size_t count = 1000;
+    CHECK(test.doRandomThings(handle, gen, count) == ESP_OK);
+
+    s_perf << "Monkey test: nErase=" << f.emu.getEraseOps() << " nWrite=" << f.emu.getWriteOps() << std::endl;
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("test recovery from sudden poweroff", "[long][nvs][recovery][monkey]")
+{
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    uint32_t seed = 3;
+    gen.seed(seed);
+    const size_t iter_count = 2000;
+
+    size_t totalOps = 0;
+    int lastPercent = -1;
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+
+        PartitionEmulationFixture f(0, 10);
+        const uint32_t NVS_FLASH_SECTOR = 2;
+        const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 8;
+        f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+
+        f.emu.randomize(seed);
+        f.emu.clearStats();
+        f.emu.failAfter(errDelay);
+        RandomTest test;
+
+        if (totalOps != 0) {
+            int percent = errDelay * 100 / totalOps;
+            if (percent > lastPercent) {
+                printf("%d/%d (%d%%)\r\n", errDelay, static_cast<int>(totalOps), percent);
+                lastPercent = percent;
+            }
+        }
+
+
+        nvs_handle_t handle;
+        size_t count = iter_count;
+
+        if (NVSPartitionManager::get_instance()->init_custom(&f.part,
+                NVS_FLASH_SECTOR,
+                NVS_FLASH_SECTOR_COUNT_MIN) == ESP_OK) {
+            auto res = ESP_ERR_FLASH_OP_FAIL;
+            if (nvs_open("namespace1", NVS_READWRITE, &handle) == ESP_OK) {
+                res = test.doRandomThings(handle, gen, count);
+                nvs_close(handle);
+            }
+
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+            if (res != ESP_ERR_FLASH_OP_FAIL) {
+                // This means we got to the end without an error due to f.emu.failAfter(), therefore errDelay
+                // is high enough that we're not triggering it any more, therefore we're done
+                break;
+            }
+        }
+
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part,
+                NVS_FLASH_SECTOR,
+                NVS_FLASH_SECTOR_COUNT_MIN));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        auto res = test.doRandomThings(handle, gen, count);
+        if (res != ESP_OK) {
+            nvs_dump(NVS_DEFAULT_PART_NAME);
+            CHECK(0);
+        }
+        nvs_close(handle);
+        totalOps = f.emu.getEraseOps() + f.emu.getWriteBytes() / 4;
+
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+}
+
+TEST_CASE("nvs transaction stages values until it is committed", "[nvs][transaction]")
+{
+    PartitionEmulationFixture f(0, 10);
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part,
+            NVS_FLASH_SECTOR,
+            NVS_FLASH_SECTOR_COUNT_MIN));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "foo", 1));
+    TEST_ESP_ERR(nvs_transaction_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_transaction_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_OK(nvs_set_i32(handle, "foo", 2));
+    TEST_ESP_OK(nvs_set_i32(handle, "foo", 3));
+    TEST_ESP_OK(nvs_set_str(handle, "str", "staged in a transaction"));
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", "blob", 4), ESP_ERR_NOT_SUPPORTED);
+    TEST_ESP_ERR(nvs_erase_key(handle, "foo"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    // readers see stored values until the transaction is committed
+    int32_t value;
+    size_t len;
+    TEST_ESP_OK(nvs_get_i32(handle, "foo", &value));
+    CHECK(value == 1);
+    TEST_ESP_ERR(nvs_get_str(handle, "str", NULL, &len), ESP_ERR_NVS_NOT_FOUND);
+
+    TEST_ESP_OK(nvs_transaction_commit(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "foo", &value));
+    CHECK(value == 3);
+    char buf[32];
+    len = sizeof(buf);
+    TEST_ESP_OK(nvs_get_str(handle, "str", buf, &len));
+    CHECK(strcmp(buf, "staged in a transaction") == 0);
+
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "foo", 4));
+    TEST_ESP_OK(nvs_transaction_abort(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "foo", &value));
+    CHECK(value == 3);
+
+    // a transaction has to fit into one page, it doesn't fit into the rest of the current one
+    const size_t maxEntries = Transaction::MAX_ENTRY_COUNT;
+    char key[16];
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    for (size_t i = 0; i < maxEntries; ++i) {
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        TEST_ESP_OK(nvs_set_i32(handle, key, i));
+    }
+    TEST_ESP_ERR(nvs_set_i32(handle, "onemore", 0), ESP_ERR_NVS_TRANSACTION_TOO_BIG);
+    TEST_ESP_OK(nvs_transaction_commit(handle));
+    for (size_t i = 0; i < maxEntries; ++i) {
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        TEST_ESP_OK(nvs_get_i32(handle, key, &value));
+        CHECK(value == static_cast<int32_t>(i));
+    }
+    TEST_ESP_OK(nvs_get_i32(handle, "foo", &value));
+    CHECK(value == 3);
+    nvs_close(handle);
+
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_READ_ONLY);
+    nvs_close(handle);
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs transaction needs fewer flash writes than separate writes", "[nvs][transaction]")
+{
+    const size_t keyCount = 50;
+    char key[16];
+    size_t writeOps[2][2];
+
+    for (int useTransaction = 0; useTransaction < 2; ++useTransaction) {
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+        // first pass writes new keys, second pass overwrites them
+        for (int pass = 0; pass < 2; ++pass) {
+            f.emu.clearStats();
+            if (useTransaction) {
+                TEST_ESP_OK(nvs_transaction_begin(handle));
+            }
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+                TEST_ESP_OK(nvs_set_u32(handle, key, pass * 1000 + i));
+            }
+            if (useTransaction) {
+                TEST_ESP_OK(nvs_transaction_commit(handle));
+            }
+            writeOps[useTransaction][pass] = f.emu.getWriteOps();
+        }
+
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+
+    CHECK(writeOps[1][0] * 4 < writeOps[0][0]);
+    CHECK(writeOps[1][1] < writeOps[0][1]);
+    s_perf << "Flash writes for " << keyCount << " new keys: " << writeOps[0][0] << " separately, "
+           << writeOps[1][0] << " in a transaction" << std::endl;
+    s_perf << "Flash writes for " << keyCount << " updated keys: " << writeOps[0][1] << " separately, "
+           << writeOps[1][1] << " in a transaction" << std::endl;
+}
+
+TEST_CASE("nvs transaction is applied completely or not at all if power is lost", "[nvs][transaction][recovery]")
+{
+    const size_t keyCount = 40;
+    const size_t strCount = 4;
+    const uint32_t oldBase = 0;
+    const uint32_t newBase = 1000;
+    char key[16];
+    char str[64];
+
+    auto setValues = [&](nvs_handle_t handle, uint32_t base) {
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, base + i));
+        }
+        for (size_t i = 0; i < strCount; ++i) {
+            snprintf(key, sizeof(key), "str%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of a string which takes a few entries", static_cast<int>(base + i));
+            TEST_ESP_OK(nvs_set_str(handle, key, str));
+        }
+    };
+
+    size_t failurePoints = 0;
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, 5);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        // fill the first page, so that committing the transaction has to switch to the next one
+        for (size_t i = 0; i < 60; ++i) {
+            snprintf(key, sizeof(key), "fill%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u8(handle, key, i));
+        }
+        setValues(handle, oldBase);
+
+        f.emu.failAfter(errDelay);
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        setValues(handle, newBase);
+        esp_err_t err = nvs_transaction_commit(handle);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+        f.emu.failAfter(UINT32_MAX);
+
+        // the transaction must be complete once the commit record was written, which is the case if
+        // the commit succeeded or only removing the old values failed
+        const bool committed = (err == ESP_OK || err == ESP_ERR_NVS_REMOVE_FAILED);
+        const uint32_t base = committed ? newBase : oldBase;
+
+        // firmware which doesn't know about transactions looks up namespaces like this,
+        // transaction records left on flash must not get in its way
+        for (size_t i = 0; i < 5; ++i) {
+            Page p;
+            TEST_ESP_OK(p.load(&f.part, i));
+            size_t itemIndex = 0;
+            Item item;
+            esp_err_t findErr;
+            while ((findErr = p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item)) == ESP_OK) {
+                itemIndex += item.span;
+            }
+            CHECK(findErr == ESP_ERR_NVS_NOT_FOUND);
+        }
+
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == base + i);
+        }
+        for (size_t i = 0; i < strCount; ++i) {
+            snprintf(key, sizeof(key), "str%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of a string which takes a few entries", static_cast<int>(base + i));
+            char buf[64];
+            size_t len = sizeof(buf);
+            TEST_ESP_OK(nvs_get_str(handle, key, buf, &len));
+            CHECK(strcmp(buf, str) == 0);
+        }
+        uint8_t fill;
+        TEST_ESP_OK(nvs_get_u8(handle, "fill0", &fill));
+
+        // the partition must still be writable after recovery
+        TEST_ESP_OK(nvs_set_u32(handle, "key0", 12345));
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        if (err == ESP_OK) {
+            break;
+        }
+        ++failurePoints;
+    }
+    s_perf << "Transaction atomicity checked at " << failurePoints << " power loss points" << std::endl;
+}
+
+TEST_CASE("nvs transaction which failed to be written doesn't take items written after it", "[nvs][transaction][recovery]")
+{
+    const size_t keyCount = 20;
+    char key[16];
+
+    size_t writesAfterFailure = 0;
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, 5);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+
+        // fail one flash write between the begin and the commit record, then keep using the partition
+        f.emu.failAfter(errDelay);
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, 1000 + i));
+        }
+        esp_err_t err = nvs_transaction_commit(handle);
+        f.emu.failAfter(UINT32_MAX);
+        if (err == ESP_OK) {
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+            break;
+        }
+        const bool committed = (err == ESP_ERR_NVS_REMOVE_FAILED);
+        const esp_err_t afterErr = nvs_set_u32(handle, "after", 12345);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == (committed ? 1000 : 0) + i);
+        }
+        if (afterErr == ESP_OK) {
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, "after", &value));
+            CHECK(value == 12345);
+            ++writesAfterFailure;
+        }
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+    CHECK(writesAfterFailure > 0);
+}
+
+TEST_CASE("Page copies transaction records together with the items left between them", "[nvs][transaction]")
+{
+    PartitionEmulationFixture f(0, 2);
+    Page page;
+    TEST_ESP_OK(page.load(&f.part, 0));
+    TEST_ESP_OK(page.writeItem<uint32_t>(1, "before", 1));
+
+    const size_t count = 5;
+    Item entries[count];
+    char key[16];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "txn%d", static_cast<int>(i));
+        entries[i] = Item(1, ItemType::U32, 1, key);
+        const uint32_t value = 100 + i;
+        memcpy(entries[i].data, &value, sizeof(value));
+        entries[i].crc32 = entries[i].calculateCrc32();
+    }
+    size_t itemIndex;
+    TEST_ESP_OK(page.writeTransaction(entries, count, itemIndex));
+    // items which are overwritten later leave erased entries between the records
+    TEST_ESP_OK(page.eraseItem<uint32_t>(1, "txn1"));
+    TEST_ESP_OK(page.eraseItem<uint32_t>(1, "txn3"));
+    TEST_ESP_OK(page.writeItem<uint32_t>(1, "after", 2));
+
+    TEST_ESP_OK(page.markFreeing());
+    Page other;
+    TEST_ESP_OK(other.load(&f.part, 1));
+    TEST_ESP_OK(page.copyItems(other));
+    CHECK(other.getUsedEntryCount() == page.getUsedEntryCount());
+
+    // the copy is active, so load() checks whether the transaction was committed
+    Page reloaded;
+    TEST_ESP_OK(reloaded.load(&f.part, 1));
+    uint32_t value;
+    TEST_ESP_OK(reloaded.readItem(1, "before", value));
+    CHECK(value == 1);
+    TEST_ESP_OK(reloaded.readItem(1, "after", value));
+    CHECK(value == 2);
+    for (size_t i = 0; i < count; i += 2) {
+        snprintf(key, sizeof(key), "txn%d", static_cast<int>(i));
+        TEST_ESP_OK(reloaded.readItem(1, key, value));
+        CHECK(value == 100 + i);
+    }
+
+    size_t commitIndex = 0;
+    Item commit;
+    TEST_ESP_OK(reloaded.findItem(Page::TXN_NS_INDEX, ItemType::U32, Page::TXN_RECORD_KEY, commitIndex, commit, Page::TXN_COMMIT_CHUNK));
+    size_t beginIndex;
+    TEST_ESP_OK(reloaded.findTransactionBegin(commitIndex, commit, beginIndex));
+    CHECK(commitIndex - beginIndex == 4);
+}
+
+TEST_CASE("nvs transaction records moved by garbage collection don't erase other items", "[nvs][transaction][recovery]")
+{
+    const size_t keyCount = 20;
+    const size_t newCount = 5;
+    const size_t otherCount = 30;
+    char key[16];
+    char str[64];
+
+    auto setOthers = [&](nvs_handle_t handle, size_t round) {
+        for (size_t i = 0; i < otherCount; ++i) {
+            snprintf(key, sizeof(key), "other%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of key %d", static_cast<int>(round), static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_str(handle, key, str));
+        }
+    };
 
-                    auto err = nvs_set_str(handle, keys[index], buf);
-                    if (err == ESP_ERR_FLASH_OP_FAIL) {
-                        return err;
-                    }
-                    if (err == ESP_ERR_NVS_REMOVE_FAILED) {
-                        written[index] = true;
-                        strncpy(reinterpret_cast<char*>(values[index]), buf, strBufLen);
-                        return ESP_ERR_FLASH_OP_FAIL;
-                    }
-                    REQUIRE(err == ESP_OK);
-                    written[index] = true;
-                    strncpy(reinterpret_cast<char*>(values[index]), buf, strBufLen);
-                    break;
-                }
+    size_t leftovers = 0;
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, 5);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
 
-                case ItemType::BLOB:
-                {
-                    uint32_t blobBufLen = 0;
-                    if(strncmp(keys[index],"singlepage", sizeof("singlepage")) == 0) {
-                       blobBufLen = smallBlobLen ;
-                    } else {
-                       blobBufLen = largeBlobLen ;
-                    }
-                    uint8_t buf[blobBufLen];
-                    memset(buf, 0, blobBufLen);
-                    size_t blobLen = gen() % blobBufLen;
-                    std::generate_n(buf, blobLen, [&]() -> uint8_t {
-                        return static_cast<uint8_t>(gen() % 256);
-                    });
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+        // fill the first page, so that the old values and the transaction are on different pages
+        for (size_t i = 0; i < 100; ++i) {
+            snprintf(key, sizeof(key), "fill%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u8(handle, key, i));
+        }
 
-                    auto err = nvs_set_blob(handle, keys[index], buf, blobLen);
-                    if (err == ESP_ERR_FLASH_OP_FAIL) {
-                        return err;
-                    }
-                    if (err == ESP_ERR_NVS_REMOVE_FAILED) {
-                        written[index] = true;
-                        memcpy(reinterpret_cast<uint8_t*>(values[index]), buf, blobBufLen);
-                        return ESP_ERR_FLASH_OP_FAIL;
-                    }
-                    REQUIRE(err == ESP_OK);
-                    written[index] = true;
-                    memcpy(reinterpret_cast<char*>(values[index]), buf, blobBufLen);
-                    break;
-                }
+        // interrupt the transaction after its commit point, so that its records stay on the page
+        f.emu.failAfter(errDelay);
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, 1000 + i));
+        }
+        for (size_t i = 0; i < newCount; ++i) {
+            snprintf(key, sizeof(key), "new%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, 1000 + i));
+        }
+        esp_err_t err = nvs_transaction_commit(handle);
+        f.emu.failAfter(UINT32_MAX);
+        if (err == ESP_OK) {
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+            break;
+        }
+        // the page of the transaction must still be writable, i.e. erasing an old value on another page failed
+        if (err != ESP_ERR_NVS_REMOVE_FAILED || nvs_set_u32(handle, "probe", 0) != ESP_OK) {
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+            continue;
+        }
 
-                default:
-                    assert(0);
-            }
-            return ESP_OK;
-        };
+        // leave erased entries between the records, then let garbage collection move them to another page.
+        // Keys without old values are overwritten, an old value on the page on which erasing failed
+        // would be found again after init.
+        for (size_t i = 0; i < newCount; ++i) {
+            snprintf(key, sizeof(key), "new%d", static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, 2000 + i));
+        }
+        for (size_t round = 0; round < 8; ++round) {
+            setOthers(handle, round);
+        }
+        do {
+            err = nvs_gc_step(NULL, 8);
+        } while (err == ESP_ERR_NOT_FINISHED);
+        TEST_ESP_OK(err);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == 1000 + i);
+        }
+        for (size_t i = 0; i < newCount; ++i) {
+            snprintf(key, sizeof(key), "new%d", static_cast<int>(i));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == 2000 + i);
+        }
+        for (size_t i = 0; i < otherCount; ++i) {
+            snprintf(key, sizeof(key), "other%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of key %d", 7, static_cast<int>(i));
+            char buf[64];
+            size_t len = sizeof(buf);
+            TEST_ESP_OK(nvs_get_str(handle, key, buf, &len));
+            CHECK(strcmp(buf, str) == 0);
+        }
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+        ++leftovers;
+    }
+    CHECK(leftovers > 0);
+}
 
-        for (; count != 0; --count) {
-            size_t index = gen() % (nKeys);
-            switch (gen() % 3) {
-                case 0:  // read, 1/3
-                    if (randomRead(index) == ESP_ERR_FLASH_OP_FAIL) {
-                        return ESP_ERR_FLASH_OP_FAIL;
-                    }
-                    break;
+static uint8_t streamBlobByte(size_t pos, uint8_t seed)
+{
+    return static_cast<uint8_t>(pos * 7 + (pos >> 8) + seed);
+}
 
-                default: // write, 2/3
-                    if (randomWrite(index) == ESP_ERR_FLASH_OP_FAIL) {
-                        return ESP_ERR_FLASH_OP_FAIL;
-                    }
-                    break;
-            }
+static void appendStreamBlob(nvs_handle_t handle, size_t size, uint8_t seed, size_t partSize)
+{
+    uint8_t part[1024];
+    REQUIRE(partSize <= sizeof(part));
+    for (size_t pos = 0; pos < size; ) {
+        size_t len = std::min(partSize, size - pos);
+        for (size_t i = 0; i < len; ++i) {
+            part[i] = streamBlobByte(pos + i, seed);
         }
-        return ESP_OK;
+        TEST_ESP_OK(nvs_blob_append(handle, part, len));
+        pos += len;
     }
+}
 
-    esp_err_t handleExternalWriteAtIndex(uint8_t index, const void* value, const size_t len ) {
-        if(index == 9) {  /* This is only done for small-page blobs for now*/
-            if(len > smallBlobLen) {
-                return ESP_FAIL;
+static bool checkStreamBlob(nvs_handle_t handle, const char* key, size_t size, uint8_t seed)
+{
+    size_t storedSize = 0;
+    if (nvs_get_blob(handle, key, NULL, &storedSize) != ESP_OK || storedSize != size) {
+        return false;
+    }
+    uint8_t part[1500];
+    for (size_t pos = 0; pos < size; pos += sizeof(part)) {
+        size_t len = std::min(sizeof(part), size - pos);
+        if (nvs_blob_read_at(handle, key, pos, part, len) != ESP_OK) {
+            return false;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            if (part[i] != streamBlobByte(pos + i, seed)) {
+                return false;
             }
-            memcpy(v10, value, len);
-            written[index] = true;
-            return ESP_OK;
-        } else {
-            return ESP_FAIL;
         }
     }
-};
+    return true;
+}
 
-TEST_CASE("monkey test", "[nvs][monkey]")
+TEST_CASE("nvs blob written in parts can be read in ranges", "[nvs][blob_stream]")
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    uint32_t seed = 3;
-    gen.seed(seed);
+    // the blob is much larger than the chunk buffer of the writer and than any buffer used here
+    const size_t blobSize = 100000;
+    const uint8_t seed = 3;
+    PartitionEmulationFixture f(0, 40);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 40));
 
-    PartitionEmulationFixture f(0, 10);
-    f.emu.randomize(seed);
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "before", 1));
+    TEST_ESP_OK(nvs_blob_open_write(handle, "stream"));
+    appendStreamBlob(handle, blobSize, seed, 997);
+
+    // the blob isn't visible before it is finalized
+    size_t size = 0;
+    TEST_ESP_ERR(nvs_get_blob(handle, "stream", NULL, &size), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_blob_finalize(handle));
+    TEST_ESP_ERR(nvs_blob_finalize(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_OK(nvs_set_i32(handle, "after", 2));
+
+    CHECK(checkStreamBlob(handle, "stream", blobSize, seed));
+
+    // ranges at random offsets, including ones crossing chunk boundaries
+    srand(42);
+    std::vector<uint8_t> part(5000);
+    for (int i = 0; i < 200; ++i) {
+        size_t offset = rand() % blobSize;
+        size_t len = std::min(static_cast<size_t>(rand() % part.size()), blobSize - offset);
+        TEST_ESP_OK(nvs_blob_read_at(handle, "stream", offset, part.data(), len));
+        for (size_t j = 0; j < len; ++j) {
+            REQUIRE(part[j] == streamBlobByte(offset + j, seed));
+        }
+    }
+    TEST_ESP_OK(nvs_blob_read_at(handle, "stream", blobSize, part.data(), 0));
+    TEST_ESP_ERR(nvs_blob_read_at(handle, "stream", blobSize - 10, part.data(), 11), ESP_ERR_NVS_INVALID_LENGTH);
+    TEST_ESP_ERR(nvs_blob_read_at(handle, "stream", blobSize + 1, part.data(), 0), ESP_ERR_NVS_INVALID_LENGTH);
+    TEST_ESP_ERR(nvs_blob_read_at(handle, "missing", 0, part.data(), 1), ESP_ERR_NVS_NOT_FOUND);
+
+    // the blob is stored in the same format as blobs set with nvs_set_blob
+    std::vector<uint8_t> whole(blobSize);
+    size = whole.size();
+    f.emu.clearStats();
+    TEST_ESP_OK(nvs_get_blob(handle, "stream", whole.data(), &size));
+    size_t wholeReadBytes = f.emu.getReadBytes();
+    for (size_t i = 0; i < blobSize; ++i) {
+        REQUIRE(whole[i] == streamBlobByte(i, seed));
+    }
+    // only the last chunk is read, besides the chunk headers
     f.emu.clearStats();
+    TEST_ESP_OK(nvs_blob_read_at(handle, "stream", blobSize - 16, part.data(), 16));
+    size_t rangeReadBytes = f.emu.getReadBytes();
+    CHECK(rangeReadBytes * 10 < wholeReadBytes);
+    s_perf << "Bytes read from flash for the last 16 bytes of a " << blobSize << " byte blob: "
+           << wholeReadBytes << " with nvs_get_blob, " << rangeReadBytes << " with nvs_blob_read_at" << std::endl;
+
+    // blobs set with nvs_set_blob can be read in ranges as well
+    TEST_ESP_OK(nvs_set_blob(handle, "small", whole.data(), 300));
+    TEST_ESP_OK(nvs_blob_read_at(handle, "small", 100, part.data(), 200));
+    CHECK(memcmp(part.data(), whole.data() + 100, 200) == 0);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 
-    const uint32_t NVS_FLASH_SECTOR = 2;
-    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 8;
-    f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+    // the blob survives re-initialization
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 40));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    CHECK(checkStreamBlob(handle, "stream", blobSize, seed));
+    int32_t value;
+    TEST_ESP_OK(nvs_get_i32(handle, "before", &value));
+    TEST_ESP_OK(nvs_get_i32(handle, "after", &value));
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
 
-    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part,
-            NVS_FLASH_SECTOR,
-            NVS_FLASH_SECTOR_COUNT_MIN));
+TEST_CASE("nvs blob written in parts replaces the previous value when it is finalized", "[nvs][blob_stream]")
+{
+    PartitionEmulationFixture f(0, 12);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 12));
 
     nvs_handle_t handle;
     TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
-    RandomTest test;
-    size_t count = 1000;
-    CHECK(test.doRandomThings(handle, gen, count) == ESP_OK);
+    TEST_ESP_ERR(nvs_blob_append(handle, "x", 1), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_finalize(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_open_write(handle, "a_very_long_key_name"), ESP_ERR_NVS_KEY_TOO_LONG);
+
+    TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+    appendStreamBlob(handle, 6000, 1, 1000);
+    TEST_ESP_OK(nvs_blob_finalize(handle));
+    CHECK(checkStreamBlob(handle, "blob", 6000, 1));
+
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    const size_t usedEntries = stats.used_entries;
+
+    // aborting keeps the previous value and erases the chunks written so far
+    TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+    TEST_ESP_ERR(nvs_blob_open_write(handle, "other"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE);
+    appendStreamBlob(handle, 10000, 2, 1000);
+    CHECK(checkStreamBlob(handle, "blob", 6000, 1));
+    TEST_ESP_OK(nvs_blob_abort(handle));
+    CHECK(checkStreamBlob(handle, "blob", 6000, 1));
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == usedEntries);
+
+    // finalizing replaces it, alternating between both blob versions
+    for (uint8_t seed = 2; seed < 6; ++seed) {
+        size_t size = 3000 + seed * 1500;
+        TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+        appendStreamBlob(handle, size, seed, 1000);
+        TEST_ESP_OK(nvs_blob_finalize(handle));
+        CHECK(checkStreamBlob(handle, "blob", size, seed));
+    }
 
-    s_perf << "Monkey test: nErase=" << f.emu.getEraseOps() << " nWrite=" << f.emu.getWriteOps() << std::endl;
+    // an empty blob
+    TEST_ESP_OK(nvs_blob_open_write(handle, "empty"));
+    TEST_ESP_OK(nvs_blob_finalize(handle));
+    size_t size = 1;
+    TEST_ESP_OK(nvs_get_blob(handle, "empty", NULL, &size));
+    CHECK(size == 0);
+
+    // closing the handle discards an open blob write
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    const size_t usedEntriesBeforeClose = stats.used_entries;
+    TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+    appendStreamBlob(handle, 5000, 9, 1000);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == usedEntriesBeforeClose);
+
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    CHECK(checkStreamBlob(handle, "blob", 3000 + 5 * 1500, 5));
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_ERR(nvs_blob_open_write(handle, "blob"), ESP_ERR_NOT_SUPPORTED);
+    TEST_ESP_OK(nvs_transaction_abort(handle));
+    nvs_close(handle);
 
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_blob_open_write(handle, "blob"), ESP_ERR_NVS_READ_ONLY);
+    nvs_close(handle);
     TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 }
 
-TEST_CASE("test recovery from sudden poweroff", "[long][nvs][recovery][monkey]")
+TEST_CASE("nvs blob written in parts keeps the previous value if power is lost", "[nvs][blob_stream][recovery]")
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    uint32_t seed = 3;
-    gen.seed(seed);
-    const size_t iter_count = 2000;
-
-    size_t totalOps = 0;
-    int lastPercent = -1;
+    const size_t oldSize = 5000;
+    const size_t newSize = 12000;
+    size_t failurePoints = 0;
     for (uint32_t errDelay = 0; ; ++errDelay) {
         INFO(errDelay);
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
 
-        PartitionEmulationFixture f(0, 10);
-        const uint32_t NVS_FLASH_SECTOR = 2;
-        const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 8;
-        f.emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+        appendStreamBlob(handle, oldSize, 1, 1000);
+        TEST_ESP_OK(nvs_blob_finalize(handle));
 
-        f.emu.randomize(seed);
-        f.emu.clearStats();
         f.emu.failAfter(errDelay);
-        RandomTest test;
-
-        if (totalOps != 0) {
-            int percent = errDelay * 100 / totalOps;
-            if (percent > lastPercent) {
-                printf("%d/%d (%d%%)\r\n", errDelay, static_cast<int>(totalOps), percent);
-                lastPercent = percent;
+        esp_err_t err = nvs_blob_open_write(handle, "blob");
+        uint8_t part[1000];
+        for (size_t pos = 0; err == ESP_OK && pos < newSize; pos += sizeof(part)) {
+            for (size_t i = 0; i < sizeof(part); ++i) {
+                part[i] = streamBlobByte(pos + i, 2);
             }
+            err = nvs_blob_append(handle, part, sizeof(part));
+        }
+        if (err == ESP_OK) {
+            err = nvs_blob_finalize(handle);
+        }
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+        f.emu.failAfter(UINT32_MAX);
+
+        // after a failure, the blob is either complete or has its previous value
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        if (err == ESP_OK) {
+            CHECK(checkStreamBlob(handle, "blob", newSize, 2));
+        } else {
+            CHECK((checkStreamBlob(handle, "blob", oldSize, 1) || checkStreamBlob(handle, "blob", newSize, 2)));
         }
 
+        // the partition must still be writable after recovery
+        TEST_ESP_OK(nvs_blob_open_write(handle, "blob"));
+        appendStreamBlob(handle, newSize, 3, 1000);
+        TEST_ESP_OK(nvs_blob_finalize(handle));
+        CHECK(checkStreamBlob(handle, "blob", newSize, 3));
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        if (err == ESP_OK) {
+            break;
+        }
+        ++failurePoints;
+    }
+    s_perf << "Blob write in parts checked at " << failurePoints << " power loss points" << std::endl;
+}
 
+TEST_CASE("nvs_gc_step keeps free pages, so that writes don't have to copy and erase pages", "[nvs][gc]")
+{
+    const size_t keyCount = 60;
+    const size_t writeCount = 3000;
+    char key[16];
+    char str[64];
+    size_t maxLatency[2];
+    size_t p99Latency[2];
+    size_t foregroundErases[2];
+
+    for (int useGc = 0; useGc < 2; ++useGc) {
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
         nvs_handle_t handle;
-        size_t count = iter_count;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
 
-        if (NVSPartitionManager::get_instance()->init_custom(&f.part,
-                NVS_FLASH_SECTOR,
-                NVS_FLASH_SECTOR_COUNT_MIN) == ESP_OK) {
-            auto res = ESP_ERR_FLASH_OP_FAIL;
-            if (nvs_open("namespace1", NVS_READWRITE, &handle) == ESP_OK) {
-                res = test.doRandomThings(handle, gen, count);
-                nvs_close(handle);
+        std::vector<size_t> latencies;
+        foregroundErases[useGc] = 0;
+        for (size_t i = 0; i < writeCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i % keyCount));
+            snprintf(str, sizeof(str), "value %d of a string which takes a few entries", static_cast<int>(i));
+            size_t time = f.emu.getTotalTime();
+            size_t erases = f.emu.getEraseOps();
+            TEST_ESP_OK(nvs_set_str(handle, key, str));
+            latencies.push_back(f.emu.getTotalTime() - time);
+            foregroundErases[useGc] += f.emu.getEraseOps() - erases;
+
+            // one step in between writes, as if it was called from an idle task
+            if (useGc) {
+                esp_err_t err = nvs_gc_step(NULL, 16);
+                CHECK((err == ESP_OK || err == ESP_ERR_NOT_FINISHED));
             }
+        }
 
-            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
-            if (res != ESP_ERR_FLASH_OP_FAIL) {
-                // This means we got to the end without an error due to f.emu.failAfter(), therefore errDelay
-                // is high enough that we're not triggering it any more, therefore we're done
-                break;
-            }
+        for (size_t i = writeCount - keyCount; i < writeCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i % keyCount));
+            snprintf(str, sizeof(str), "value %d of a string which takes a few entries", static_cast<int>(i));
+            char buf[64];
+            size_t len = sizeof(buf);
+            TEST_ESP_OK(nvs_get_str(handle, key, buf, &len));
+            CHECK(strcmp(buf, str) == 0);
         }
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 
-        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part,
-                NVS_FLASH_SECTOR,
-                NVS_FLASH_SECTOR_COUNT_MIN));
+        std::sort(latencies.begin(), latencies.end());
+        maxLatency[useGc] = latencies.back();
+        p99Latency[useGc] = latencies[latencies.size() * 99 / 100];
+        s_perf << "Write latency (" << writeCount << " strings, " << (useGc ? "with" : "without")
+               << " nvs_gc_step): median " << latencies[latencies.size() / 2] << " us, 99% "
+               << p99Latency[useGc] << " us, max " << maxLatency[useGc] << " us, "
+               << foregroundErases[useGc] << " page erases" << std::endl;
+    }
+
+    CHECK(foregroundErases[0] > 0);
+    CHECK(foregroundErases[1] == 0);
+    CHECK(maxLatency[1] * 4 < maxLatency[0]);
+}
+
+TEST_CASE("nvs_gc_step doesn't lose values if power is lost", "[nvs][gc][recovery]")
+{
+    const size_t keyCount = 40;
+    char key[16];
+    char str[64];
+
+    auto setValues = [&](nvs_handle_t handle, size_t round) {
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of key %d", static_cast<int>(round), static_cast<int>(i));
+            TEST_ESP_OK(nvs_set_str(handle, key, str));
+        }
+    };
+
+    size_t failurePoints = 0;
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, 5);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+        nvs_handle_t handle;
         TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
-        auto res = test.doRandomThings(handle, gen, count);
-        if (res != ESP_OK) {
-            nvs_dump(NVS_DEFAULT_PART_NAME);
-            CHECK(0);
+        // leave erased entries on full pages, each of which also holds a value which is still used
+        for (size_t round = 0; round < 6; ++round) {
+            snprintf(key, sizeof(key), "keep%d", static_cast<int>(round));
+            TEST_ESP_OK(nvs_set_u32(handle, key, round));
+            setValues(handle, round);
         }
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", str, sizeof(str)));
+
+        f.emu.failAfter(errDelay);
+        esp_err_t gcErr;
+        do {
+            gcErr = nvs_gc_step(NULL, 8);
+        } while (gcErr == ESP_ERR_NOT_FINISHED);
         nvs_close(handle);
-        totalOps = f.emu.getEraseOps() + f.emu.getWriteBytes() / 4;
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+        f.emu.failAfter(UINT32_MAX);
+
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            snprintf(str, sizeof(str), "value %d of key %d", 5, static_cast<int>(i));
+            char buf[64];
+            size_t len = sizeof(buf);
+            TEST_ESP_OK(nvs_get_str(handle, key, buf, &len));
+            CHECK(strcmp(buf, str) == 0);
+        }
+        size_t len = sizeof(str);
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", str, &len));
+        for (size_t round = 0; round < 6; ++round) {
+            snprintf(key, sizeof(key), "keep%d", static_cast<int>(round));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == round);
+        }
 
+        // garbage collection and writes continue after recovery
+        esp_err_t err;
+        do {
+            err = nvs_gc_step(NULL, 8);
+        } while (err == ESP_ERR_NOT_FINISHED);
+        TEST_ESP_OK(err);
+        setValues(handle, 6);
+        nvs_close(handle);
         TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        if (gcErr == ESP_OK) {
+            break;
+        }
+        ++failurePoints;
     }
+    CHECK(failurePoints > 10);
+    s_perf << "Incremental garbage collection checked at " << failurePoints << " power loss points" << std::endl;
 }
 
 TEST_CASE("test for memory leaks in open/set", "[leaks]")
@@ -3296,6 +4862,56 @@ TEST_CASE("test nvs apis with encryption enabled", "[nvs]")
 
 }
 
+TEST_CASE("benchmark blob read on plain and encrypted partitions", "[nvs][long]")
+{
+    const uint32_t sectorCount = 6;
+    const size_t blobSize = 1900;
+    const size_t rounds = 200;
+    nvs_sec_cfg_t xts_cfg;
+    for(int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+    uint8_t blob[blobSize];
+    uint8_t readBlob[blobSize];
+    for (size_t i = 0; i < blobSize; ++i) {
+        blob[i] = i;
+    }
+
+    const char* names[] = {"plain", "encrypted", "encrypted with page cache"};
+    for (int mode = 0; mode < 3; ++mode) {
+        PartitionEmulationFixture plainFixture(0, sectorCount);
+        EncryptedPartitionFixture encryptedFixture(&xts_cfg, 0, sectorCount);
+        SpiFlashEmulator& emu = (mode == 0) ? plainFixture.emu : encryptedFixture.emu;
+        Partition* part = &plainFixture.part;
+        if (mode > 0) {
+            TEST_ESP_OK(encryptedFixture.part.set_page_cache_enabled(mode == 2));
+            part = &encryptedFixture.part;
+        }
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(part, 0, sectorCount));
+
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, blobSize));
+
+        emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            size_t size = blobSize;
+            TEST_ESP_OK(nvs_get_blob(handle, "blob", readBlob, &size));
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        CHECK(memcmp(blob, readBlob, blobSize) == 0);
+
+        s_perf << "Blob read (" << blobSize << " bytes, " << names[mode] << "): "
+               << (elapsed > 0 ? rounds * blobSize * 1000 / elapsed : 0) << " kB/s, "
+               << emu.getReadOps() / rounds << " flash reads per blob" << std::endl;
+
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+}
+
 TEST_CASE("test nvs apis for nvs partition generator utility with encryption enabled", "[nvs_part_gen]")
 {
     int status;
@@ -53,3 +53,81 @@ TEST_CASE("encrypted partition write size must be mod item size", "[nvs]")
     CHECK(fix.part.write(0, foo, sizeof (foo)) == ESP_OK);
     CHECK(fix.part.write(0, foo, sizeof (foo) * 2) == ESP_OK);
 }
+
+TEST_CASE("encrypted partition reads several entries at once", "[nvs]")
+{
+    uint8_t data[4 * 32];
+    uint8_t readData[sizeof(data)];
+    nvs_sec_cfg_t xts_cfg;
+    for(int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i;
+    }
+    EncryptedPartitionFixture fix(&xts_cfg);
+    CHECK(fix.part.set_page_cache_enabled(false) == ESP_OK);
+
+    CHECK(fix.part.write(64, data, sizeof(data)) == ESP_OK);
+    CHECK(fix.part.read(64, readData, 0) == ESP_ERR_INVALID_SIZE);
+
+    fix.emu.clearStats();
+    CHECK(fix.part.read(64, readData, sizeof(readData)) == ESP_OK);
+    CHECK(fix.emu.getReadOps() == 1);
+    CHECK(memcmp(data, readData, sizeof(data)) == 0);
+
+    memset(readData, 0, sizeof(readData));
+    for (size_t i = 0; i < sizeof(readData); i += 32) {
+        CHECK(fix.part.read(64 + i, readData + i, 32) == ESP_OK);
+    }
+    CHECK(memcmp(data, readData, sizeof(data)) == 0);
+}
+
+TEST_CASE("encrypted partition page cache follows writes and erases", "[nvs]")
+{
+    uint8_t data[2 * 32];
+    uint8_t readData[sizeof(data)];
+    nvs_sec_cfg_t xts_cfg;
+    for(int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+    memset(data, 0xaa, sizeof(data));
+    EncryptedPartitionFixture fix(&xts_cfg, 0, 2);
+    CHECK(fix.part.set_page_cache_enabled(true) == ESP_OK);
+    CHECK(fix.part.write(64, data, sizeof(data)) == ESP_OK);
+
+    // the first read loads the whole sector, further reads of it don't access flash
+    fix.emu.clearStats();
+    CHECK(fix.part.read(64, readData, sizeof(readData)) == ESP_OK);
+    CHECK(memcmp(data, readData, sizeof(data)) == 0);
+    CHECK(fix.part.read(96, readData, 32) == ESP_OK);
+    CHECK(fix.emu.getReadOps() == 1);
+
+    // written entries are updated in the cache
+    memset(data, 0x55, 32);
+    CHECK(fix.part.write(128, data, 32) == ESP_OK);
+    CHECK(fix.part.read(128, readData, 32) == ESP_OK);
+    CHECK(memcmp(data, readData, 32) == 0);
+    CHECK(fix.emu.getReadOps() == 1);
+
+    // entries written raw are read from flash again
+    uint32_t raw = 0;
+    CHECK(fix.part.write_raw(64, &raw, sizeof(raw)) == ESP_OK);
+    CHECK(fix.part.read(64, readData, 32) == ESP_OK);
+    CHECK(fix.emu.getReadOps() == 2);
+    CHECK(fix.part.read(96, readData, 32) == ESP_OK);
+    CHECK(fix.emu.getReadOps() == 2);
+
+    // reading another sector replaces the cached one
+    CHECK(fix.part.read(SPI_FLASH_SEC_SIZE, readData, 32) == ESP_OK);
+    CHECK(fix.emu.getReadOps() == 3);
+
+    CHECK(fix.part.erase_range(SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    memset(data, 0x33, 32);
+    CHECK(fix.part.write(SPI_FLASH_SEC_SIZE, data, 32) == ESP_OK);
+    CHECK(fix.part.read(SPI_FLASH_SEC_SIZE, readData, 32) == ESP_OK);
+    CHECK(memcmp(data, readData, 32) == 0);
+    CHECK(fix.emu.getReadOps() == 4);
+}